@@ -0,0 +1,663 @@
+// `bench.c` - lexer benchmark suite over generated corpora
+//
+// Runs every benchmark on every corpus mix in a forked child, so the peak RSS
+// read back with wait4 belongs to that benchmark alone, and prints one JSON
+// object per line for regression tracking:
+//
+//   lex-switch, lex-dfa  lexerGetNextToken loop over resident contents
+//   cursor               tokenCursorAdvance with one token of lookahead
+//   symbols              lexing with -s symbol table rows for every token
+//   end-to-end           compileRensFile of the corpus written to a file, -S
+//   relex                lexerRelex of one byte edits spread over the corpus,
+//                        made and undone (the first full lex is not timed)
+//   parse                parseTokens into a syntax tree (lexing is not
+//                        timed), tree_bytes counts node and extra words
+//   vm-goto, vm-switch   vmRun of a rehearse loop of size iterations on the
+//                        computed goto and the switch loop (compiling is not
+//                        timed), instructions_per_s from one counted run.
+//                        Run once on the "loop" program, not per mix.
+//
+// Usage: renaisscript_bench [--size=<bytes>[k|m]] [--mix=<mix>|all]
+//                           [--bench=<benchmark>|all] [--rounds=<n>]
+//                           [--seed=<n>] [--write=<file.rens>]
+//
+// --write stores the generated corpus of one mix instead of benchmarking.
+
+#include "allocstat.h" // allocation counters
+#include "compile.h"   // compileRensFile, CompileOptions
+#include "corpusgen.h" // corpusGenerate
+#include "cursor.h"    // TokenCursor
+#include "fileread.h"  // StringOutput
+#include "lexer.h"     // lexical analyzer and tokens
+#include "parser.h"    // parseTokens, Ast
+#include "vm.h"        // vmRun, VmProgram
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef enum BenchKindEnum {
+    BENCH_LEX_SWITCH,
+    BENCH_LEX_DFA,
+    BENCH_CURSOR,
+    BENCH_SYMBOLS,
+    BENCH_END_TO_END,
+    BENCH_RELEX,
+    BENCH_PARSE,
+    BENCH_VM_GOTO,
+    BENCH_VM_SWITCH,
+    BENCH_KIND_COUNT,
+} BenchKind;
+
+static const char *const bench_names[BENCH_KIND_COUNT] = {
+    [BENCH_LEX_SWITCH] = "lex-switch",
+    [BENCH_LEX_DFA] = "lex-dfa",
+    [BENCH_CURSOR] = "cursor",
+    [BENCH_SYMBOLS] = "symbols",
+    [BENCH_END_TO_END] = "end-to-end",
+    [BENCH_RELEX] = "relex",
+    [BENCH_PARSE] = "parse",
+    [BENCH_VM_GOTO] = "vm-goto",
+    [BENCH_VM_SWITCH] = "vm-switch",
+};
+
+#define BENCH_RELEX_EDITS 256 // edits per relex round, each undone again
+
+// one generated corpus, resident and written to path
+typedef struct BenchCorpusStruct {
+    CorpusMix mix;
+    const char *name; // mix name, or "loop" for the vm program
+    char *contents;
+    unsigned long length;
+    unsigned long tokens;
+    char path[64];
+} BenchCorpus;
+
+// measurements sent back from the child process
+typedef struct BenchResultStruct {
+    int status;
+    double seconds; // fastest round
+    AllocStat allocs; // per round
+    unsigned long tree_bytes; // syntax tree in use, 0 when none is built
+    unsigned long instructions; // executed per run, 0 when nothing runs
+} BenchResult;
+
+// long options only, values past the char range
+enum {
+    OPT_SIZE = 256,
+    OPT_MIX,
+    OPT_BENCH,
+    OPT_ROUNDS,
+    OPT_SEED,
+    OPT_WRITE,
+};
+
+static const struct option long_options[] = {
+    {"size", required_argument, NULL, OPT_SIZE},
+    {"mix", required_argument, NULL, OPT_MIX},
+    {"bench", required_argument, NULL, OPT_BENCH},
+    {"rounds", required_argument, NULL, OPT_ROUNDS},
+    {"seed", required_argument, NULL, OPT_SEED},
+    {"write", required_argument, NULL, OPT_WRITE},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+};
+
+static int benchCorpusCreate(BenchCorpus *corpus, CorpusMix mix,
+                             unsigned long size, unsigned long seed);
+static int benchProgramCreate(BenchCorpus *program, unsigned long size);
+static void benchCorpusCleanup(BenchCorpus *corpus);
+static int benchMeasure(BenchKind kind, const BenchCorpus *corpus,
+                        unsigned int rounds, unsigned long seed);
+static void benchRunChild(BenchKind kind, const BenchCorpus *corpus,
+                          unsigned int rounds, BenchResult *result);
+static int benchRound(BenchKind kind, const BenchCorpus *corpus,
+                      double *start, BenchResult *result);
+static int benchVmRound(BenchKind kind, const BenchCorpus *program,
+                        double *start, BenchResult *result);
+static int benchWriteCorpus(const char *filename, CorpusMix mix,
+                            unsigned long size, unsigned long seed);
+static int parseSize(const char *text, unsigned long *size);
+static double benchNow(void);
+static void displayBenchHelp(void);
+
+int main(int argc, char *argv[]) {
+    unsigned long size = 4UL << 20;
+    unsigned long seed = 1;
+    unsigned int rounds = 5;
+    int mix = -1;  // every mix
+    int kind = -1;  // every benchmark
+    const char *write_file = NULL;
+
+    opterr = 0;
+    int option;
+    while ((option = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        char *end = NULL;
+        switch (option) {
+        case OPT_SIZE:
+            if (parseSize(optarg, &size)) {
+                printf("ERROR: invalid corpus size '%s' [BENCH_SIZE_ERROR]\n",
+                       optarg);
+                return 1;
+            }
+            break;
+        case OPT_MIX:
+            if (strcmp(optarg, "all") != 0) {
+                CorpusMix found;
+                if (corpusMixFromName(optarg, &found)) {
+                    printf("ERROR: unknown corpus mix '%s' [BENCH_MIX_ERROR]\n",
+                           optarg);
+                    return 1;
+                }
+                mix = (int)found;
+            }
+            break;
+        case OPT_BENCH:
+            kind = -1;
+            for (int i = 0; i < BENCH_KIND_COUNT; i++) {
+                if (strcmp(optarg, bench_names[i]) == 0) {
+                    kind = i;
+                }
+            }
+            if (kind < 0 && strcmp(optarg, "all") != 0) {
+                printf("ERROR: unknown benchmark '%s' [BENCH_NAME_ERROR]\n",
+                       optarg);
+                return 1;
+            }
+            break;
+        case OPT_ROUNDS:
+            rounds = (unsigned int)strtoul(optarg, &end, 10);
+            if (*optarg == '\0' || *end != '\0' || rounds == 0) {
+                printf("ERROR: invalid round count '%s' [BENCH_ROUNDS_ERROR]\n",
+                       optarg);
+                return 1;
+            }
+            break;
+        case OPT_SEED:
+            seed = strtoul(optarg, &end, 10);
+            if (*optarg == '\0' || *end != '\0') {
+                printf("ERROR: invalid seed '%s' [BENCH_SEED_ERROR]\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_WRITE:
+            write_file = optarg;
+            break;
+        case 'h':
+            displayBenchHelp();
+            return 0;
+        default:
+            printf("ERROR: unknown option '%s' [OPTION_ERROR]\n",
+                   argv[optind - 1]);
+            displayBenchHelp();
+            return 1;
+        }
+    }
+
+    if (write_file != NULL) {
+        return benchWriteCorpus(write_file, mix < 0 ? CORPUS_MIXED : mix,
+                                size, seed);
+    }
+
+    int return_error = 0;
+    for (int m = 0; m < CORPUS_MIX_COUNT && !return_error; m++) {
+        if (mix >= 0 && m != mix) {
+            continue;
+        }
+
+        BenchCorpus corpus;
+        if (benchCorpusCreate(&corpus, (CorpusMix)m, size, seed)) {
+            return 1;
+        }
+        for (int k = 0; k < BENCH_VM_GOTO; k++) {
+            if (kind < 0 || k == kind) {
+                return_error |=
+                    benchMeasure((BenchKind)k, &corpus, rounds, seed);
+            }
+        }
+        benchCorpusCleanup(&corpus);
+    }
+
+    // the vm runs one program whatever the mixes
+    if (!return_error && (kind < 0 || kind >= BENCH_VM_GOTO)) {
+        BenchCorpus program;
+        if (benchProgramCreate(&program, size)) {
+            return 1;
+        }
+        for (int k = BENCH_VM_GOTO; k < BENCH_KIND_COUNT; k++) {
+            if (kind < 0 || k == kind) {
+                return_error |=
+                    benchMeasure((BenchKind)k, &program, rounds, seed);
+            }
+        }
+        benchCorpusCleanup(&program);
+    }
+
+    return return_error;
+}
+
+// generate the corpus, count its tokens and write it to a temporary file
+static int benchCorpusCreate(BenchCorpus *corpus, CorpusMix mix,
+                             unsigned long size, unsigned long seed) {
+    memset(corpus, 0, sizeof(BenchCorpus));
+    corpus->mix = mix;
+    corpus->name = corpus_mix_names[mix];
+    corpus->contents = corpusGenerate(mix, size, seed, &corpus->length);
+    if (corpus->contents == NULL) {
+        printf("ERROR: corpus memory allocation failure "
+               "[BENCH_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+
+    Lexer *lexer = initLexer(corpus->contents, corpus->length);
+    while (lexerGetNextToken(lexer).type != TK_EOF) {
+        corpus->tokens++;
+    }
+    lexerCleanUp(&lexer);
+
+    // compileRensFile reads files only, by extension
+    const char *directory = getenv("TMPDIR");
+    snprintf(corpus->path, sizeof(corpus->path), "%s/rensbenchXXXXXX.rens",
+             directory != NULL && strlen(directory) < 32 ? directory : "/tmp");
+    int file_desc = mkstemps(corpus->path, 5);
+    FILE *file_ptr = file_desc >= 0 ? fdopen(file_desc, "w") : NULL;
+    if (file_ptr == NULL ||
+        fwrite(corpus->contents, 1, corpus->length, file_ptr) !=
+            corpus->length ||
+        fclose(file_ptr) != 0) {
+        printf("ERROR: cannot write corpus file '%s' [BENCH_FILE_ERROR]\n",
+               corpus->path);
+        free(corpus->contents);
+        return 1;
+    }
+    return 0;
+}
+
+// a tight rehearse loop of size iterations, like test/iterator.rn
+static int benchProgramCreate(BenchCorpus *program, unsigned long size) {
+    static const char *const format =
+        "# rehearse loop of the vm benchmarks\n"
+        "maketh count sum = 0;\n"
+        "maketh count index = 0;\n"
+        "rehearse (index < %lu) {\n"
+        "    sum += index %% 7;\n"
+        "    index++;\n"
+        "}\n"
+        "sayeth(\"Sum: %%d\", sum);\n";
+
+    memset(program, 0, sizeof(BenchCorpus));
+    program->name = "loop";
+    int length = snprintf(NULL, 0, format, size);
+    program->contents = calloc((size_t)length + 1 + LEXER_PADDING, 1);
+    if (program->contents == NULL) {
+        printf("ERROR: corpus memory allocation failure "
+               "[BENCH_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+    snprintf(program->contents, (size_t)length + 1, format, size);
+    program->length = (unsigned long)length;
+
+    Lexer *lexer = initLexer(program->contents, program->length);
+    while (lexerGetNextToken(lexer).type != TK_EOF) {
+        program->tokens++;
+    }
+    lexerCleanUp(&lexer);
+    return 0;
+}
+
+static void benchCorpusCleanup(BenchCorpus *corpus) {
+    if (corpus->path[0] != '\0') {
+        unlink(corpus->path);
+    }
+    free(corpus->contents);
+}
+
+// run one benchmark in a child process and print its JSON line
+static int benchMeasure(BenchKind kind, const BenchCorpus *corpus,
+                        unsigned int rounds, unsigned long seed) {
+    int pipe_desc[2];
+    if (pipe(pipe_desc) != 0) {
+        printf("ERROR: cannot create result pipe [BENCH_PROCESS_ERROR]\n");
+        return 1;
+    }
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        close(pipe_desc[0]);
+        close(pipe_desc[1]);
+        printf("ERROR: cannot fork benchmark [BENCH_PROCESS_ERROR]\n");
+        return 1;
+    }
+    if (child == 0) {
+        BenchResult result;
+        close(pipe_desc[0]);
+        benchRunChild(kind, corpus, rounds, &result);
+        ssize_t written = write(pipe_desc[1], &result, sizeof(result));
+        _exit(written == (ssize_t)sizeof(result) ? 0 : 1);
+    }
+
+    BenchResult result = {1, 0, {0, 0}, 0, 0};
+    close(pipe_desc[1]);
+    ssize_t received = read(pipe_desc[0], &result, sizeof(result));
+    close(pipe_desc[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(child, &status, 0, &usage) != child || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0 || received != (ssize_t)sizeof(result) ||
+        result.status != 0) {
+        printf("ERROR: benchmark '%s' on '%s' failed [BENCH_RUN_ERROR]\n",
+               bench_names[kind], corpus->name);
+        return 1;
+    }
+
+    // a tree size and instruction rate or null, like unknown --stats values
+    double seconds = result.seconds > 0 ? result.seconds : 1e-9;
+    char tree_bytes[32] = "null";
+    char instructions_per_s[32] = "null";
+    if (result.tree_bytes > 0) {
+        snprintf(tree_bytes, sizeof(tree_bytes), "%lu", result.tree_bytes);
+    }
+    if (result.instructions > 0) {
+        snprintf(instructions_per_s, sizeof(instructions_per_s), "%.0f",
+                 result.instructions / seconds);
+    }
+
+    printf("{\"benchmark\":\"%s\",\"mix\":\"%s\",\"seed\":%lu,"
+           "\"scan\":\"%s\",\"bytes\":%lu,\"tokens\":%lu,\"rounds\":%u,"
+           "\"seconds\":%.6f,\"mb_per_s\":%.2f,\"tokens_per_s\":%.0f,"
+           "\"allocations\":%lu,\"allocated_bytes\":%lu,"
+           "\"allocations_per_token\":%.6f,\"tree_bytes\":%s,"
+           "\"instructions_per_s\":%s,\"peak_rss_kib\":%ld}\n",
+           bench_names[kind], corpus->name, seed,
+           scanGetBestKernels()->name, corpus->length, corpus->tokens, rounds,
+           result.seconds, corpus->length / seconds / 1e6,
+           corpus->tokens / seconds, result.allocs.count,
+           result.allocs.bytes,
+           corpus->tokens ? (double)result.allocs.count / corpus->tokens : 0.0,
+           tree_bytes, instructions_per_s, usage.ru_maxrss);
+    return 0;
+}
+
+// fastest of rounds runs, allocations averaged over them
+static void benchRunChild(BenchKind kind, const BenchCorpus *corpus,
+                          unsigned int rounds, BenchResult *result) {
+    AllocStat before;
+    AllocStat after;
+    memset(result, 0, sizeof(BenchResult));
+
+    allocStatGet(&before);
+    for (unsigned int i = 0; i < rounds && !result->status; i++) {
+        double start = benchNow();
+        result->status = benchRound(kind, corpus, &start, result);
+        double elapsed = benchNow() - start;
+        if (i == 0 || elapsed < result->seconds) {
+            result->seconds = elapsed;
+        }
+    }
+    allocStatGet(&after);
+
+    result->allocs.count = (after.count - before.count) / rounds;
+    result->allocs.bytes = (after.bytes - before.bytes) / rounds;
+}
+
+// one timed run, setup that is not measured moves start past itself
+static int benchRound(BenchKind kind, const BenchCorpus *corpus,
+                      double *start, BenchResult *result) {
+    Lexer *lexer = NULL;
+    int return_error = 0;
+
+    switch (kind) {
+    case BENCH_LEX_SWITCH:
+    case BENCH_LEX_DFA:
+        lexer = initLexer(corpus->contents, corpus->length);
+        lexerSetEngine(lexer, kind == BENCH_LEX_DFA ? LEXER_ENGINE_DFA
+                                                    : LEXER_ENGINE_SWITCH);
+        while (lexerGetNextToken(lexer).type != TK_EOF) {
+            // tokens only, nothing reported
+        }
+        lexerCleanUp(&lexer);
+        return 0;
+    case BENCH_CURSOR: {
+        // a parser's loop: look at the next token, then take the current
+        TokenCursor cursor;
+        lexer = initLexer(corpus->contents, corpus->length);
+        return_error = tokenCursorInit(&cursor, lexer, stdout);
+        unsigned long tokens = 0;
+        while (!return_error &&
+               tokenCursorPeek(&cursor, 1).type != TK_EOF) {
+            tokenCursorAdvance(&cursor);
+            tokens++;
+        }
+        lexerCleanUp(&lexer);
+        return return_error || tokens + 1 < corpus->tokens;
+    }
+    case BENCH_SYMBOLS: {
+        // -s rows streamed in chunks like compileRensFile does
+        FILE *devnull = fopen("/dev/null", "w");
+        StringOutput symbols;
+        if (devnull == NULL ||
+            openCollectedStringOutput(&symbols, devnull, 0, stdout)) {
+            return 1;
+        }
+
+        lexer = initLexer(corpus->contents, corpus->length);
+        Token tok = lexerGetNextToken(lexer);
+        while (tok.type != TK_EOF && !return_error) {
+            unsigned long line;
+            unsigned long column;
+            return_error = lexerGetPosition(
+                lexer, lexer->content_base + lexer->index, &line, &column,
+                stdout);
+            return_error |= collectStringOutput(
+                &symbols, line, column, tk_map[tok.type],
+                lexerGetLexeme(lexer, &tok), tok.length);
+            tok = lexerGetNextToken(lexer);
+        }
+        return_error |= storeCollectedStringOutput(&symbols);
+
+        lexerCleanUp(&lexer);
+        cleanupCollectedString(&symbols);
+        fclose(devnull);
+        return return_error;
+    }
+    case BENCH_END_TO_END: {
+        FILE *devnull = fopen("/dev/null", "w");
+        if (devnull == NULL) {
+            return 1;
+        }
+        CompileOptions options;
+        compileOptionsDefault(&options);
+        options.symbol_out = 1;
+        return_error =
+            compileRensFile(corpus->path, &options, devnull, NULL, NULL);
+        fclose(devnull);
+        return return_error;
+    }
+    case BENCH_RELEX: {
+        char *contents = malloc(corpus->length + LEXER_PADDING);
+        if (contents == NULL || corpus->length == 0) {
+            free(contents);
+            return 1;
+        }
+        memcpy(contents, corpus->contents, corpus->length + LEXER_PADDING);
+
+        TokenBuffer tokens = {0};
+        lexer = initLexer(contents, corpus->length);
+        return_error = lexerTokenizeAll(lexer, &tokens, stdout);
+        *start = benchNow();
+
+        // replace a byte by an identifier character, then restore it
+        LexerEdit edit = {0, 1, 1};
+        char saved = 0;
+        for (unsigned long i = 0; i < BENCH_RELEX_EDITS * 2 && !return_error;
+             i++) {
+            edit.start = (i / 2) * 2654435761UL % corpus->length;
+            if (i % 2 == 0) {
+                saved = contents[edit.start];
+                contents[edit.start] = 'x';
+            } else {
+                contents[edit.start] = saved;
+            }
+            return_error =
+                lexerRelex(lexer, contents, corpus->length, &edit, &tokens,
+                           stdout);
+        }
+
+        lexerCleanUp(&lexer);
+        tokenBufferCleanup(&tokens);
+        free(contents);
+        return return_error;
+    }
+    case BENCH_PARSE: {
+        FILE *devnull = fopen("/dev/null", "w");
+        if (devnull == NULL) {
+            return 1;
+        }
+        TokenBuffer tokens = {0};
+        lexer = initLexer(corpus->contents, corpus->length);
+        return_error = lexerTokenizeAll(lexer, &tokens, stdout);
+        *start = benchNow();
+
+        Ast ast;
+        return_error |=
+            parseTokens(lexer, &tokens, corpus->path, devnull, &ast);
+        result->tree_bytes = ast.node_count * 13UL + ast.extra_count * 4UL;
+        astCleanup(&ast);
+
+        lexerCleanUp(&lexer);
+        tokenBufferCleanup(&tokens);
+        fclose(devnull);
+        return return_error;
+    }
+    case BENCH_VM_GOTO:
+    case BENCH_VM_SWITCH:
+        return benchVmRound(kind, corpus, start, result);
+    default:
+        return 1;
+    }
+}
+
+// compile the program, count its instructions once, then time one run
+static int benchVmRound(BenchKind kind, const BenchCorpus *program,
+                        double *start, BenchResult *result) {
+    FILE *devnull = fopen("/dev/null", "w");
+    if (devnull == NULL) {
+        return 1;
+    }
+    TokenBuffer tokens = {0};
+    Lexer *lexer = initLexer(program->contents, program->length);
+    int return_error = lexerTokenizeAll(lexer, &tokens, stdout);
+
+    Ast ast = {0};
+    VmProgram code = {0};
+    if (!return_error) {
+        return_error = parseTokens(lexer, &tokens, "<loop>", devnull, &ast) ||
+                       bytecodeCompile(lexer, &ast, "<loop>", devnull, &code);
+    }
+
+    VmRunOptions options;
+    VmResult run;
+    vmRunOptionsDefault(&options, lexer, "<loop>");
+    options.out = devnull;
+    if (!return_error && result->instructions == 0) {
+        options.count_instructions = 1;
+        return_error = vmRun(&code, &options, &run);
+        result->instructions = run.instructions;
+        options.count_instructions = 0;
+    }
+
+    options.dispatch =
+        kind == BENCH_VM_GOTO ? VM_DISPATCH_GOTO : VM_DISPATCH_SWITCH;
+    *start = benchNow();
+    if (!return_error) {
+        return_error = vmRun(&code, &options, &run);
+    }
+
+    bytecodeCleanup(&code);
+    astCleanup(&ast);
+    lexerCleanUp(&lexer);
+    tokenBufferCleanup(&tokens);
+    fclose(devnull);
+    return return_error;
+}
+
+// write one generated corpus to filename
+static int benchWriteCorpus(const char *filename, CorpusMix mix,
+                            unsigned long size, unsigned long seed) {
+    unsigned long length;
+    char *contents = corpusGenerate(mix, size, seed, &length);
+    if (contents == NULL) {
+        printf("ERROR: corpus memory allocation failure "
+               "[BENCH_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+
+    FILE *file_ptr = fopen(filename, "wb");
+    int return_error = file_ptr == NULL ||
+                       fwrite(contents, 1, length, file_ptr) != length;
+    if (file_ptr != NULL && fclose(file_ptr) != 0) {
+        return_error = 1;
+    }
+    if (return_error) {
+        printf("ERROR: cannot write corpus file '%s' [BENCH_FILE_ERROR]\n",
+               filename);
+    }
+
+    free(contents);
+    return return_error;
+}
+
+// byte count with an optional k or m (binary) suffix
+static int parseSize(const char *text, unsigned long *size) {
+    char *end = NULL;
+    unsigned long value = strtoul(text, &end, 10);
+    if (end == text) {
+        return 1;
+    }
+
+    if (*end == 'k' || *end == 'K') {
+        value <<= 10;
+        end++;
+    } else if (*end == 'm' || *end == 'M') {
+        value <<= 20;
+        end++;
+    }
+    if (*end != '\0' || value == 0) {
+        return 1;
+    }
+
+    *size = value;
+    return 0;
+}
+
+// monotonic clock in seconds
+static double benchNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void displayBenchHelp(void) {
+    printf("Usage: renaisscript_bench [options]\n"
+           "Options:\n"
+           "  --size=<bytes>[k|m]   corpus size per mix (default 4m)\n"
+           "  --mix=<mix>           identifier, comment, string, numeric, "
+           "mixed or all\n"
+           "  --bench=<benchmark>   lex-switch, lex-dfa, cursor, symbols, "
+           "end-to-end,\n"
+           "                        relex, parse, vm-goto, vm-switch or all\n"
+           "  --rounds=<n>          runs per benchmark, fastest is reported "
+           "(default 5)\n"
+           "  --seed=<n>            corpus generator seed (default 1)\n"
+           "  --write=<file.rens>   write the corpus of --mix (default mixed) "
+           "and exit\n"
+           "  -h, --help            display this help\n"
+           "Prints one JSON object per benchmark and mix.\n");
+}
@@ -0,0 +1,285 @@
+// corpusgen header implementation
+//
+// `corpusgen.c` draws statement kinds by per-mix weights from a xorshift
+// generator seeded by the caller, never from the clock or libc rand().
+
+#include "corpusgen.h"
+#include "lexer.h" // LEXER_PADDING, lexerIdReservedKeyword
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum StatementKindEnum {
+    STMT_IDENTIFIER,
+    STMT_LINE_COMMENT,
+    STMT_BLOCK_COMMENT,
+    STMT_STRING,
+    STMT_NUMERIC,
+    STMT_KIND_COUNT,
+} StatementKind;
+
+// relative weight of every statement kind in a mix
+static const unsigned int corpus_weights[CORPUS_MIX_COUNT][STMT_KIND_COUNT] = {
+    [CORPUS_IDENTIFIER] = {8, 1, 0, 0, 1},
+    [CORPUS_COMMENT] = {1, 4, 3, 0, 0},
+    [CORPUS_STRING] = {1, 1, 0, 7, 1},
+    [CORPUS_NUMERIC] = {1, 0, 0, 1, 8},
+    [CORPUS_MIXED] = {1, 1, 1, 1, 1},
+};
+
+const char *const corpus_mix_names[CORPUS_MIX_COUNT] = {
+    [CORPUS_IDENTIFIER] = "identifier", [CORPUS_COMMENT] = "comment",
+    [CORPUS_STRING] = "string",         [CORPUS_NUMERIC] = "numeric",
+    [CORPUS_MIXED] = "mixed",
+};
+
+static const char *const corpus_words[] = {
+    "thy",   "quill", "doth", "render", "each", "verse", "anon", "hither",
+    "whence", "fare", "well", "good",   "sir",  "value", "count", "index",
+};
+
+static const char *const corpus_types[] = {"count", "portion", "fraction",
+                                           "verdict", "glyph"};
+
+// the first seven are arithmetic, used between numeric literals
+static const char *const corpus_operators[] = {"+", "-", "*", "/", "//",
+                                               "%", "**", "&&", "||"};
+
+static const char *const corpus_compares[] = {"==", "!=", "<",
+                                              "<=", ">",  ">="};
+
+// growing output text and generator state
+typedef struct CorpusTextStruct {
+    char *text;
+    unsigned long length;
+    unsigned long capacity;
+    int failed;
+    unsigned long long state;
+} CorpusText;
+
+static unsigned long corpusRandom(CorpusText *corpus, unsigned long bound);
+static void corpusAppend(CorpusText *corpus, const char *format, ...);
+static void corpusIdentifier(CorpusText *corpus);
+static void corpusFunctionName(CorpusText *corpus, unsigned long index);
+static void corpusWords(CorpusText *corpus, unsigned long length);
+static void corpusStatement(CorpusText *corpus, StatementKind kind);
+
+/// PUBLIC FUNCTIONS
+
+// mix named name, returns 1 for unknown names
+int corpusMixFromName(const char *name, CorpusMix *mix) {
+    for (int i = 0; i < CORPUS_MIX_COUNT; i++) {
+        if (strcmp(name, corpus_mix_names[i]) == 0) {
+            *mix = (CorpusMix)i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// generate about size bytes (whole statements, at least one function)
+// followed by LEXER_PADDING zero bytes, NULL on allocation failure
+char *corpusGenerate(CorpusMix mix, unsigned long size, unsigned long seed,
+                     unsigned long *length) {
+    CorpusText corpus = {0};
+    corpus.state = (seed + 1) * 0x9E3779B97F4A7C15ULL;
+
+    unsigned int total = 0;
+    for (int kind = 0; kind < STMT_KIND_COUNT; kind++) {
+        total += corpus_weights[mix][kind];
+    }
+
+    unsigned long functions = 0;
+    while ((corpus.length < size || functions == 0) && !corpus.failed) {
+        corpusAppend(&corpus, "define count fn");
+        corpusFunctionName(&corpus, functions++);
+        corpusAppend(&corpus, "() {\n");
+
+        unsigned long statements = 8 + corpusRandom(&corpus, 17);
+        for (unsigned long i = 0; i < statements; i++) {
+            // weighted pick of the statement kind
+            unsigned long pick = corpusRandom(&corpus, total);
+            int kind = 0;
+            while (pick >= corpus_weights[mix][kind]) {
+                pick -= corpus_weights[mix][kind];
+                kind++;
+            }
+            corpusStatement(&corpus, (StatementKind)kind);
+        }
+        corpusAppend(&corpus, "    returneth 0;\n}\n\n");
+    }
+
+    // reserve the zero padding for the table-driven engine
+    corpusAppend(&corpus, "%*s", LEXER_PADDING, "");
+    if (corpus.failed) {
+        free(corpus.text);
+        return NULL;
+    }
+    corpus.length -= LEXER_PADDING;
+    memset(corpus.text + corpus.length, 0, LEXER_PADDING);
+
+    *length = corpus.length;
+    return corpus.text;
+}
+
+/// PRIVATE FUNCTIONS
+
+// xorshift64* value below bound
+static unsigned long corpusRandom(CorpusText *corpus, unsigned long bound) {
+    corpus->state ^= corpus->state >> 12;
+    corpus->state ^= corpus->state << 25;
+    corpus->state ^= corpus->state >> 27;
+    return (unsigned long)((corpus->state * 0x2545F4914F6CDD1DULL) >> 32) %
+           bound;
+}
+
+// printf formatted text onto the corpus
+static void corpusAppend(CorpusText *corpus, const char *format, ...) {
+    if (corpus->failed) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (corpus->length + (unsigned long)needed + 1 > corpus->capacity) {
+        unsigned long capacity = corpus->capacity * 2 + (unsigned long)needed;
+        char *grown = realloc(corpus->text, capacity + 1);
+        if (grown == NULL) {
+            corpus->failed = 1;
+            return;
+        }
+        corpus->text = grown;
+        corpus->capacity = capacity + 1;
+    }
+
+    va_start(args, format);
+    vsnprintf(corpus->text + corpus->length, (unsigned long)needed + 1, format,
+              args);
+    va_end(args);
+    corpus->length += (unsigned long)needed;
+}
+
+// identifier of 3 to 24 characters, letters and underscores (digits end
+// an identifier in renaisscript), never a reserved keyword
+static void corpusIdentifier(CorpusText *corpus) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz_";
+
+    char name[25];
+    unsigned long length;
+    do {
+        length = 3 + corpusRandom(corpus, 22);
+        for (unsigned long i = 0; i < length; i++) {
+            name[i] = letters[corpusRandom(corpus, sizeof(letters) - 1)];
+        }
+    } while (lexerIdReservedKeyword(name, length) != TK_IDENTIFIER);
+    name[length] = '\0';
+    corpusAppend(corpus, "%s", name);
+}
+
+// distinct letters for every function index, base 26 from 'a'
+static void corpusFunctionName(CorpusText *corpus, unsigned long index) {
+    char name[16];
+    int length = 0;
+    do {
+        name[length++] = (char)('a' + index % 26);
+        index /= 26;
+    } while (index > 0);
+    while (length > 0) {
+        corpusAppend(corpus, "%c", name[--length]);
+    }
+}
+
+// space separated words up to about length characters
+static void corpusWords(CorpusText *corpus, unsigned long length) {
+    unsigned long start = corpus->length;
+    unsigned long word_count = sizeof(corpus_words) / sizeof(corpus_words[0]);
+
+    corpusAppend(corpus, "%s", corpus_words[corpusRandom(corpus, word_count)]);
+    while (corpus->length - start < length && !corpus->failed) {
+        corpusAppend(corpus, " %s",
+                     corpus_words[corpusRandom(corpus, word_count)]);
+    }
+}
+
+static void corpusStatement(CorpusText *corpus, StatementKind kind) {
+    unsigned long type_count = sizeof(corpus_types) / sizeof(corpus_types[0]);
+    unsigned long operator_count =
+        sizeof(corpus_operators) / sizeof(corpus_operators[0]);
+    unsigned long compare_count =
+        sizeof(corpus_compares) / sizeof(corpus_compares[0]);
+
+    switch (kind) {
+    case STMT_IDENTIFIER: // declaration or condition
+        if (corpusRandom(corpus, 3) == 0) {
+            corpusAppend(corpus, "    if (");
+            corpusIdentifier(corpus);
+            corpusAppend(corpus, " %s ",
+                         corpus_compares[corpusRandom(corpus, compare_count)]);
+            corpusIdentifier(corpus);
+            corpusAppend(corpus, ") {\n        ");
+            corpusIdentifier(corpus);
+            corpusAppend(corpus, "++;\n    }\n");
+            break;
+        }
+        corpusAppend(corpus, "    maketh %s ",
+                     corpus_types[corpusRandom(corpus, type_count)]);
+        corpusIdentifier(corpus);
+        corpusAppend(corpus, " = ");
+        corpusIdentifier(corpus);
+        for (unsigned long i = corpusRandom(corpus, 4); i > 0; i--) {
+            unsigned long op = corpusRandom(corpus, operator_count);
+            corpusAppend(corpus, " %s ", corpus_operators[op]);
+            corpusIdentifier(corpus);
+        }
+        corpusAppend(corpus, ";\n");
+        break;
+    case STMT_LINE_COMMENT: // comment on its own line
+        corpusAppend(corpus, "    # ");
+        corpusWords(corpus, 20 + corpusRandom(corpus, 80));
+        corpusAppend(corpus, "\n");
+        break;
+    case STMT_BLOCK_COMMENT: // commented out lines between '##' markers
+        corpusAppend(corpus, "    ##\n");
+        for (unsigned long i = 2 + corpusRandom(corpus, 5); i > 0; i--) {
+            corpusAppend(corpus, "        ");
+            corpusWords(corpus, 20 + corpusRandom(corpus, 60));
+            corpusAppend(corpus, "\n");
+        }
+        corpusAppend(corpus, "    ##\n");
+        break;
+    case STMT_STRING: // output call with escapes inside the literal
+        corpusAppend(corpus, "    sayeth(\"");
+        for (unsigned long i = 1 + corpusRandom(corpus, 4); i > 0; i--) {
+            corpusWords(corpus, 10 + corpusRandom(corpus, 40));
+            corpusAppend(corpus, "%s", i > 1 ? " \\\"\\t\\n\\\\ " : "\\n");
+        }
+        corpusAppend(corpus, "\");\n");
+        break;
+    case STMT_NUMERIC: // integer and float literal expression
+        corpusAppend(corpus, "    maketh portion ");
+        corpusIdentifier(corpus);
+        corpusAppend(corpus, " = %lu.%lu", corpusRandom(corpus, 100000),
+                     corpusRandom(corpus, 1000));
+        for (unsigned long i = 1 + corpusRandom(corpus, 5); i > 0; i--) {
+            if (corpusRandom(corpus, 2) == 0) {
+                corpusAppend(corpus, " %s %lu",
+                             corpus_operators[corpusRandom(corpus, 7)],
+                             corpusRandom(corpus, 1000000000));
+            } else {
+                corpusAppend(corpus, " %s %lu.%lu",
+                             corpus_operators[corpusRandom(corpus, 7)],
+                             corpusRandom(corpus, 10000),
+                             corpusRandom(corpus, 100000));
+            }
+        }
+        corpusAppend(corpus, ";\n");
+        break;
+    default:
+        break;
+    }
+}
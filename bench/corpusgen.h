@@ -0,0 +1,29 @@
+// `corpusgen.h` - deterministic synthetic rens sources for benchmarks
+//
+// `corpusgen.c` writes functions full of statements drawn from a token mix.
+// The same mix, size and seed always give the same bytes, so results stay
+// comparable between releases.
+
+#ifndef CORPUSGEN_H_
+#define CORPUSGEN_H_
+
+typedef enum CorpusMixEnum {
+    CORPUS_IDENTIFIER, // declarations and expressions over long identifiers
+    CORPUS_COMMENT,    // line comments and multi-line block comments
+    CORPUS_STRING,     // sayeth calls with long escaped string literals
+    CORPUS_NUMERIC,    // integer and float literal arithmetic
+    CORPUS_MIXED,      // every statement kind in equal parts
+    CORPUS_MIX_COUNT,
+} CorpusMix;
+
+extern const char *const corpus_mix_names[CORPUS_MIX_COUNT];
+
+// mix named name, returns 1 for unknown names
+int corpusMixFromName(const char *name, CorpusMix *mix);
+
+// generate about size bytes (whole statements, at least one function)
+// followed by LEXER_PADDING zero bytes, NULL on allocation failure
+char *corpusGenerate(CorpusMix mix, unsigned long size, unsigned long seed,
+                     unsigned long *length);
+
+#endif // CORPUSGEN_H_
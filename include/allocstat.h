@@ -0,0 +1,20 @@
+// `allocstat.h` - heap allocation counters
+//
+// Targets compiled with ALLOCSTAT_WRAP and linked with
+// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc route the allocations made by
+// renaisscript code through `allocstat.c`, which counts calls and requested
+// bytes. Allocations made inside libc (stdio buffers, strndup) are not seen.
+
+#ifndef ALLOCSTAT_H_
+#define ALLOCSTAT_H_
+
+// allocation calls and bytes requested since the process started
+typedef struct AllocStatStruct {
+    unsigned long count;
+    unsigned long bytes;
+} AllocStat;
+
+// read the counters, returns 1 (and zeroes) when allocations are not wrapped
+int allocStatGet(AllocStat *stat);
+
+#endif // ALLOCSTAT_H_
@@ -0,0 +1,27 @@
+// `arena.h` - header file for the single block bump allocator
+//
+// `arena.c` hands out aligned slices of one block reserved up front. Slices
+// are never freed one by one: everything allocated from an arena goes with
+// one arenaCleanup. The block never moves, so pointers into it stay valid.
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdio.h>
+
+typedef struct ArenaStruct {
+    char *base;
+    unsigned long used;
+    unsigned long capacity;
+} Arena;
+
+// reserve a block of capacity bytes, a failure is printed to out
+int arenaInit(Arena *arena, unsigned long capacity, FILE *out);
+
+// size bytes aligned to align (a power of two), NULL when the block is full
+void *arenaAlloc(Arena *arena, unsigned long size, unsigned long align);
+
+// free the block and everything allocated from it
+void arenaCleanup(Arena *arena);
+
+#endif // ARENA_H_
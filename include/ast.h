@@ -0,0 +1,117 @@
+// `ast.h` - header file for the index-based abstract syntax tree
+//
+// `ast.c` keeps every node of a file in struct-of-arrays form inside one
+// arena: kind, main token and two 32-bit data words per node, plus an extra
+// array of node lists and pairs. Nodes refer to each other and to the token
+// buffer they were parsed from by index, never by pointer. Every node owns a
+// distinct main token, so a file of n tokens has at most n + 1 nodes (with
+// the root) and 3 * (n + 1) extra words, which is all the arena reserves.
+//
+// Node 0 is the root and doubles as the null child. Data per kind:
+//
+//   kind           main token   lhs                  rhs
+//   AST_ROOT       0            items start (extra)  items end
+//   AST_FUNCTION   define       extra: params s, e   body block
+//   AST_PARAM      name         -                    -
+//   AST_BLOCK      {            statements start     statements end
+//   AST_VAR_DECL   maketh       array length or 0    initializer or 0
+//   AST_IF         if           condition            extra: then, else or 0
+//   AST_WHILE      rehearse     condition            body block
+//   AST_SWITCH     switch       subject              extra: cases s, e
+//   AST_CASE       case         value                extra: statements s, e
+//   AST_LABEL      label name   statement            -
+//   AST_BREAK      cease        -                    -
+//   AST_CONTINUE   persist      -                    -
+//   AST_GOTO       thither      -                    -
+//   AST_RETURN     returneth    value or 0           -
+//   AST_EXPR_STMT  ;            expression or 0      -
+//   AST_ASSIGN     operator     target               value
+//   AST_BINARY     operator     left                 right
+//   AST_UNARY      operator     operand              -
+//   AST_POSTFIX    operator     operand              -
+//   AST_CALL       (            callee               extra: arguments s, e
+//   AST_INDEX      [            array                index
+//   leaves         the token    -                    -
+//
+// Types and names sit at fixed tokens after the main token: `define <type>
+// <name>`, `maketh <type> <name>`, `<type> <name>` of a parameter, and the
+// optional label of `cease`, `persist` and `thither`. A declaration is an
+// array when its name is followed by '['.
+
+#ifndef AST_H_
+#define AST_H_
+
+#include "arena.h" // Arena
+#include "lexer.h" // TokenBuffer, Lexer
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum AstKindEnum {
+    AST_ROOT,
+    AST_FUNCTION,
+    AST_PARAM,
+    AST_BLOCK,
+    AST_VAR_DECL,
+    AST_IF,
+    AST_WHILE,
+    AST_SWITCH,
+    AST_CASE,
+    AST_LABEL,
+    AST_BREAK,
+    AST_CONTINUE,
+    AST_GOTO,
+    AST_RETURN,
+    AST_EXPR_STMT,
+    AST_ASSIGN,
+    AST_BINARY,
+    AST_UNARY,
+    AST_POSTFIX,
+    AST_CALL,
+    AST_INDEX,
+    AST_IDENTIFIER,
+    AST_BUILTIN, // sayeth or heareth as a callee
+    AST_INTEGER,
+    AST_FLOAT,
+    AST_CHARACTER,
+    AST_STRING,
+    AST_BOOLEAN,
+    AST_WILDCARD, // '*' of a default case
+    AST_KIND_COUNT,
+} AstKind;
+
+extern const char *const ast_kind_names[AST_KIND_COUNT];
+
+typedef struct AstStruct {
+    const TokenBuffer *tokens; // borrowed, must outlive the tree
+    uint8_t *kinds;
+    uint32_t *main_tokens;
+    uint32_t *lhs;
+    uint32_t *rhs;
+    uint32_t node_count;
+    uint32_t node_capacity;
+    uint32_t *extra;
+    uint32_t extra_count;
+    uint32_t extra_capacity;
+    Arena arena;
+} Ast;
+
+// reserve the arena for a tree over tokens and add the root node, errors are
+// printed to out
+int astInit(Ast *ast, const TokenBuffer *tokens, FILE *out);
+
+// append a node, returns its index (0 when the arena is full)
+uint32_t astAddNode(Ast *ast, AstKind kind, uint32_t main_token, uint32_t lhs,
+                    uint32_t rhs);
+
+// append count words to extra, returns the index of the first
+uint32_t astAddExtra(Ast *ast, const uint32_t *words, uint32_t count);
+
+// print the tree one node per line, indented by depth, with the lexemes of
+// names, operators and literals
+int astPrint(const Ast *ast, const Lexer *lexer, FILE *out);
+
+// free every node at once
+void astCleanup(Ast *ast);
+
+#endif // AST_H_
@@ -0,0 +1,122 @@
+// `bytecode.h` - header file for the register bytecode of renaisscript
+//
+// `bytecode.c` compiles a syntax tree (see ast.h) into a VmProgram that
+// vm.c executes. Instructions are 32-bit words, an 8-bit opcode (see
+// opcodes.def) then operands:
+//
+//   ABC   A 8 bits, B 8 bits, C 8 bits   registers, or sC = C - 128
+//   ABx   A 8 bits, Bx 16 bits           constant, global or function index,
+//                                        or jump offset sBx = Bx - 32768
+//   sAx   24 bits                        jump offset sAx = Ax - 2^23
+//
+// Every function runs in a window of at most 256 registers holding its
+// parameters, then its locals, then temporaries. Types are checked while
+// compiling and never stored at run time: a register holds a count, glyph
+// or verdict as int64_t, a portion or fraction as double, a string or an
+// array as a pointer. Function 0 is the top level of the file, it calls
+// `main` (when defined) at its end and returns the exit value.
+
+#ifndef BYTECODE_H_
+#define BYTECODE_H_
+
+#include "ast.h"   // Ast
+#include "lexer.h" // Lexer, TokenBuffer
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum VmOpcodeEnum {
+#define OPCODE(name, format) OP_##name,
+#include "opcodes.def"
+#undef OPCODE
+    OP_COUNT,
+} VmOpcode;
+
+// operand layouts of opcodes.def
+typedef enum VmFormatEnum {
+    VM_FORMAT_NONE,
+    VM_FORMAT_A,
+    VM_FORMAT_AB,
+    VM_FORMAT_ABC,
+    VM_FORMAT_ABSC,
+    VM_FORMAT_ABX,
+    VM_FORMAT_ASBX,
+    VM_FORMAT_SAX,
+} VmFormat;
+
+extern const char *const vm_opcode_names[OP_COUNT];
+extern const uint8_t vm_opcode_formats[OP_COUNT];
+
+#define VM_SC_BIAS 128
+#define VM_SBX_BIAS 32768
+#define VM_SAX_BIAS 0x800000
+#define VM_MAX_REGISTERS 256
+
+// instruction fields
+#define VM_OP(i) ((i)&0xff)
+#define VM_A(i) (((i) >> 8) & 0xff)
+#define VM_B(i) (((i) >> 16) & 0xff)
+#define VM_C(i) ((i) >> 24)
+#define VM_SC(i) ((int)VM_C(i) - VM_SC_BIAS)
+#define VM_BX(i) ((i) >> 16)
+#define VM_SBX(i) ((int32_t)VM_BX(i) - VM_SBX_BIAS)
+#define VM_SAX(i) ((int32_t)((i) >> 8) - VM_SAX_BIAS)
+
+// instruction builders
+#define VM_ABC(op, a, b, c)                                                    \
+    ((uint32_t)(op) | (uint32_t)(a) << 8 | (uint32_t)(b) << 16 |               \
+     (uint32_t)(c) << 24)
+#define VM_ABX(op, a, bx)                                                      \
+    ((uint32_t)(op) | (uint32_t)(a) << 8 | (uint32_t)(bx) << 16)
+#define VM_AX(op, ax) ((uint32_t)(op) | (uint32_t)(ax) << 8)
+
+// one register, its type known to the compiler only
+typedef union VmValueUnion {
+    int64_t i;
+    double f;
+    const char *s;
+    struct VmArrayStruct *a;
+} VmValue;
+
+// array of count, portion, fraction or verdict elements
+typedef struct VmArrayStruct {
+    int64_t length;
+    VmValue items[];
+} VmArray;
+
+typedef struct VmFunctionStruct {
+    uint32_t entry;     // first instruction
+    uint32_t name;      // token of the name, 0 for the top level
+    uint16_t params;    // registers filled by the caller
+    uint16_t registers; // window size
+} VmFunction;
+
+typedef struct VmProgramStruct {
+    const TokenBuffer *tokens; // borrowed, must outlive the program
+    uint32_t *code;
+    uint32_t *code_tokens; // token of the source of each instruction
+    uint32_t code_count;
+    uint32_t code_capacity;
+    VmValue *constants;
+    uint32_t constant_count;
+    uint32_t constant_capacity;
+    char **strings; // string constants, owned
+    uint32_t string_count;
+    uint32_t string_capacity;
+    VmFunction *functions;
+    uint32_t function_count;
+    uint32_t global_count;
+} VmProgram;
+
+// compile the tree of lexer's resident contents into program, printing
+// semantic errors to out. program is freed with bytecodeCleanup either way.
+int bytecodeCompile(Lexer *lexer, const Ast *ast, const char *filename,
+                    FILE *out, VmProgram *program);
+
+// print every instruction with its operands, one per line
+int bytecodePrint(const VmProgram *program, FILE *out);
+
+// free code, constants and strings
+void bytecodeCleanup(VmProgram *program);
+
+#endif // BYTECODE_H_
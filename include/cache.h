@@ -0,0 +1,46 @@
+// `cache.h` - header file for the on-disk compile cache of renaisscript
+//
+// `cache.c` keeps the output of compiled files in a directory, one entry
+// file per key, named by the key in hex. Keys are XXH64 hashes of the input
+// bytes chained with everything else the output depends on (see
+// compile.c). Entries are written to a temporary file and renamed into
+// place, so readers and concurrent compilers only ever see whole entries.
+// A hit touches the entry's modification time; a store evicts the least
+// recently used entries once the directory holds more than its limit.
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define CACHE_DEFAULT_LIMIT (256UL << 20) // bytes of entries kept (--cache)
+#define CACHE_EXTENSION ".rnc"
+
+// stored output of one compile
+typedef struct CacheEntryStruct {
+    int status; // return value of the compile
+    char *out_text;
+    size_t out_length;
+    char *symbol_text; // -s file contents
+    size_t symbol_length;
+} CacheEntry;
+
+// XXH64 of length bytes of data
+uint64_t cacheHash(const void *data, size_t length, uint64_t seed);
+
+// read the entry of key from directory into a zeroed entry, 1 on a hit and
+// 0 on a miss (missing, unreadable or damaged entries all miss)
+int cacheLookup(const char *directory, uint64_t key, CacheEntry *entry);
+
+// atomically write entry under key (creating directory), then evict least
+// recently used entries until at most limit bytes remain. Errors are
+// printed to report.
+int cacheStore(const char *directory, uint64_t key, const CacheEntry *entry,
+               unsigned long limit, FILE *report);
+
+// free the texts of an entry read by cacheLookup
+void cacheEntryCleanup(CacheEntry *entry);
+
+#endif // CACHE_H_
@@ -0,0 +1,33 @@
+// `codegen.h` - header file for the x86-64 backend of renaisscript
+//
+// `codegen.c` lowers an optimized VmProgram (see bytecode.h) to x86-64
+// assembly for the GNU assembler, one machine function per bytecode
+// function. Registers of a function are allocated by linear scan over
+// their live ranges, the most used ones inside loops first; the rest stay
+// in the register stack of the runtime (runtime.h), laid out as vmRun lays
+// it out. Executables are assembled and linked by the system compiler
+// driver, output and runtime errors match vmRun.
+
+#ifndef CODEGEN_H_
+#define CODEGEN_H_
+
+#include "bytecode.h" // VmProgram
+#include "lexer.h"    // Lexer
+
+#include <stdio.h>
+
+#define CODEGEN_RUNTIME_NAME "librenaisscript_rt.a"
+
+// write program as assembly to out, runtime errors are rendered from the
+// tokens of lexer the way vmRun reports them
+int codegenEmit(const VmProgram *program, Lexer *lexer, const char *filename,
+                FILE *out);
+
+// write program to output: assembly when output ends in ".s", otherwise an
+// executable linked with `cc` against runtime (NULL for the archive next to
+// the running executable). Errors are printed to report.
+int codegenBuild(const VmProgram *program, Lexer *lexer,
+                 const char *filename, const char *output,
+                 const char *runtime, FILE *report);
+
+#endif // CODEGEN_H_
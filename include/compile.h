@@ -0,0 +1,90 @@
+// `compile.h` - header file for compiling rens files
+//
+// `compile.c` runs every input file through the lexer (and the parser with
+// --ast and --symbols, the bytecode compiler and optimizer with --bytecode,
+// the virtual machine with --run and the x86-64 backend with -o), alone or
+// as a batch spread across a thread pool. A batch renders each file's
+// diagnostics and symbol table into memory and writes them out in input
+// order, so output stays grouped per file and identical for any thread
+// count. With --cache, outputs of unchanged files are replayed from disk.
+// A CompileUnit keeps a file lexed between compiles, so --watch relexes
+// only the bytes changed by each save.
+// Settings come in CompileOptions on every call, so compiles may run on any
+// threads.
+
+#ifndef COMPILE_H_
+#define COMPILE_H_
+
+#include "diag.h"  // DiagFormat
+#include "lexer.h" // LexerEngine
+#include "stats.h" // CompileStats
+#include "vm.h"    // VmDispatch
+
+#include <stdio.h>
+
+#define COMPILE_VERSION "0.1.0" // also keys --cache entries
+
+// settings of one compile, see compileOptionsDefault
+typedef struct CompileOptionsStruct {
+    int symbol_out;            // print symbol table rows to out (-S)
+    LexerEngine engine;        // engine of resident files (--engine)
+    unsigned int lex_threads;  // threads lexing one file, 0 for one per core
+    const char *rtok_file;     // write binary token file (NULL for none)
+    int rtok_source;           // embed source bytes in rtok_file
+    int ast_out;               // parse and print the syntax tree to out
+    int symbols_out;           // parse and print the names table to out
+    int run;                   // compile to bytecode and run, output to out
+    VmDispatch dispatch;       // dispatch loop of --run
+    int optimize;              // bytecode pass level, 0 to OPTIMIZE_MAX_LEVEL
+    int bytecode_out;          // print the optimized bytecode to out
+    const char *output_file;   // native executable or ".s" (NULL for none)
+    const char *runtime_file;  // archive linked into output_file (NULL for
+                               // the one next to the running executable)
+    const char *cache_dir;     // replay and store outputs (NULL for none)
+    unsigned long cache_size;  // bytes of entries kept in cache_dir
+    FILE *input;               // heareth input of --run (NULL for stdin)
+    DiagFormat diagnostics;    // format errors are written in
+    unsigned long error_limit; // errors kept per file, 0 for all
+} CompileOptions;
+
+// switch engine, serial lexing, no symbol rows or token file
+void compileOptionsDefault(CompileOptions *options);
+
+// compile a single file ('-' reads stdin): diagnostics and -S rows are
+// printed to out, -s rows written to symbol_file (when non-NULL), phase
+// timings and counts added to stats (when non-NULL)
+int compileRensFile(const char *filename, const CompileOptions *options,
+                    FILE *out, FILE *symbol_file, CompileStats *stats);
+
+// compile count files on thread_count workers (0 for one per core), printing
+// to out and symbol_file in input order, stats summed in input order
+int compileRensFiles(const char **filenames, unsigned long count,
+                     unsigned int thread_count, const CompileOptions *options,
+                     FILE *out, FILE *symbol_file, CompileStats *stats);
+
+// a resident file kept lexed between compiles (--watch), zero-initialized
+// before the first compileUnitUpdate
+typedef struct CompileUnitStruct {
+    char *contents; // last lexed, followed by LEXER_PADDING zero bytes
+    unsigned long size;
+    unsigned long capacity;
+    char *spare; // the buffer the next contents are read into
+    unsigned long spare_capacity;
+    Lexer *lexer; // NULL until lexed
+    TokenBuffer tokens;
+    InternTable *names; // interned names of parsed files
+    int changed;        // contents differed at the last update
+    int status;         // return value of the last compile
+} CompileUnit;
+
+// read filename again and, when its contents changed since the last update,
+// relex only the changed bytes and compile the tokens like compileRensFile.
+// Unchanged contents print nothing and return the last status.
+int compileUnitUpdate(CompileUnit *unit, const char *filename,
+                      const CompileOptions *options, FILE *out,
+                      FILE *symbol_file, CompileStats *stats);
+
+// free the contents, lexer and tokens of unit
+void compileUnitCleanup(CompileUnit *unit);
+
+#endif // COMPILE_H_
@@ -0,0 +1,48 @@
+// `cursor.h` - pull-based token cursor with lookahead over a ring buffer
+//
+// `cursor.c` lexes tokens in batches into a fixed ring of value tokens, so
+// parsers peek ahead, mark and reset without allocating or relexing. The
+// ring keeps the last TOKEN_CURSOR_SIZE tokens lexed: peeks reach up to
+// TOKEN_CURSOR_SIZE - 1 tokens ahead, and a mark can be reset to until the
+// cursor has lexed TOKEN_CURSOR_SIZE tokens past it. Past TK_EOF every peek
+// and advance gives TK_EOF again.
+
+#ifndef CURSOR_H_
+#define CURSOR_H_
+
+#include "lexer.h"
+
+#define TOKEN_CURSOR_SIZE 256 // ring capacity, a power of two
+#define TOKEN_CURSOR_BATCH 64 // tokens lexed per refill at most
+
+typedef struct TokenCursorStruct {
+    Lexer *lexer;
+    Token tokens[TOKEN_CURSOR_SIZE];
+    unsigned long begins[TOKEN_CURSOR_SIZE]; // first character of each token
+    unsigned long head; // token count before the current token
+    unsigned long tail; // token count lexed
+    int eof;            // TK_EOF lexed, no more refills
+} TokenCursor;
+
+// start a cursor at the next token of a resident lexer (streaming lexers
+// drop lexemes of earlier tokens on refills and are refused, which is
+// printed to out)
+int tokenCursorInit(TokenCursor *cursor, Lexer *lexer, FILE *out);
+
+// token n places after the current one (n < TOKEN_CURSOR_SIZE)
+Token tokenCursorPeek(TokenCursor *cursor, unsigned int n);
+
+// input offset where the token n places after the current one begins, for
+// lexerGetPosition and diagnostics (n < TOKEN_CURSOR_SIZE)
+unsigned long tokenCursorBegin(TokenCursor *cursor, unsigned int n);
+
+// return the current token and move past it
+Token tokenCursorAdvance(TokenCursor *cursor);
+
+// position of the current token to return to with tokenCursorReset
+unsigned long tokenCursorMark(const TokenCursor *cursor);
+
+// go back (or forward) to a mark, fails when its token left the ring
+int tokenCursorReset(TokenCursor *cursor, unsigned long mark);
+
+#endif // CURSOR_H_
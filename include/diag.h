@@ -0,0 +1,93 @@
+// `diag.h` - header file for the renaisscript diagnostics engine
+//
+// `diag.c` collects the errors of one file as records (code, span, message)
+// instead of printing each one as it is found. Records are rendered as
+// human text, JSON lines or a SARIF log and written to the output stream
+// with one write per diagnosticsFlush. A limit keeps only the first records
+// of a file, the others are counted and summarized by diagnosticsFinish.
+
+#ifndef DIAG_H_
+#define DIAG_H_
+
+#include <stdio.h>
+
+// output selected with --diagnostics[=human|json|sarif]
+typedef enum DiagFormatEnum {
+    DIAG_HUMAN, // message, source line and markers under the span
+    DIAG_JSON,  // one object per line
+    DIAG_SARIF, // one SARIF 2.1.0 log per file, written by diagnosticsFinish
+} DiagFormat;
+
+// where an error is and how to mark it under its source line
+typedef struct DiagSiteStruct {
+    const char *code;     // static, e.g. "ILLEGAL_CHARACTER_ERROR"
+    unsigned long line;   // from 1, 0 for errors of the whole file
+    unsigned long column; // from 1
+    unsigned long offset; // input offset of the span
+    unsigned long length; // span bytes
+    const char *source;   // source line of human output (NULL for none)
+    unsigned long source_length;
+    unsigned long marker_skip;   // spaces after the column before the marker
+    unsigned long marker_carets; // '^' drawn under the span
+    const char *marker_note;     // text after the carets (NULL for none)
+} DiagSite;
+
+// a collected error, text fields are offsets into Diagnostics text
+typedef struct DiagnosticStruct {
+    const char *code;
+    unsigned long line;
+    unsigned long column;
+    unsigned long offset;
+    unsigned long length;
+    unsigned long message;
+    unsigned long message_length;
+    unsigned long source;
+    unsigned long source_length;
+    unsigned long marker_skip;
+    unsigned long marker_carets;
+    const char *marker_note;
+} Diagnostic;
+
+// the errors of one file waiting to be written to out
+typedef struct DiagnosticsStruct {
+    DiagFormat format;
+    unsigned long limit;    // records kept per file, 0 for all
+    unsigned long reported; // errors since diagnosticsInit, kept or not
+    const char *filename;
+    FILE *out;
+    Diagnostic *records; // not yet flushed
+    unsigned long count;
+    unsigned long capacity;
+    char *text; // messages and source lines of records
+    unsigned long text_length;
+    unsigned long text_capacity;
+    char *render; // output of one flush
+    unsigned long render_length;
+    unsigned long render_capacity;
+    int failed; // an allocation failed, records were lost
+} Diagnostics;
+
+// start collecting the errors of filename, written to out in format with at
+// most limit of them kept (0 for all)
+void diagnosticsInit(Diagnostics *diagnostics, const char *filename,
+                     DiagFormat format, unsigned long limit, FILE *out);
+
+// whether the next error is past the limit, reporters may skip building its
+// site but must still call diagnosticsReport to count it
+int diagnosticsFull(const Diagnostics *diagnostics);
+
+// add an error at site with a printf-style message, human and JSON records
+// are flushed once enough of them are waiting
+void diagnosticsReport(Diagnostics *diagnostics, const DiagSite *site,
+                       const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+// write the waiting human or JSON records to out in one write, nothing for
+// SARIF (written whole by diagnosticsFinish) or a NULL diagnostics
+int diagnosticsFlush(Diagnostics *diagnostics);
+
+// write what is still waiting, a count of the errors past the limit and the
+// SARIF log, then free the records
+int diagnosticsFinish(Diagnostics *diagnostics);
+
+#endif // DIAG_H_
@@ -1,27 +1,67 @@
 // `fileread.h` - header file for reading contents of rens file
 //
 // `fileread.c` scans if file is the accepted extension file (*.rens || *.rn).
-// It also allocates memory for a dynamic array where the contents of the
-// file is stored.
+// It memory maps the file read-only, or reads it into a dynamic array where
+// mapping is unavailable. Contents are not NUL terminated, use 'size'.
+// At least LEXER_PADDING zero bytes follow the contents for the DFA engine.
+// All state lives in the structs below, so files may be read on any thread.
 
-// access the file contents with 'file_contents'
-extern char *file_contents;
-extern char *str_out; // store symbol table
+#ifndef FILEREAD_H_
+#define FILEREAD_H_
 
-// detect file extension (*.rens || *.rn) and store values to 'file_contents'
-extern int getRensFileContents(const char *filename);
+#include <stdio.h>
 
-// free allocated file_contents memory
-void cleanupFileContents();
+// contents of one rens file
+typedef struct RensFileStruct {
+    const char *contents;
+    unsigned long size;
+    int mapped;                  // contents is a mapping, not a heap copy
+    unsigned long mapped_length; // mapping including padding
+} RensFile;
 
-// continously collect token and lexeme strings on lexer
-void collectStringOutput(unsigned long lineno, unsigned long col,
-                         const char *tok_name, char *lexeme);
+// symbol table rows, flushed in chunks to file unless kept whole for printing
+// after diagnostics
+typedef struct StringOutputStruct {
+    char *buffer;
+    unsigned long length;
+    unsigned long capacity;
+    int kept;
+    FILE *file;
+    FILE *out;  // stream errors are printed to
+    int failed; // a flush or allocation failed, later rows are dropped
+} StringOutput;
 
-void printCollectedStringOutput();
+// detect file extension (*.rens || *.rn) and store values to 'file', errors
+// are printed to out
+int getRensFileContents(const char *filename, RensFile *file, FILE *out);
 
-// write collected strings from str_out to file
-int storeCollectedStringOutput(const char *filename);
+// read a rens file into buffer, grown to capacity bytes when too small and
+// followed by LEXER_PADDING zero bytes, for files read again and again
+int readRensFileInto(const char *filename, char **buffer,
+                     unsigned long *capacity, unsigned long *size,
+                     FILE *out);
 
-// free allocated str_out memory
-void cleanupCollectedString();
+// unmap or free file contents memory
+void cleanupFileContents(RensFile *file);
+
+// prepare symbol table output: rows stream to file (if non-NULL) in chunks,
+// or are kept in memory when keep_output is set, errors are printed to out
+int openCollectedStringOutput(StringOutput *output, FILE *file,
+                              int keep_output, FILE *out);
+
+// continously collect token and lexeme strings on lexer, a row that cannot be
+// flushed or buffered is an error
+int collectStringOutput(StringOutput *output, unsigned long lineno,
+                        unsigned long col, const char *tok_name,
+                        const char *lexeme, unsigned long lexeme_len);
+
+// print symbol table kept in memory to out
+void printCollectedStringOutput(const StringOutput *output, FILE *out);
+
+// write collected strings not yet flushed to the symbol file
+int storeCollectedStringOutput(StringOutput *output);
+
+// free allocated output buffer memory
+void cleanupCollectedString(StringOutput *output);
+
+#endif // FILEREAD_H_
@@ -0,0 +1,45 @@
+// `intern.h` - header file for the concurrent identifier intern table
+//
+// `intern.c` maps identifier names to 32-bit symbols through one
+// open-addressing table of fixed capacity. Any number of lexer threads
+// insert into it at once without locks: a new name is copied and described
+// first, then published by a single compare-and-swap on its slot, a thread
+// losing that race takes the winner's symbol. Equal names always get equal
+// symbols, so names are compared as integers once interned.
+
+#ifndef INTERN_H_
+#define INTERN_H_
+
+#include <stdint.h>
+
+// FNV-1a, fed a character at a time while the lexer scans an identifier
+#define INTERN_HASH_SEED 2166136261u
+#define INTERN_HASH_STEP(hash, chr)                                            \
+    (((hash) ^ (unsigned char)(chr)) * 16777619u)
+
+typedef struct InternTableStruct InternTable;
+
+// table for up to capacity names of byte_capacity bytes in total (each with
+// a terminator), NULL when out of memory
+InternTable *internCreate(uint32_t capacity, unsigned long byte_capacity);
+
+// table that every identifier of content_length bytes of source fits in
+InternTable *internCreateFor(unsigned long content_length);
+
+// symbol of name (from 1), hash being INTERN_HASH_STEP over its bytes. The
+// same symbol for the same name on every thread, 0 once the table is full.
+uint32_t internSymbol(InternTable *table, const char *name, uint32_t length,
+                      uint32_t hash);
+
+// terminated copy of the name of symbol, NULL for symbols given out by
+// racing inserts of a name that was published under another symbol
+const char *internName(const InternTable *table, uint32_t symbol,
+                       uint32_t *length);
+
+// symbols given out so far, every symbol is at most this
+uint32_t internCount(const InternTable *table);
+
+// free the table and every name
+void internDestroy(InternTable **table);
+
+#endif // INTERN_H_
@@ -3,176 +3,179 @@
 #ifndef LEXER_H_
 #define LEXER_H_
 
+#include "diag.h"
+#include "intern.h"
+#include "lineidx.h"
+#include "scan.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
 // token types
 typedef enum {
-    TK_ILLEGALCHR,
-    TK_EMPTYCHERR,
-    TK_MULTICHERR,
-    TK_FLOATERR,
-    TK_STREOFERR,
-    TK_EOF,
-    TK_IDENTIFIER,
-    TK_CHARACLIT,
-    TK_STRINGLIT,
-    TK_INTLIT,
-    TK_FLTLIT,
-    TK_AMPERSAND,
-    TK_AND,
-    TK_OR,
-    TK_BANG,
-    TK_PLUS,
-    TK_MINUS,
-    TK_ASTERISK,
-    TK_EXPONENT,
-    TK_SLASH,
-    TK_FLOORDIV,
-    TK_MODULO,
-    TK_ASSIGN,
-    TK_ASSIGNINC,
-    TK_ASSIGNDEC,
-    TK_ASSIGNMUL,
-    TK_ASSIGNDIV,
-    TK_ASSIGNMOD,
-    TK_INCREMENT,
-    TK_DECREMENT,
-    TK_EQUAL,
-    TK_GT,
-    TK_GEQUAL,
-    TK_LT,
-    TK_LEQUAL,
-    TK_NOTEQUAL,
-    TK_COMMA,
-    TK_DOT,
-    TK_SEMICOLON,
-    TK_COLON,
-    TK_LPAREN,
-    TK_RPAREN,
-    TK_LBRACKET,
-    TK_RBRACKET,
-    TK_LCURLY,
-    TK_RCURLY,
-    TK_INT,
-    TK_CHAR,
-    TK_FLOAT,
-    TK_DOUBLE,
-    TK_BOOL,
-    TK_VOID,
-    TK_GOTO,
-    TK_SWITCH,
-    TK_CASE,
-    TK_BREAK,
-    TK_OUT,
-    TK_IN,
-    TK_FUNCTION,
-    TK_LET,
-    TK_TRUE,
-    TK_FALSE,
-    TK_IF,
-    TK_ELSE,
-    TK_WHILE,
-    TK_CONTINUE,
-    TK_RETURN,
+#define TOKEN(type) type,
+#define KEYWORD(type, word) type,
+#include "tokens.def"
+#undef KEYWORD
+#undef TOKEN
+    TK_TYPE_COUNT // number of token types, not produced by the lexer
 } TokenType;
 
+// token lexeme is a slice of lexer->contents, no copy is stored
 typedef struct TokenStruct {
     TokenType type;
-    char *lexeme;
+    unsigned long start;  // lexeme offset in the input (see lexerGetLexeme)
+    unsigned long length; // lexeme length in bytes
+    uint32_t symbol;      // interned identifier (see lexerSetSymbols) or 0
 } Token;
 
+// struct-of-arrays token stream of a whole file (offsets into contents)
+typedef struct TokenBufferStruct {
+    uint8_t *types;
+    uint32_t *starts;
+    uint32_t *lengths;
+    uint32_t *begins; // first character of the token (before any quote)
+    uint32_t *symbols; // symbol of each token, NULL until one is interned
+    unsigned long count;
+    unsigned long capacity;
+} TokenBuffer;
+
+// edit of resident contents: removed_length bytes at start were replaced by
+// inserted_length bytes
+typedef struct LexerEditStruct {
+    unsigned long start;
+    unsigned long removed_length;
+    unsigned long inserted_length;
+} LexerEdit;
+
+// zero bytes required after contents by the table-driven engine
+#define LEXER_PADDING 16
+
+// token recognition engines behind lexerGetNextToken
+typedef enum {
+    LEXER_ENGINE_SWITCH, // character-by-character with bounds checks
+    LEXER_ENGINE_DFA,    // character class and transition tables, padded input
+} LexerEngine;
+
 typedef struct LexerStruct {
     const char *contents;
     unsigned long content_length;
     unsigned long index;
     unsigned long read_index;
-    unsigned long line_number;
-    unsigned long curr_line_start;
     char ch;
+    int skipping; // inside lexerSkipWhitespace
+    LexerEngine engine;
+    const ScanKernels *scan;  // whitespace, comment and string body kernels
+    InternTable *symbols;     // borrowed, identifiers are interned when set
+    Diagnostics *diagnostics; // borrowed, errors are collected when set
+
+    // line numbers are resolved on demand, never tracked while lexing
+    LineIndex line_index; // resident contents, built on the first lookup
+    LineCursor line_cursor; // streaming contents, advanced on lookups
+
+    // streaming mode: contents is a window at content_base of the input
+    int stream_fd; // -1 when contents are fully resident
+    int stream_eof;
+    char *stream_buffer;
+    unsigned long stream_capacity;
+    unsigned long content_base;
 } Lexer;
 
-// start lexical analysis
-Lexer *initLexer(const char *contents);
+// start lexical analysis over content_length bytes (no NUL terminator needed)
+Lexer *initLexer(const char *contents, unsigned long content_length);
+
+// start lexical analysis reading file_desc in chunks with bounded memory
+// (token slices stay valid until the next lexerGetNextToken call)
+Lexer *initLexerStream(int file_desc);
 
 // free lexer allocated memory
 void lexerCleanUp(Lexer **lexer);
 
+// select the engine of lexerGetNextToken (LEXER_ENGINE_DFA requires resident
+// contents followed by LEXER_PADDING zero bytes, fails on streaming lexers)
+int lexerSetEngine(Lexer *lexer, LexerEngine engine);
+
+// intern every identifier lexed from now on into symbols (NULL stops),
+// lexers on many threads may share one table
+void lexerSetSymbols(Lexer *lexer, InternTable *symbols);
+
+// collect the errors reported on lexer (lexerErrorHandler, parseReportError)
+// into diagnostics instead of writing each one out (NULL stops)
+void lexerSetDiagnostics(Lexer *lexer, Diagnostics *diagnostics);
+
 // iterate lexer to create and return tokens (tokenization and classification)
-Token *lexerGetNextToken(Lexer *lexer);
+Token lexerGetNextToken(Lexer *lexer);
+
+// table-driven engine, same token stream as the default switch engine
+Token lexerDfaGetNextToken(Lexer *lexer);
+
+// token builder slicing lexer->index to lexer->read_index (shared by engines)
+Token tokenCreate(Lexer *lexer, TokenType type);
+
+// tokenCreate interning identifiers by the hash taken while scanning them
+Token tokenCreateIdentifier(Lexer *lexer, TokenType type, uint32_t hash);
+
+// detect if given identifier is a reserved keyword and return the type
+TokenType lexerIdReservedKeyword(const char *ident, unsigned long len);
+
+// pointer to the lexeme of token in the buffered lexer contents
+const char *lexerGetLexeme(const Lexer *lexer, const Token *token);
+
+// line and column (from 1) of the character at an input offset, streaming
+// lexers resolve offsets of the current token or later only. A line index
+// that cannot be built is reported to out.
+int lexerGetPosition(Lexer *lexer, unsigned long offset, unsigned long *line,
+                     unsigned long *column, FILE *out);
+
+// lex all of lexer->contents into a zero-initialized buffer up to TK_EOF,
+// buffer limit and allocation errors are printed to out (as by the functions
+// below)
+int lexerTokenizeAll(Lexer *lexer, TokenBuffer *buffer, FILE *out);
+
+// lex into buffer up to TK_EOF or the first other token starting at or after
+// end, leaving the lexer where that token would be lexed again
+int lexerTokenizeRange(Lexer *lexer, TokenBuffer *buffer, unsigned long end,
+                       FILE *out);
+
+// lex the resident contents of a fresh lexer on thread_count threads (0 for
+// one per core) in ranges of about chunk_size bytes (0 for a default), giving
+// the tokens of lexerTokenizeAll
+int lexerTokenizeParallel(Lexer *lexer, unsigned int thread_count,
+                          unsigned long chunk_size, TokenBuffer *buffer,
+                          FILE *out);
+
+// point a resident lexer at contents after edit and update buffer, the tokens
+// of the contents before it, relexing only from the last token before the
+// edit until the tokens line up with the old stream again
+int lexerRelex(Lexer *lexer, const char *contents, unsigned long content_length,
+               const LexerEdit *edit, TokenBuffer *buffer, FILE *out);
+
+// append the token last produced by lexer to buffer
+int tokenBufferAppend(TokenBuffer *buffer, const Lexer *lexer,
+                      const Token *token, FILE *out);
+
+// add the symbols array (zeroed) to a buffer without one
+int tokenBufferTrackSymbols(TokenBuffer *buffer, FILE *out);
+
+// grow token buffer arrays to hold at least capacity tokens
+int tokenBufferReserve(TokenBuffer *buffer, unsigned long capacity,
+                       FILE *out);
 
-// free token allocated memory
-void tokenCleanup(Token **token);
+// free token buffer arrays
+void tokenBufferCleanup(TokenBuffer *buffer);
 
-// pass tokens here to filter TK_ERR and TK_ILLEGAL types
-int lexerErrorHandler(Lexer *lexer, Token *token, const char *filename);
+// pass tokens here to filter TK_ERR and TK_ILLEGAL types, reporting them to
+// the diagnostics of lexer or, without any, writing each one to out
+int lexerErrorHandler(Lexer *lexer, const Token *token, const char *filename,
+                      FILE *out);
 
 // for printing actual TokenType string
 static const char *const tk_map[] = {
-    "TK_ILLEGALCHR",
-    "TK_EMPTYCHERR",
-    "TK_MULTICHERR",
-    "TK_FLOATERR",
-    "TK_STREOFERR",
-    "TK_EOF",
-    "TK_IDENTIFIER",
-    "TK_CHARACLIT",
-    "TK_STRINGLIT",
-    "TK_INTLIT",
-    "TK_FLTLIT",
-    "TK_AMPERSAND",
-    "TK_AND",
-    "TK_OR",
-    "TK_BANG",
-    "TK_PLUS",
-    "TK_MINUS",
-    "TK_ASTERISK",
-    "TK_EXPONENT",
-    "TK_SLASH",
-    "TK_FLOORDIV",
-    "TK_MODULO",
-    "TK_ASSIGN",
-    "TK_ASSIGNINC",
-    "TK_ASSIGNDEC",
-    "TK_ASSIGNMUL",
-    "TK_ASSIGNDIV",
-    "TK_ASSIGNMOD",
-    "TK_INCREMENT",
-    "TK_DECREMENT",
-    "TK_EQUAL",
-    "TK_GT",
-    "TK_GEQUAL",
-    "TK_LT",
-    "TK_LEQUAL",
-    "TK_NOTEQUAL",
-    "TK_COMMA",
-    "TK_DOT",
-    "TK_SEMICOLON",
-    "TK_COLON",
-    "TK_LPAREN",
-    "TK_RPAREN",
-    "TK_LBRACKET",
-    "TK_RBRACKET",
-    "TK_LCURLY",
-    "TK_RCURLY",
-    "TK_INT",
-    "TK_CHAR",
-    "TK_FLOAT",
-    "TK_DOUBLE",
-    "TK_BOOL",
-    "TK_VOID",
-    "TK_GOTO",
-    "TK_SWITCH",
-    "TK_CASE",
-    "TK_BREAK",
-    "TK_OUT",
-    "TK_IN",
-    "TK_FUNCTION",
-    "TK_LET",
-    "TK_TRUE",
-    "TK_FALSE",
-    "TK_IF",
-    "TK_ELSE",
-    "TK_WHILE",
-    "TK_CONTINUE",
-    "TK_RETURN",
+#define TOKEN(type) #type,
+#define KEYWORD(type, word) #type,
+#include "tokens.def"
+#undef KEYWORD
+#undef TOKEN
 };
 
 #endif // LEXER_H_
@@ -0,0 +1,54 @@
+// 'lineidx.h' - line and column lookup by input offset
+//
+// Resident contents get an index of every line start, built in one pass of
+// the newline scan kernel the first time a position is needed, and looked
+// up by binary search. Edits replace the starts inside the edited range and
+// shift the ones after it. Streaming contents cannot be indexed up front, so
+// a cursor counts newlines up to each offset resolved (offsets only grow).
+
+#ifndef LINEIDX_H_
+#define LINEIDX_H_
+
+#include "scan.h"
+
+#include <stdio.h>
+
+typedef struct LineIndexStruct {
+    unsigned long *starts; // offset of the first character of every line
+    unsigned long count;
+    unsigned long capacity;
+    unsigned long hint; // line of the last lookup, tried first
+} LineIndex;
+
+typedef struct LineCursorStruct {
+    unsigned long offset;     // input offset counted up to
+    unsigned long line;       // line number at offset (from 1)
+    unsigned long line_start; // input offset of that line's first character
+} LineCursor;
+
+// index the line starts of length bytes of contents, allocation failures are
+// printed to out
+int lineIndexBuild(LineIndex *index, const ScanKernels *scan,
+                   const char *contents, unsigned long length, FILE *out);
+
+// line number (from 1) and line start of the character at offset
+void lineIndexFind(LineIndex *index, unsigned long offset,
+                   unsigned long *line, unsigned long *line_start);
+
+// update a built index after removed_length bytes at start were replaced by
+// inserted_length bytes, contents being the edited input
+int lineIndexEdit(LineIndex *index, const ScanKernels *scan,
+                  const char *contents, unsigned long start,
+                  unsigned long removed_length, unsigned long inserted_length,
+                  FILE *out);
+
+// free line start array
+void lineIndexCleanup(LineIndex *index);
+
+// count newlines from the cursor up to the input offset, reading them from
+// window (the input bytes starting at input offset window_base)
+void lineCursorAdvance(LineCursor *cursor, const ScanKernels *scan,
+                       const char *window, unsigned long window_base,
+                       unsigned long offset);
+
+#endif // LINEIDX_H_
@@ -3,13 +3,41 @@
 #ifndef OPTFLAGS_H_
 #define OPTFLAGS_H_
 
-// access file argument names with 'inputfile' and 'outputfile'
-extern const char *inputfile;  // access the specified file
-extern const char *outputfile; // output executable name
-extern const char *symbolfile;  // write symbol table to file
-extern int symbolout;  // print symbol table to stdout
-
-// detect argument type ( -h || -o <outputfile> [-s] || -v ) && inputfile
-extern int parseOptionFlags(int argc, char *argv[]);
+#include "compile.h" // CompileOptions
+
+// arguments with '@file' expanded, inputfiles point into it
+typedef struct ArgumentListStruct {
+    char **values;
+    int count;
+    int capacity;
+} ArgumentList;
+
+// access file argument names with 'inputfiles' and 'outputfile'
+typedef struct OptionFlagsStruct {
+    const char **inputfiles;       // files to compile in argument order
+    unsigned long inputfile_count; // number of inputfiles
+    const char *outputfile;        // -o executable name, NULL for none
+    const char *symbolfile;        // write symbol table to file
+    unsigned int jobcount;         // batch worker threads, 0 for one per core
+    int statsformat;               // StatsFormat selected with --stats
+    const char *serversocket;      // --server socket path, NULL for none
+    const char *connectsocket;     // --connect socket path, NULL for none
+    int watch;                     // --watch compiles again on every save
+    CompileOptions compile; // -S, -O, -o, --engine, --lex-threads, --rtok,
+                            // --ast, --run, --dispatch, --bytecode,
+                            // --runtime, --diagnostics, --error-limit
+    ArgumentList arguments;
+} OptionFlags;
+
+// detect argument type ( -h || -o <outputfile> [-s] || -v ) && inputfiles,
+// expanding '@file' arguments to the whitespace separated words in file
+int parseOptionFlags(OptionFlags *flags, int argc, char *argv[]);
+
+// compile the input files of parsed flags, printing to out and the --stats
+// report to err, returns 1 when any file failed
+int runOptionFlags(const OptionFlags *flags, FILE *out, FILE *err);
+
+// free expanded arguments and input file list
+void cleanupOptionFlags(OptionFlags *flags);
 
 #endif // !OPTFLAGS_H_
@@ -0,0 +1,49 @@
+// `optimize.h` - header file for the bytecode optimizer of renaisscript
+//
+// `optimize.c` rewrites a compiled VmProgram (see bytecode.h) in place
+// before it runs. Passes work on the register instructions directly:
+//
+//   fold         constant folding and propagation within basic blocks,
+//                operands known small become immediates (ADDI, EQI, ...)
+//   cse          local value numbering, repeated expressions become MOVEs
+//   branches     conditional jumps on known values, jump threading and
+//                removal of unreachable code and jumps to the next
+//                instruction
+//   dead-stores  liveness across the blocks of each function, pure
+//                instructions writing a register never read are removed
+//
+// -O1 runs fold and branches, -O2 every pass. Instructions that may fail
+// at run time (division by a register, indexing, calls, input) are never
+// removed or folded into a different result.
+
+#ifndef OPTIMIZE_H_
+#define OPTIMIZE_H_
+
+#include "bytecode.h" // VmProgram
+
+#define OPTIMIZE_MAX_LEVEL 2
+
+typedef enum OptimizePassEnum {
+    OPTIMIZE_FOLD,
+    OPTIMIZE_CSE,
+    OPTIMIZE_BRANCHES,
+    OPTIMIZE_DEAD_STORES,
+    OPTIMIZE_PASS_COUNT,
+} OptimizePass;
+
+extern const char *const optimize_pass_names[OPTIMIZE_PASS_COUNT];
+
+// instruction counts of --stats, a LOADKX and its constant word count once
+typedef struct OptimizeStatsStruct {
+    unsigned long instructions;                   // before the first pass
+    unsigned long rewritten[OPTIMIZE_PASS_COUNT]; // changed in place
+    unsigned long removed[OPTIMIZE_PASS_COUNT];   // deleted
+} OptimizeStats;
+
+// run the passes of level (0 to OPTIMIZE_MAX_LEVEL) over program, adding
+// instructions rewritten and removed by each pass to stats (when non-NULL),
+// running out of memory is printed to out
+int optimizeProgram(VmProgram *program, int level, OptimizeStats *stats,
+                    FILE *out);
+
+#endif // OPTIMIZE_H_
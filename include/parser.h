@@ -0,0 +1,33 @@
+// `parser.h` - header file for the renaisscript recursive-descent parser
+//
+// `parser.c` builds an Ast (see ast.h) from a lexed token buffer in one pass
+// without backtracking. Syntax errors are reported with the line of source
+// they were found on (see diag.h), then the parser skips to the next
+// statement and goes on, so one run reports every statement that fails to
+// parse. Tokens with lexical errors were already reported by
+// lexerErrorHandler and only make their statement fail.
+
+#ifndef PARSER_H_
+#define PARSER_H_
+
+#include "ast.h"   // Ast
+#include "lexer.h" // Lexer, TokenBuffer
+
+#include <stdio.h>
+
+#define PARSER_MAX_DEPTH 256 // nested statements and expressions
+
+// parse the tokens of lexer's resident contents into ast, printing syntax
+// errors to out. ast holds the statements parsed even on failure and is
+// freed with astCleanup either way.
+int parseTokens(Lexer *lexer, const TokenBuffer *tokens, const char *filename,
+                FILE *out, Ast *ast);
+
+// report an error at token index with the line of source it is on to the
+// diagnostics of lexer (or straight to out without any), nothing at tokens
+// with lexical errors (lexerErrorHandler reported those)
+void parseReportError(Lexer *lexer, const TokenBuffer *tokens, uint32_t index,
+                      const char *filename, FILE *out, const char *message,
+                      const char *code);
+
+#endif // PARSER_H_
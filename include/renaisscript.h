@@ -0,0 +1,36 @@
+// `renaisscript.h` - public interface of the librenaisscript front end
+//
+// The library keeps no process-wide state: a Lexer, TokenBuffer, Ast,
+// VmProgram, RensFile, StringOutput or RtokFile holds everything one file
+// needs, and compiles and runs take their settings in CompileOptions and
+// VmRunOptions. Any number of threads may lex, parse, compile and run at
+// once as long as each of those objects is used by one thread at a time.
+// Contents may be shared read-only between lexers. Errors are printed to
+// stdout (or the FILE given) and reported by a nonzero return, errors of
+// source files are collected by a Diagnostics set on their Lexer.
+//
+// The renaisscript executable is a client of this interface, argument
+// parsing (optflags.h), allocation counting (allocstat.h), the compile
+// server (server.h) and --watch (watch.h) stay in it.
+
+#ifndef RENAISSCRIPT_H_
+#define RENAISSCRIPT_H_
+
+#include "ast.h"      // index-based syntax tree
+#include "bytecode.h" // bytecodeCompile, VmProgram
+#include "cache.h"    // on-disk compile cache
+#include "codegen.h"  // codegenBuild
+#include "compile.h"  // compileRensFile, compileRensFiles, CompileOptions
+#include "cursor.h"   // TokenCursor lookahead
+#include "diag.h"     // Diagnostics, JSON and SARIF output
+#include "fileread.h" // RensFile, StringOutput
+#include "intern.h"   // concurrent identifier interning
+#include "lexer.h"    // Lexer, TokenBuffer, lexerRelex
+#include "optimize.h" // optimizeProgram
+#include "parser.h"   // parseTokens
+#include "rtok.h"     // binary token files
+#include "stats.h"    // CompileStats
+#include "symtab.h"   // symbol table of a parsed file
+#include "vm.h"       // vmRun
+
+#endif // RENAISSCRIPT_H_
@@ -0,0 +1,79 @@
+// `rtok.h` - header file for the binary token stream format (.rtok)
+//
+// `rtok.c` writes lexed tokens as fixed-size records after a versioned header
+// and reads them back through a read-only mapping, so tools iterate tokens
+// straight from the file without parsing. Layout (all offsets from the start
+// of the file, integers in the writer's byte order, see byte_order):
+//
+//   RtokHeader                      64 bytes
+//   type names                      type_count NUL terminated tk_map names
+//   RtokRecord[token_count]         at records_offset, 4 byte aligned
+//   source bytes (optional)         source_length bytes at source_offset
+//
+// Version 1 records hold the lexeme slice (quotes of literals excluded) and
+// the line and column of the token's first character, TK_EOF is not stored.
+
+#ifndef RTOK_H_
+#define RTOK_H_
+
+#include "lexer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define RTOK_VERSION 1
+#define RTOK_BYTE_ORDER 0x0102 // reads 0x0201 on a host of the other order
+#define RTOK_HAS_SOURCE 0x1    // flags: source bytes follow the records
+
+typedef struct RtokHeaderStruct {
+    char magic[4]; // "RTOK"
+    uint16_t version;
+    uint16_t byte_order;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t type_count; // TK_TYPE_COUNT of the writer
+    uint32_t flags;
+    uint64_t token_count;
+    uint64_t names_offset;
+    uint64_t records_offset;
+    uint64_t source_offset; // 0 without RTOK_HAS_SOURCE
+    uint64_t source_length; // bytes of source lexed
+} RtokHeader;
+
+typedef struct RtokRecordStruct {
+    uint32_t offset; // lexeme start in the source
+    uint32_t length; // lexeme length in bytes
+    uint32_t line;   // from 1
+    uint32_t column; // from 1
+    uint8_t type;    // index into the type names
+    uint8_t reserved[3];
+} RtokRecord;
+
+// token file opened for reading, every pointer points into the mapping
+typedef struct RtokFileStruct {
+    const RtokHeader *header;
+    const RtokRecord *records;
+    unsigned long token_count;
+    const char *source; // NULL without RTOK_HAS_SOURCE
+    const char *type_names[256];
+    void *data;
+    unsigned long data_length;
+    int mapped;
+} RtokFile;
+
+// write the tokens lexerTokenizeAll gave for the resident contents of lexer
+// to file, with the source bytes when with_source is set, errors are printed
+// to out
+int rtokWrite(FILE *file, Lexer *lexer, const TokenBuffer *tokens,
+              int with_source, FILE *out);
+
+// map and validate a token file, errors are printed to out
+int rtokOpen(const char *filename, RtokFile *file, FILE *out);
+
+// name of a record type, "?" when out of range
+const char *rtokTypeName(const RtokFile *file, unsigned int type);
+
+// unmap or free a token file
+void rtokClose(RtokFile *file);
+
+#endif // RTOK_H_
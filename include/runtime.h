@@ -0,0 +1,58 @@
+// `runtime.h` - header file for the runtime of native renaisscript programs
+//
+// `runtime.c` is built into librenaisscript_rt.a, the archive codegen.c
+// links executables against. It holds `main`, the register stack and the
+// instructions too large to inline: printing, input, strings and arrays.
+// Values print exactly as vmRun prints them. Strings and arrays are never
+// freed, the process ends with the program. Reports of runtime errors are
+// rendered while compiling and passed in whole, see codegen.c.
+
+#ifndef RUNTIME_H_
+#define RUNTIME_H_
+
+#include "bytecode.h" // VmValue, VmArray
+
+#include <stdint.h>
+
+#define RT_THREAD_STACK (64UL << 20) // machine stack of the program thread
+
+// emitted by codegen.c: run function 0 in the register window at stack,
+// calls fail once a window would pass stack_end
+int64_t rtProgram(VmValue *stack, VmValue *stack_end);
+
+// print report (a RUNTIME_ERROR) after the output so far and exit 1
+_Noreturn void rtError(const char *report);
+
+void rtPrintCount(int64_t value);
+void rtPrintPortion(double value);
+void rtPrintGlyph(int64_t value);
+void rtPrintVerdict(int64_t value);
+void rtPrintString(const char *value);
+void rtPrintNewline(void);
+
+// a line of input each, output is flushed first
+int64_t rtReadCount(void);
+double rtReadPortion(void);
+int64_t rtReadGlyph(void);
+int64_t rtReadVerdict(void);
+const char *rtReadString(const char *memory_report);
+
+// count semantics of vmarith.h for the generated code
+int64_t rtFloorDivide(int64_t dividend, int64_t divisor);
+int64_t rtPower(int64_t base, int64_t exponent);
+int64_t rtTruncate(double value);
+
+// zeroed elements, length is not negative
+VmArray *rtNewArray(int64_t length, const char *memory_report);
+
+// glyph index of text, failing with report past its end
+int64_t rtGetChar(const char *text, int64_t index, const char *report);
+
+const char *rtConcat(const char *left, const char *right,
+                     const char *memory_report);
+const char *rtCountText(int64_t value, const char *memory_report);
+const char *rtPortionText(double value, const char *memory_report);
+const char *rtGlyphText(int64_t value, const char *memory_report);
+const char *rtVerdictText(int64_t value);
+
+#endif // RUNTIME_H_
@@ -0,0 +1,45 @@
+// 'scan.h' - byte scanning kernels behind whitespace, comment and string loops
+//
+// Each kernel looks at text[pos] up to (not including) text[end] and returns
+// the index of the first byte it stops at, or end when none was found. The
+// SSE2 and AVX2 variants compare 16 or 32 bytes at a time and are selected at
+// runtime from the CPU features, the scalar variant is the reference.
+
+#ifndef SCAN_H_
+#define SCAN_H_
+
+// kernel variants, ordered by preference
+typedef enum {
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2,
+    SCAN_COUNT,
+} ScanLevel;
+
+typedef struct ScanKernelsStruct {
+    const char *name;
+
+    // first '\n' (line comment end)
+    unsigned long (*find_newline)(const char *text, unsigned long pos,
+                                  unsigned long end);
+
+    // first '#' or zero byte (block comment end)
+    unsigned long (*find_comment_end)(const char *text, unsigned long pos,
+                                      unsigned long end);
+
+    // first '"', '\\' or zero byte (string literal body end or escape)
+    unsigned long (*find_string_special)(const char *text, unsigned long pos,
+                                         unsigned long end);
+
+    // first byte other than ' ', '\t', '\r' and '\n'
+    unsigned long (*skip_blanks)(const char *text, unsigned long pos,
+                                 unsigned long end);
+} ScanKernels;
+
+// kernels of the given variant, NULL when the CPU or compiler lacks it
+const ScanKernels *scanGetKernels(ScanLevel level);
+
+// fastest kernels supported by the running CPU
+const ScanKernels *scanGetBestKernels(void);
+
+#endif // SCAN_H_
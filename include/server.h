@@ -0,0 +1,22 @@
+// `server.h` - header file for the compile server of renaisscript
+//
+// A server (--server=<socket>) stays running on a Unix domain socket so
+// clients (--connect=<socket>) skip process start and allocator warm up on
+// every compile. Clients send their working directory, stdin (for --run)
+// and arguments; the server parses and compiles them exactly as the command
+// line would and sends back what it printed and its exit status.
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include "optflags.h" // OptionFlags
+
+// accept requests on socket_path with thread_count workers (0 for one per
+// core) until SIGINT, SIGTERM or SIGHUP, then remove the socket
+int serverListen(const char *socket_path, unsigned int thread_count);
+
+// compile the files of flags on the server of socket_path, printing its
+// output to stdout and stderr, returns the server's exit status
+int serverRequest(const char *socket_path, const OptionFlags *flags);
+
+#endif // SERVER_H_
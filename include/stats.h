@@ -0,0 +1,64 @@
+// `stats.h` - header file for --stats compile instrumentation
+//
+// `stats.c` times compile phases on the monotonic clock and prints the
+// report. Timings, token and instruction counts and bytes read are gathered
+// per file and summed in input order, so batch phase times add up over
+// files and may exceed the wall time. Peak RSS is read for the whole
+// process when printing, heap allocations are passed in by the program
+// counting them (see allocstat.h).
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include "allocstat.h" // AllocStat
+#include "lexer.h"     // TK_TYPE_COUNT
+#include "optimize.h"  // OptimizeStats
+
+#include <stdio.h>
+
+// output selected with --stats[=human|json]
+typedef enum StatsFormatEnum {
+    STATS_NONE,
+    STATS_HUMAN,
+    STATS_JSON,
+} StatsFormat;
+
+typedef enum StatsPhaseEnum {
+    STATS_READ,        // getRensFileContents
+    STATS_LEX,         // tokenizing (stdin also reports and collects here)
+    STATS_DIAGNOSTICS, // lexerErrorHandler over every token
+    STATS_PARSE,       // syntax tree of --ast and --run
+    STATS_BYTECODE,    // bytecode compiler of --run
+    STATS_OPTIMIZE,    // bytecode passes of -O
+    STATS_CODEGEN,     // native code of -o, assembled and linked
+    STATS_RUN,         // virtual machine of --run
+    STATS_SYMBOLS,     // symbol table rows and token file output
+    STATS_CACHE,       // --cache lookups, stores and evictions
+    STATS_PHASE_COUNT,
+} StatsPhase;
+
+typedef struct CompileStatsStruct {
+    double phase_seconds[STATS_PHASE_COUNT];
+    unsigned long token_counts[TK_TYPE_COUNT]; // TK_EOF not counted
+    unsigned long bytes_read;
+    unsigned long files;
+    unsigned long cache_hits;   // files replayed from --cache
+    unsigned long cache_misses; // files compiled and stored in --cache
+    OptimizeStats optimize; // instructions compiled and changed by -O
+} CompileStats;
+
+// monotonic clock in seconds, 0 without stats (no clock read)
+double statsClock(const CompileStats *stats);
+
+// add the time since start to phase, returns the clock for the next phase
+double statsLap(CompileStats *stats, StatsPhase phase, double start);
+
+// add stats of one file to total
+void statsAdd(CompileStats *total, const CompileStats *stats);
+
+// print the report with allocs (NULL when not counted) and the process peak
+// RSS to out
+void statsPrint(const CompileStats *stats, double total_seconds,
+                const AllocStat *allocs, StatsFormat format, FILE *out);
+
+#endif // STATS_H_
@@ -0,0 +1,55 @@
+// `symtab.h` - header file for the symbol table of a parsed file
+//
+// `symtab.c` gathers the names of a syntax tree by interned symbol (see
+// intern.h and lexerSetSymbols): the kind and token of the first
+// definition and how often the name is referenced. Rows come in source
+// order of the first definition, names never defined follow in order of
+// their first reference. Names the lexer left uninterned are not listed.
+
+#ifndef SYMTAB_H_
+#define SYMTAB_H_
+
+#include "ast.h"    // Ast
+#include "intern.h" // InternTable
+#include "lexer.h"  // Lexer
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum SymbolKindEnum {
+    SYMBOL_UNDEFINED, // referenced, never defined
+    SYMBOL_FUNCTION,
+    SYMBOL_PARAMETER,
+    SYMBOL_VARIABLE,
+    SYMBOL_ARRAY,
+    SYMBOL_LABEL,
+    SYMBOL_KIND_COUNT,
+} SymbolKind;
+
+extern const char *const symbol_kind_names[SYMBOL_KIND_COUNT];
+
+typedef struct SymbolRowStruct {
+    uint32_t symbol;
+    uint32_t definition; // token of the first definition, or first reference
+    uint32_t references; // identifiers and labels of cease, persist, thither
+    uint8_t kind;        // SymbolKind of the first definition
+} SymbolRow;
+
+typedef struct SymbolTableStruct {
+    SymbolRow *rows;
+    uint32_t row_count;
+} SymbolTable;
+
+// collect a row for every interned name of ast, allocation failures are
+// printed to out
+int symtabBuild(SymbolTable *table, const Ast *ast, FILE *out);
+
+// print the rows with names from names and positions from the tokens of
+// lexer's resident contents
+int symtabPrint(const SymbolTable *table, const Ast *ast, Lexer *lexer,
+                const InternTable *names, FILE *out);
+
+// free the rows
+void symtabCleanup(SymbolTable *table);
+
+#endif // SYMTAB_H_
@@ -0,0 +1,29 @@
+// `threadpool.h` - work-stealing thread pool over a fixed set of tasks
+//
+// Tasks are numbered 0 to task_count - 1 and dealt round-robin to per-worker
+// queues. A worker takes its lowest numbered task first and, once its queue
+// runs dry, steals the highest numbered task of another worker, so early
+// tasks finish first and callers can consume results in task order.
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+typedef void (*ThreadPoolTask)(void *context, unsigned long index);
+
+typedef struct ThreadPoolStruct ThreadPool;
+
+// start thread_count workers running task(context, index) for every index
+ThreadPool *threadPoolCreate(unsigned int thread_count,
+                             unsigned long task_count, ThreadPoolTask task,
+                             void *context);
+
+// block until the task at index has finished
+void threadPoolWaitTask(ThreadPool *pool, unsigned long index);
+
+// wait for every task, join the workers and free the pool
+void threadPoolDestroy(ThreadPool **pool);
+
+// number of online processors, at least 1
+unsigned int threadPoolCoreCount(void);
+
+#endif // THREADPOOL_H_
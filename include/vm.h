@@ -0,0 +1,58 @@
+// `vm.h` - header file for the renaisscript virtual machine
+//
+// `vm.c` executes a VmProgram (see bytecode.h) on a fixed register stack.
+// The dispatch loop is compiled twice from `vmloop.h`: threaded with
+// computed goto (one indirect jump at the end of every handler) where the
+// compiler supports labels as values, and as a switch in a loop everywhere.
+// Strings and arrays made while running live until the run ends. A run
+// keeps all of its state in its own stack frame and heap, so programs may
+// run on any number of threads at once.
+
+#ifndef VM_H_
+#define VM_H_
+
+#include "bytecode.h" // VmProgram
+#include "lexer.h"    // Lexer
+#include "vmarith.h"  // count semantics, VM_PORTION_FORMAT
+
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined(__GNUC__)
+#define VM_HAVE_COMPUTED_GOTO 1
+#else
+#define VM_HAVE_COMPUTED_GOTO 0
+#endif
+
+#define VM_STACK_SIZE (1UL << 20) // registers of all frames
+#define VM_MAX_FRAMES 65536       // nested calls
+
+// dispatch loops, goto falls back to switch without computed goto
+typedef enum VmDispatchEnum {
+    VM_DISPATCH_GOTO,
+    VM_DISPATCH_SWITCH,
+} VmDispatch;
+
+typedef struct VmRunOptionsStruct {
+    VmDispatch dispatch;
+    int count_instructions; // slower loop filling VmResult.instructions
+    FILE *in;               // heareth input
+    FILE *out;              // sayeth output and runtime errors
+    Lexer *lexer;           // positions of runtime errors
+    const char *filename;
+} VmRunOptions;
+
+typedef struct VmResultStruct {
+    int64_t exit_value;        // returned by the top level or main
+    unsigned long instructions; // executed, with count_instructions only
+} VmResult;
+
+// goto dispatch, no counting, stdin and stdout, errors positioned in lexer
+void vmRunOptionsDefault(VmRunOptions *options, Lexer *lexer,
+                         const char *filename);
+
+// run program from function 0, 1 on a runtime error (printed to out)
+int vmRun(const VmProgram *program, const VmRunOptions *options,
+          VmResult *result);
+
+#endif // VM_H_
@@ -0,0 +1,57 @@
+// `vmarith.h` - count and conversion semantics of the renaisscript machine
+//
+// One definition shared by the loops of vm.c, constant folding in
+// optimize.c and the runtime library of native executables (runtime.c),
+// so every way of running a program computes the same values.
+
+#ifndef VMARITH_H_
+#define VMARITH_H_
+
+#include <stdint.h>
+
+#define VM_PORTION_FORMAT "%.15g" // text of portions and fractions
+
+// quotient rounded toward negative infinity, divisor is not 0
+static inline int64_t vmFloorDivide(int64_t dividend, int64_t divisor) {
+    if (divisor == -1) {
+        return (int64_t)(0 - (uint64_t)dividend);
+    }
+    int64_t quotient = dividend / divisor;
+    if (dividend % divisor != 0 && (dividend < 0) != (divisor < 0)) {
+        quotient--;
+    }
+    return quotient;
+}
+
+// square and multiply, wrapping like the other count operators
+static inline int64_t vmPower(int64_t base, int64_t exponent) {
+    if (exponent < 0) {
+        return base == 1 ? 1 : base == -1 ? (exponent % 2 ? -1 : 1) : 0;
+    }
+    uint64_t result = 1;
+    uint64_t square = (uint64_t)base;
+    while (exponent > 0) {
+        if (exponent & 1) {
+            result *= square;
+        }
+        square *= square;
+        exponent >>= 1;
+    }
+    return (int64_t)result;
+}
+
+// portion to count, saturating instead of undefined past the range
+static inline int64_t vmTruncate(double value) {
+    if (value != value) {
+        return 0;
+    }
+    if (value >= 9223372036854775807.0) {
+        return INT64_MAX;
+    }
+    if (value <= -9223372036854775808.0) {
+        return INT64_MIN;
+    }
+    return (int64_t)value;
+}
+
+#endif // VMARITH_H_
@@ -0,0 +1,20 @@
+// `watch.h` - header file for the --watch mode of renaisscript
+//
+// `watch.c` compiles the input files once, then again whenever they are
+// saved, each file kept lexed in memory (see CompileUnit) so a save relexes
+// only the bytes it changed. Only files whose contents changed print their
+// output again.
+
+#ifndef WATCH_H_
+#define WATCH_H_
+
+#include "optflags.h" // OptionFlags
+
+#include <stdio.h>
+
+// compile the files of flags on every save until interrupted, printing to
+// out and --stats reports of each round to err, returns 1 when watching
+// fails
+int watchFiles(const OptionFlags *flags, FILE *out, FILE *err);
+
+#endif // WATCH_H_
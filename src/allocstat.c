@@ -0,0 +1,64 @@
+// allocstat header implementation
+//
+// `allocstat.c` defines the linker wrapped allocation functions. Counters are
+// relaxed atomics since batch and parallel lexing allocate on many threads.
+
+#include "allocstat.h"
+
+#include <stddef.h>
+
+#ifdef ALLOCSTAT_WRAP
+#include <stdatomic.h>
+
+static atomic_ulong allocstat_count;
+static atomic_ulong allocstat_bytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t count, size_t size);
+void *__wrap_realloc(void *pointer, size_t size);
+
+static void allocStatAdd(unsigned long bytes);
+#endif
+
+/// PUBLIC FUNCTIONS
+
+// read the counters, returns 1 (and zeroes) when allocations are not wrapped
+int allocStatGet(AllocStat *stat) {
+#ifdef ALLOCSTAT_WRAP
+    stat->count = atomic_load_explicit(&allocstat_count, memory_order_relaxed);
+    stat->bytes = atomic_load_explicit(&allocstat_bytes, memory_order_relaxed);
+    return 0;
+#else
+    stat->count = 0;
+    stat->bytes = 0;
+    return 1;
+#endif
+}
+
+#ifdef ALLOCSTAT_WRAP
+void *__wrap_malloc(size_t size) {
+    allocStatAdd(size);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocStatAdd(count * size);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+    allocStatAdd(size);
+    return __real_realloc(pointer, size);
+}
+
+/// PRIVATE FUNCTIONS
+
+static void allocStatAdd(unsigned long bytes) {
+    atomic_fetch_add_explicit(&allocstat_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&allocstat_bytes, bytes, memory_order_relaxed);
+}
+#endif // ALLOCSTAT_WRAP
@@ -0,0 +1,44 @@
+// arena header implementation
+//
+// `arena.c` takes the block from malloc, so large arenas are mapped lazily
+// by the system and bytes reserved but never allocated cost no memory.
+
+#include "arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/// PUBLIC FUNCTIONS
+
+// reserve a block of capacity bytes, a failure is printed to out
+int arenaInit(Arena *arena, unsigned long capacity, FILE *out) {
+    arena->base = malloc(capacity > 0 ? capacity : 1);
+    arena->used = 0;
+    arena->capacity = capacity;
+    if (arena->base == NULL) {
+        arena->capacity = 0;
+        fprintf(out, "ERROR: arena memory allocation failure "
+                     "[ARENA_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+    return 0;
+}
+
+// size bytes aligned to align (a power of two), NULL when the block is full
+void *arenaAlloc(Arena *arena, unsigned long size, unsigned long align) {
+    unsigned long offset = (arena->used + align - 1) & ~(align - 1);
+    if (offset > arena->capacity || size > arena->capacity - offset) {
+        return NULL;
+    }
+
+    arena->used = offset + size;
+    return arena->base + offset;
+}
+
+// free the block and everything allocated from it
+void arenaCleanup(Arena *arena) {
+    free(arena->base);
+    arena->base = NULL;
+    arena->used = 0;
+    arena->capacity = 0;
+}
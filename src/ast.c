@@ -0,0 +1,239 @@
+// ast header implementation
+//
+// `ast.c` carves the node arrays and the extra array out of one arena sized
+// from the token count, so adding a node never reallocates and the whole
+// tree is freed with the arena. The printer walks the tree recursively, its
+// depth is bounded by the parser's nesting limit.
+
+#include "ast.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const char *const ast_kind_names[AST_KIND_COUNT] = {
+    [AST_ROOT] = "ROOT",
+    [AST_FUNCTION] = "FUNCTION",
+    [AST_PARAM] = "PARAM",
+    [AST_BLOCK] = "BLOCK",
+    [AST_VAR_DECL] = "VAR_DECL",
+    [AST_IF] = "IF",
+    [AST_WHILE] = "WHILE",
+    [AST_SWITCH] = "SWITCH",
+    [AST_CASE] = "CASE",
+    [AST_LABEL] = "LABEL",
+    [AST_BREAK] = "BREAK",
+    [AST_CONTINUE] = "CONTINUE",
+    [AST_GOTO] = "GOTO",
+    [AST_RETURN] = "RETURN",
+    [AST_EXPR_STMT] = "EXPR_STMT",
+    [AST_ASSIGN] = "ASSIGN",
+    [AST_BINARY] = "BINARY",
+    [AST_UNARY] = "UNARY",
+    [AST_POSTFIX] = "POSTFIX",
+    [AST_CALL] = "CALL",
+    [AST_INDEX] = "INDEX",
+    [AST_IDENTIFIER] = "IDENTIFIER",
+    [AST_BUILTIN] = "BUILTIN",
+    [AST_INTEGER] = "INTEGER",
+    [AST_FLOAT] = "FLOAT",
+    [AST_CHARACTER] = "CHARACTER",
+    [AST_STRING] = "STRING",
+    [AST_BOOLEAN] = "BOOLEAN",
+    [AST_WILDCARD] = "WILDCARD",
+};
+
+static void astPrintNode(const Ast *ast, const Lexer *lexer, uint32_t node,
+                         unsigned int depth, FILE *out);
+static void astPrintRange(const Ast *ast, const Lexer *lexer, uint32_t start,
+                          uint32_t end, unsigned int depth, FILE *out);
+static void astPrintToken(const Ast *ast, const Lexer *lexer, uint32_t index,
+                          FILE *out);
+
+/// PUBLIC FUNCTIONS
+
+// reserve the arena for a tree over tokens and add the root node
+int astInit(Ast *ast, const TokenBuffer *tokens, FILE *out) {
+    memset(ast, 0, sizeof(Ast));
+    ast->tokens = tokens;
+
+    // keeps 3 * (count + 1) extra words within 32 bits
+    if (tokens->count >= UINT32_MAX / 3) {
+        fprintf(out,
+                "ERROR: too many tokens for a syntax tree [AST_SIZE_ERROR]\n");
+        return 1;
+    }
+    unsigned long nodes = tokens->count + 1;
+    unsigned long extra = nodes * 3;
+
+    // u32 arrays first, then kinds, each aligned by the arena
+    unsigned long size = nodes * 3 * 4 + extra * 4 + nodes + 16;
+    if (arenaInit(&ast->arena, size, out)) {
+        return 1;
+    }
+    ast->main_tokens = arenaAlloc(&ast->arena, nodes * 4, 4);
+    ast->lhs = arenaAlloc(&ast->arena, nodes * 4, 4);
+    ast->rhs = arenaAlloc(&ast->arena, nodes * 4, 4);
+    ast->extra = arenaAlloc(&ast->arena, extra * 4, 4);
+    ast->kinds = arenaAlloc(&ast->arena, nodes, 1);
+    ast->node_capacity = (uint32_t)nodes;
+    ast->extra_capacity = (uint32_t)extra;
+
+    astAddNode(ast, AST_ROOT, 0, 0, 0);
+    return 0;
+}
+
+// append a node, returns its index (0 when the arena is full)
+uint32_t astAddNode(Ast *ast, AstKind kind, uint32_t main_token, uint32_t lhs,
+                    uint32_t rhs) {
+    if (ast->node_count == ast->node_capacity) {
+        return 0;
+    }
+
+    uint32_t node = ast->node_count++;
+    ast->kinds[node] = (uint8_t)kind;
+    ast->main_tokens[node] = main_token;
+    ast->lhs[node] = lhs;
+    ast->rhs[node] = rhs;
+    return node;
+}
+
+// append count words to extra, returns the index of the first
+uint32_t astAddExtra(Ast *ast, const uint32_t *words, uint32_t count) {
+    uint32_t start = ast->extra_count;
+    if (count > ast->extra_capacity - start) {
+        return start;
+    }
+
+    memcpy(ast->extra + start, words, count * sizeof(uint32_t));
+    ast->extra_count += count;
+    return start;
+}
+
+// print the tree one node per line, indented by depth, with the lexemes of
+// names, operators and literals
+int astPrint(const Ast *ast, const Lexer *lexer, FILE *out) {
+    if (ast->node_count == 0) {
+        return 1;
+    }
+    astPrintNode(ast, lexer, 0, 0, out);
+    return ferror(out) != 0;
+}
+
+// free every node at once
+void astCleanup(Ast *ast) {
+    arenaCleanup(&ast->arena);
+    memset(ast, 0, sizeof(Ast));
+}
+
+/// PRIVATE FUNCTIONS
+
+static void astPrintNode(const Ast *ast, const Lexer *lexer, uint32_t node,
+                         unsigned int depth, FILE *out) {
+    AstKind kind = (AstKind)ast->kinds[node];
+    uint32_t token = ast->main_tokens[node];
+    uint32_t lhs = ast->lhs[node];
+    uint32_t rhs = ast->rhs[node];
+    const uint8_t *types = ast->tokens->types;
+
+    fprintf(out, "%*s%s", depth * 2, "", ast_kind_names[kind]);
+    switch (kind) {
+    case AST_FUNCTION:
+    case AST_VAR_DECL:
+        // type and name follow the keyword
+        astPrintToken(ast, lexer, token + 1, out);
+        astPrintToken(ast, lexer, token + 2, out);
+        break;
+    case AST_PARAM:
+        astPrintToken(ast, lexer, token - 1, out);
+        astPrintToken(ast, lexer, token, out);
+        break;
+    case AST_BREAK:
+    case AST_CONTINUE:
+    case AST_GOTO:
+        if (types[token + 1] == TK_IDENTIFIER) {
+            astPrintToken(ast, lexer, token + 1, out);
+        }
+        break;
+    case AST_ROOT:
+    case AST_BLOCK:
+    case AST_IF:
+    case AST_WHILE:
+    case AST_SWITCH:
+    case AST_CASE:
+    case AST_RETURN:
+    case AST_EXPR_STMT:
+    case AST_CALL:
+    case AST_INDEX:
+        break;
+    default:
+        // names, operators and literals
+        astPrintToken(ast, lexer, token, out);
+        break;
+    }
+    if ((kind == AST_VAR_DECL || kind == AST_PARAM) &&
+        types[token + (kind == AST_VAR_DECL ? 3 : 1)] == TK_LBRACKET) {
+        fprintf(out, " []");
+    }
+    fputc('\n', out);
+
+    depth++;
+    switch (kind) {
+    case AST_ROOT:
+    case AST_BLOCK:
+        astPrintRange(ast, lexer, lhs, rhs, depth, out);
+        break;
+    case AST_FUNCTION:
+        astPrintRange(ast, lexer, ast->extra[lhs], ast->extra[lhs + 1], depth,
+                      out);
+        astPrintNode(ast, lexer, rhs, depth, out);
+        break;
+    case AST_IF:
+        astPrintNode(ast, lexer, lhs, depth, out);
+        astPrintNode(ast, lexer, ast->extra[rhs], depth, out);
+        if (ast->extra[rhs + 1] != 0) {
+            astPrintNode(ast, lexer, ast->extra[rhs + 1], depth, out);
+        }
+        break;
+    case AST_SWITCH:
+    case AST_CASE:
+    case AST_CALL:
+        astPrintNode(ast, lexer, lhs, depth, out);
+        astPrintRange(ast, lexer, ast->extra[rhs], ast->extra[rhs + 1], depth,
+                      out);
+        break;
+    default:
+        // optional children in order
+        if (lhs != 0) {
+            astPrintNode(ast, lexer, lhs, depth, out);
+        }
+        if (rhs != 0) {
+            astPrintNode(ast, lexer, rhs, depth, out);
+        }
+        break;
+    }
+}
+
+// nodes listed in extra from start to end
+static void astPrintRange(const Ast *ast, const Lexer *lexer, uint32_t start,
+                          uint32_t end, unsigned int depth, FILE *out) {
+    for (uint32_t i = start; i < end; i++) {
+        astPrintNode(ast, lexer, ast->extra[i], depth, out);
+    }
+}
+
+// lexeme of a token after a space, literals in their quotes
+static void astPrintToken(const Ast *ast, const Lexer *lexer, uint32_t index,
+                          FILE *out) {
+    const TokenBuffer *tokens = ast->tokens;
+    Token tok = {.type = (TokenType)tokens->types[index],
+                 .start = tokens->starts[index],
+                 .length = tokens->lengths[index]};
+    const char *quote = "";
+    if (tok.type == TK_STRINGLIT) {
+        quote = "\"";
+    } else if (tok.type == TK_CHARACLIT) {
+        quote = "'";
+    }
+    fprintf(out, " %s%.*s%s", quote, (int)tok.length,
+            lexerGetLexeme(lexer, &tok), quote);
+}
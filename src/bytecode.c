@@ -0,0 +1,2326 @@
+// bytecode header implementation
+//
+// `bytecode.c` walks the syntax tree once per function and emits register
+// instructions as it goes. Locals live in registers from the bottom of the
+// function's window, temporaries are taken above them while an expression
+// is compiled and given back after every statement. A top level variable
+// named inside any function body (or one past the registers of the top
+// level) lives in a global slot instead.
+//
+// Loops test their condition at the bottom, so one rehearse iteration runs
+// its body, the test and a single backward jump. Comparisons and additions
+// with small literals take the literal as an immediate operand.
+
+#include "bytecode.h"
+#include "parser.h" // parseReportError
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_REGISTER UINT32_MAX
+#define NO_LABEL UINT32_MAX
+#define TOP_LEVEL_REGISTERS 192 // top level variables spill to globals past it
+#define LOADI_MIN (-VM_SBX_BIAS)
+#define LOADI_MAX (VM_SBX_BIAS - 1)
+
+const char *const vm_opcode_names[OP_COUNT] = {
+#define OPCODE(name, format) [OP_##name] = #name,
+#include "opcodes.def"
+#undef OPCODE
+};
+
+const uint8_t vm_opcode_formats[OP_COUNT] = {
+#define OPCODE(name, format) [OP_##name] = VM_FORMAT_##format,
+#include "opcodes.def"
+#undef OPCODE
+};
+
+// static types of values, arrays add VT_ARRAY to their element type
+typedef enum ValueTypeEnum {
+    VT_NOUGHT,
+    VT_COUNT,
+    VT_GLYPH,
+    VT_VERDICT,
+    VT_PORTION, // portion and fraction
+    VT_STRING,  // glyph arrays
+    VT_ARRAY = 8,
+    VT_ERROR = 255, // already reported
+} ValueType;
+
+static const char *const value_type_names[VT_STRING + 1] = {
+    [VT_NOUGHT] = "nought", [VT_COUNT] = "count",     [VT_GLYPH] = "glyph",
+    [VT_VERDICT] = "verdict", [VT_PORTION] = "portion", [VT_STRING] = "string",
+};
+
+// opcodes of arithmetic operators on counts and on portions
+static const uint8_t count_opcodes[TK_TYPE_COUNT] = {
+    [TK_PLUS] = OP_ADD_I,         [TK_MINUS] = OP_SUB_I,
+    [TK_ASTERISK] = OP_MUL_I,     [TK_SLASH] = OP_DIV_I,
+    [TK_FLOORDIV] = OP_FLOORDIV_I, [TK_MODULO] = OP_MOD_I,
+    [TK_EXPONENT] = OP_POW_I,
+};
+static const uint8_t portion_opcodes[TK_TYPE_COUNT] = {
+    [TK_PLUS] = OP_ADD_F,         [TK_MINUS] = OP_SUB_F,
+    [TK_ASTERISK] = OP_MUL_F,     [TK_SLASH] = OP_DIV_F,
+    [TK_FLOORDIV] = OP_FLOORDIV_F, [TK_MODULO] = OP_MOD_F,
+    [TK_EXPONENT] = OP_POW_F,
+};
+
+// operator applied by a compound assignment
+static const uint8_t compound_operators[TK_TYPE_COUNT] = {
+    [TK_ASSIGNINC] = TK_PLUS,     [TK_ASSIGNDEC] = TK_MINUS,
+    [TK_ASSIGNMUL] = TK_ASTERISK, [TK_ASSIGNDIV] = TK_SLASH,
+    [TK_ASSIGNMOD] = TK_MODULO,
+};
+
+typedef struct NameEntryStruct {
+    const char *name; // lexeme in the lexer contents, NULL when free
+    uint32_t length;
+    uint32_t value;
+} NameEntry;
+
+// open addressing map of names to indices
+typedef struct NameTableStruct {
+    NameEntry *entries;
+    uint32_t count;
+    uint32_t capacity;
+} NameTable;
+
+typedef struct LocalStruct {
+    const char *name;
+    uint32_t length;
+    uint32_t symbol; // interned name, 0 when compared by lexeme
+    uint32_t id;   // declaration order within the function
+    uint32_t slot; // register, or global slot
+    uint8_t type;
+    uint8_t global;
+} Local;
+
+// where an assignment stores
+typedef enum PlaceKindEnum {
+    PLACE_REGISTER,
+    PLACE_GLOBAL,
+    PLACE_ELEMENT,   // slot holds the array, index the element index
+    PLACE_CHARACTER, // glyph of a string, read only
+} PlaceKind;
+
+typedef struct PlaceStruct {
+    PlaceKind kind;
+    uint8_t type;
+    uint32_t slot;
+    uint32_t index;
+} Place;
+
+// loop or switch that cease and persist may leave
+typedef struct JumpContextStruct {
+    uint32_t label; // label token, NO_LABEL when unlabeled
+    int loop;
+} JumpContext;
+
+// cease or persist jump waiting for the end of its context
+typedef struct PendingJumpStruct {
+    uint32_t at;
+    uint32_t context;
+    int is_continue;
+} PendingJump;
+
+typedef struct LabelStruct {
+    uint32_t token;
+    uint32_t target;
+    uint32_t local_count; // locals in scope at the label
+    uint32_t top_id;      // id of the innermost of them
+} Label;
+
+// thither to a label further down
+typedef struct GotoStruct {
+    uint32_t at;
+    uint32_t token;   // label name
+    uint32_t next_id; // locals declared before the jump
+} Goto;
+
+typedef struct CompilerStruct {
+    Lexer *lexer;
+    const Ast *ast;
+    const TokenBuffer *tokens;
+    const char *filename;
+    FILE *out;
+    VmProgram *program;
+    int status;
+    int out_of_memory;
+
+    NameTable functions; // name to function index
+    NameTable shared;    // names used inside function bodies
+    NameTable globals;   // name to global slot
+    uint32_t *function_nodes;
+    uint8_t *global_types;
+    uint32_t global_capacity;
+
+    // function being compiled
+    uint32_t function;
+    uint8_t return_type;
+    Local *locals;
+    uint32_t local_count;
+    uint32_t local_capacity;
+    uint32_t next_id;
+    unsigned int scope_depth;
+    uint32_t scope_start; // locals from here on are in the innermost scope
+    uint32_t local_top; // registers below are locals (or held temporaries)
+    uint32_t free_register;
+    uint32_t max_register;
+    int register_error; // reported once per function
+    uint32_t token;     // source of emitted instructions
+    JumpContext *contexts;
+    uint32_t context_count;
+    uint32_t context_capacity;
+    PendingJump *jumps;
+    uint32_t jump_count;
+    uint32_t jump_capacity;
+    Label *labels;
+    uint32_t label_count;
+    uint32_t label_capacity;
+    Goto *gotos;
+    uint32_t goto_count;
+    uint32_t goto_capacity;
+} Compiler;
+
+static void compilePrepass(Compiler *c);
+static void compileTopLevel(Compiler *c);
+static void compileFunction(Compiler *c, uint32_t index);
+static void compileFunctionEnd(Compiler *c);
+static void compileStatement(Compiler *c, uint32_t node, uint32_t label);
+static void compileStatementKind(Compiler *c, uint32_t node, uint32_t label);
+static void compileStatementList(Compiler *c, uint32_t start, uint32_t end);
+static void compileVarDecl(Compiler *c, uint32_t node);
+static void compileIf(Compiler *c, uint32_t node);
+static void compileWhile(Compiler *c, uint32_t node, uint32_t label);
+static void compileSwitch(Compiler *c, uint32_t node, uint32_t label);
+static void compileJump(Compiler *c, uint32_t node, int is_continue);
+static void compileGoto(Compiler *c, uint32_t node);
+static void compileReturn(Compiler *c, uint32_t node);
+static void compileLabel(Compiler *c, uint32_t node);
+static void compileEffect(Compiler *c, uint32_t node);
+static uint8_t compileExpr(Compiler *c, uint32_t node, uint32_t dest);
+static uint8_t compileExprKind(Compiler *c, uint32_t node, uint32_t dest);
+static uint8_t compileOperand(Compiler *c, uint32_t node, uint32_t *reg);
+static uint32_t compileCondition(Compiler *c, uint32_t node);
+static uint8_t compileUnary(Compiler *c, uint32_t node, uint32_t dest);
+static uint8_t compileBinary(Compiler *c, uint32_t node, uint32_t dest);
+static uint8_t compileLogical(Compiler *c, uint32_t node, uint32_t dest);
+static uint8_t compileOperator(Compiler *c, TokenType op, uint32_t left,
+                               uint8_t left_type, uint32_t right_node,
+                               uint32_t dest);
+static uint8_t compileOperatorRegisters(Compiler *c, TokenType op,
+                                        uint32_t left, uint8_t left_type,
+                                        uint32_t right, uint8_t right_type,
+                                        uint32_t dest);
+static uint8_t compileAssign(Compiler *c, uint32_t node, uint32_t dest);
+static uint8_t compileIncrement(Compiler *c, uint32_t node, uint32_t operand,
+                                int prefix, uint32_t dest);
+static uint8_t compileIndex(Compiler *c, uint32_t node, uint32_t dest);
+static uint8_t compileCall(Compiler *c, uint32_t node, uint32_t dest);
+static uint8_t compileSayeth(Compiler *c, uint32_t node, uint32_t dest);
+static uint8_t compileHeareth(Compiler *c, uint32_t node, uint32_t dest);
+static void compilePrintValue(Compiler *c, uint32_t node);
+static int compilePlace(Compiler *c, uint32_t node, Place *place);
+static void placeLoad(Compiler *c, const Place *place, uint32_t dest);
+static void placeStore(Compiler *c, const Place *place, uint32_t src);
+static int coerce(Compiler *c, uint32_t reg, uint8_t from, uint8_t to);
+static uint32_t toString(Compiler *c, uint32_t reg, uint8_t type);
+static uint8_t promote(Compiler *c, uint32_t *reg, uint8_t type);
+static void loadInteger(Compiler *c, uint32_t dest, int64_t value);
+static void loadConstant(Compiler *c, uint32_t dest, VmValue value);
+static void loadConstantIndex(Compiler *c, uint32_t dest, uint32_t index);
+static void loadString(Compiler *c, uint32_t dest, const char *text,
+                       unsigned long length);
+static int smallInteger(Compiler *c, uint32_t node, int *value);
+static int literalInteger(Compiler *c, uint32_t node, int64_t *value);
+static int64_t glyphValue(Compiler *c, uint32_t token);
+static char *decodeString(Compiler *c, uint32_t token, unsigned long *length);
+static uint8_t keywordType(TokenType type);
+static uint8_t declarationType(Compiler *c, uint32_t node);
+static uint8_t paramType(Compiler *c, uint32_t param);
+static int isInteger(uint8_t type);
+static int isNumber(uint8_t type);
+static const char *typeName(uint8_t type, char *buffer, size_t size);
+static Local *declareLocal(Compiler *c, uint32_t token, uint8_t type);
+static Local *findLocal(Compiler *c, const char *name, uint32_t length,
+                        uint32_t symbol);
+static int resolveName(Compiler *c, uint32_t token, Place *place);
+static uint32_t allocRegister(Compiler *c);
+static uint32_t emit(Compiler *c, uint32_t instruction);
+static uint32_t emitJump(Compiler *c, VmOpcode op, uint32_t reg);
+static void patchJump(Compiler *c, uint32_t at, uint32_t target);
+static uint32_t pushContext(Compiler *c, uint32_t label, int loop);
+static void popContext(Compiler *c, uint32_t continue_target,
+                       uint32_t break_target);
+static uint32_t addConstant(Compiler *c, VmValue value);
+static const char *lexeme(const Compiler *c, uint32_t token,
+                          uint32_t *length);
+static uint32_t tokenSymbol(const Compiler *c, uint32_t token);
+static int sameLexeme(const Compiler *c, uint32_t first, uint32_t second);
+static int grow(Compiler *c, void **array, uint32_t *capacity, uint32_t count,
+                size_t size);
+static int nameTableFind(const NameTable *table, const char *name,
+                         uint32_t length, uint32_t *value);
+static int nameTableInsert(Compiler *c, NameTable *table, const char *name,
+                           uint32_t length, uint32_t value);
+static void compilerError(Compiler *c, uint32_t token, const char *message);
+
+/// PUBLIC FUNCTIONS
+
+// compile the tree of lexer's resident contents into program, printing
+// semantic errors to out. program is freed with bytecodeCleanup either way.
+int bytecodeCompile(Lexer *lexer, const Ast *ast, const char *filename,
+                    FILE *out, VmProgram *program) {
+    memset(program, 0, sizeof(VmProgram));
+    program->tokens = ast->tokens;
+
+    Compiler compiler = {.lexer = lexer,
+                         .ast = ast,
+                         .tokens = ast->tokens,
+                         .filename = filename,
+                         .out = out,
+                         .program = program};
+    Compiler *c = &compiler;
+
+    compilePrepass(c);
+    if (!c->status) {
+        compileTopLevel(c);
+        for (uint32_t i = 1; i < program->function_count; i++) {
+            compileFunction(c, i);
+        }
+    }
+
+    free(c->functions.entries);
+    free(c->shared.entries);
+    free(c->globals.entries);
+    free(c->function_nodes);
+    free(c->global_types);
+    free(c->locals);
+    free(c->contexts);
+    free(c->jumps);
+    free(c->labels);
+    free(c->gotos);
+    return c->status;
+}
+
+// print every instruction with its operands, one per line
+int bytecodePrint(const VmProgram *program, FILE *out) {
+    uint32_t function = 0;
+    for (uint32_t pc = 0; pc < program->code_count; pc++) {
+        while (function < program->function_count &&
+               program->functions[function].entry == pc) {
+            const VmFunction *fn = &program->functions[function];
+            fprintf(out, "function %u: %u params, %u registers\n", function,
+                    fn->params, fn->registers);
+            function++;
+        }
+
+        uint32_t i = program->code[pc];
+        fprintf(out, "%6u  %-11s", pc, vm_opcode_names[VM_OP(i)]);
+        switch ((VmFormat)vm_opcode_formats[VM_OP(i)]) {
+        case VM_FORMAT_NONE:
+            break;
+        case VM_FORMAT_A:
+            fprintf(out, "%u", VM_A(i));
+            break;
+        case VM_FORMAT_AB:
+            fprintf(out, "%u %u", VM_A(i), VM_B(i));
+            break;
+        case VM_FORMAT_ABC:
+            fprintf(out, "%u %u %u", VM_A(i), VM_B(i), VM_C(i));
+            break;
+        case VM_FORMAT_ABSC:
+            fprintf(out, "%u %u %d", VM_A(i), VM_B(i), VM_SC(i));
+            break;
+        case VM_FORMAT_ABX:
+            fprintf(out, "%u %u", VM_A(i), VM_BX(i));
+            break;
+        case VM_FORMAT_ASBX:
+            fprintf(out, "%u %d", VM_A(i), VM_SBX(i));
+            break;
+        case VM_FORMAT_SAX:
+            fprintf(out, "%d", VM_SAX(i));
+            break;
+        }
+        fputc('\n', out);
+
+        // the constant index of LOADKX takes the next word
+        if (VM_OP(i) == OP_LOADKX && pc + 1 < program->code_count) {
+            pc++;
+            fprintf(out, "%6u  %u\n", pc, program->code[pc]);
+        }
+    }
+    return ferror(out) != 0;
+}
+
+// free code, constants and strings
+void bytecodeCleanup(VmProgram *program) {
+    for (uint32_t i = 0; i < program->string_count; i++) {
+        free(program->strings[i]);
+    }
+    free(program->strings);
+    free(program->code);
+    free(program->code_tokens);
+    free(program->constants);
+    free(program->functions);
+    memset(program, 0, sizeof(VmProgram));
+}
+
+/// PRIVATE FUNCTIONS
+
+// number the functions and give top level variables used by them a global
+// slot, so calls and globals may come before their definitions
+static void compilePrepass(Compiler *c) {
+    const Ast *ast = c->ast;
+    uint32_t start = ast->lhs[0];
+    uint32_t end = ast->rhs[0];
+
+    uint32_t count = 1;
+    for (uint32_t i = start; i < end; i++) {
+        count += ast->kinds[ast->extra[i]] == AST_FUNCTION;
+    }
+    c->program->functions = calloc(count, sizeof(VmFunction));
+    c->function_nodes = calloc(count, sizeof(uint32_t));
+    if (c->program->functions == NULL || c->function_nodes == NULL) {
+        compilerError(c, 0, NULL);
+        return;
+    }
+    c->program->function_count = 1;
+
+    // a function's nodes are the ones after the previous top level item
+    uint32_t previous = 0;
+    for (uint32_t i = start; i < end; i++) {
+        uint32_t item = ast->extra[i];
+        if (ast->kinds[item] == AST_FUNCTION) {
+            uint32_t name_token = ast->main_tokens[item] + 2;
+            uint32_t length;
+            const char *name = lexeme(c, name_token, &length);
+            uint32_t index = c->program->function_count;
+            if (nameTableFind(&c->functions, name, length, &index)) {
+                compilerError(c, name_token, "function already defined");
+            } else {
+                nameTableInsert(c, &c->functions, name, length, index);
+                c->function_nodes[index] = item;
+                c->program->functions[index].name = name_token;
+                c->program->function_count++;
+            }
+
+            for (uint32_t node = previous + 1; node < item; node++) {
+                if (ast->kinds[node] == AST_IDENTIFIER) {
+                    name = lexeme(c, ast->main_tokens[node], &length);
+                    nameTableInsert(c, &c->shared, name, length, 0);
+                }
+            }
+        }
+        previous = item;
+    }
+
+    for (uint32_t i = start; i < end; i++) {
+        uint32_t item = ast->extra[i];
+        uint32_t length;
+        uint32_t slot;
+        if (ast->kinds[item] != AST_VAR_DECL) {
+            continue;
+        }
+        const char *name = lexeme(c, ast->main_tokens[item] + 2, &length);
+        if (!nameTableFind(&c->shared, name, length, &slot) ||
+            nameTableFind(&c->globals, name, length, &slot)) {
+            continue;
+        }
+        slot = c->program->global_count;
+        if (slot > UINT16_MAX) {
+            compilerError(c, ast->main_tokens[item] + 2, "too many globals");
+            return;
+        }
+        if (grow(c, (void **)&c->global_types, &c->global_capacity, slot,
+                 1)) {
+            return;
+        }
+        c->global_types[slot] = declarationType(c, item);
+        c->program->global_count++;
+        nameTableInsert(c, &c->globals, name, length, slot);
+    }
+}
+
+// function 0: the top level statements, then main
+static void compileTopLevel(Compiler *c) {
+    const Ast *ast = c->ast;
+    compileFunction(c, 0);
+
+    // globals of string type start empty, functions may run before the
+    // declaration does
+    uint32_t reg = allocRegister(c);
+    for (uint32_t slot = 0; slot < c->program->global_count; slot++) {
+        if (c->global_types[slot] == VT_STRING) {
+            loadString(c, reg, "", 0);
+            emit(c, VM_ABX(OP_SETGLOBAL, reg, slot));
+        }
+    }
+    c->free_register = c->local_top;
+
+    for (uint32_t i = ast->lhs[0]; i < ast->rhs[0]; i++) {
+        uint32_t item = ast->extra[i];
+        if (ast->kinds[item] != AST_FUNCTION) {
+            compileStatement(c, item, NO_LABEL);
+        }
+    }
+
+    // the exit value is what main returns
+    uint32_t index;
+    if (nameTableFind(&c->functions, "main", 4, &index)) {
+        uint32_t node = c->function_nodes[index];
+        uint32_t define = ast->main_tokens[node];
+        c->token = define;
+        uint8_t type = keywordType((TokenType)c->tokens->types[define + 1]);
+        if (ast->extra[ast->lhs[node]] != ast->extra[ast->lhs[node] + 1]) {
+            compilerError(c, define + 2, "main takes no parameters");
+        }
+        reg = allocRegister(c);
+        emit(c, VM_ABX(OP_CALL, reg, index));
+        if (type == VT_NOUGHT) {
+            emit(c, VM_ABC(OP_RET0, 0, 0, 0));
+        } else {
+            coerce(c, reg, type, VT_COUNT);
+            emit(c, VM_ABC(OP_RET, reg, 0, 0));
+        }
+    }
+    compileFunctionEnd(c);
+}
+
+// reset the per function state and declare the parameters, a function
+// other than 0 is compiled whole
+static void compileFunction(Compiler *c, uint32_t index) {
+    VmFunction *fn = &c->program->functions[index];
+    fn->entry = c->program->code_count;
+    c->function = index;
+    c->return_type = VT_COUNT;
+    c->local_count = 0;
+    c->next_id = 0;
+    c->scope_depth = 0;
+    c->scope_start = 0;
+    c->local_top = 0;
+    c->free_register = 0;
+    c->max_register = 0;
+    c->register_error = 0;
+    c->context_count = 0;
+    c->jump_count = 0;
+    c->label_count = 0;
+    c->goto_count = 0;
+    if (index == 0) {
+        return;
+    }
+
+    const Ast *ast = c->ast;
+    uint32_t node = c->function_nodes[index];
+    uint32_t define = ast->main_tokens[node];
+    c->token = define;
+    c->return_type = keywordType((TokenType)c->tokens->types[define + 1]);
+
+    uint32_t params = ast->lhs[node];
+    for (uint32_t i = ast->extra[params]; i < ast->extra[params + 1]; i++) {
+        uint32_t param = ast->extra[i];
+        uint32_t name = ast->main_tokens[param];
+        uint8_t type = paramType(c, param);
+        if (type == VT_NOUGHT) {
+            compilerError(c, name, "parameters cannot be nought");
+        }
+        declareLocal(c, name, type);
+    }
+    fn->params = (uint16_t)c->local_count;
+
+    // the body shares the scope of the parameters
+    uint32_t body = ast->rhs[node];
+    compileStatementList(c, ast->lhs[body], ast->rhs[body]);
+    c->token = ast->main_tokens[body];
+    compileFunctionEnd(c);
+}
+
+// falling off the end returns nothing, then jumps to later labels resolve
+static void compileFunctionEnd(Compiler *c) {
+    emit(c, VM_ABC(OP_RET0, 0, 0, 0));
+
+    for (uint32_t i = 0; i < c->goto_count; i++) {
+        const Goto *jump = &c->gotos[i];
+        const Label *label = NULL;
+        for (uint32_t j = 0; j < c->label_count && label == NULL; j++) {
+            if (sameLexeme(c, c->labels[j].token, jump->token)) {
+                label = &c->labels[j];
+            }
+        }
+        if (label == NULL) {
+            compilerError(c, jump->token, "undefined label");
+        } else if (label->local_count > 0 && label->top_id >= jump->next_id) {
+            compilerError(c, jump->token,
+                          "thither jumps into the scope of a variable");
+        } else {
+            patchJump(c, jump->at, label->target);
+        }
+    }
+
+    c->program->functions[c->function].registers =
+        (uint16_t)c->max_register;
+}
+
+static void compileStatement(Compiler *c, uint32_t node, uint32_t label) {
+    uint32_t saved = c->token;
+    c->token = c->ast->main_tokens[node];
+    compileStatementKind(c, node, label);
+    c->token = saved;
+
+    // temporaries never outlive their statement
+    c->free_register = c->local_top;
+}
+
+static void compileStatementKind(Compiler *c, uint32_t node, uint32_t label) {
+    const Ast *ast = c->ast;
+    uint32_t scope_start = c->scope_start;
+    switch ((AstKind)ast->kinds[node]) {
+    case AST_VAR_DECL:
+        compileVarDecl(c, node);
+        break;
+    case AST_IF:
+        compileIf(c, node);
+        break;
+    case AST_WHILE:
+        compileWhile(c, node, label);
+        break;
+    case AST_SWITCH:
+        compileSwitch(c, node, label);
+        break;
+    case AST_BREAK:
+        compileJump(c, node, 0);
+        break;
+    case AST_CONTINUE:
+        compileJump(c, node, 1);
+        break;
+    case AST_GOTO:
+        compileGoto(c, node);
+        break;
+    case AST_RETURN:
+        compileReturn(c, node);
+        break;
+    case AST_LABEL:
+        compileLabel(c, node);
+        break;
+    case AST_BLOCK: {
+        uint32_t local_count = c->local_count;
+        uint32_t local_top = c->local_top;
+        c->scope_depth++;
+        c->scope_start = local_count;
+        compileStatementList(c, ast->lhs[node], ast->rhs[node]);
+        c->scope_depth--;
+        c->scope_start = scope_start;
+        c->local_count = local_count;
+        c->local_top = local_top;
+        break;
+    }
+    case AST_EXPR_STMT:
+        if (ast->lhs[node] != 0) {
+            compileEffect(c, ast->lhs[node]);
+        }
+        break;
+    default:
+        compilerError(c, ast->main_tokens[node], "expected statement");
+        break;
+    }
+}
+
+// statements listed in extra from start to end
+static void compileStatementList(Compiler *c, uint32_t start, uint32_t end) {
+    for (uint32_t i = start; i < end; i++) {
+        compileStatement(c, c->ast->extra[i], NO_LABEL);
+    }
+}
+
+static void compileVarDecl(Compiler *c, uint32_t node) {
+    const Ast *ast = c->ast;
+    uint32_t keyword = ast->main_tokens[node];
+    uint32_t name = keyword + 2;
+    uint32_t length_node = ast->lhs[node];
+    uint32_t value = ast->rhs[node];
+    uint8_t type = declarationType(c, node);
+
+    if (type == VT_NOUGHT) {
+        compilerError(c, keyword + 1, "variables cannot be nought");
+        type = VT_ERROR;
+    } else if (type == VT_STRING && length_node != 0) {
+        compilerError(c, keyword + 1, "glyph arrays are strings, no length");
+    } else if ((type & VT_ARRAY) && length_node != 0 && value != 0) {
+        compilerError(c, name, "array takes a length or a value, not both");
+    } else if ((type & VT_ARRAY) && length_node == 0 && value == 0) {
+        compilerError(c, name, "array needs a length or a value");
+    }
+
+    // the variable is in scope inside its own value
+    Local *local = declareLocal(c, name, type);
+    if (local == NULL) {
+        return;
+    }
+    uint32_t target = local->global ? allocRegister(c) : local->slot;
+
+    // strings and arrays must hold a valid pointer before any read
+    if (type == VT_STRING && value != 0) {
+        loadString(c, target, "", 0);
+    } else if ((type & VT_ARRAY) && value != 0) {
+        loadInteger(c, target, 0);
+    }
+
+    if (length_node != 0 && (type & VT_ARRAY)) {
+        uint32_t count;
+        uint8_t count_type = compileOperand(c, length_node, &count);
+        if (!isInteger(count_type) && count_type != VT_ERROR) {
+            compilerError(c, ast->main_tokens[length_node],
+                          "array length must be a count");
+        }
+        emit(c, VM_ABC(OP_NEWARRAY, target, count, 0));
+    } else if (value != 0) {
+        coerce(c, target, compileExpr(c, value, target), type);
+    } else if (type == VT_STRING) {
+        loadString(c, target, "", 0);
+    } else {
+        loadInteger(c, target, 0);
+    }
+
+    if (local->global) {
+        emit(c, VM_ABX(OP_SETGLOBAL, target, local->slot));
+    }
+}
+
+static void compileIf(Compiler *c, uint32_t node) {
+    const Ast *ast = c->ast;
+    uint32_t pair = ast->rhs[node];
+    uint32_t condition = compileCondition(c, ast->lhs[node]);
+    uint32_t skip_then = emitJump(c, OP_JMPF, condition);
+    c->free_register = c->local_top;
+
+    compileStatement(c, ast->extra[pair], NO_LABEL);
+    if (ast->extra[pair + 1] == 0) {
+        patchJump(c, skip_then, c->program->code_count);
+        return;
+    }
+
+    uint32_t skip_else = emitJump(c, OP_JMP, 0);
+    patchJump(c, skip_then, c->program->code_count);
+    compileStatement(c, ast->extra[pair + 1], NO_LABEL);
+    patchJump(c, skip_else, c->program->code_count);
+}
+
+// body first, the test at the bottom jumps back while it holds
+static void compileWhile(Compiler *c, uint32_t node, uint32_t label) {
+    const Ast *ast = c->ast;
+    uint32_t condition = ast->lhs[node];
+    uint32_t body = ast->rhs[node];
+    uint32_t context = pushContext(c, label, 1);
+    if (context == UINT32_MAX) {
+        return;
+    }
+
+    // 'rehearse (yay)' needs no test
+    int forever = ast->kinds[condition] == AST_BOOLEAN &&
+                  c->tokens->types[ast->main_tokens[condition]] == TK_TRUE;
+    uint32_t enter = forever ? 0 : emitJump(c, OP_JMP, 0);
+    uint32_t body_start = c->program->code_count;
+    compileStatement(c, body, NO_LABEL);
+
+    uint32_t test = c->program->code_count;
+    if (forever) {
+        patchJump(c, emitJump(c, OP_JMP, 0), body_start);
+    } else {
+        patchJump(c, enter, test);
+        uint32_t saved = c->token;
+        c->token = ast->main_tokens[condition];
+        uint32_t reg = compileCondition(c, condition);
+        patchJump(c, emitJump(c, OP_JMPT, reg), body_start);
+        c->token = saved;
+        c->free_register = c->local_top;
+    }
+    popContext(c, test, c->program->code_count);
+}
+
+// compare the subject with every case value in order, then the bodies in
+// order so a case without cease falls through to the next
+static void compileSwitch(Compiler *c, uint32_t node, uint32_t label) {
+    const Ast *ast = c->ast;
+    uint32_t pair = ast->rhs[node];
+    uint32_t first = ast->extra[pair];
+    uint32_t count = ast->extra[pair + 1] - first;
+
+    uint32_t subject;
+    uint8_t subject_type = compileOperand(c, ast->lhs[node], &subject);
+    uint32_t local_top = c->local_top;
+    c->local_top = c->free_register; // the subject outlives statements
+
+    uint32_t *entries = calloc(count + 1, sizeof(uint32_t));
+    if (entries == NULL) {
+        compilerError(c, 0, NULL);
+        return;
+    }
+    uint32_t context = pushContext(c, label, 0);
+
+    // the wildcard matches when no other case does
+    uint32_t wildcard = count;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t case_node = ast->extra[first + i];
+        uint32_t value = ast->lhs[case_node];
+        if (ast->kinds[value] == AST_WILDCARD) {
+            wildcard = i;
+            continue;
+        }
+        uint32_t saved = c->token;
+        c->token = ast->main_tokens[case_node];
+        uint32_t mark = c->free_register;
+        uint32_t result = allocRegister(c);
+        compileOperator(c, TK_EQUAL, subject, subject_type, value, result);
+        entries[i] = emitJump(c, OP_JMPT, result);
+        c->free_register = mark;
+        c->token = saved;
+    }
+    entries[count] = emitJump(c, OP_JMP, 0);
+
+    uint32_t wildcard_target = UINT32_MAX;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t case_node = ast->extra[first + i];
+        uint32_t statements = ast->rhs[case_node];
+        if (i == wildcard) {
+            wildcard_target = c->program->code_count;
+        } else {
+            patchJump(c, entries[i], c->program->code_count);
+        }
+
+        uint32_t local_count = c->local_count;
+        uint32_t case_top = c->local_top;
+        uint32_t scope_start = c->scope_start;
+        c->scope_depth++;
+        c->scope_start = local_count;
+        compileStatementList(c, ast->extra[statements],
+                             ast->extra[statements + 1]);
+        c->scope_depth--;
+        c->scope_start = scope_start;
+        c->local_count = local_count;
+        c->local_top = case_top;
+        c->free_register = case_top;
+    }
+
+    uint32_t end = c->program->code_count;
+    patchJump(c, entries[count],
+              wildcard_target != UINT32_MAX ? wildcard_target : end);
+    if (context != UINT32_MAX) {
+        popContext(c, end, end);
+    }
+    free(entries);
+
+    c->local_top = local_top;
+    c->free_register = local_top;
+}
+
+// cease and persist leave the innermost loop or switch, or the labeled one
+static void compileJump(Compiler *c, uint32_t node, int is_continue) {
+    uint32_t keyword = c->ast->main_tokens[node];
+    int labeled = c->tokens->types[keyword + 1] == TK_IDENTIFIER;
+
+    uint32_t context = c->context_count;
+    while (context > 0) {
+        const JumpContext *ctx = &c->contexts[context - 1];
+        if (labeled ? ctx->label != NO_LABEL &&
+                          sameLexeme(c, ctx->label, keyword + 1)
+                    : ctx->loop || !is_continue) {
+            break;
+        }
+        context--;
+    }
+    if (context == 0) {
+        compilerError(c, labeled ? keyword + 1 : keyword,
+                      labeled ? "no enclosing loop or switch has this label"
+                      : is_continue ? "persist outside of a loop"
+                                    : "cease outside of a loop or switch");
+        return;
+    }
+    if (is_continue && !c->contexts[context - 1].loop) {
+        compilerError(c, keyword + 1, "persist cannot continue a switch");
+        return;
+    }
+
+    if (grow(c, (void **)&c->jumps, &c->jump_capacity, c->jump_count,
+             sizeof(PendingJump))) {
+        return;
+    }
+    c->jumps[c->jump_count++] =
+        (PendingJump){emitJump(c, OP_JMP, 0), context - 1, is_continue};
+}
+
+// jumps back to a label are checked now, forward ones at the end of the
+// function
+static void compileGoto(Compiler *c, uint32_t node) {
+    uint32_t name = c->ast->main_tokens[node] + 1;
+    uint32_t at = emitJump(c, OP_JMP, 0);
+
+    for (uint32_t i = 0; i < c->label_count; i++) {
+        const Label *label = &c->labels[i];
+        if (!sameLexeme(c, label->token, name)) {
+            continue;
+        }
+        // every local in scope at the label is still in scope here
+        if (label->local_count > c->local_count ||
+            (label->local_count > 0 &&
+             c->locals[label->local_count - 1].id != label->top_id)) {
+            compilerError(c, name,
+                          "thither jumps into the scope of a variable");
+        }
+        patchJump(c, at, label->target);
+        return;
+    }
+
+    if (grow(c, (void **)&c->gotos, &c->goto_capacity, c->goto_count,
+             sizeof(Goto))) {
+        return;
+    }
+    c->gotos[c->goto_count++] = (Goto){at, name, c->next_id};
+}
+
+static void compileReturn(Compiler *c, uint32_t node) {
+    uint32_t keyword = c->ast->main_tokens[node];
+    uint32_t value = c->ast->lhs[node];
+    if (value == 0) {
+        if (c->return_type != VT_NOUGHT && c->function != 0) {
+            compilerError(c, keyword, "returneth needs a value");
+        }
+        emit(c, VM_ABC(OP_RET0, 0, 0, 0));
+        return;
+    }
+    if (c->return_type == VT_NOUGHT) {
+        compilerError(c, keyword, "nought function returneth a value");
+        return;
+    }
+
+    uint32_t reg;
+    uint8_t type = compileOperand(c, value, &reg);
+    if (type != c->return_type && type != VT_ERROR) {
+        // converting in place would change a local
+        uint32_t temp = allocRegister(c);
+        emit(c, VM_ABC(OP_MOVE, temp, reg, 0));
+        reg = temp;
+    }
+    coerce(c, reg, type, c->return_type);
+    emit(c, VM_ABC(OP_RET, reg, 0, 0));
+}
+
+// labels are function wide thither targets, a label on a loop or switch
+// also names it for cease and persist
+static void compileLabel(Compiler *c, uint32_t node) {
+    uint32_t token = c->ast->main_tokens[node];
+    for (uint32_t i = 0; i < c->label_count; i++) {
+        if (sameLexeme(c, c->labels[i].token, token)) {
+            compilerError(c, token, "label already defined");
+            break;
+        }
+    }
+
+    if (!grow(c, (void **)&c->labels, &c->label_capacity, c->label_count,
+              sizeof(Label))) {
+        uint32_t count = c->local_count;
+        c->labels[c->label_count++] =
+            (Label){token, c->program->code_count, count,
+                    count > 0 ? c->locals[count - 1].id : 0};
+    }
+    compileStatement(c, c->ast->lhs[node], token);
+}
+
+// expression statement, its value is not kept
+static void compileEffect(Compiler *c, uint32_t node) {
+    uint32_t saved = c->token;
+    c->token = c->ast->main_tokens[node];
+    switch ((AstKind)c->ast->kinds[node]) {
+    case AST_ASSIGN:
+        compileAssign(c, node, NO_REGISTER);
+        break;
+    case AST_POSTFIX:
+        compileIncrement(c, node, c->ast->lhs[node], 0, NO_REGISTER);
+        break;
+    case AST_CALL:
+        compileCall(c, node, NO_REGISTER);
+        break;
+    case AST_UNARY: {
+        TokenType op = (TokenType)c->tokens->types[c->token];
+        if (op == TK_INCREMENT || op == TK_DECREMENT) {
+            compileIncrement(c, node, c->ast->lhs[node], 1, NO_REGISTER);
+            break;
+        }
+    }
+        // fallthrough
+    default:
+        compileExpr(c, node, allocRegister(c));
+        break;
+    }
+    c->token = saved;
+}
+
+// compile node into register dest, returns its type (VT_ERROR after an
+// error). Only the last instruction writes dest unless dest is a temporary
+// of the caller, so `x = x + y` may target x directly.
+static uint8_t compileExpr(Compiler *c, uint32_t node, uint32_t dest) {
+    uint32_t saved = c->token;
+    c->token = c->ast->main_tokens[node];
+    uint8_t type = compileExprKind(c, node, dest);
+    c->token = saved;
+    return type;
+}
+
+static uint8_t compileExprKind(Compiler *c, uint32_t node, uint32_t dest) {
+    const Ast *ast = c->ast;
+    uint32_t token = ast->main_tokens[node];
+    switch ((AstKind)ast->kinds[node]) {
+    case AST_INTEGER: {
+        int64_t value;
+        if (literalInteger(c, node, &value)) {
+            return VT_ERROR;
+        }
+        loadInteger(c, dest, value);
+        return VT_COUNT;
+    }
+    case AST_FLOAT: {
+        uint32_t length;
+        const char *text = lexeme(c, token, &length);
+        char buffer[64];
+        if (length >= sizeof(buffer)) {
+            compilerError(c, token, "portion literal too long");
+            return VT_ERROR;
+        }
+        memcpy(buffer, text, length);
+        buffer[length] = '\0';
+        loadConstant(c, dest, (VmValue){.f = strtod(buffer, NULL)});
+        return VT_PORTION;
+    }
+    case AST_CHARACTER:
+        loadInteger(c, dest, glyphValue(c, token));
+        return VT_GLYPH;
+    case AST_STRING: {
+        unsigned long length;
+        char *text = decodeString(c, token, &length);
+        if (text == NULL) {
+            return VT_ERROR;
+        }
+        loadString(c, dest, text, length);
+        free(text);
+        return VT_STRING;
+    }
+    case AST_BOOLEAN:
+        loadInteger(c, dest, c->tokens->types[token] == TK_TRUE);
+        return VT_VERDICT;
+    case AST_IDENTIFIER: {
+        Place place;
+        if (resolveName(c, token, &place)) {
+            return VT_ERROR;
+        }
+        placeLoad(c, &place, dest);
+        return place.type;
+    }
+    case AST_UNARY:
+        return compileUnary(c, node, dest);
+    case AST_POSTFIX:
+        return compileIncrement(c, node, ast->lhs[node], 0, dest);
+    case AST_BINARY:
+        return compileBinary(c, node, dest);
+    case AST_ASSIGN:
+        return compileAssign(c, node, dest);
+    case AST_CALL:
+        return compileCall(c, node, dest);
+    case AST_INDEX:
+        return compileIndex(c, node, dest);
+    case AST_BUILTIN:
+        compilerError(c, token, "sayeth and heareth must be called");
+        return VT_ERROR;
+    default:
+        compilerError(c, token, "expected expression");
+        return VT_ERROR;
+    }
+}
+
+// register holding node's value: a local's own register, else a new
+// temporary
+static uint8_t compileOperand(Compiler *c, uint32_t node, uint32_t *reg) {
+    if (c->ast->kinds[node] == AST_IDENTIFIER) {
+        Place place;
+        if (resolveName(c, c->ast->main_tokens[node], &place)) {
+            *reg = 0;
+            return VT_ERROR;
+        }
+        if (place.kind == PLACE_REGISTER) {
+            *reg = place.slot;
+            return place.type;
+        }
+    }
+    *reg = allocRegister(c);
+    return compileExpr(c, node, *reg);
+}
+
+// register that is nonzero when the condition holds
+static uint32_t compileCondition(Compiler *c, uint32_t node) {
+    uint32_t reg;
+    uint8_t type = compileOperand(c, node, &reg);
+    if (type == VT_PORTION) {
+        uint32_t truth = allocRegister(c);
+        emit(c, VM_ABC(OP_BOOL_F, truth, reg, 0));
+        return truth;
+    }
+    if (!isInteger(type) && type != VT_ERROR) {
+        compilerError(c, c->ast->main_tokens[node],
+                      "condition must be a number or verdict");
+    }
+    return reg;
+}
+
+static uint8_t compileUnary(Compiler *c, uint32_t node, uint32_t dest) {
+    const Ast *ast = c->ast;
+    uint32_t token = ast->main_tokens[node];
+    uint32_t operand = ast->lhs[node];
+    TokenType op = (TokenType)c->tokens->types[token];
+
+    switch (op) {
+    case TK_INCREMENT:
+    case TK_DECREMENT:
+        return compileIncrement(c, node, operand, 1, dest);
+    case TK_AMPERSAND:
+        compilerError(c, token, "'&' only marks the variable of heareth");
+        return VT_ERROR;
+    case TK_MINUS: {
+        // negative literals are constants
+        int64_t value;
+        if (ast->kinds[operand] == AST_INTEGER) {
+            if (literalInteger(c, operand, &value)) {
+                return VT_ERROR;
+            }
+            loadInteger(c, dest, (int64_t)(0 - (uint64_t)value));
+            return VT_COUNT;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    uint32_t reg;
+    uint8_t type = compileOperand(c, operand, &reg);
+    if (type == VT_ERROR) {
+        return VT_ERROR;
+    }
+    if (op == TK_BANG) {
+        if (type == VT_PORTION) {
+            uint32_t truth = allocRegister(c);
+            emit(c, VM_ABC(OP_BOOL_F, truth, reg, 0));
+            reg = truth;
+        } else if (!isInteger(type)) {
+            compilerError(c, token, "'!' needs a number or verdict");
+            return VT_ERROR;
+        }
+        emit(c, VM_ABC(OP_NOT, dest, reg, 0));
+        return VT_VERDICT;
+    }
+
+    if (!isNumber(type)) {
+        compilerError(c, token, "sign needs a number");
+        return VT_ERROR;
+    }
+    if (op == TK_PLUS) {
+        if (reg != dest) {
+            emit(c, VM_ABC(OP_MOVE, dest, reg, 0));
+        }
+        return type;
+    }
+    emit(c, VM_ABC(type == VT_PORTION ? OP_NEG_F : OP_NEG_I, dest, reg, 0));
+    return type == VT_PORTION ? VT_PORTION : VT_COUNT;
+}
+
+static uint8_t compileBinary(Compiler *c, uint32_t node, uint32_t dest) {
+    const Ast *ast = c->ast;
+    TokenType op = (TokenType)c->tokens->types[ast->main_tokens[node]];
+    if (op == TK_AND || op == TK_OR) {
+        return compileLogical(c, node, dest);
+    }
+
+    // a temporary dest may hold the left operand, so chains to the left
+    // take no extra registers
+    uint32_t mark = c->free_register;
+    uint32_t left;
+    uint8_t left_type;
+    if (dest >= c->local_top && dest != NO_REGISTER) {
+        left = dest;
+        left_type = compileExpr(c, ast->lhs[node], dest);
+    } else {
+        left_type = compileOperand(c, ast->lhs[node], &left);
+    }
+    uint8_t type =
+        compileOperator(c, op, left, left_type, ast->rhs[node], dest);
+    c->free_register = mark;
+    return type;
+}
+
+// && and || skip the right operand once the left one decides
+static uint8_t compileLogical(Compiler *c, uint32_t node, uint32_t dest) {
+    const Ast *ast = c->ast;
+    int is_and = c->tokens->types[ast->main_tokens[node]] == TK_AND;
+    uint32_t truth = allocRegister(c);
+
+    uint32_t mark = c->free_register;
+    uint32_t reg = compileCondition(c, ast->lhs[node]);
+    emit(c, VM_ABC(OP_BOOL_I, truth, reg, 0));
+    c->free_register = mark;
+    uint32_t skip = emitJump(c, is_and ? OP_JMPF : OP_JMPT, truth);
+
+    reg = compileCondition(c, ast->rhs[node]);
+    emit(c, VM_ABC(OP_BOOL_I, truth, reg, 0));
+    c->free_register = mark;
+    patchJump(c, skip, c->program->code_count);
+
+    if (truth != dest) {
+        emit(c, VM_ABC(OP_MOVE, dest, truth, 0));
+    }
+    return VT_VERDICT;
+}
+
+// apply op to the left register and the right node, small integer literals
+// on the right become immediates
+static uint8_t compileOperator(Compiler *c, TokenType op, uint32_t left,
+                               uint8_t left_type, uint32_t right_node,
+                               uint32_t dest) {
+    int value;
+    if (isInteger(left_type) && smallInteger(c, right_node, &value)) {
+        int negated = -value;
+        switch (op) {
+        case TK_PLUS:
+            emit(c, VM_ABC(OP_ADDI, dest, left, value + VM_SC_BIAS));
+            return VT_COUNT;
+        case TK_MINUS:
+            if (negated < VM_SC_BIAS) {
+                emit(c, VM_ABC(OP_ADDI, dest, left, negated + VM_SC_BIAS));
+                return VT_COUNT;
+            }
+            break;
+        case TK_LT:
+            emit(c, VM_ABC(OP_LTI, dest, left, value + VM_SC_BIAS));
+            return VT_VERDICT;
+        case TK_LEQUAL:
+            emit(c, VM_ABC(OP_LEI, dest, left, value + VM_SC_BIAS));
+            return VT_VERDICT;
+        case TK_GT:
+            emit(c, VM_ABC(OP_GTI, dest, left, value + VM_SC_BIAS));
+            return VT_VERDICT;
+        case TK_GEQUAL:
+            emit(c, VM_ABC(OP_GEI, dest, left, value + VM_SC_BIAS));
+            return VT_VERDICT;
+        case TK_EQUAL:
+            emit(c, VM_ABC(OP_EQI, dest, left, value + VM_SC_BIAS));
+            return VT_VERDICT;
+        case TK_NOTEQUAL:
+            emit(c, VM_ABC(OP_NEI, dest, left, value + VM_SC_BIAS));
+            return VT_VERDICT;
+        default:
+            break;
+        }
+    }
+
+    uint32_t right;
+    uint8_t right_type = compileOperand(c, right_node, &right);
+    return compileOperatorRegisters(c, op, left, left_type, right, right_type,
+                                    dest);
+}
+
+static uint8_t compileOperatorRegisters(Compiler *c, TokenType op,
+                                        uint32_t left, uint8_t left_type,
+                                        uint32_t right, uint8_t right_type,
+                                        uint32_t dest) {
+    if (left_type == VT_ERROR || right_type == VT_ERROR) {
+        return VT_ERROR;
+    }
+
+    // '+' joins strings, the other operand is written out first
+    if (op == TK_PLUS && (left_type == VT_STRING || right_type == VT_STRING)) {
+        left = toString(c, left, left_type);
+        right = toString(c, right, right_type);
+        if (left == NO_REGISTER || right == NO_REGISTER) {
+            return VT_ERROR;
+        }
+        emit(c, VM_ABC(OP_CONCAT, dest, left, right));
+        return VT_STRING;
+    }
+
+    int strings = left_type == VT_STRING && right_type == VT_STRING;
+    int numbers = isNumber(left_type) && isNumber(right_type);
+    int portions = left_type == VT_PORTION || right_type == VT_PORTION;
+    switch (op) {
+    case TK_EQUAL:
+    case TK_NOTEQUAL:
+    case TK_LT:
+    case TK_LEQUAL:
+    case TK_GT:
+    case TK_GEQUAL: {
+        if (!numbers && !strings) {
+            compilerError(c, c->token, "operands cannot be compared");
+            return VT_ERROR;
+        }
+        if (portions) {
+            promote(c, &left, left_type);
+            promote(c, &right, right_type);
+        }
+        static const uint8_t compare_opcodes[3][4] = {
+            {OP_EQ_I, OP_NE_I, OP_LT_I, OP_LE_I},
+            {OP_EQ_F, OP_NE_F, OP_LT_F, OP_LE_F},
+            {OP_EQ_S, OP_NE_S, OP_LT_S, OP_LE_S},
+        };
+        const uint8_t *opcodes = compare_opcodes[strings ? 2 : portions];
+        // a > b is b < a
+        if (op == TK_GT || op == TK_GEQUAL) {
+            uint32_t swap = left;
+            left = right;
+            right = swap;
+        }
+        int which = op == TK_EQUAL      ? 0
+                    : op == TK_NOTEQUAL ? 1
+                    : op == TK_LT || op == TK_GT ? 2
+                                                 : 3;
+        emit(c, VM_ABC(opcodes[which], dest, left, right));
+        return VT_VERDICT;
+    }
+    default:
+        break;
+    }
+
+    if (count_opcodes[op] == 0) {
+        compilerError(c, c->token, "unsupported operator");
+        return VT_ERROR;
+    }
+    if (!numbers) {
+        compilerError(c, c->token, "arithmetic needs numbers");
+        return VT_ERROR;
+    }
+    if (portions) {
+        promote(c, &left, left_type);
+        promote(c, &right, right_type);
+        emit(c, VM_ABC(portion_opcodes[op], dest, left, right));
+        return VT_PORTION;
+    }
+    emit(c, VM_ABC(count_opcodes[op], dest, left, right));
+    return VT_COUNT;
+}
+
+// target = value, or target op= value, the stored value goes to dest
+static uint8_t compileAssign(Compiler *c, uint32_t node, uint32_t dest) {
+    const Ast *ast = c->ast;
+    TokenType op = (TokenType)c->tokens->types[ast->main_tokens[node]];
+    uint32_t value = ast->rhs[node];
+    Place place;
+    if (compilePlace(c, ast->lhs[node], &place)) {
+        return VT_ERROR;
+    }
+    if (place.kind == PLACE_CHARACTER) {
+        compilerError(c, c->token, "strings cannot be changed in place");
+        return VT_ERROR;
+    }
+
+    uint32_t work = place.kind == PLACE_REGISTER ? place.slot
+                                                 : allocRegister(c);
+    uint8_t type;
+    if (op == TK_ASSIGN) {
+        type = compileExpr(c, value, work);
+    } else {
+        if (place.kind != PLACE_REGISTER) {
+            placeLoad(c, &place, work);
+        }
+        type = compileOperator(c, (TokenType)compound_operators[op], work,
+                               place.type, value, work);
+    }
+    if (type != VT_ERROR && (type & VT_ARRAY) && type != place.type) {
+        compilerError(c, c->token, "array types differ");
+        return VT_ERROR;
+    }
+    coerce(c, work, type, place.type);
+    if (place.kind != PLACE_REGISTER) {
+        placeStore(c, &place, work);
+    }
+
+    if (dest != NO_REGISTER && dest != work) {
+        emit(c, VM_ABC(OP_MOVE, dest, work, 0));
+    }
+    return place.type;
+}
+
+// ++ and -- on operand, dest gets the value after (prefix) or before
+static uint8_t compileIncrement(Compiler *c, uint32_t node, uint32_t operand,
+                                int prefix, uint32_t dest) {
+    TokenType op = (TokenType)c->tokens->types[c->ast->main_tokens[node]];
+    Place place;
+    if (compilePlace(c, operand, &place)) {
+        return VT_ERROR;
+    }
+    if (place.kind == PLACE_CHARACTER) {
+        compilerError(c, c->token, "strings cannot be changed in place");
+        return VT_ERROR;
+    }
+    if (place.type != VT_COUNT && place.type != VT_GLYPH &&
+        place.type != VT_PORTION) {
+        compilerError(c, c->token, "only numbers step with ++ and --");
+        return VT_ERROR;
+    }
+
+    uint32_t work = place.slot;
+    if (place.kind != PLACE_REGISTER) {
+        work = allocRegister(c);
+        placeLoad(c, &place, work);
+    }
+    if (!prefix && dest != NO_REGISTER) {
+        emit(c, VM_ABC(OP_MOVE, dest, work, 0));
+    }
+
+    int step = op == TK_INCREMENT ? 1 : -1;
+    if (place.type == VT_PORTION) {
+        uint32_t one = allocRegister(c);
+        loadConstant(c, one, (VmValue){.f = 1.0});
+        emit(c, VM_ABC(step > 0 ? OP_ADD_F : OP_SUB_F, work, work, one));
+    } else {
+        emit(c, VM_ABC(OP_ADDI, work, work, step + VM_SC_BIAS));
+        if (place.type == VT_GLYPH) {
+            emit(c, VM_ABC(OP_CHAR_I, work, work, 0));
+        }
+    }
+
+    if (place.kind != PLACE_REGISTER) {
+        placeStore(c, &place, work);
+    }
+    if (prefix && dest != NO_REGISTER && dest != work) {
+        emit(c, VM_ABC(OP_MOVE, dest, work, 0));
+    }
+    return place.type;
+}
+
+static uint8_t compileIndex(Compiler *c, uint32_t node, uint32_t dest) {
+    Place place;
+    if (compilePlace(c, node, &place)) {
+        return VT_ERROR;
+    }
+    placeLoad(c, &place, dest);
+    return place.type;
+}
+
+static uint8_t compileCall(Compiler *c, uint32_t node, uint32_t dest) {
+    const Ast *ast = c->ast;
+    uint32_t callee = ast->lhs[node];
+    uint32_t callee_token = ast->main_tokens[callee];
+    if (ast->kinds[callee] == AST_BUILTIN) {
+        return c->tokens->types[callee_token] == TK_OUT
+                   ? compileSayeth(c, node, dest)
+                   : compileHeareth(c, node, dest);
+    }
+    if (ast->kinds[callee] != AST_IDENTIFIER) {
+        compilerError(c, c->token, "only functions can be called");
+        return VT_ERROR;
+    }
+
+    uint32_t length;
+    uint32_t index;
+    const char *name = lexeme(c, callee_token, &length);
+    if (!nameTableFind(&c->functions, name, length, &index)) {
+        compilerError(c, callee_token, "undefined function");
+        return VT_ERROR;
+    }
+    uint32_t function = c->function_nodes[index];
+    uint32_t params = ast->lhs[function];
+    uint32_t param_start = ast->extra[params];
+    uint32_t pair = ast->rhs[node];
+    uint32_t count = ast->extra[pair + 1] - ast->extra[pair];
+    if (count != ast->extra[params + 1] - param_start) {
+        compilerError(c, callee_token, "wrong number of arguments");
+        return VT_ERROR;
+    }
+
+    // arguments go right above the result register, where the callee's
+    // window starts
+    uint32_t base = dest;
+    if (dest == NO_REGISTER || dest < c->local_top ||
+        dest + 1 != c->free_register) {
+        base = allocRegister(c);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t reg = allocRegister(c);
+        uint32_t argument = ast->extra[ast->extra[pair] + i];
+        uint8_t param = paramType(c, ast->extra[param_start + i]);
+        uint8_t type = compileExpr(c, argument, reg);
+        if ((param & VT_ARRAY) && type != param && type != VT_ERROR) {
+            compilerError(c, ast->main_tokens[argument],
+                          "array argument types differ");
+        } else {
+            coerce(c, reg, type, param);
+        }
+        c->free_register = reg + 1;
+    }
+    emit(c, VM_ABX(OP_CALL, base, index));
+    c->free_register = base + 1;
+
+    uint32_t define = ast->main_tokens[function];
+    uint8_t type = keywordType((TokenType)c->tokens->types[define + 1]);
+    if (dest != NO_REGISTER && type == VT_NOUGHT) {
+        compilerError(c, callee_token, "nought function gives no value");
+        return VT_ERROR;
+    }
+    if (dest != NO_REGISTER && dest != base) {
+        emit(c, VM_ABC(OP_MOVE, dest, base, 0));
+    }
+    return type;
+}
+
+// sayeth prints its arguments apart by spaces and a newline, a string
+// literal with a '%' followed by more arguments is a format whose
+// conversions print them in turn
+static uint8_t compileSayeth(Compiler *c, uint32_t node, uint32_t dest) {
+    const Ast *ast = c->ast;
+    uint32_t pair = ast->rhs[node];
+    uint32_t start = ast->extra[pair];
+    uint32_t end = ast->extra[pair + 1];
+    if (dest != NO_REGISTER) {
+        compilerError(c, c->token, "sayeth gives no value");
+        return VT_ERROR;
+    }
+
+    uint32_t first = start < end ? ast->extra[start] : 0;
+    int formatted = end - start >= 2 && ast->kinds[first] == AST_STRING;
+    if (formatted) {
+        uint32_t raw_length;
+        const char *raw = lexeme(c, ast->main_tokens[first], &raw_length);
+        formatted = memchr(raw, '%', raw_length) != NULL;
+    }
+    if (!formatted) {
+        for (uint32_t i = start; i < end; i++) {
+            if (i > start) {
+                loadString(c, NO_REGISTER, " ", 1);
+            }
+            compilePrintValue(c, ast->extra[i]);
+            c->free_register = c->local_top;
+        }
+        emit(c, VM_ABC(OP_PRINTNL, 0, 0, 0));
+        return VT_NOUGHT;
+    }
+
+    unsigned long length;
+    char *format = decodeString(c, ast->main_tokens[first], &length);
+    if (format == NULL) {
+        return VT_ERROR;
+    }
+    uint32_t next = start + 1;
+    unsigned long text_start = 0;
+    for (unsigned long i = 0; i < length; i++) {
+        if (format[i] != '%' || i + 1 >= length) {
+            continue;
+        }
+        // flags, width and precision, then the conversion
+        unsigned long spec = i + 1;
+        while (spec < length && strchr("-+ #0123456789.lh", format[spec])) {
+            spec++;
+        }
+        if (spec >= length) {
+            break;
+        }
+        if (format[spec] == '%') {
+            loadString(c, NO_REGISTER, format + text_start, spec - text_start);
+            text_start = spec + 1;
+        } else if (next < end) {
+            loadString(c, NO_REGISTER, format + text_start, i - text_start);
+            compilePrintValue(c, ast->extra[next++]);
+            c->free_register = c->local_top;
+            text_start = spec + 1;
+        }
+        i = spec;
+    }
+    loadString(c, NO_REGISTER, format + text_start, length - text_start);
+    free(format);
+
+    // arguments left over are still evaluated
+    for (; next < end; next++) {
+        compileExpr(c, ast->extra[next], allocRegister(c));
+        c->free_register = c->local_top;
+    }
+    emit(c, VM_ABC(OP_PRINTNL, 0, 0, 0));
+    return VT_NOUGHT;
+}
+
+// heareth(prompt, variable) prints the prompt up to its first conversion,
+// reads a line into the variable and gives its value; without a variable
+// the line is a string
+static uint8_t compileHeareth(Compiler *c, uint32_t node, uint32_t dest) {
+    const Ast *ast = c->ast;
+    uint32_t pair = ast->rhs[node];
+    uint32_t start = ast->extra[pair];
+    uint32_t count = ast->extra[pair + 1] - start;
+    if (count > 2) {
+        compilerError(c, c->token, "heareth takes a prompt and a variable");
+        return VT_ERROR;
+    }
+
+    if (count > 0) {
+        uint32_t prompt = ast->extra[start];
+        if (ast->kinds[prompt] == AST_STRING) {
+            unsigned long length;
+            char *text = decodeString(c, ast->main_tokens[prompt], &length);
+            if (text == NULL) {
+                return VT_ERROR;
+            }
+            char *conversion = memchr(text, '%', length);
+            if (conversion != NULL) {
+                length = (unsigned long)(conversion - text);
+            }
+            loadString(c, NO_REGISTER, text, length);
+            free(text);
+        } else {
+            compilePrintValue(c, prompt);
+        }
+    }
+
+    if (count < 2) {
+        uint32_t reg = dest != NO_REGISTER ? dest : allocRegister(c);
+        emit(c, VM_ABC(OP_READ_S, reg, 0, 0));
+        return VT_STRING;
+    }
+
+    Place place;
+    uint32_t target = ast->extra[start + 1];
+    if (ast->kinds[target] == AST_UNARY &&
+        c->tokens->types[ast->main_tokens[target]] == TK_AMPERSAND) {
+        target = ast->lhs[target];
+    }
+    if (compilePlace(c, target, &place)) {
+        return VT_ERROR;
+    }
+
+    static const uint8_t read_opcodes[VT_STRING + 1] = {
+        [VT_COUNT] = OP_READ_I,   [VT_GLYPH] = OP_READ_C,
+        [VT_VERDICT] = OP_READ_B, [VT_PORTION] = OP_READ_F,
+        [VT_STRING] = OP_READ_S,
+    };
+    if (place.type > VT_STRING || place.type == VT_NOUGHT ||
+        place.kind == PLACE_CHARACTER) {
+        compilerError(c, ast->main_tokens[target],
+                      "heareth reads into a number, glyph, verdict or "
+                      "string variable");
+        return VT_ERROR;
+    }
+    uint32_t work =
+        place.kind == PLACE_REGISTER ? place.slot : allocRegister(c);
+    emit(c, VM_ABC(read_opcodes[place.type], work, 0, 0));
+    if (place.kind != PLACE_REGISTER) {
+        placeStore(c, &place, work);
+    }
+    if (dest != NO_REGISTER && dest != work) {
+        emit(c, VM_ABC(OP_MOVE, dest, work, 0));
+    }
+    return place.type;
+}
+
+static void compilePrintValue(Compiler *c, uint32_t node) {
+    static const uint8_t print_opcodes[VT_STRING + 1] = {
+        [VT_COUNT] = OP_PRINT_I,   [VT_GLYPH] = OP_PRINT_C,
+        [VT_VERDICT] = OP_PRINT_B, [VT_PORTION] = OP_PRINT_F,
+        [VT_STRING] = OP_PRINT_S,
+    };
+
+    // literal text is printed from its constant
+    if (c->ast->kinds[node] == AST_STRING) {
+        unsigned long length;
+        char *text = decodeString(c, c->ast->main_tokens[node], &length);
+        if (text != NULL) {
+            loadString(c, NO_REGISTER, text, length);
+            free(text);
+        }
+        return;
+    }
+
+    uint32_t reg;
+    uint8_t type = compileOperand(c, node, &reg);
+    if (type == VT_ERROR) {
+        return;
+    }
+    if (type > VT_STRING || type == VT_NOUGHT) {
+        compilerError(c, c->ast->main_tokens[node], "value cannot be printed");
+        return;
+    }
+    emit(c, VM_ABC(print_opcodes[type], reg, 0, 0));
+}
+
+// resolve an assignable expression, its array and index are compiled
+static int compilePlace(Compiler *c, uint32_t node, Place *place) {
+    const Ast *ast = c->ast;
+    uint32_t token = ast->main_tokens[node];
+    switch ((AstKind)ast->kinds[node]) {
+    case AST_IDENTIFIER:
+        return resolveName(c, token, place);
+    case AST_INDEX: {
+        uint32_t array;
+        uint32_t index;
+        uint8_t type = compileOperand(c, ast->lhs[node], &array);
+        uint8_t index_type = compileOperand(c, ast->rhs[node], &index);
+        if (type == VT_ERROR || index_type == VT_ERROR) {
+            return 1;
+        }
+        if (!(type & VT_ARRAY) && type != VT_STRING) {
+            compilerError(c, token, "only arrays and strings are indexed");
+            return 1;
+        }
+        if (!isInteger(index_type)) {
+            compilerError(c, ast->main_tokens[ast->rhs[node]],
+                          "index must be a count");
+            return 1;
+        }
+        if (type == VT_STRING) {
+            *place = (Place){PLACE_CHARACTER, VT_GLYPH, array, index};
+        } else {
+            *place = (Place){PLACE_ELEMENT, type & ~VT_ARRAY, array, index};
+        }
+        return 0;
+    }
+    default:
+        compilerError(c, token, "expression cannot be assigned");
+        return 1;
+    }
+}
+
+static void placeLoad(Compiler *c, const Place *place, uint32_t dest) {
+    switch (place->kind) {
+    case PLACE_REGISTER:
+        if (place->slot != dest) {
+            emit(c, VM_ABC(OP_MOVE, dest, place->slot, 0));
+        }
+        break;
+    case PLACE_GLOBAL:
+        emit(c, VM_ABX(OP_GETGLOBAL, dest, place->slot));
+        break;
+    case PLACE_ELEMENT:
+        emit(c, VM_ABC(OP_GETINDEX, dest, place->slot, place->index));
+        break;
+    case PLACE_CHARACTER:
+        emit(c, VM_ABC(OP_GETCHAR, dest, place->slot, place->index));
+        break;
+    }
+}
+
+static void placeStore(Compiler *c, const Place *place, uint32_t src) {
+    switch (place->kind) {
+    case PLACE_REGISTER:
+        if (place->slot != src) {
+            emit(c, VM_ABC(OP_MOVE, place->slot, src, 0));
+        }
+        break;
+    case PLACE_GLOBAL:
+        emit(c, VM_ABX(OP_SETGLOBAL, src, place->slot));
+        break;
+    case PLACE_ELEMENT:
+        emit(c, VM_ABC(OP_SETINDEX, place->slot, place->index, src));
+        break;
+    case PLACE_CHARACTER: // rejected by compilePlace callers
+        break;
+    }
+}
+
+// convert reg in place from one type to another, 1 when they do not mix
+static int coerce(Compiler *c, uint32_t reg, uint8_t from, uint8_t to) {
+    if (from == to || from == VT_ERROR || to == VT_ERROR) {
+        return 0;
+    }
+    if (isInteger(from) && to == VT_PORTION) {
+        emit(c, VM_ABC(OP_I2F, reg, reg, 0));
+        return 0;
+    }
+    if (from == VT_PORTION && isInteger(to)) {
+        emit(c, VM_ABC(to == VT_VERDICT ? OP_BOOL_F : OP_F2I, reg, reg, 0));
+        if (to == VT_GLYPH) {
+            emit(c, VM_ABC(OP_CHAR_I, reg, reg, 0));
+        }
+        return 0;
+    }
+    if (isInteger(from) && isInteger(to)) {
+        if (to == VT_GLYPH) {
+            emit(c, VM_ABC(OP_CHAR_I, reg, reg, 0));
+        } else if (to == VT_VERDICT) {
+            emit(c, VM_ABC(OP_BOOL_I, reg, reg, 0));
+        }
+        return 0;
+    }
+
+    char message[96];
+    char from_name[24];
+    char to_name[24];
+    snprintf(message, sizeof(message), "cannot convert %s to %s",
+             typeName(from, from_name, sizeof(from_name)),
+             typeName(to, to_name, sizeof(to_name)));
+    compilerError(c, c->token, message);
+    return 1;
+}
+
+// register holding the text of a value, NO_REGISTER for arrays
+static uint32_t toString(Compiler *c, uint32_t reg, uint8_t type) {
+    static const uint8_t string_opcodes[VT_STRING + 1] = {
+        [VT_COUNT] = OP_TOSTR_I,   [VT_GLYPH] = OP_TOSTR_C,
+        [VT_VERDICT] = OP_TOSTR_B, [VT_PORTION] = OP_TOSTR_F,
+    };
+    if (type == VT_STRING) {
+        return reg;
+    }
+    if (type > VT_STRING || type == VT_NOUGHT) {
+        compilerError(c, c->token, "value cannot be joined to a string");
+        return NO_REGISTER;
+    }
+    uint32_t text = allocRegister(c);
+    emit(c, VM_ABC(string_opcodes[type], text, reg, 0));
+    return text;
+}
+
+// portion copy of an integer operand in a temporary
+static uint8_t promote(Compiler *c, uint32_t *reg, uint8_t type) {
+    if (type == VT_PORTION) {
+        return type;
+    }
+    uint32_t converted = allocRegister(c);
+    emit(c, VM_ABC(OP_I2F, converted, *reg, 0));
+    *reg = converted;
+    return VT_PORTION;
+}
+
+static void loadInteger(Compiler *c, uint32_t dest, int64_t value) {
+    if (value >= LOADI_MIN && value <= LOADI_MAX) {
+        emit(c, VM_ABX(OP_LOADI, dest, (uint32_t)(value + VM_SBX_BIAS)));
+    } else {
+        loadConstant(c, dest, (VmValue){.i = value});
+    }
+}
+
+static void loadConstant(Compiler *c, uint32_t dest, VmValue value) {
+    loadConstantIndex(c, dest, addConstant(c, value));
+}
+
+static void loadConstantIndex(Compiler *c, uint32_t dest, uint32_t index) {
+    if (index <= UINT16_MAX) {
+        emit(c, VM_ABX(OP_LOADK, dest, index));
+    } else {
+        emit(c, VM_ABC(OP_LOADKX, dest, 0, 0));
+        emit(c, index);
+    }
+}
+
+// copy text into a string constant loaded into dest, or printed when dest
+// is NO_REGISTER
+static void loadString(Compiler *c, uint32_t dest, const char *text,
+                       unsigned long length) {
+    VmProgram *program = c->program;
+    if (dest == NO_REGISTER && length == 0) {
+        return;
+    }
+    char *copy = malloc(length + 1);
+    if (copy == NULL || grow(c, (void **)&program->strings,
+                             &program->string_capacity, program->string_count,
+                             sizeof(char *))) {
+        free(copy);
+        compilerError(c, 0, NULL);
+        return;
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    program->strings[program->string_count++] = copy;
+
+    uint32_t index = addConstant(c, (VmValue){.s = copy});
+    if (dest != NO_REGISTER) {
+        loadConstantIndex(c, dest, index);
+    } else if (index <= UINT16_MAX) {
+        emit(c, VM_ABX(OP_PRINTK, 0, index));
+    } else {
+        uint32_t reg = allocRegister(c);
+        emit(c, VM_ABC(OP_LOADKX, reg, 0, 0));
+        emit(c, index);
+        emit(c, VM_ABC(OP_PRINT_S, reg, 0, 0));
+    }
+}
+
+// integer or glyph literal (or a negated integer) within the sC range
+static int smallInteger(Compiler *c, uint32_t node, int *value) {
+    const Ast *ast = c->ast;
+    int64_t literal;
+    switch ((AstKind)ast->kinds[node]) {
+    case AST_CHARACTER:
+        literal = glyphValue(c, ast->main_tokens[node]);
+        break;
+    case AST_INTEGER:
+        if (literalInteger(c, node, &literal)) {
+            return 0;
+        }
+        break;
+    case AST_UNARY:
+        if (c->tokens->types[ast->main_tokens[node]] != TK_MINUS ||
+            ast->kinds[ast->lhs[node]] != AST_INTEGER ||
+            literalInteger(c, ast->lhs[node], &literal)) {
+            return 0;
+        }
+        literal = -literal;
+        break;
+    default:
+        return 0;
+    }
+    if (literal < -VM_SC_BIAS || literal >= VM_SC_BIAS) {
+        return 0;
+    }
+    *value = (int)literal;
+    return 1;
+}
+
+// value of an integer literal, 1 (reported) when it does not fit
+static int literalInteger(Compiler *c, uint32_t node, int64_t *value) {
+    uint32_t token = c->ast->main_tokens[node];
+    uint32_t length;
+    const char *text = lexeme(c, token, &length);
+    uint64_t result = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        uint64_t digit = (uint64_t)(text[i] - '0');
+        if (result > (INT64_MAX - digit) / 10) {
+            compilerError(c, token, "count literal too large");
+            return 1;
+        }
+        result = result * 10 + digit;
+    }
+    *value = (int64_t)result;
+    return 0;
+}
+
+// character literal between its quotes, with escapes
+static int64_t glyphValue(Compiler *c, uint32_t token) {
+    uint32_t length;
+    const char *text = lexeme(c, token, &length);
+    if (length == 0) {
+        return 0;
+    }
+    if (text[0] != '\\' || length < 2) {
+        return (unsigned char)text[0];
+    }
+    switch (text[1]) {
+    case 'n':
+        return '\n';
+    case 't':
+        return '\t';
+    case 'r':
+        return '\r';
+    case '0':
+        return '\0';
+    default:
+        return (unsigned char)text[1];
+    }
+}
+
+// string literal between its quotes with escapes replaced, malloc'd
+static char *decodeString(Compiler *c, uint32_t token, unsigned long *length) {
+    uint32_t raw_length;
+    const char *raw = lexeme(c, token, &raw_length);
+    char *text = malloc(raw_length + 1);
+    if (text == NULL) {
+        compilerError(c, 0, NULL);
+        return NULL;
+    }
+
+    unsigned long out = 0;
+    for (uint32_t i = 0; i < raw_length; i++) {
+        char chr = raw[i];
+        if (chr == '\\' && i + 1 < raw_length) {
+            switch (raw[++i]) {
+            case 'n':
+                chr = '\n';
+                break;
+            case 't':
+                chr = '\t';
+                break;
+            case 'r':
+                chr = '\r';
+                break;
+            case 'v':
+                chr = '\v';
+                break;
+            case '0':
+                chr = '\0';
+                break;
+            default:
+                chr = raw[i];
+                break;
+            }
+        }
+        text[out++] = chr;
+    }
+    text[out] = '\0';
+    *length = out;
+    return text;
+}
+
+static uint8_t keywordType(TokenType type) {
+    switch (type) {
+    case TK_INT:
+        return VT_COUNT;
+    case TK_CHAR:
+        return VT_GLYPH;
+    case TK_FLOAT:
+    case TK_DOUBLE:
+        return VT_PORTION;
+    case TK_BOOL:
+        return VT_VERDICT;
+    default:
+        return VT_NOUGHT;
+    }
+}
+
+// `maketh <type> <name> [...]`, glyph arrays are strings
+static uint8_t declarationType(Compiler *c, uint32_t node) {
+    uint32_t keyword = c->ast->main_tokens[node];
+    uint8_t type = keywordType((TokenType)c->tokens->types[keyword + 1]);
+    if (c->tokens->types[keyword + 3] != TK_LBRACKET || type == VT_NOUGHT) {
+        return type;
+    }
+    return type == VT_GLYPH ? VT_STRING : type | VT_ARRAY;
+}
+
+// `<type> <name> [ '[' ']' ]` of a parameter
+static uint8_t paramType(Compiler *c, uint32_t param) {
+    uint32_t name = c->ast->main_tokens[param];
+    uint8_t type = keywordType((TokenType)c->tokens->types[name - 1]);
+    if (c->tokens->types[name + 1] != TK_LBRACKET || type == VT_NOUGHT) {
+        return type;
+    }
+    return type == VT_GLYPH ? VT_STRING : type | VT_ARRAY;
+}
+
+// count, glyph and verdict share the integer instructions
+static int isInteger(uint8_t type) {
+    return type == VT_COUNT || type == VT_GLYPH || type == VT_VERDICT;
+}
+
+static int isNumber(uint8_t type) {
+    return isInteger(type) || type == VT_PORTION;
+}
+
+static const char *typeName(uint8_t type, char *buffer, size_t size) {
+    if (type & VT_ARRAY && type != VT_ERROR) {
+        snprintf(buffer, size, "%s[]", value_type_names[type & ~VT_ARRAY]);
+    } else {
+        snprintf(buffer, size, "%s",
+                 type <= VT_STRING ? value_type_names[type] : "error");
+    }
+    return buffer;
+}
+
+// declare a variable in the innermost scope, in a register unless it is a
+// top level variable shared with functions or past the top level registers
+static Local *declareLocal(Compiler *c, uint32_t token, uint8_t type) {
+    uint32_t length;
+    const char *name = lexeme(c, token, &length);
+    uint32_t symbol = tokenSymbol(c, token);
+
+    // names may be reused by inner scopes only
+    Local *existing = findLocal(c, name, length, symbol);
+    if (existing != NULL &&
+        (uint32_t)(existing - c->locals) >= c->scope_start) {
+        compilerError(c, token, "variable already declared in this scope");
+    }
+
+    if (grow(c, (void **)&c->locals, &c->local_capacity, c->local_count,
+             sizeof(Local))) {
+        return NULL;
+    }
+    Local *local = &c->locals[c->local_count];
+    *local = (Local){name, length, symbol, c->next_id++, 0, type, 0};
+
+    uint32_t slot;
+    int top_level = c->function == 0 && c->scope_depth == 0;
+    if (top_level && nameTableFind(&c->globals, name, length, &slot)) {
+        local->global = 1;
+        local->slot = slot;
+    } else if (top_level && c->free_register >= TOP_LEVEL_REGISTERS) {
+        slot = c->program->global_count;
+        if (slot > UINT16_MAX ||
+            grow(c, (void **)&c->global_types, &c->global_capacity, slot,
+                 1)) {
+            compilerError(c, token, "too many globals");
+            return NULL;
+        }
+        c->global_types[slot] = type;
+        c->program->global_count++;
+        local->global = 1;
+        local->slot = slot;
+    } else {
+        local->slot = allocRegister(c);
+        c->local_top = c->free_register;
+    }
+    c->local_count++;
+    return local;
+}
+
+// innermost local named name, by symbol when both names are interned
+static Local *findLocal(Compiler *c, const char *name, uint32_t length,
+                        uint32_t symbol) {
+    for (uint32_t i = c->local_count; i > 0; i--) {
+        Local *local = &c->locals[i - 1];
+        if (symbol != 0 && local->symbol != 0) {
+            if (local->symbol == symbol) {
+                return local;
+            }
+        } else if (local->length == length &&
+                   memcmp(local->name, name, length) == 0) {
+            return local;
+        }
+    }
+    return NULL;
+}
+
+// variable named by token: a local, else (in functions) a global
+static int resolveName(Compiler *c, uint32_t token, Place *place) {
+    uint32_t length;
+    const char *name = lexeme(c, token, &length);
+    Local *local = findLocal(c, name, length, tokenSymbol(c, token));
+    if (local != NULL) {
+        *place = (Place){local->global ? PLACE_GLOBAL : PLACE_REGISTER,
+                         local->type, local->slot, 0};
+        return local->type == VT_ERROR;
+    }
+
+    uint32_t slot;
+    if (c->function != 0 && nameTableFind(&c->globals, name, length, &slot)) {
+        *place = (Place){PLACE_GLOBAL, c->global_types[slot], slot, 0};
+        return c->global_types[slot] == VT_ERROR;
+    }
+
+    compilerError(c, token,
+                  nameTableFind(&c->functions, name, length, &slot)
+                      ? "function used as a value"
+                      : "undeclared variable");
+    return 1;
+}
+
+static uint32_t allocRegister(Compiler *c) {
+    if (c->free_register >= VM_MAX_REGISTERS) {
+        if (!c->register_error) {
+            compilerError(c, c->token, "function needs too many registers");
+            c->register_error = 1;
+        }
+        return VM_MAX_REGISTERS - 1;
+    }
+    uint32_t reg = c->free_register++;
+    if (c->free_register > c->max_register) {
+        c->max_register = c->free_register;
+    }
+    return reg;
+}
+
+// append an instruction from the current token, returns its index
+static uint32_t emit(Compiler *c, uint32_t instruction) {
+    VmProgram *program = c->program;
+    uint32_t capacity = program->code_capacity;
+    if (grow(c, (void **)&program->code, &capacity, program->code_count,
+             sizeof(uint32_t)) ||
+        grow(c, (void **)&program->code_tokens, &program->code_capacity,
+             program->code_count, sizeof(uint32_t))) {
+        return 0;
+    }
+    program->code[program->code_count] = instruction;
+    program->code_tokens[program->code_count] = c->token;
+    return program->code_count++;
+}
+
+// jump to be patched, reg is the tested register of JMPF and JMPT
+static uint32_t emitJump(Compiler *c, VmOpcode op, uint32_t reg) {
+    if (op == OP_JMP) {
+        return emit(c, VM_AX(OP_JMP, VM_SAX_BIAS));
+    }
+    return emit(c, VM_ABX(op, reg, VM_SBX_BIAS));
+}
+
+static void patchJump(Compiler *c, uint32_t at, uint32_t target) {
+    VmProgram *program = c->program;
+    if (c->out_of_memory) {
+        return;
+    }
+    int64_t offset = (int64_t)target - ((int64_t)at + 1);
+    uint32_t i = program->code[at];
+    if (VM_OP(i) == OP_JMP) {
+        if (offset < -VM_SAX_BIAS || offset >= VM_SAX_BIAS) {
+            compilerError(c, program->code_tokens[at], "jump too far");
+            return;
+        }
+        program->code[at] = VM_AX(OP_JMP, (uint32_t)(offset + VM_SAX_BIAS));
+    } else {
+        if (offset < -VM_SBX_BIAS || offset >= VM_SBX_BIAS) {
+            compilerError(c, program->code_tokens[at], "jump too far");
+            return;
+        }
+        program->code[at] =
+            VM_ABX(VM_OP(i), VM_A(i), (uint32_t)(offset + VM_SBX_BIAS));
+    }
+}
+
+// enter a loop or switch, returns its index (UINT32_MAX on failure)
+static uint32_t pushContext(Compiler *c, uint32_t label, int loop) {
+    if (grow(c, (void **)&c->contexts, &c->context_capacity,
+             c->context_count, sizeof(JumpContext))) {
+        return UINT32_MAX;
+    }
+    c->contexts[c->context_count] = (JumpContext){label, loop};
+    return c->context_count++;
+}
+
+// leave the innermost context, patching its cease and persist jumps
+static void popContext(Compiler *c, uint32_t continue_target,
+                       uint32_t break_target) {
+    uint32_t context = --c->context_count;
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < c->jump_count; i++) {
+        PendingJump jump = c->jumps[i];
+        if (jump.context != context) {
+            c->jumps[kept++] = jump;
+            continue;
+        }
+        patchJump(c, jump.at,
+                  jump.is_continue ? continue_target : break_target);
+    }
+    c->jump_count = kept;
+}
+
+static uint32_t addConstant(Compiler *c, VmValue value) {
+    VmProgram *program = c->program;
+    if (grow(c, (void **)&program->constants, &program->constant_capacity,
+             program->constant_count, sizeof(VmValue))) {
+        return 0;
+    }
+    program->constants[program->constant_count] = value;
+    return program->constant_count++;
+}
+
+static const char *lexeme(const Compiler *c, uint32_t token,
+                          uint32_t *length) {
+    const TokenBuffer *tokens = c->tokens;
+    Token tok = {.type = (TokenType)tokens->types[token],
+                 .start = tokens->starts[token],
+                 .length = tokens->lengths[token]};
+    *length = tokens->lengths[token];
+    return lexerGetLexeme(c->lexer, &tok);
+}
+
+// interned symbol of token, 0 when the lexer interned none
+static uint32_t tokenSymbol(const Compiler *c, uint32_t token) {
+    return c->tokens->symbols != NULL ? c->tokens->symbols[token] : 0;
+}
+
+static int sameLexeme(const Compiler *c, uint32_t first, uint32_t second) {
+    uint32_t first_symbol = tokenSymbol(c, first);
+    uint32_t second_symbol = tokenSymbol(c, second);
+    if (first_symbol != 0 && second_symbol != 0) {
+        return first_symbol == second_symbol;
+    }
+
+    uint32_t first_length;
+    uint32_t second_length;
+    const char *first_text = lexeme(c, first, &first_length);
+    const char *second_text = lexeme(c, second, &second_length);
+    return first_length == second_length &&
+           memcmp(first_text, second_text, first_length) == 0;
+}
+
+// make room for one more element after count, doubling the capacity
+static int grow(Compiler *c, void **array, uint32_t *capacity, uint32_t count,
+                size_t size) {
+    if (c->out_of_memory) {
+        return 1;
+    }
+    if (count < *capacity) {
+        return 0;
+    }
+    uint32_t grown = *capacity ? *capacity * 2 : 16;
+    void *resized = grown > *capacity ? realloc(*array, grown * size) : NULL;
+    if (resized == NULL) {
+        compilerError(c, 0, NULL);
+        return 1;
+    }
+    *array = resized;
+    *capacity = grown;
+    return 0;
+}
+
+static uint32_t nameHash(const char *name, uint32_t length) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static int nameTableFind(const NameTable *table, const char *name,
+                         uint32_t length, uint32_t *value) {
+    if (table->capacity == 0) {
+        return 0;
+    }
+    uint32_t mask = table->capacity - 1;
+    for (uint32_t i = nameHash(name, length) & mask;; i = (i + 1) & mask) {
+        const NameEntry *entry = &table->entries[i];
+        if (entry->name == NULL) {
+            return 0;
+        }
+        if (entry->length == length &&
+            memcmp(entry->name, name, length) == 0) {
+            *value = entry->value;
+            return 1;
+        }
+    }
+}
+
+// add name unless present, the table stays at most half full
+static int nameTableInsert(Compiler *c, NameTable *table, const char *name,
+                           uint32_t length, uint32_t value) {
+    uint32_t existing;
+    if (nameTableFind(table, name, length, &existing)) {
+        return 0;
+    }
+
+    if ((table->count + 1) * 2 > table->capacity) {
+        uint32_t capacity = table->capacity ? table->capacity * 2 : 64;
+        NameEntry *entries = calloc(capacity, sizeof(NameEntry));
+        if (entries == NULL) {
+            compilerError(c, 0, NULL);
+            return 1;
+        }
+        for (uint32_t i = 0; i < table->capacity; i++) {
+            const NameEntry *entry = &table->entries[i];
+            if (entry->name == NULL) {
+                continue;
+            }
+            uint32_t j = nameHash(entry->name, entry->length) & (capacity - 1);
+            while (entries[j].name != NULL) {
+                j = (j + 1) & (capacity - 1);
+            }
+            entries[j] = *entry;
+        }
+        free(table->entries);
+        table->entries = entries;
+        table->capacity = capacity;
+    }
+
+    uint32_t mask = table->capacity - 1;
+    uint32_t i = nameHash(name, length) & mask;
+    while (table->entries[i].name != NULL) {
+        i = (i + 1) & mask;
+    }
+    table->entries[i] = (NameEntry){name, length, value};
+    table->count++;
+    return 0;
+}
+
+// report a semantic error at token, a NULL message is an allocation failure
+static void compilerError(Compiler *c, uint32_t token, const char *message) {
+    c->status = 1;
+    if (message == NULL) {
+        if (!c->out_of_memory) {
+            fprintf(c->out, "ERROR: bytecode memory allocation failure "
+                            "[BYTECODE_ALLOCATION_ERROR]\n");
+        }
+        c->out_of_memory = 1;
+        return;
+    }
+    parseReportError(c->lexer, c->tokens, token, c->filename, c->out, message,
+                     "SEMANTIC_ERROR");
+}
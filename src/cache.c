@@ -0,0 +1,370 @@
+// cache header implementation
+//
+// `cache.c` stores an entry as a fixed header (magic, key, status and text
+// lengths in native byte order), the two texts and an XXH64 checksum of all
+// of it, so a torn or foreign file reads as a miss. Writers go through
+// mkstemp in the cache directory and rename(2), which replaces entries
+// atomically on POSIX file systems. Eviction lists the directory after a
+// store, least recently touched entries go first.
+
+#include "cache.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "RNCACHE1"
+#define CACHE_NAME_SIZE 64
+#define CACHE_STALE_SECONDS 3600 // temporary files left by a crashed writer
+#define CACHE_TEMPORARY_LENGTH 24 // ".<key>.XXXXXX" names of temporaries
+#define CACHE_ENTRY_LENGTH 20     // "<key>.rnc" names of entries
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+typedef struct CacheHeaderStruct {
+    char magic[8];
+    uint64_t key;
+    int64_t status;
+    uint64_t out_length;
+    uint64_t symbol_length;
+} CacheHeader;
+
+// entry file seen while evicting
+typedef struct CacheFileStruct {
+    char name[CACHE_NAME_SIZE];
+    struct timespec touched;
+    unsigned long size;
+} CacheFile;
+
+static uint64_t xxhRound(uint64_t accumulator, uint64_t input);
+static uint64_t xxhMergeRound(uint64_t accumulator, uint64_t value);
+static uint64_t xxhRead64(const unsigned char *bytes);
+static uint32_t xxhRead32(const unsigned char *bytes);
+static uint64_t cacheChecksum(const CacheHeader *header, const char *out_text,
+                              const char *symbol_text);
+static int cacheWriteAll(int file_desc, const void *data, size_t length);
+static void cacheEvict(const char *directory, unsigned long limit);
+static int cacheIsTemporary(const char *name, size_t length);
+static int cacheIsEntry(const char *name, size_t length);
+static int cacheIsKey(const char *digits);
+static int cacheCompareFiles(const void *first, const void *second);
+
+/// PUBLIC FUNCTIONS
+
+// XXH64 of length bytes of data
+uint64_t cacheHash(const void *data, size_t length, uint64_t seed) {
+    const unsigned char *bytes = data;
+    const unsigned char *end = length > 0 ? bytes + length : bytes;
+    uint64_t hash;
+
+    // four lanes over 32 byte stripes
+    if (length >= 32) {
+        uint64_t lanes[4] = {seed + XXH_PRIME64_1 + XXH_PRIME64_2,
+                             seed + XXH_PRIME64_2, seed,
+                             seed - XXH_PRIME64_1};
+        for (; end - bytes >= 32; bytes += 32) {
+            for (int i = 0; i < 4; i++) {
+                lanes[i] = xxhRound(lanes[i], xxhRead64(bytes + i * 8));
+            }
+        }
+        hash = ((lanes[0] << 1) | (lanes[0] >> 63)) +
+               ((lanes[1] << 7) | (lanes[1] >> 57)) +
+               ((lanes[2] << 12) | (lanes[2] >> 52)) +
+               ((lanes[3] << 18) | (lanes[3] >> 46));
+        for (int i = 0; i < 4; i++) {
+            hash = xxhMergeRound(hash, lanes[i]);
+        }
+    } else {
+        hash = seed + XXH_PRIME64_5;
+    }
+    hash += length;
+
+    // the tail in 8, 4 and 1 byte steps
+    for (; end - bytes >= 8; bytes += 8) {
+        hash ^= xxhRound(0, xxhRead64(bytes));
+        hash = ((hash << 27) | (hash >> 37)) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (end - bytes >= 4) {
+        hash ^= (uint64_t)xxhRead32(bytes) * XXH_PRIME64_1;
+        hash = ((hash << 23) | (hash >> 41)) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        bytes += 4;
+    }
+    for (; bytes < end; bytes++) {
+        hash ^= *bytes * XXH_PRIME64_5;
+        hash = ((hash << 11) | (hash >> 53)) * XXH_PRIME64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// read the entry of key from directory into a zeroed entry, 1 on a hit and
+// 0 on a miss (missing, unreadable or damaged entries all miss)
+int cacheLookup(const char *directory, uint64_t key, CacheEntry *entry) {
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/%016" PRIx64 CACHE_EXTENSION,
+                 directory, key) >= (int)sizeof(path)) {
+        return 0;
+    }
+    FILE *file_ptr = fopen(path, "rb");
+    if (file_ptr == NULL) {
+        return 0;
+    }
+
+    CacheHeader header;
+    uint64_t checksum;
+    int hit = fread(&header, sizeof(header), 1, file_ptr) == 1 &&
+              memcmp(header.magic, CACHE_MAGIC, 8) == 0 &&
+              header.key == key && header.out_length < SIZE_MAX / 2 &&
+              header.symbol_length < SIZE_MAX / 2;
+    if (hit) {
+        entry->status = (int)header.status;
+        entry->out_length = (size_t)header.out_length;
+        entry->symbol_length = (size_t)header.symbol_length;
+        entry->out_text = malloc(entry->out_length + 1);
+        entry->symbol_text = malloc(entry->symbol_length + 1);
+        hit = entry->out_text != NULL && entry->symbol_text != NULL &&
+              fread(entry->out_text, 1, entry->out_length, file_ptr) ==
+                  entry->out_length &&
+              fread(entry->symbol_text, 1, entry->symbol_length, file_ptr) ==
+                  entry->symbol_length &&
+              fread(&checksum, sizeof(checksum), 1, file_ptr) == 1 &&
+              fgetc(file_ptr) == EOF &&
+              checksum == cacheChecksum(&header, entry->out_text,
+                                        entry->symbol_text);
+    }
+
+    // a hit makes the entry the most recently used
+    if (hit) {
+        futimens(fileno(file_ptr), NULL);
+    } else {
+        cacheEntryCleanup(entry);
+    }
+    fclose(file_ptr);
+    return hit;
+}
+
+// atomically write entry under key (creating directory), then evict least
+// recently used entries until at most limit bytes remain. Errors are
+// printed to report.
+int cacheStore(const char *directory, uint64_t key, const CacheEntry *entry,
+               unsigned long limit, FILE *report) {
+    char path[4096];
+    char temporary[4096];
+    if (snprintf(path, sizeof(path), "%s/%016" PRIx64 CACHE_EXTENSION,
+                 directory, key) >= (int)sizeof(path) ||
+        snprintf(temporary, sizeof(temporary), "%s/.%016" PRIx64 ".XXXXXX",
+                 directory, key) >= (int)sizeof(temporary)) {
+        fprintf(report,
+                "ERROR: cache directory '%s' name too long "
+                "[CACHE_WRITE_ERROR]\n",
+                directory);
+        return 1;
+    }
+    if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+        fprintf(report,
+                "ERROR: cannot create cache directory '%s' "
+                "[CACHE_WRITE_ERROR]\n",
+                directory);
+        return 1;
+    }
+
+    CacheHeader header = {CACHE_MAGIC, key, entry->status, entry->out_length,
+                          entry->symbol_length};
+    uint64_t checksum =
+        cacheChecksum(&header, entry->out_text, entry->symbol_text);
+
+    int file_desc = mkstemp(temporary);
+    if (file_desc < 0) {
+        fprintf(report,
+                "ERROR: cannot write cache directory '%s' "
+                "[CACHE_WRITE_ERROR]\n",
+                directory);
+        return 1;
+    }
+    // readable by other compilers sharing the directory, like open(2) makes
+    int failed = fchmod(file_desc, 0644) != 0 ||
+                 cacheWriteAll(file_desc, &header, sizeof(header)) ||
+                 cacheWriteAll(file_desc, entry->out_text,
+                               entry->out_length) ||
+                 cacheWriteAll(file_desc, entry->symbol_text,
+                               entry->symbol_length) ||
+                 cacheWriteAll(file_desc, &checksum, sizeof(checksum));
+    failed |= close(file_desc) != 0;
+    if (failed || rename(temporary, path) != 0) {
+        unlink(temporary);
+        fprintf(report,
+                "ERROR: cannot write cache entry '%s' [CACHE_WRITE_ERROR]\n",
+                path);
+        return 1;
+    }
+
+    cacheEvict(directory, limit);
+    return 0;
+}
+
+// free the texts of an entry read by cacheLookup
+void cacheEntryCleanup(CacheEntry *entry) {
+    free(entry->out_text);
+    free(entry->symbol_text);
+    memset(entry, 0, sizeof(CacheEntry));
+}
+
+/// PRIVATE FUNCTIONS
+
+static uint64_t xxhRound(uint64_t accumulator, uint64_t input) {
+    accumulator += input * XXH_PRIME64_2;
+    accumulator = (accumulator << 31) | (accumulator >> 33);
+    return accumulator * XXH_PRIME64_1;
+}
+
+static uint64_t xxhMergeRound(uint64_t accumulator, uint64_t value) {
+    accumulator ^= xxhRound(0, value);
+    return accumulator * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+// little-endian reads at any alignment
+static uint64_t xxhRead64(const unsigned char *bytes) {
+    return (uint64_t)xxhRead32(bytes) | (uint64_t)xxhRead32(bytes + 4) << 32;
+}
+
+static uint32_t xxhRead32(const unsigned char *bytes) {
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 |
+           (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+// header and texts chained through XXH64
+static uint64_t cacheChecksum(const CacheHeader *header, const char *out_text,
+                              const char *symbol_text) {
+    uint64_t checksum = cacheHash(header, sizeof(CacheHeader), 0);
+    checksum = cacheHash(out_text, header->out_length, checksum);
+    return cacheHash(symbol_text, header->symbol_length, checksum);
+}
+
+static int cacheWriteAll(int file_desc, const void *data, size_t length) {
+    const char *bytes = data;
+    while (length > 0) {
+        ssize_t written = write(file_desc, bytes, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return 1;
+        }
+        bytes += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+// remove the least recently touched entries past limit bytes and stale
+// temporary files, racing evictions of other compilers are harmless
+static void cacheEvict(const char *directory, unsigned long limit) {
+    DIR *dir = opendir(directory);
+    if (dir == NULL) {
+        return;
+    }
+
+    CacheFile *files = NULL;
+    unsigned long count = 0;
+    unsigned long capacity = 0;
+    unsigned long total = 0;
+    time_t now = time(NULL);
+    char path[4096];
+    struct dirent *item;
+    while ((item = readdir(dir)) != NULL) {
+        size_t length = strlen(item->d_name);
+        int temporary = cacheIsTemporary(item->d_name, length);
+        int cached = cacheIsEntry(item->d_name, length);
+        struct stat info;
+        if ((!temporary && !cached) ||
+            snprintf(path, sizeof(path), "%s/%s", directory, item->d_name) >=
+                (int)sizeof(path) ||
+            stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+            continue;
+        }
+        if (temporary) {
+            if (now - info.st_mtime > CACHE_STALE_SECONDS) {
+                unlink(path);
+            }
+            continue;
+        }
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            CacheFile *grown = realloc(files, capacity * sizeof(CacheFile));
+            if (grown == NULL) {
+                break;
+            }
+            files = grown;
+        }
+        memcpy(files[count].name, item->d_name, length + 1);
+        files[count].touched = info.st_mtim;
+        files[count].size = (unsigned long)info.st_size;
+        total += files[count].size;
+        count++;
+    }
+    closedir(dir);
+
+    if (count > 1) {
+        qsort(files, count, sizeof(CacheFile), cacheCompareFiles);
+    }
+    for (unsigned long i = 0; i < count && total > limit; i++) {
+        snprintf(path, sizeof(path), "%s/%s", directory, files[i].name);
+        if (unlink(path) == 0 || errno == ENOENT) {
+            total -= files[i].size;
+        }
+    }
+    free(files);
+}
+
+// names of cacheStore temporaries only: '.', the key in 16 hex digits, '.'
+// and the 6 characters mkstemp fills in, other dotfiles are left alone
+static int cacheIsTemporary(const char *name, size_t length) {
+    return length == CACHE_TEMPORARY_LENGTH && name[0] == '.' &&
+           name[17] == '.' && cacheIsKey(name + 1);
+}
+
+// names of cacheStore entries only: the key in 16 hex digits and ".rnc",
+// other files of the directory are left alone
+static int cacheIsEntry(const char *name, size_t length) {
+    return length == CACHE_ENTRY_LENGTH &&
+           strcmp(name + 16, CACHE_EXTENSION) == 0 && cacheIsKey(name);
+}
+
+// 16 hex digits of a key
+static int cacheIsKey(const char *digits) {
+    for (int i = 0; i < 16; i++) {
+        if (!isxdigit((unsigned char)digits[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// oldest first
+static int cacheCompareFiles(const void *first, const void *second) {
+    const CacheFile *a = first;
+    const CacheFile *b = second;
+    if (a->touched.tv_sec != b->touched.tv_sec) {
+        return a->touched.tv_sec < b->touched.tv_sec ? -1 : 1;
+    }
+    return (a->touched.tv_nsec > b->touched.tv_nsec) -
+           (a->touched.tv_nsec < b->touched.tv_nsec);
+}
@@ -0,0 +1,1220 @@
+// codegen header implementation
+//
+// `codegen.c` walks each function twice: once to build the live interval
+// of every register and hand out machine registers, once to print its
+// instructions. r15 holds the register window of the running function (R
+// of vmloop.h), so a register left in memory is `8*r(%r15)`, a call moves
+// r15 up to the callee's window the way CALL moves R and the arguments are
+// already in place. Instructions that may fail jump to a stub passing the
+// report of their source token, rendered here, to rtError.
+
+#include "codegen.h"
+#include "parser.h"  // parseReportError
+#include "runtime.h" // rt* helpers called by the generated code
+#include "vm.h"      // VM_MAX_FRAMES
+
+#include <inttypes.h>
+#include <limits.h>
+#include <spawn.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+#define CODEGEN_IN_MEMORY (-1) // machine of a register left in its slot
+#define CODEGEN_MAX_DEPTH 6    // loop nesting told apart by spill weights
+
+// reports an instruction passes to the runtime
+#define CODEGEN_REPORT_FAIL 1   // .Lreport<pc>, the failure of its opcode
+#define CODEGEN_REPORT_MEMORY 2 // .Lmemory<pc>, out of memory
+
+typedef struct CodegenMachineStruct {
+    const char *name;
+    int callee_saved; // kept across calls into the runtime and libc
+} CodegenMachine;
+
+// rax, rcx, rdx, rsi, rdi, xmm0 and xmm1 are scratch, r15 is the window
+static const CodegenMachine codegen_machines[] = {
+    {"%rbx", 1}, {"%r12", 1}, {"%r13", 1}, {"%r14", 1},
+    {"%r8", 0},  {"%r9", 0},  {"%r10", 0}, {"%r11", 0},
+};
+
+#define CODEGEN_MACHINE_COUNT                                                  \
+    (int)(sizeof(codegen_machines) / sizeof(codegen_machines[0]))
+
+// live range of one register of the function being lowered
+typedef struct CodegenIntervalStruct {
+    uint32_t start;
+    uint32_t end;
+    uint64_t weight;  // uses, each 8 times heavier per loop around it
+    int used;         // read or written in the function
+    int crosses_call; // live across an instruction that calls
+    int machine;      // index into codegen_machines or CODEGEN_IN_MEMORY
+} CodegenInterval;
+
+typedef struct CodegenStruct {
+    const VmProgram *program;
+    Lexer *lexer;
+    const char *filename;
+    FILE *out;
+    uint8_t *targets;     // 1 on instructions that jumps land on
+    uint8_t *depths;      // loops around each instruction
+    uint8_t *reports;     // CODEGEN_REPORT_* of each instruction
+    const char **strings; // program->strings sorted by address
+    const char *condition;      // flags of the last compare, NULL if lost
+    uint32_t condition_register; // register the compare wrote
+    CodegenInterval intervals[VM_MAX_REGISTERS];
+    char operands[VM_MAX_REGISTERS][16]; // assembly operand of each register
+} Codegen;
+
+static void codegenFunction(Codegen *g, uint32_t index);
+static void codegenAllocate(Codegen *g, uint32_t begin, uint32_t end,
+                            const VmFunction *fn);
+static void codegenInstruction(Codegen *g, uint32_t pc, uint32_t end,
+                               uint32_t function);
+static void codegenData(Codegen *g);
+static int codegenReport(Codegen *g, const char *label, uint32_t pc,
+                         const char *message);
+static void codegenString(FILE *out, const char *text);
+static void codegenLine(Codegen *g, const char *format, ...);
+static void codegenMove(Codegen *g, const char *from, const char *to);
+static void codegenBinary(Codegen *g, uint32_t i, const char *operation,
+                          const char *right);
+static void codegenCompare(Codegen *g, uint32_t i, const char *right,
+                           const char *condition);
+static void codegenFloat(Codegen *g, uint32_t i, const char *operation);
+static void codegenFloatCall(Codegen *g, uint32_t i, const char *function);
+static void codegenFloatCompare(Codegen *g, uint32_t i, int swap,
+                                const char *first, const char *second,
+                                const char *combine);
+static void codegenStringCompare(Codegen *g, uint32_t i,
+                                 const char *condition);
+static void codegenCall(Codegen *g, const char *function, const char *result);
+static int codegenIsMemory(const char *operand);
+static const char *codegenInverse(const char *condition);
+static int codegenRegisters(const VmProgram *program, uint32_t pc,
+                            uint8_t *registers);
+static int codegenJump(const uint32_t *code, uint32_t pc, uint32_t *target);
+static uint32_t codegenNext(const uint32_t *code, uint32_t pc);
+static int codegenCalls(VmOpcode op);
+static const char *codegenFailure(VmOpcode op);
+static int codegenAllocates(VmOpcode op);
+static long codegenStringIndex(const Codegen *g, const char *pointer);
+static int compareAddresses(const void *left, const void *right);
+static int codegenLink(const char *assembly, const char *output,
+                       const char *runtime, FILE *report);
+static char *codegenDefaultRuntime(void);
+
+/// PUBLIC FUNCTIONS
+
+// write program as assembly to out, runtime errors are rendered from the
+// tokens of lexer the way vmRun reports them
+int codegenEmit(const VmProgram *program, Lexer *lexer, const char *filename,
+                FILE *out) {
+    uint32_t count = program->code_count;
+    Codegen *g = calloc(1, sizeof(Codegen));
+    if (g == NULL) {
+        return 1;
+    }
+    *g = (Codegen){
+        .program = program, .lexer = lexer, .filename = filename, .out = out};
+    g->targets = calloc(count + 1, 1);
+    g->depths = calloc(count + 1, 1);
+    g->reports = calloc(count + 1, 1);
+    g->strings = malloc((program->string_count + 1) * sizeof(char *));
+    if (g->targets == NULL || g->depths == NULL || g->reports == NULL ||
+        g->strings == NULL) {
+        free(g->targets);
+        free(g->depths);
+        free(g->reports);
+        free(g->strings);
+        free(g);
+        return 1;
+    }
+
+    // constants are untyped, a string is a pointer to one of the strings
+    for (uint32_t s = 0; s < program->string_count; s++) {
+        g->strings[s] = program->strings[s];
+    }
+    qsort(g->strings, program->string_count, sizeof(char *),
+          compareAddresses);
+
+    // a backward jump closes a loop around its target up to itself
+    for (uint32_t pc = 0; pc < count; pc = codegenNext(program->code, pc)) {
+        uint32_t target;
+        if (!codegenJump(program->code, pc, &target)) {
+            continue;
+        }
+        g->targets[target] = 1;
+        for (uint32_t p = target; p <= pc && target <= pc; p++) {
+            if (g->depths[p] < UINT8_MAX) {
+                g->depths[p]++;
+            }
+        }
+    }
+
+    fprintf(out, "# generated by renaisscript from %s\n", filename);
+    fprintf(out, "\t.text\n"
+                 "\t.globl\trtProgram\n"
+                 "\t.type\trtProgram, @function\n"
+                 "rtProgram:\n"
+                 "\tpushq\t%%r15\n"
+                 "\tmovq\t%%rdi, %%r15\n"
+                 "\tmovq\t%%rsi, .Lstack_end(%%rip)\n"
+                 "\tcall\t.Lfunction0\n"
+                 "\tpopq\t%%r15\n"
+                 "\tret\n"
+                 "\t.size\trtProgram, .-rtProgram\n");
+    for (uint32_t f = 0; f < program->function_count; f++) {
+        codegenFunction(g, f);
+    }
+    codegenData(g);
+
+    int status = ferror(out) ? 1 : 0;
+    free(g->targets);
+    free(g->depths);
+    free(g->reports);
+    free(g->strings);
+    free(g);
+    return status;
+}
+
+// write program to output: assembly when output ends in ".s", otherwise an
+// executable linked with `cc` against runtime (NULL for the archive next to
+// the running executable). Errors are printed to report.
+int codegenBuild(const VmProgram *program, Lexer *lexer,
+                 const char *filename, const char *output,
+                 const char *runtime, FILE *report) {
+    size_t length = strlen(output);
+    if (length > 2 && strcmp(output + length - 2, ".s") == 0) {
+        FILE *file_ptr = fopen(output, "w");
+        int status = file_ptr == NULL ||
+                     codegenEmit(program, lexer, filename, file_ptr);
+        if (file_ptr != NULL && fclose(file_ptr) != 0) {
+            status = 1;
+        }
+        if (status) {
+            fprintf(report, "ERROR: failed writing assembly to '%s' "
+                            "[OUTPUT_WRITE_ERROR]\n",
+                    output);
+        }
+        return status;
+    }
+
+    char *default_runtime = NULL;
+    if (runtime == NULL) {
+        runtime = default_runtime = codegenDefaultRuntime();
+    }
+    if (runtime == NULL || access(runtime, R_OK) != 0) {
+        fprintf(report, "ERROR: runtime library '%s' not found "
+                        "[RUNTIME_LIBRARY_ERROR]\n",
+                runtime != NULL ? runtime : CODEGEN_RUNTIME_NAME);
+        free(default_runtime);
+        return 1;
+    }
+
+    // the assembly only lives until cc is done with it
+    const char *directory = getenv("TMPDIR");
+    char assembly[PATH_MAX];
+    snprintf(assembly, sizeof(assembly), "%s/renaisscript-XXXXXX.s",
+             directory != NULL && directory[0] != '\0' ? directory : "/tmp");
+    int descriptor = mkstemps(assembly, 2);
+    FILE *file_ptr = descriptor < 0 ? NULL : fdopen(descriptor, "w");
+    int status = file_ptr == NULL ||
+                 codegenEmit(program, lexer, filename, file_ptr);
+    if (file_ptr != NULL && fclose(file_ptr) != 0) {
+        status = 1;
+    } else if (file_ptr == NULL && descriptor >= 0) {
+        close(descriptor);
+    }
+
+    if (status) {
+        fprintf(report, "ERROR: failed writing assembly to '%s' "
+                        "[OUTPUT_WRITE_ERROR]\n",
+                assembly);
+    } else {
+        status = codegenLink(assembly, output, runtime, report);
+    }
+    if (descriptor >= 0) {
+        unlink(assembly);
+    }
+    free(default_runtime);
+    return status;
+}
+
+/// PRIVATE FUNCTIONS
+
+// prologue saving the callee-saved machines in use, parameters given
+// machines loaded from the window, the body, then the shared epilogue and
+// the failure stubs
+static void codegenFunction(Codegen *g, uint32_t index) {
+    const VmProgram *program = g->program;
+    const VmFunction *fn = &program->functions[index];
+    uint32_t begin = fn->entry;
+    uint32_t end = index + 1 < program->function_count
+                       ? program->functions[index + 1].entry
+                       : program->code_count;
+    codegenAllocate(g, begin, end, fn);
+
+    int saved[CODEGEN_MACHINE_COUNT];
+    int saved_count = 0;
+    for (int m = 0; m < CODEGEN_MACHINE_COUNT; m++) {
+        for (int r = 0; r < VM_MAX_REGISTERS; r++) {
+            if (codegen_machines[m].callee_saved &&
+                g->intervals[r].machine == m) {
+                saved[saved_count++] = m;
+                break;
+            }
+        }
+    }
+    // the return address and an odd number of pushes keep rsp aligned
+    int pad = saved_count % 2 == 0;
+
+    if (fn->name == 0) {
+        fprintf(g->out, "\n# top level\n");
+    } else {
+        const TokenBuffer *tokens = program->tokens;
+        Token tok = {.type = (TokenType)tokens->types[fn->name],
+                     .start = tokens->starts[fn->name],
+                     .length = tokens->lengths[fn->name]};
+        fprintf(g->out, "\n# %.*s\n", (int)tok.length,
+                lexerGetLexeme(g->lexer, &tok));
+    }
+    fprintf(g->out, ".Lfunction%" PRIu32 ":\n", index);
+    for (int s = 0; s < saved_count; s++) {
+        codegenLine(g, "pushq\t%s", codegen_machines[saved[s]].name);
+    }
+    if (pad) {
+        codegenLine(g, "subq\t$8, %%rsp");
+    }
+    for (uint32_t r = 0; r < fn->params; r++) {
+        if (g->intervals[r].machine != CODEGEN_IN_MEMORY) {
+            codegenLine(g, "movq\t%" PRIu32 "(%%r15), %s", 8 * r,
+                        g->operands[r]);
+        }
+    }
+
+    g->condition = NULL;
+    for (uint32_t pc = begin; pc < end; pc = codegenNext(program->code, pc)) {
+        if (g->targets[pc]) {
+            fprintf(g->out, ".Lpc%" PRIu32 ":\n", pc);
+            g->condition = NULL;
+        }
+        codegenInstruction(g, pc, end, index);
+    }
+
+    fprintf(g->out, ".Lreturn%" PRIu32 ":\n", index);
+    if (pad) {
+        codegenLine(g, "addq\t$8, %%rsp");
+    }
+    for (int s = saved_count - 1; s >= 0; s--) {
+        codegenLine(g, "popq\t%s", codegen_machines[saved[s]].name);
+    }
+    codegenLine(g, "ret");
+
+    for (uint32_t pc = begin; pc < end; pc = codegenNext(program->code, pc)) {
+        if (g->reports[pc] & CODEGEN_REPORT_FAIL &&
+            VM_OP(program->code[pc]) != OP_GETCHAR) {
+            fprintf(g->out, ".Lerror%" PRIu32 ":\n", pc);
+            codegenLine(g, "leaq\t.Lreport%" PRIu32 "(%%rip), %%rdi", pc);
+            codegenLine(g, "call\trtError");
+        }
+    }
+}
+
+// live intervals of the registers of one function, then linear scan in
+// order of their starts. With every machine taken, the lightest interval
+// of the ones holding a usable machine and the new one stays in memory.
+static void codegenAllocate(Codegen *g, uint32_t begin, uint32_t end,
+                            const VmFunction *fn) {
+    const uint32_t *code = g->program->code;
+    CodegenInterval *intervals = g->intervals;
+    memset(intervals, 0, sizeof(g->intervals));
+
+    // parameters are written by the caller before the first instruction
+    for (uint32_t r = 0; r < fn->params && r < VM_MAX_REGISTERS; r++) {
+        intervals[r].start = intervals[r].end = begin;
+        intervals[r].used = 1;
+    }
+    for (uint32_t pc = begin; pc < end; pc = codegenNext(code, pc)) {
+        uint8_t registers[VM_MAX_REGISTERS + 1];
+        int count = codegenRegisters(g->program, pc, registers);
+        int depth = g->depths[pc] < CODEGEN_MAX_DEPTH ? g->depths[pc]
+                                                      : CODEGEN_MAX_DEPTH;
+        for (int k = 0; k < count; k++) {
+            CodegenInterval *interval = &intervals[registers[k]];
+            if (!interval->used) {
+                interval->start = pc;
+                interval->used = 1;
+            }
+            interval->end = pc;
+            interval->weight += (uint64_t)1 << (3 * depth);
+        }
+    }
+
+    // a register live anywhere in a loop is live around all of it, the
+    // next iteration may read it before writing it
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (uint32_t pc = begin; pc < end; pc = codegenNext(code, pc)) {
+            uint32_t target;
+            if (!codegenJump(code, pc, &target) || target > pc) {
+                continue;
+            }
+            for (int r = 0; r < VM_MAX_REGISTERS; r++) {
+                CodegenInterval *interval = &intervals[r];
+                if (interval->used && interval->start <= pc &&
+                    interval->end >= target &&
+                    (interval->start > target || interval->end < pc)) {
+                    interval->start =
+                        interval->start < target ? interval->start : target;
+                    interval->end = interval->end > pc ? interval->end : pc;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    // caller-saved machines lose their values in calls
+    for (uint32_t pc = begin; pc < end; pc = codegenNext(code, pc)) {
+        if (!codegenCalls(VM_OP(code[pc]))) {
+            continue;
+        }
+        for (int r = 0; r < VM_MAX_REGISTERS; r++) {
+            if (intervals[r].used && intervals[r].start < pc &&
+                pc < intervals[r].end) {
+                intervals[r].crosses_call = 1;
+            }
+        }
+    }
+
+    uint8_t order[VM_MAX_REGISTERS];
+    int order_count = 0;
+    for (int r = 0; r < VM_MAX_REGISTERS; r++) {
+        intervals[r].machine = CODEGEN_IN_MEMORY;
+        if (!intervals[r].used || intervals[r].weight == 0) {
+            continue;
+        }
+        int k = order_count++;
+        while (k > 0 && intervals[order[k - 1]].start > intervals[r].start) {
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = (uint8_t)r;
+    }
+
+    int owners[CODEGEN_MACHINE_COUNT]; // register holding each machine
+    for (int m = 0; m < CODEGEN_MACHINE_COUNT; m++) {
+        owners[m] = -1;
+    }
+    for (int k = 0; k < order_count; k++) {
+        CodegenInterval *interval = &intervals[order[k]];
+        for (int m = 0; m < CODEGEN_MACHINE_COUNT; m++) {
+            if (owners[m] >= 0 && intervals[owners[m]].end < interval->start) {
+                owners[m] = -1;
+            }
+        }
+
+        // free caller-saved machines first, callee-saved ones cost a push
+        int choice = -1;
+        for (int m = CODEGEN_MACHINE_COUNT - 1; m >= 0 && choice < 0; m--) {
+            if (owners[m] < 0 &&
+                (codegen_machines[m].callee_saved || !interval->crosses_call)) {
+                choice = m;
+            }
+        }
+        if (choice < 0) {
+            int victim = -1;
+            for (int m = 0; m < CODEGEN_MACHINE_COUNT; m++) {
+                if ((codegen_machines[m].callee_saved ||
+                     !interval->crosses_call) &&
+                    (victim < 0 || intervals[owners[m]].weight <
+                                       intervals[owners[victim]].weight)) {
+                    victim = m;
+                }
+            }
+            if (victim >= 0 &&
+                intervals[owners[victim]].weight < interval->weight) {
+                intervals[owners[victim]].machine = CODEGEN_IN_MEMORY;
+                choice = victim;
+            }
+        }
+        if (choice >= 0) {
+            owners[choice] = order[k];
+            interval->machine = choice;
+        }
+    }
+
+    for (int r = 0; r < VM_MAX_REGISTERS; r++) {
+        if (intervals[r].machine == CODEGEN_IN_MEMORY) {
+            snprintf(g->operands[r], sizeof(g->operands[r]), "%d(%%r15)",
+                     8 * r);
+        } else {
+            snprintf(g->operands[r], sizeof(g->operands[r]), "%s",
+                     codegen_machines[intervals[r].machine].name);
+        }
+    }
+}
+
+// lower one instruction, end is the end of its function
+static void codegenInstruction(Codegen *g, uint32_t pc, uint32_t end,
+                               uint32_t function) {
+    const VmProgram *program = g->program;
+    uint32_t i = program->code[pc];
+    VmOpcode op = VM_OP(i);
+    const char *ra = g->operands[VM_A(i)];
+    const char *rb = g->operands[VM_B(i)];
+    const char *rc = g->operands[VM_C(i)];
+    char text[64];
+
+    // a jump on the register a compare just wrote reuses its flags
+    const char *condition = g->condition;
+    uint32_t condition_register = g->condition_register;
+    g->condition = NULL;
+
+    if (codegenFailure(op) != NULL) {
+        g->reports[pc] |= CODEGEN_REPORT_FAIL;
+    }
+    if (codegenAllocates(op)) {
+        g->reports[pc] |= CODEGEN_REPORT_MEMORY;
+    }
+
+    switch (op) {
+    case OP_MOVE:
+        codegenMove(g, rb, ra);
+        break;
+    case OP_LOADI:
+        snprintf(text, sizeof(text), "$%" PRId32, VM_SBX(i));
+        codegenMove(g, text, ra);
+        break;
+    case OP_LOADK:
+    case OP_LOADKX: {
+        uint32_t index = op == OP_LOADK ? VM_BX(i) : program->code[pc + 1];
+        snprintf(text, sizeof(text), ".Lconstants+%" PRIu64 "(%%rip)",
+                 (uint64_t)index * 8);
+        codegenMove(g, text, ra);
+        break;
+    }
+    case OP_GETGLOBAL:
+        snprintf(text, sizeof(text), ".Lglobals+%" PRIu32 "(%%rip)",
+                 VM_BX(i) * 8);
+        codegenMove(g, text, ra);
+        break;
+    case OP_SETGLOBAL:
+        snprintf(text, sizeof(text), ".Lglobals+%" PRIu32 "(%%rip)",
+                 VM_BX(i) * 8);
+        codegenMove(g, ra, text);
+        break;
+
+    case OP_ADD_I:
+        codegenBinary(g, i, "addq", rc);
+        break;
+    case OP_SUB_I:
+        codegenBinary(g, i, "subq", rc);
+        break;
+    case OP_MUL_I:
+        codegenBinary(g, i, "imulq", rc);
+        break;
+    case OP_ADDI:
+        snprintf(text, sizeof(text), "$%d", VM_SC(i));
+        codegenBinary(g, i, "addq", text);
+        break;
+    case OP_DIV_I:
+    case OP_MOD_I:
+        // idiv traps on INT64_MIN / -1, which wraps like the loops do
+        codegenLine(g, "movq\t%s, %%rcx", rc);
+        codegenLine(g, "testq\t%%rcx, %%rcx");
+        codegenLine(g, "je\t.Lerror%" PRIu32, pc);
+        codegenLine(g, "movq\t%s, %%rax", rb);
+        codegenLine(g, "cmpq\t$-1, %%rcx");
+        codegenLine(g, "je\t1f");
+        codegenLine(g, "cqto");
+        codegenLine(g, "idivq\t%%rcx");
+        if (op == OP_MOD_I) {
+            codegenLine(g, "movq\t%%rdx, %%rax");
+        }
+        codegenLine(g, "jmp\t2f");
+        fprintf(g->out, "1:\n");
+        codegenLine(g, op == OP_DIV_I ? "negq\t%%rax" : "xorl\t%%eax, %%eax");
+        fprintf(g->out, "2:\n");
+        codegenMove(g, "%rax", ra);
+        break;
+    case OP_FLOORDIV_I:
+        codegenLine(g, "movq\t%s, %%rsi", rc);
+        codegenLine(g, "testq\t%%rsi, %%rsi");
+        codegenLine(g, "je\t.Lerror%" PRIu32, pc);
+        codegenLine(g, "movq\t%s, %%rdi", rb);
+        codegenCall(g, "rtFloorDivide", ra);
+        break;
+    case OP_POW_I:
+        codegenLine(g, "movq\t%s, %%rdi", rb);
+        codegenLine(g, "movq\t%s, %%rsi", rc);
+        codegenCall(g, "rtPower", ra);
+        break;
+
+    case OP_ADD_F:
+        codegenFloat(g, i, "addsd");
+        break;
+    case OP_SUB_F:
+        codegenFloat(g, i, "subsd");
+        break;
+    case OP_MUL_F:
+        codegenFloat(g, i, "mulsd");
+        break;
+    case OP_DIV_F:
+        codegenFloat(g, i, "divsd");
+        break;
+    case OP_FLOORDIV_F:
+        codegenLine(g, "movq\t%s, %%xmm0", rb);
+        codegenLine(g, "movq\t%s, %%xmm1", rc);
+        codegenLine(g, "divsd\t%%xmm1, %%xmm0");
+        codegenFloatCall(g, i, "floor@PLT");
+        break;
+    case OP_MOD_F:
+        codegenLine(g, "movq\t%s, %%xmm0", rb);
+        codegenLine(g, "movq\t%s, %%xmm1", rc);
+        codegenFloatCall(g, i, "fmod@PLT");
+        break;
+    case OP_POW_F:
+        codegenLine(g, "movq\t%s, %%xmm0", rb);
+        codegenLine(g, "movq\t%s, %%xmm1", rc);
+        codegenFloatCall(g, i, "pow@PLT");
+        break;
+
+    case OP_NEG_I:
+        codegenLine(g, "movq\t%s, %%rax", rb);
+        codegenLine(g, "negq\t%%rax");
+        codegenMove(g, "%rax", ra);
+        break;
+    case OP_NEG_F:
+        codegenLine(g, "movq\t%s, %%rax", rb);
+        codegenLine(g, "btcq\t$63, %%rax");
+        codegenMove(g, "%rax", ra);
+        break;
+    case OP_NOT:
+        codegenCompare(g, i, "$0", "e");
+        break;
+    case OP_I2F:
+        codegenLine(g, "pxor\t%%xmm0, %%xmm0");
+        codegenLine(g, "cvtsi2sdq\t%s, %%xmm0", rb);
+        codegenLine(g, "movq\t%%xmm0, %s", ra);
+        break;
+    case OP_F2I:
+        codegenLine(g, "movq\t%s, %%xmm0", rb);
+        codegenCall(g, "rtTruncate", ra);
+        break;
+    case OP_BOOL_I:
+        codegenCompare(g, i, "$0", "ne");
+        break;
+    case OP_BOOL_F:
+        codegenLine(g, "movq\t%s, %%xmm0", rb);
+        codegenLine(g, "xorpd\t%%xmm1, %%xmm1");
+        codegenFloatCompare(g, i, 0, "ne", "p", "orl");
+        break;
+    case OP_CHAR_I:
+        codegenLine(g, "movq\t%s, %%rax", rb);
+        codegenLine(g, "movzbl\t%%al, %%eax");
+        codegenMove(g, "%rax", ra);
+        break;
+
+    case OP_EQ_I:
+        codegenCompare(g, i, rc, "e");
+        break;
+    case OP_NE_I:
+        codegenCompare(g, i, rc, "ne");
+        break;
+    case OP_LT_I:
+        codegenCompare(g, i, rc, "l");
+        break;
+    case OP_LE_I:
+        codegenCompare(g, i, rc, "le");
+        break;
+    case OP_EQI:
+    case OP_NEI:
+    case OP_LTI:
+    case OP_LEI:
+    case OP_GTI:
+    case OP_GEI: {
+        static const char *const conditions[] = {"e", "ne", "l",
+                                                 "le", "g", "ge"};
+        snprintf(text, sizeof(text), "$%d", VM_SC(i));
+        codegenCompare(g, i, text, conditions[op - OP_EQI]);
+        break;
+    }
+    // ucomisd flags unordered (a NaN operand) as both equal and below
+    case OP_EQ_F:
+        codegenLine(g, "movq\t%s, %%xmm0", rb);
+        codegenLine(g, "movq\t%s, %%xmm1", rc);
+        codegenFloatCompare(g, i, 0, "e", "np", "andl");
+        break;
+    case OP_NE_F:
+        codegenLine(g, "movq\t%s, %%xmm0", rb);
+        codegenLine(g, "movq\t%s, %%xmm1", rc);
+        codegenFloatCompare(g, i, 0, "ne", "p", "orl");
+        break;
+    case OP_LT_F:
+        codegenLine(g, "movq\t%s, %%xmm0", rb);
+        codegenLine(g, "movq\t%s, %%xmm1", rc);
+        codegenFloatCompare(g, i, 1, "a", NULL, NULL);
+        break;
+    case OP_LE_F:
+        codegenLine(g, "movq\t%s, %%xmm0", rb);
+        codegenLine(g, "movq\t%s, %%xmm1", rc);
+        codegenFloatCompare(g, i, 1, "ae", NULL, NULL);
+        break;
+    case OP_EQ_S:
+        codegenStringCompare(g, i, "e");
+        break;
+    case OP_NE_S:
+        codegenStringCompare(g, i, "ne");
+        break;
+    case OP_LT_S:
+        codegenStringCompare(g, i, "l");
+        break;
+    case OP_LE_S:
+        codegenStringCompare(g, i, "le");
+        break;
+
+    case OP_JMP:
+    case OP_JMPF:
+    case OP_JMPT: {
+        uint32_t target;
+        codegenJump(program->code, pc, &target);
+        if (op == OP_JMP) {
+            codegenLine(g, "jmp\t.Lpc%" PRIu32, target);
+        } else if (condition != NULL && condition_register == VM_A(i) &&
+                   !g->targets[pc]) {
+            codegenLine(g, "j%s\t.Lpc%" PRIu32,
+                        op == OP_JMPT ? condition : codegenInverse(condition),
+                        target);
+        } else {
+            codegenLine(g, "cmpq\t$0, %s", ra);
+            codegenLine(g, "%s\t.Lpc%" PRIu32, op == OP_JMPT ? "jne" : "je",
+                        target);
+        }
+        break;
+    }
+
+    // the callee's window starts above the result register
+    case OP_CALL: {
+        const VmFunction *callee = &program->functions[VM_BX(i)];
+        uint32_t base = 8 * (VM_A(i) + 1);
+        for (uint32_t p = 0; p < callee->params; p++) {
+            uint32_t r = VM_A(i) + 1 + p;
+            if (r < VM_MAX_REGISTERS &&
+                g->intervals[r].machine != CODEGEN_IN_MEMORY) {
+                codegenLine(g, "movq\t%s, %" PRIu32 "(%%r15)", g->operands[r],
+                            8 * r);
+            }
+        }
+        codegenLine(g, "leaq\t%" PRIu32 "(%%r15), %%rax",
+                    base + 8 * (uint32_t)callee->registers);
+        codegenLine(g, "cmpq\t.Lstack_end(%%rip), %%rax");
+        codegenLine(g, "ja\t.Lerror%" PRIu32, pc);
+        codegenLine(g, "cmpq\t$%d, .Ldepth(%%rip)", VM_MAX_FRAMES);
+        codegenLine(g, "jae\t.Lerror%" PRIu32, pc);
+        codegenLine(g, "incq\t.Ldepth(%%rip)");
+        codegenLine(g, "addq\t$%" PRIu32 ", %%r15", base);
+        codegenLine(g, "call\t.Lfunction%" PRIu32, VM_BX(i));
+        codegenLine(g, "subq\t$%" PRIu32 ", %%r15", base);
+        codegenLine(g, "decq\t.Ldepth(%%rip)");
+        codegenMove(g, "%rax", ra);
+        break;
+    }
+    case OP_RET:
+    case OP_RET0:
+        if (op == OP_RET) {
+            codegenLine(g, "movq\t%s, %%rax", ra);
+        } else {
+            codegenLine(g, "xorl\t%%eax, %%eax");
+        }
+        if (codegenNext(program->code, pc) != end) {
+            codegenLine(g, "jmp\t.Lreturn%" PRIu32, function);
+        }
+        break;
+
+    case OP_NEWARRAY:
+        codegenLine(g, "movq\t%s, %%rdi", rb);
+        codegenLine(g, "testq\t%%rdi, %%rdi");
+        codegenLine(g, "js\t.Lerror%" PRIu32, pc);
+        codegenLine(g, "leaq\t.Lmemory%" PRIu32 "(%%rip), %%rsi", pc);
+        codegenCall(g, "rtNewArray", ra);
+        break;
+    case OP_GETINDEX:
+        codegenLine(g, "movq\t%s, %%rax", rb);
+        codegenLine(g, "movq\t%s, %%rcx", rc);
+        codegenLine(g, "testq\t%%rax, %%rax");
+        codegenLine(g, "je\t.Lerror%" PRIu32, pc);
+        codegenLine(g, "cmpq\t(%%rax), %%rcx");
+        codegenLine(g, "jae\t.Lerror%" PRIu32, pc);
+        codegenLine(g, "movq\t8(%%rax,%%rcx,8), %%rax");
+        codegenMove(g, "%rax", ra);
+        break;
+    case OP_SETINDEX:
+        codegenLine(g, "movq\t%s, %%rax", ra);
+        codegenLine(g, "movq\t%s, %%rcx", rb);
+        codegenLine(g, "testq\t%%rax, %%rax");
+        codegenLine(g, "je\t.Lerror%" PRIu32, pc);
+        codegenLine(g, "cmpq\t(%%rax), %%rcx");
+        codegenLine(g, "jae\t.Lerror%" PRIu32, pc);
+        codegenLine(g, "movq\t%s, %%rdx", rc);
+        codegenLine(g, "movq\t%%rdx, 8(%%rax,%%rcx,8)");
+        break;
+    case OP_GETCHAR:
+        codegenLine(g, "movq\t%s, %%rdi", rb);
+        codegenLine(g, "movq\t%s, %%rsi", rc);
+        codegenLine(g, "leaq\t.Lreport%" PRIu32 "(%%rip), %%rdx", pc);
+        codegenCall(g, "rtGetChar", ra);
+        break;
+    case OP_CONCAT:
+        codegenLine(g, "movq\t%s, %%rdi", rb);
+        codegenLine(g, "movq\t%s, %%rsi", rc);
+        codegenLine(g, "leaq\t.Lmemory%" PRIu32 "(%%rip), %%rdx", pc);
+        codegenCall(g, "rtConcat", ra);
+        break;
+
+    case OP_TOSTR_I:
+    case OP_TOSTR_C:
+        codegenLine(g, "movq\t%s, %%rdi", rb);
+        codegenLine(g, "leaq\t.Lmemory%" PRIu32 "(%%rip), %%rsi", pc);
+        codegenCall(g, op == OP_TOSTR_I ? "rtCountText" : "rtGlyphText", ra);
+        break;
+    case OP_TOSTR_F:
+        codegenLine(g, "movq\t%s, %%xmm0", rb);
+        codegenLine(g, "leaq\t.Lmemory%" PRIu32 "(%%rip), %%rdi", pc);
+        codegenCall(g, "rtPortionText", ra);
+        break;
+    case OP_TOSTR_B:
+        codegenLine(g, "movq\t%s, %%rdi", rb);
+        codegenCall(g, "rtVerdictText", ra);
+        break;
+
+    case OP_PRINT_I:
+    case OP_PRINT_C:
+    case OP_PRINT_B:
+    case OP_PRINT_S: {
+        static const char *const printers[] = {
+            [OP_PRINT_I] = "rtPrintCount",
+            [OP_PRINT_C] = "rtPrintGlyph",
+            [OP_PRINT_B] = "rtPrintVerdict",
+            [OP_PRINT_S] = "rtPrintString",
+        };
+        codegenLine(g, "movq\t%s, %%rdi", ra);
+        codegenCall(g, printers[op], NULL);
+        break;
+    }
+    case OP_PRINT_F:
+        codegenLine(g, "movq\t%s, %%xmm0", ra);
+        codegenCall(g, "rtPrintPortion", NULL);
+        break;
+    case OP_PRINTK:
+        codegenLine(g, "movq\t.Lconstants+%" PRIu64 "(%%rip), %%rdi",
+                    (uint64_t)VM_BX(i) * 8);
+        codegenCall(g, "rtPrintString", NULL);
+        break;
+    case OP_PRINTNL:
+        codegenCall(g, "rtPrintNewline", NULL);
+        break;
+
+    case OP_READ_I:
+        codegenCall(g, "rtReadCount", ra);
+        break;
+    case OP_READ_F:
+        codegenCall(g, "rtReadPortion", NULL);
+        codegenLine(g, "movq\t%%xmm0, %s", ra);
+        break;
+    case OP_READ_C:
+        codegenCall(g, "rtReadGlyph", ra);
+        break;
+    case OP_READ_B:
+        codegenCall(g, "rtReadVerdict", ra);
+        break;
+    case OP_READ_S:
+        codegenLine(g, "leaq\t.Lmemory%" PRIu32 "(%%rip), %%rdi", pc);
+        codegenCall(g, "rtReadString", ra);
+        break;
+    default:
+        break;
+    }
+}
+
+// strings, reports, the constant table, globals and the call counters
+static void codegenData(Codegen *g) {
+    const VmProgram *program = g->program;
+    FILE *out = g->out;
+
+    fprintf(out, "\n\t.section\t.rodata\n");
+    for (uint32_t s = 0; s < program->string_count; s++) {
+        fprintf(out, ".Lstring%" PRIu32 ":\n\t.string\t", s);
+        codegenString(out, g->strings[s]);
+        fputc('\n', out);
+    }
+    for (uint32_t pc = 0; pc < program->code_count; pc++) {
+        VmOpcode op = VM_OP(program->code[pc]);
+        if (g->reports[pc] & CODEGEN_REPORT_FAIL) {
+            codegenReport(g, ".Lreport", pc, codegenFailure(op));
+        }
+        if (g->reports[pc] & CODEGEN_REPORT_MEMORY) {
+            codegenReport(g, ".Lmemory", pc, "out of memory");
+        }
+    }
+
+    fprintf(out, "\n\t.data\n\t.balign\t8\n.Lconstants:\n");
+    for (uint32_t k = 0; k < program->constant_count; k++) {
+        long s = codegenStringIndex(g, program->constants[k].s);
+        if (s >= 0) {
+            fprintf(out, "\t.quad\t.Lstring%ld\n", s);
+        } else {
+            fprintf(out, "\t.quad\t%" PRId64 "\n", program->constants[k].i);
+        }
+    }
+
+    fprintf(out, "\n\t.bss\n\t.balign\t8\n"
+                 ".Lglobals:\n\t.zero\t%" PRIu64 "\n"
+                 ".Lstack_end:\n\t.zero\t8\n"
+                 ".Ldepth:\n\t.zero\t8\n"
+                 "\t.section\t.note.GNU-stack,\"\",@progbits\n",
+            (uint64_t)(program->global_count ? program->global_count : 1) *
+                8);
+}
+
+// the report vmRun prints when instruction pc fails with message
+static int codegenReport(Codegen *g, const char *label, uint32_t pc,
+                         const char *message) {
+    char *text = NULL;
+    size_t length = 0;
+    FILE *stream = open_memstream(&text, &length);
+    if (stream == NULL) {
+        return 1;
+    }
+    // rendered as human text, not collected with the errors of this compile
+    Diagnostics *diagnostics = g->lexer->diagnostics;
+    lexerSetDiagnostics(g->lexer, NULL);
+    parseReportError(g->lexer, g->program->tokens, g->program->code_tokens[pc],
+                     g->filename, stream, message, "RUNTIME_ERROR");
+    lexerSetDiagnostics(g->lexer, diagnostics);
+    if (fclose(stream) != 0) {
+        free(text);
+        return 1;
+    }
+    fprintf(g->out, "%s%" PRIu32 ":\n\t.string\t", label, pc);
+    codegenString(g->out, text);
+    fputc('\n', g->out);
+    free(text);
+    return 0;
+}
+
+// quoted for .string, bytes outside printable ASCII as octal escapes
+static void codegenString(FILE *out, const char *text) {
+    fputc('"', out);
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if (*c < 0x20 || *c >= 0x7f) {
+            fprintf(out, "\\%03o", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void codegenLine(Codegen *g, const char *format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    fputc('\t', g->out);
+    vfprintf(g->out, format, arguments);
+    fputc('\n', g->out);
+    va_end(arguments);
+}
+
+// movq between any two operands, through rax when both are in memory
+static void codegenMove(Codegen *g, const char *from, const char *to) {
+    if (strcmp(from, to) == 0) {
+        return;
+    }
+    if (codegenIsMemory(from) && codegenIsMemory(to)) {
+        codegenLine(g, "movq\t%s, %%rax", from);
+        from = "%rax";
+    }
+    codegenLine(g, "movq\t%s, %s", from, to);
+}
+
+// R[A] = R[B] operation right, in place when R[A] has a machine
+static void codegenBinary(Codegen *g, uint32_t i, const char *operation,
+                          const char *right) {
+    const char *ra = g->operands[VM_A(i)];
+    const char *rb = g->operands[VM_B(i)];
+    if (!codegenIsMemory(ra) && strcmp(ra, right) != 0) {
+        codegenMove(g, rb, ra);
+        codegenLine(g, "%s\t%s, %s", operation, right, ra);
+        return;
+    }
+    codegenLine(g, "movq\t%s, %%rax", rb);
+    codegenLine(g, "%s\t%s, %%rax", operation, right);
+    codegenMove(g, "%rax", ra);
+}
+
+// R[A] = R[B] condition right, the flags stay for a following jump
+static void codegenCompare(Codegen *g, uint32_t i, const char *right,
+                           const char *condition) {
+    const char *rb = g->operands[VM_B(i)];
+    codegenLine(g, "xorl\t%%eax, %%eax");
+    if (codegenIsMemory(rb) && codegenIsMemory(right)) {
+        codegenLine(g, "movq\t%s, %%rcx", rb);
+        rb = "%rcx";
+    }
+    codegenLine(g, "cmpq\t%s, %s", right, rb);
+    codegenLine(g, "set%s\t%%al", condition);
+    codegenMove(g, "%rax", g->operands[VM_A(i)]);
+    g->condition = condition;
+    g->condition_register = VM_A(i);
+}
+
+// R[A] = R[B] operation R[C] on doubles
+static void codegenFloat(Codegen *g, uint32_t i, const char *operation) {
+    codegenLine(g, "movq\t%s, %%xmm0", g->operands[VM_B(i)]);
+    codegenLine(g, "movq\t%s, %%xmm1", g->operands[VM_C(i)]);
+    codegenLine(g, "%s\t%%xmm1, %%xmm0", operation);
+    codegenLine(g, "movq\t%%xmm0, %s", g->operands[VM_A(i)]);
+}
+
+// R[A] = function(xmm0, xmm1) from libm
+static void codegenFloatCall(Codegen *g, uint32_t i, const char *function) {
+    codegenCall(g, function, NULL);
+    codegenLine(g, "movq\t%%xmm0, %s", g->operands[VM_A(i)]);
+}
+
+// R[A] = xmm0 compared with xmm1 (swapped: xmm1 with xmm0), a second
+// condition combined into the first when given
+static void codegenFloatCompare(Codegen *g, uint32_t i, int swap,
+                                const char *first, const char *second,
+                                const char *combine) {
+    codegenLine(g, "xorl\t%%eax, %%eax");
+    codegenLine(g, "xorl\t%%ecx, %%ecx");
+    codegenLine(g, swap ? "ucomisd\t%%xmm0, %%xmm1"
+                        : "ucomisd\t%%xmm1, %%xmm0");
+    codegenLine(g, "set%s\t%%al", first);
+    if (second != NULL) {
+        codegenLine(g, "set%s\t%%cl", second);
+        codegenLine(g, "%s\t%%ecx, %%eax", combine);
+    }
+    codegenMove(g, "%rax", g->operands[VM_A(i)]);
+}
+
+// R[A] = strcmp(R[B], R[C]) condition 0
+static void codegenStringCompare(Codegen *g, uint32_t i,
+                                 const char *condition) {
+    codegenLine(g, "movq\t%s, %%rdi", g->operands[VM_B(i)]);
+    codegenLine(g, "movq\t%s, %%rsi", g->operands[VM_C(i)]);
+    codegenCall(g, "strcmp@PLT", NULL);
+    codegenLine(g, "xorl\t%%ecx, %%ecx");
+    codegenLine(g, "testl\t%%eax, %%eax");
+    codegenLine(g, "set%s\t%%cl", condition);
+    codegenMove(g, "%rcx", g->operands[VM_A(i)]);
+}
+
+// call a runtime or libc function, its result stored in result when given
+static void codegenCall(Codegen *g, const char *function, const char *result) {
+    codegenLine(g, "call\t%s", function);
+    if (result != NULL) {
+        codegenMove(g, "%rax", result);
+    }
+}
+
+static int codegenIsMemory(const char *operand) {
+    return operand[0] != '%' && operand[0] != '$';
+}
+
+static const char *codegenInverse(const char *condition) {
+    static const char *const pairs[][2] = {
+        {"e", "ne"}, {"ne", "e"}, {"l", "ge"},
+        {"le", "g"}, {"g", "le"}, {"ge", "l"},
+    };
+    for (size_t p = 0; p < sizeof(pairs) / sizeof(pairs[0]); p++) {
+        if (strcmp(pairs[p][0], condition) == 0) {
+            return pairs[p][1];
+        }
+    }
+    return NULL;
+}
+
+// registers instruction pc reads or writes, arguments of calls included
+static int codegenRegisters(const VmProgram *program, uint32_t pc,
+                            uint8_t *registers) {
+    uint32_t i = program->code[pc];
+    VmOpcode op = VM_OP(i);
+    int count = 0;
+    switch ((VmFormat)vm_opcode_formats[op]) {
+    case VM_FORMAT_ABC:
+        registers[count++] = (uint8_t)VM_C(i);
+        // fall through
+    case VM_FORMAT_AB:
+    case VM_FORMAT_ABSC:
+        registers[count++] = (uint8_t)VM_B(i);
+        // fall through
+    case VM_FORMAT_A:
+    case VM_FORMAT_ASBX:
+        registers[count++] = (uint8_t)VM_A(i);
+        break;
+    case VM_FORMAT_ABX:
+        if (op != OP_PRINTK) {
+            registers[count++] = (uint8_t)VM_A(i);
+        }
+        if (op == OP_CALL) {
+            const VmFunction *callee = &program->functions[VM_BX(i)];
+            for (uint32_t p = 1; p <= callee->params &&
+                                 VM_A(i) + p < VM_MAX_REGISTERS;
+                 p++) {
+                registers[count++] = (uint8_t)(VM_A(i) + p);
+            }
+        }
+        break;
+    case VM_FORMAT_NONE:
+    case VM_FORMAT_SAX:
+        break;
+    }
+    return count;
+}
+
+// target of a jump at pc, 0 when pc is not a jump
+static int codegenJump(const uint32_t *code, uint32_t pc, uint32_t *target) {
+    uint32_t i = code[pc];
+    switch (VM_OP(i)) {
+    case OP_JMP:
+        *target = (uint32_t)((int64_t)pc + 1 + VM_SAX(i));
+        return 1;
+    case OP_JMPF:
+    case OP_JMPT:
+        *target = (uint32_t)((int64_t)pc + 1 + VM_SBX(i));
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// LOADKX carries its constant index in the next word
+static uint32_t codegenNext(const uint32_t *code, uint32_t pc) {
+    return pc + (VM_OP(code[pc]) == OP_LOADKX ? 2 : 1);
+}
+
+// instructions lowered to calls, which clobber caller-saved machines
+static int codegenCalls(VmOpcode op) {
+    switch (op) {
+    case OP_FLOORDIV_I:
+    case OP_POW_I:
+    case OP_FLOORDIV_F:
+    case OP_MOD_F:
+    case OP_POW_F:
+    case OP_F2I:
+    case OP_EQ_S:
+    case OP_NE_S:
+    case OP_LT_S:
+    case OP_LE_S:
+    case OP_CALL:
+    case OP_NEWARRAY:
+    case OP_GETCHAR:
+    case OP_CONCAT:
+    case OP_TOSTR_I:
+    case OP_TOSTR_F:
+    case OP_TOSTR_C:
+    case OP_TOSTR_B:
+    case OP_PRINT_I:
+    case OP_PRINT_F:
+    case OP_PRINT_C:
+    case OP_PRINT_B:
+    case OP_PRINT_S:
+    case OP_PRINTK:
+    case OP_PRINTNL:
+    case OP_READ_I:
+    case OP_READ_F:
+    case OP_READ_C:
+    case OP_READ_B:
+    case OP_READ_S:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// message of the runtime error an instruction may fail with, as in vmloop.h
+static const char *codegenFailure(VmOpcode op) {
+    switch (op) {
+    case OP_DIV_I:
+    case OP_FLOORDIV_I:
+    case OP_MOD_I:
+        return "division by zero";
+    case OP_CALL:
+        return "call stack overflow";
+    case OP_NEWARRAY:
+        return "negative array length";
+    case OP_GETINDEX:
+    case OP_SETINDEX:
+    case OP_GETCHAR:
+        return "index out of bounds";
+    default:
+        return NULL;
+    }
+}
+
+// instructions allocating a string or an array
+static int codegenAllocates(VmOpcode op) {
+    return op == OP_NEWARRAY || op == OP_CONCAT || op == OP_TOSTR_I ||
+           op == OP_TOSTR_F || op == OP_TOSTR_C || op == OP_READ_S;
+}
+
+// label index of a string constant, -1 when pointer is not a string
+static long codegenStringIndex(const Codegen *g, const char *pointer) {
+    const char **found =
+        bsearch(&pointer, g->strings, g->program->string_count,
+                sizeof(char *), compareAddresses);
+    return found == NULL ? -1 : (long)(found - g->strings);
+}
+
+static int compareAddresses(const void *left, const void *right) {
+    uintptr_t a = (uintptr_t) * (const char *const *)left;
+    uintptr_t b = (uintptr_t) * (const char *const *)right;
+    return (a > b) - (a < b);
+}
+
+// cc -o output assembly runtime -lm -pthread
+static int codegenLink(const char *assembly, const char *output,
+                       const char *runtime, FILE *report) {
+    char *const arguments[] = {"cc",           "-o", (char *)output,
+                               (char *)assembly, (char *)runtime,
+                               "-lm",          "-pthread", NULL};
+    pid_t pid;
+    int status;
+    if (posix_spawnp(&pid, "cc", NULL, NULL, arguments, environ) != 0 ||
+        waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+        fprintf(report, "ERROR: linking '%s' with cc failed [LINK_ERROR]\n",
+                output);
+        return 1;
+    }
+    return 0;
+}
+
+// CODEGEN_RUNTIME_NAME in the directory of the running executable
+static char *codegenDefaultRuntime(void) {
+    char path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length <= 0) {
+        return NULL;
+    }
+    path[length] = '\0';
+    char *slash = strrchr(path, '/');
+    size_t directory = slash == NULL ? 0 : (size_t)(slash - path) + 1;
+    char *runtime = malloc(directory + sizeof(CODEGEN_RUNTIME_NAME));
+    if (runtime != NULL) {
+        memcpy(runtime, path, directory);
+        memcpy(runtime + directory, CODEGEN_RUNTIME_NAME,
+               sizeof(CODEGEN_RUNTIME_NAME));
+    }
+    return runtime;
+}
@@ -0,0 +1,802 @@
+// compile header implementation
+//
+// `compile.c` holds the per-file pipeline (read, lex, report, collect symbol
+// table) and the batch driver. Batch workers print into memory streams that
+// the calling thread writes out as soon as every earlier file is done.
+
+#include "compile.h"
+#include "bytecode.h"   // VmProgram
+#include "cache.h"      // --cache entries
+#include "codegen.h"    // native executables
+#include "fileread.h"   // RensFile, StringOutput
+#include "intern.h"     // identifier symbols
+#include "lexer.h"      // lexical analyzer and tokens
+#include "optimize.h"   // bytecode passes
+#include "parser.h"     // syntax tree
+#include "rtok.h"       // binary token file
+#include "symtab.h"     // names table
+#include "threadpool.h" // work-stealing workers
+#include "vm.h"         // virtual machine
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define COMPILE_UNIT_BLOCK 256 // bytes compared at once finding an edit
+
+// output of one file rendered by a batch worker
+typedef struct CompileJobStruct {
+    const char *filename;
+    int status;
+    char *out_text;
+    size_t out_length;
+    char *symbol_text;
+    size_t symbol_length;
+    CompileStats stats;
+} CompileJob;
+
+typedef struct CompileBatchStruct {
+    CompileJob *jobs;
+    const CompileOptions *options;
+    int collect_symbols; // render -s rows for each job
+    int collect_stats;   // time and count each job
+} CompileBatch;
+
+static int compileContents(const char *filename, int from_stdin,
+                           const RensFile *file,
+                           const CompileOptions *options, FILE *out,
+                           FILE *symbol_file, CompileStats *stats);
+static int compileCachedContents(const char *filename, const RensFile *file,
+                                 const CompileOptions *options, FILE *out,
+                                 FILE *symbol_file, CompileStats *stats);
+static int compileCacheable(const CompileOptions *options);
+static int compileLexedTokens(Lexer *lexer, const CompileOptions *options,
+                              const char *filename, FILE *out,
+                              StringOutput *symbols, CompileStats *stats);
+static int compileTokens(Lexer *lexer, const CompileOptions *options,
+                         const TokenBuffer *tokens, const InternTable *names,
+                         const char *filename, FILE *out,
+                         StringOutput *symbols, CompileStats *stats);
+static int compileToken(Lexer *lexer, const Token *tok, const char *filename,
+                        FILE *out, StringOutput *symbols);
+static int compileSymbolRow(Lexer *lexer, const Token *tok,
+                            StringOutput *symbols);
+static int compileTokenFile(Lexer *lexer, const CompileOptions *options,
+                            const TokenBuffer *tokens, FILE *out);
+static int compileProgram(Lexer *lexer, const CompileOptions *options,
+                          const TokenBuffer *tokens, const InternTable *names,
+                          const char *filename, FILE *out,
+                          CompileStats *stats);
+static int compileParses(const CompileOptions *options);
+static void compileUnitEdit(const CompileUnit *unit, unsigned long size,
+                            LexerEdit *edit);
+static int compileUnitLex(CompileUnit *unit, unsigned long size,
+                          const LexerEdit *edit,
+                          const CompileOptions *options, FILE *out);
+static int compileUnitIntern(CompileUnit *unit, FILE *out);
+static void compileJobRun(void *context, unsigned long index);
+
+/// PUBLIC FUNCTIONS
+
+// switch engine, serial lexing, no symbol rows, token file or tree
+void compileOptionsDefault(CompileOptions *options) {
+    options->symbol_out = 0;
+    options->engine = LEXER_ENGINE_SWITCH;
+    options->lex_threads = 1;
+    options->rtok_file = NULL;
+    options->rtok_source = 0;
+    options->ast_out = 0;
+    options->symbols_out = 0;
+    options->run = 0;
+    options->dispatch = VM_DISPATCH_GOTO;
+    options->optimize = 0;
+    options->bytecode_out = 0;
+    options->output_file = NULL;
+    options->runtime_file = NULL;
+    options->cache_dir = NULL;
+    options->cache_size = CACHE_DEFAULT_LIMIT;
+    options->input = NULL;
+    options->diagnostics = DIAG_HUMAN;
+    options->error_limit = 0;
+}
+
+// compile a single file ('-' reads stdin): diagnostics and -S rows are
+// printed to out, -s rows written to symbol_file (when non-NULL), phase
+// timings and counts added to stats (when non-NULL)
+int compileRensFile(const char *filename, const CompileOptions *options,
+                    FILE *out, FILE *symbol_file, CompileStats *stats) {
+    // '-' streams stdin through the lexer in fixed-size chunks
+    int from_stdin = strcmp(filename, "-") == 0;
+    double lap = statsClock(stats);
+
+    // fileread.h - validate extension and get contents in file
+    RensFile file = {0};
+    if (!from_stdin && getRensFileContents(filename, &file, out)) {
+        return 1;
+    }
+    statsLap(stats, STATS_READ, lap);
+
+    int return_error =
+        !from_stdin && compileCacheable(options)
+            ? compileCachedContents(filename, &file, options, out,
+                                    symbol_file, stats)
+            : compileContents(filename, from_stdin, &file, options, out,
+                              symbol_file, stats);
+    cleanupFileContents(&file);
+    return return_error;
+}
+
+// compile count files on thread_count workers (0 for one per core), printing
+// to out and symbol_file in input order, stats summed in input order
+int compileRensFiles(const char **filenames, unsigned long count,
+                     unsigned int thread_count, const CompileOptions *options,
+                     FILE *out, FILE *symbol_file, CompileStats *stats) {
+    if (thread_count == 0) {
+        thread_count = threadPoolCoreCount();
+    }
+    if (thread_count > count) {
+        thread_count = (unsigned int)count;
+    }
+
+    int return_error = 0;
+
+    // a single worker prints directly, nothing to reorder
+    if (thread_count <= 1) {
+        for (unsigned long i = 0; i < count; i++) {
+            return_error |= compileRensFile(filenames[i], options, out,
+                                            symbol_file, stats);
+        }
+        return return_error;
+    }
+
+    CompileBatch batch = {calloc(count, sizeof(CompileJob)), options,
+                          symbol_file != NULL, stats != NULL};
+    if (batch.jobs == NULL) {
+        fprintf(out, "ERROR: batch memory allocation failure "
+                     "[BATCH_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+    for (unsigned long i = 0; i < count; i++) {
+        batch.jobs[i].filename = filenames[i];
+    }
+
+    ThreadPool *pool =
+        threadPoolCreate(thread_count, count, compileJobRun, &batch);
+    if (pool == NULL) {
+        free(batch.jobs);
+        fprintf(out,
+                "ERROR: thread pool creation failure [THREAD_POOL_ERROR]\n");
+        return 1;
+    }
+
+    // write each file's output once it and every file before it is done
+    for (unsigned long i = 0; i < count; i++) {
+        threadPoolWaitTask(pool, i);
+
+        CompileJob *job = &batch.jobs[i];
+        if (job->out_text == NULL) {
+            fprintf(out,
+                    "ERROR: output buffer allocation failure on '%s' "
+                    "[OUTPUT_ALLOCATION_ERROR]\n",
+                    job->filename);
+        } else {
+            fwrite(job->out_text, 1, job->out_length, out);
+        }
+        if (symbol_file != NULL && job->symbol_text != NULL &&
+            fwrite(job->symbol_text, 1, job->symbol_length, symbol_file) !=
+                job->symbol_length) {
+            fprintf(out, "ERROR: failed writing symbol table "
+                         "[OUTPUT_WRITE_ERROR]\n");
+            job->status = 1;
+        }
+        return_error |= job->status;
+        if (stats != NULL) {
+            statsAdd(stats, &job->stats);
+        }
+
+        free(job->out_text);
+        free(job->symbol_text);
+    }
+
+    threadPoolDestroy(&pool);
+    free(batch.jobs);
+
+    return return_error;
+}
+
+// read filename again and, when its contents changed since the last update,
+// relex only the changed bytes and compile the tokens like compileRensFile.
+// Unchanged contents print nothing and return the last status.
+int compileUnitUpdate(CompileUnit *unit, const char *filename,
+                      const CompileOptions *options, FILE *out,
+                      FILE *symbol_file, CompileStats *stats) {
+    double lap = statsClock(stats);
+    unsigned long size;
+    if (readRensFileInto(filename, &unit->spare, &unit->spare_capacity, &size,
+                         out)) {
+        // a file missing mid save is lexed afresh once it is back
+        compileUnitCleanup(unit);
+        unit->changed = 1;
+        unit->status = 1;
+        return 1;
+    }
+
+    LexerEdit edit = {0, 0, size};
+    if (unit->lexer != NULL) {
+        compileUnitEdit(unit, size, &edit);
+    }
+    unit->changed = unit->lexer == NULL || edit.removed_length != 0 ||
+                    edit.inserted_length != 0;
+    lap = statsLap(stats, STATS_READ, lap);
+    if (!unit->changed) {
+        return unit->status;
+    }
+
+    if (compileUnitLex(unit, size, &edit, options, out)) {
+        fprintf(out, "ERROR: failed lexing '%s' again [UNIT_LEX_ERROR]\n",
+                filename);
+        compileUnitCleanup(unit);
+        unit->changed = 1;
+        unit->status = 1;
+        return 1;
+    }
+    statsLap(stats, STATS_LEX, lap);
+
+    // symbol table rows are kept in memory only when printed to out
+    StringOutput symbols = {0};
+    int collect = options->symbol_out || symbol_file != NULL;
+    if (collect && openCollectedStringOutput(&symbols, symbol_file,
+                                             options->symbol_out, out)) {
+        unit->status = 1;
+        return 1;
+    }
+
+    Diagnostics diagnostics;
+    diagnosticsInit(&diagnostics, filename, options->diagnostics,
+                    options->error_limit, out);
+    lexerSetDiagnostics(unit->lexer, &diagnostics);
+    unit->status = compileTokens(unit->lexer, options, &unit->tokens,
+                                 unit->names, filename, out,
+                                 collect ? &symbols : NULL, stats);
+    if (options->symbol_out) {
+        printCollectedStringOutput(&symbols, out);
+    }
+    if (symbol_file != NULL && storeCollectedStringOutput(&symbols)) {
+        unit->status = 1;
+    }
+    cleanupCollectedString(&symbols);
+    unit->status |= diagnosticsFinish(&diagnostics);
+    lexerSetDiagnostics(unit->lexer, NULL);
+
+    if (stats != NULL) {
+        stats->bytes_read += size;
+        stats->files++;
+    }
+    return unit->status;
+}
+
+// free the contents, lexer and tokens of unit
+void compileUnitCleanup(CompileUnit *unit) {
+    if (unit->lexer != NULL) {
+        lexerCleanUp(&unit->lexer);
+    }
+    tokenBufferCleanup(&unit->tokens);
+    internDestroy(&unit->names);
+    free(unit->contents);
+    free(unit->spare);
+    memset(unit, 0, sizeof(CompileUnit));
+}
+
+/// PRIVATE FUNCTIONS
+
+// lex, report and collect a file read into file (or stdin), compiling it
+// further for the options needing a syntax tree
+static int compileContents(const char *filename, int from_stdin,
+                           const RensFile *file,
+                           const CompileOptions *options, FILE *out,
+                           FILE *symbol_file, CompileStats *stats) {
+    double lap = statsClock(stats);
+    Lexer *lexer = from_stdin ? initLexerStream(STDIN_FILENO)
+                              : initLexer(file->contents, file->size);
+    if (from_stdin) {
+        filename = "<stdin>";
+    }
+
+    // the dfa engine needs padded resident contents, streams keep switch
+    lexerSetEngine(lexer, options->engine);
+
+    // symbol table rows are kept in memory only when printed to out
+    StringOutput symbols = {0};
+    int collect = options->symbol_out || symbol_file != NULL;
+    if (collect && openCollectedStringOutput(&symbols, symbol_file,
+                                             options->symbol_out, out)) {
+        lexerCleanUp(&lexer);
+        return 1;
+    }
+
+    // errors are collected and written out in batches
+    Diagnostics diagnostics;
+    diagnosticsInit(&diagnostics, filename, options->diagnostics,
+                    options->error_limit, out);
+    lexerSetDiagnostics(lexer, &diagnostics);
+
+    int return_error = 0;
+    StringOutput *rows = collect ? &symbols : NULL;
+    // stats, token files, trees, bytecode and runs need resident files
+    // lexed into a token buffer
+    if ((options->lex_threads != 1 || stats != NULL ||
+         options->rtok_file != NULL || compileParses(options)) &&
+        !from_stdin) {
+        return_error =
+            compileLexedTokens(lexer, options, filename, out, rows, stats);
+        lap = statsClock(stats);
+    } else {
+        Token tok = lexerGetNextToken(lexer);
+        while (tok.type != TK_EOF) {
+            if (stats != NULL) {
+                stats->token_counts[tok.type]++;
+            }
+            return_error |= compileToken(lexer, &tok, filename, out, rows);
+            tok = lexerGetNextToken(lexer);
+        }
+        lap = statsLap(stats, STATS_LEX, lap);
+    }
+    return_error |= diagnosticsFlush(&diagnostics);
+
+    if (options->symbol_out) {
+        printCollectedStringOutput(&symbols, out);
+    }
+
+    // write symbol table on specified symbol file in arguments
+    if (symbol_file != NULL) {
+        if (storeCollectedStringOutput(&symbols)) {
+            return_error = 1;
+        }
+    }
+
+    if (stats != NULL) {
+        statsLap(stats, STATS_SYMBOLS, lap);
+        stats->bytes_read += from_stdin
+                                 ? lexer->content_base + lexer->content_length
+                                 : file->size;
+        stats->files++;
+    }
+
+    return_error |= diagnosticsFinish(&diagnostics);
+    lexerCleanUp(&lexer);
+    cleanupCollectedString(&symbols);
+    return return_error;
+}
+
+// compile through the --cache directory: a hit replays the stored output
+// and status without lexing, a miss compiles into memory, stores that and
+// prints it. Keys cover the contents, name, version and output options.
+static int compileCachedContents(const char *filename, const RensFile *file,
+                                 const CompileOptions *options, FILE *out,
+                                 FILE *symbol_file, CompileStats *stats) {
+    double lap = statsClock(stats);
+    char settings[64];
+    int settings_length =
+        snprintf(settings, sizeof(settings), "%s %d %d %d %d %d %d %d %lu",
+                 COMPILE_VERSION, options->symbol_out, symbol_file != NULL,
+                 options->ast_out, options->symbols_out, options->optimize,
+                 options->bytecode_out, (int)options->diagnostics,
+                 options->error_limit);
+    uint64_t key = cacheHash(file->contents, file->size, 0);
+    key = cacheHash(settings, (size_t)settings_length, key);
+    key = cacheHash(filename, strlen(filename) + 1, key);
+
+    CacheEntry entry = {0};
+    int hit = cacheLookup(options->cache_dir, key, &entry);
+    if (!hit) {
+        // compile the bytes that were hashed, a file changing meanwhile
+        // cannot store output under the wrong key
+        FILE *out_text = open_memstream(&entry.out_text, &entry.out_length);
+        FILE *symbol_text =
+            symbol_file != NULL
+                ? open_memstream(&entry.symbol_text, &entry.symbol_length)
+                : NULL;
+        if (out_text == NULL || (symbol_file != NULL && symbol_text == NULL)) {
+            fprintf(out, "ERROR: failed opening memory stream "
+                         "[OUTPUT_WRITE_ERROR]\n");
+            if (out_text != NULL) {
+                fclose(out_text);
+            }
+            cacheEntryCleanup(&entry);
+            return 1;
+        }
+
+        entry.status = compileContents(filename, 0, file, options, out_text,
+                                       symbol_text, stats);
+        lap = statsClock(stats);
+        int closed = fclose(out_text) == 0;
+        if (symbol_text != NULL) {
+            closed &= fclose(symbol_text) == 0;
+        }
+        if (!closed) {
+            entry.status = 1;
+        } else {
+            entry.status |= cacheStore(options->cache_dir, key, &entry,
+                                       options->cache_size, out);
+        }
+    }
+
+    int return_error = entry.status;
+    if (fwrite(entry.out_text, 1, entry.out_length, out) !=
+            entry.out_length ||
+        (symbol_file != NULL &&
+         fwrite(entry.symbol_text, 1, entry.symbol_length, symbol_file) !=
+             entry.symbol_length)) {
+        fprintf(out, "ERROR: failed writing output [OUTPUT_WRITE_ERROR]\n");
+        return_error = 1;
+    }
+
+    if (stats != NULL) {
+        statsLap(stats, STATS_CACHE, lap);
+        if (hit) {
+            stats->cache_hits++;
+            stats->bytes_read += file->size;
+            stats->files++;
+        } else {
+            stats->cache_misses++;
+        }
+    }
+    cacheEntryCleanup(&entry);
+    return return_error;
+}
+
+// files whose whole output is text, run on no input and write no other file
+static int compileCacheable(const CompileOptions *options) {
+    return options->cache_dir != NULL && !options->run &&
+           options->output_file == NULL && options->rtok_file == NULL;
+}
+
+// lex the whole file (on lex_threads threads), then report and collect its
+// tokens
+static int compileLexedTokens(Lexer *lexer, const CompileOptions *options,
+                              const char *filename, FILE *out,
+                              StringOutput *symbols, CompileStats *stats) {
+    double lap = statsClock(stats);
+
+    // names of parsed files are interned while lexing, on every lex thread
+    InternTable *names = NULL;
+    if (compileParses(options)) {
+        names = internCreateFor(lexer->content_length);
+        if (names == NULL) {
+            fprintf(out, "ERROR: symbol table memory allocation failure "
+                         "[SYMBOL_ALLOCATION_ERROR]\n");
+            return 1;
+        }
+        lexerSetSymbols(lexer, names);
+    }
+
+    TokenBuffer tokens = {0};
+    int status = options->lex_threads == 1
+                     ? lexerTokenizeAll(lexer, &tokens, out)
+                     : lexerTokenizeParallel(lexer, options->lex_threads, 0,
+                                             &tokens, out);
+    lexerSetSymbols(lexer, NULL);
+    if (status) {
+        tokenBufferCleanup(&tokens);
+        internDestroy(&names);
+        return 1;
+    }
+    statsLap(stats, STATS_LEX, lap);
+
+    int return_error = compileTokens(lexer, options, &tokens, names, filename,
+                                     out, symbols, stats);
+    tokenBufferCleanup(&tokens);
+    internDestroy(&names);
+    return return_error;
+}
+
+// report every token of a lexed file, compile it further for the options
+// needing a syntax tree and collect every row (printed after diagnostics)
+static int compileTokens(Lexer *lexer, const CompileOptions *options,
+                         const TokenBuffer *tokens, const InternTable *names,
+                         const char *filename, FILE *out,
+                         StringOutput *symbols, CompileStats *stats) {
+    double lap = statsClock(stats);
+    int return_error = 0;
+    unsigned long count = 0;
+    for (; tokens->types[count] != TK_EOF; count++) {
+        // error types come before TK_EOF, only they are reported
+        if (tokens->types[count] > TK_EOF) {
+            continue;
+        }
+        Token tok = {.type = (TokenType)tokens->types[count],
+                     .start = tokens->starts[count],
+                     .length = tokens->lengths[count]};
+
+        // put the lexer back where it produced the token for diagnostics
+        lexer->index = tokens->begins[count];
+        return_error |= lexerErrorHandler(lexer, &tok, filename, out);
+    }
+    return_error |= diagnosticsFlush(lexer->diagnostics);
+    lap = statsLap(stats, STATS_DIAGNOSTICS, lap);
+
+    // a file with lexical errors is parsed for its syntax errors, not
+    // compiled to bytecode
+    if (compileParses(options)) {
+        CompileOptions program_options = *options;
+        program_options.run = options->run && !return_error;
+        program_options.bytecode_out = options->bytecode_out && !return_error;
+        if (return_error) {
+            program_options.output_file = NULL;
+        }
+        return_error |= compileProgram(lexer, &program_options, tokens, names,
+                                       filename, out, stats);
+        lap = statsClock(stats);
+    }
+
+    for (unsigned long i = 0; i < count && symbols != NULL; i++) {
+        Token tok = {.type = (TokenType)tokens->types[i],
+                     .start = tokens->starts[i],
+                     .length = tokens->lengths[i]};
+        lexer->index = tokens->begins[i];
+        return_error |= compileSymbolRow(lexer, &tok, symbols);
+    }
+    if (options->rtok_file != NULL) {
+        return_error |= compileTokenFile(lexer, options, tokens, out);
+    }
+    statsLap(stats, STATS_SYMBOLS, lap);
+
+    // counted outside the timed passes
+    for (unsigned long i = 0; i < count && stats != NULL; i++) {
+        stats->token_counts[tokens->types[i]]++;
+    }
+    return return_error;
+}
+
+// report an error token and collect its symbol table row (symbols non-NULL)
+static int compileToken(Lexer *lexer, const Token *tok, const char *filename,
+                        FILE *out, StringOutput *symbols) {
+    // print error and exit fail if token type ERR and INVALID detected
+    int return_error = lexerErrorHandler(lexer, tok, filename, out);
+
+    // for symbol table file output
+    if (symbols != NULL) {
+        return_error |= compileSymbolRow(lexer, tok, symbols);
+    }
+
+    return return_error;
+}
+
+// collect the symbol table row of the token last produced by lexer,
+// positions are resolved only here
+static int compileSymbolRow(Lexer *lexer, const Token *tok,
+                            StringOutput *symbols) {
+    unsigned long line;
+    unsigned long column;
+    if (lexerGetPosition(lexer, lexer->content_base + lexer->index, &line,
+                         &column, symbols->out)) {
+        return 1;
+    }
+    return collectStringOutput(symbols, line, column, tk_map[tok->type],
+                               lexerGetLexeme(lexer, tok), tok->length);
+}
+
+// write --rtok token file, errors are printed to out
+static int compileTokenFile(Lexer *lexer, const CompileOptions *options,
+                            const TokenBuffer *tokens, FILE *out) {
+    FILE *file_ptr = fopen(options->rtok_file, "wb");
+    if (file_ptr == NULL) {
+        fprintf(out, "error: '%s'\n", options->rtok_file);
+        return 1;
+    }
+
+    int return_error =
+        rtokWrite(file_ptr, lexer, tokens, options->rtok_source, out);
+    if (fclose(file_ptr) != 0) {
+        return_error = 1;
+    }
+    return return_error;
+}
+
+// parse the tokens, then print the --ast tree and --symbols table and
+// compile, build (-o) and --run a file free of syntax errors. A run failing
+// or exiting nonzero is an error.
+static int compileProgram(Lexer *lexer, const CompileOptions *options,
+                          const TokenBuffer *tokens, const InternTable *names,
+                          const char *filename, FILE *out,
+                          CompileStats *stats) {
+    double lap = statsClock(stats);
+    Ast ast;
+    int return_error = parseTokens(lexer, tokens, filename, out, &ast);
+    return_error |= diagnosticsFlush(lexer->diagnostics);
+    if (!return_error && options->ast_out) {
+        return_error = astPrint(&ast, lexer, out);
+    }
+    if (!return_error && options->symbols_out) {
+        SymbolTable table;
+        return_error = symtabBuild(&table, &ast, out) ||
+                       symtabPrint(&table, &ast, lexer, names, out);
+        symtabCleanup(&table);
+    }
+    lap = statsLap(stats, STATS_PARSE, lap);
+
+    if (!return_error && (options->run || options->bytecode_out ||
+                          options->output_file != NULL)) {
+        VmProgram program;
+        return_error = bytecodeCompile(lexer, &ast, filename, out, &program);
+        return_error |= diagnosticsFlush(lexer->diagnostics);
+        lap = statsLap(stats, STATS_BYTECODE, lap);
+
+        if (!return_error) {
+            return_error = optimizeProgram(&program, options->optimize,
+                                           stats ? &stats->optimize : NULL,
+                                           out);
+            lap = statsLap(stats, STATS_OPTIMIZE, lap);
+        }
+        if (!return_error && options->bytecode_out) {
+            return_error = bytecodePrint(&program, out);
+        }
+        if (!return_error && options->output_file != NULL) {
+            return_error =
+                codegenBuild(&program, lexer, filename, options->output_file,
+                             options->runtime_file, out);
+            return_error |= diagnosticsFlush(lexer->diagnostics);
+            lap = statsLap(stats, STATS_CODEGEN, lap);
+        }
+        if (!return_error && options->run) {
+            VmRunOptions run_options;
+            VmResult result;
+            vmRunOptionsDefault(&run_options, lexer, filename);
+            run_options.dispatch = options->dispatch;
+            run_options.out = out;
+            if (options->input != NULL) {
+                run_options.in = options->input;
+            }
+            return_error = vmRun(&program, &run_options, &result) ||
+                           result.exit_value != 0;
+            return_error |= diagnosticsFlush(lexer->diagnostics);
+            statsLap(stats, STATS_RUN, lap);
+        }
+        bytecodeCleanup(&program);
+    }
+
+    astCleanup(&ast);
+    return return_error;
+}
+
+// any option needing the syntax tree
+static int compileParses(const CompileOptions *options) {
+    return options->ast_out || options->symbols_out || options->run ||
+           options->bytecode_out || options->output_file != NULL;
+}
+
+// the edit turning the last contents into the spare ones, found from the
+// bytes they share at either end
+static void compileUnitEdit(const CompileUnit *unit, unsigned long size,
+                            LexerEdit *edit) {
+    const char *old = unit->contents;
+    const char *new = unit->spare;
+    unsigned long shorter = size < unit->size ? size : unit->size;
+
+    // whole blocks compare first, memcmp is vectorized
+    unsigned long prefix = 0;
+    while (prefix + COMPILE_UNIT_BLOCK <= shorter &&
+           memcmp(old + prefix, new + prefix, COMPILE_UNIT_BLOCK) == 0) {
+        prefix += COMPILE_UNIT_BLOCK;
+    }
+    while (prefix < shorter && old[prefix] == new[prefix]) {
+        prefix++;
+    }
+
+    unsigned long suffix = 0;
+    while (suffix + COMPILE_UNIT_BLOCK <= shorter - prefix &&
+           memcmp(old + unit->size - suffix - COMPILE_UNIT_BLOCK,
+                  new + size - suffix - COMPILE_UNIT_BLOCK,
+                  COMPILE_UNIT_BLOCK) == 0) {
+        suffix += COMPILE_UNIT_BLOCK;
+    }
+    while (suffix < shorter - prefix &&
+           old[unit->size - suffix - 1] == new[size - suffix - 1]) {
+        suffix++;
+    }
+
+    *edit = (LexerEdit){prefix, unit->size - prefix - suffix,
+                        size - prefix - suffix};
+}
+
+// make the spare contents current (the last ones become the spare buffer)
+// and lex them, whole the first time and then only around edit
+static int compileUnitLex(CompileUnit *unit, unsigned long size,
+                          const LexerEdit *edit,
+                          const CompileOptions *options, FILE *out) {
+    char *contents = unit->spare;
+    unsigned long capacity = unit->spare_capacity;
+    unit->spare = unit->contents;
+    unit->spare_capacity = unit->capacity;
+    unit->contents = contents;
+    unit->capacity = capacity;
+    unit->size = size;
+
+    int status;
+    if (unit->lexer == NULL) {
+        unit->lexer = initLexer(contents, size);
+        lexerSetEngine(unit->lexer, options->engine);
+        if (compileParses(options)) {
+            unit->names = internCreateFor(size);
+            lexerSetSymbols(unit->lexer, unit->names);
+        }
+        status = compileParses(options) && unit->names == NULL;
+        if (!status) {
+            status = options->lex_threads == 1
+                         ? lexerTokenizeAll(unit->lexer, &unit->tokens, out)
+                         : lexerTokenizeParallel(unit->lexer,
+                                                 options->lex_threads, 0,
+                                                 &unit->tokens, out);
+        }
+    } else {
+        lexerSetSymbols(unit->lexer, unit->names);
+        status = lexerRelex(unit->lexer, contents, size, edit, &unit->tokens,
+                            out);
+    }
+    lexerSetSymbols(unit->lexer, NULL);
+    return status || (unit->names != NULL && compileUnitIntern(unit, out));
+}
+
+// names of every edit stay interned, once the table is full intern the
+// names of the current tokens into a new one
+static int compileUnitIntern(CompileUnit *unit, FILE *out) {
+    TokenBuffer *tokens = &unit->tokens;
+    unsigned long missing = 0;
+    for (unsigned long i = 0; i < tokens->count; i++) {
+        missing += tokens->types[i] == TK_IDENTIFIER &&
+                   (tokens->symbols == NULL || tokens->symbols[i] == 0);
+    }
+    if (missing == 0) {
+        return 0;
+    }
+
+    internDestroy(&unit->names);
+    unit->names = internCreateFor(unit->size);
+    if (unit->names == NULL || tokenBufferTrackSymbols(tokens, out)) {
+        return 1;
+    }
+    for (unsigned long i = 0; i < tokens->count; i++) {
+        if (tokens->types[i] != TK_IDENTIFIER) {
+            tokens->symbols[i] = 0;
+            continue;
+        }
+        const char *name = unit->contents + tokens->starts[i];
+        uint32_t hash = INTERN_HASH_SEED;
+        for (uint32_t j = 0; j < tokens->lengths[i]; j++) {
+            hash = INTERN_HASH_STEP(hash, name[j]);
+        }
+        tokens->symbols[i] =
+            internSymbol(unit->names, name, tokens->lengths[i], hash);
+    }
+    return 0;
+}
+
+// compile one batch file into memory streams
+static void compileJobRun(void *context, unsigned long index) {
+    CompileBatch *batch = context;
+    CompileJob *job = &batch->jobs[index];
+
+    FILE *out = open_memstream(&job->out_text, &job->out_length);
+    FILE *symbols = NULL;
+    if (batch->collect_symbols) {
+        symbols = open_memstream(&job->symbol_text, &job->symbol_length);
+    }
+
+    if (out == NULL || (batch->collect_symbols && symbols == NULL)) {
+        job->status = 1;
+    } else {
+        job->status = compileRensFile(job->filename, batch->options, out,
+                                      symbols,
+                                      batch->collect_stats ? &job->stats
+                                                           : NULL);
+    }
+
+    // closing the streams finalizes text and length
+    if (out != NULL && fclose(out) != 0) {
+        job->status = 1;
+    }
+    if (symbols != NULL && fclose(symbols) != 0) {
+        job->status = 1;
+    }
+}
@@ -0,0 +1,115 @@
+// cursor header implementation
+//
+// `cursor.c` counts tokens from the start of the cursor: slot i % size of the
+// ring holds token i while i >= tail - size. Refills lex a batch in one tight
+// loop and never overwrite the current token or any token peeked at.
+
+#include "cursor.h"
+
+#include <stdio.h>
+
+#define TOKEN_CURSOR_MASK (TOKEN_CURSOR_SIZE - 1)
+
+static void tokenCursorFill(TokenCursor *cursor, unsigned long needed);
+
+/// PUBLIC FUNCTIONS
+
+// start a cursor at the next token of a resident lexer (streaming lexers
+// drop lexemes of earlier tokens on refills and are refused, which is
+// printed to out)
+int tokenCursorInit(TokenCursor *cursor, Lexer *lexer, FILE *out) {
+    if (lexer->stream_fd >= 0) {
+        fprintf(out, "ERROR: token cursor needs resident contents "
+                     "[TOKEN_CURSOR_ERROR]\n");
+        return 1;
+    }
+
+    cursor->lexer = lexer;
+    cursor->head = 0;
+    cursor->tail = 0;
+    cursor->eof = 0;
+    return 0;
+}
+
+// token n places after the current one (n < TOKEN_CURSOR_SIZE)
+Token tokenCursorPeek(TokenCursor *cursor, unsigned int n) {
+    unsigned long index = cursor->head + n;
+    tokenCursorFill(cursor, index);
+
+    // past TK_EOF, the last token lexed is TK_EOF
+    if (index >= cursor->tail) {
+        index = cursor->tail - 1;
+    }
+    return cursor->tokens[index & TOKEN_CURSOR_MASK];
+}
+
+// input offset where the token n places after the current one begins, for
+// lexerGetPosition and diagnostics (n < TOKEN_CURSOR_SIZE)
+unsigned long tokenCursorBegin(TokenCursor *cursor, unsigned int n) {
+    unsigned long index = cursor->head + n;
+    tokenCursorFill(cursor, index);
+
+    if (index >= cursor->tail) {
+        index = cursor->tail - 1;
+    }
+    return cursor->begins[index & TOKEN_CURSOR_MASK];
+}
+
+// return the current token and move past it
+Token tokenCursorAdvance(TokenCursor *cursor) {
+    Token tok = tokenCursorPeek(cursor, 0);
+    if (tok.type != TK_EOF) {
+        cursor->head++;
+    }
+    return tok;
+}
+
+// position of the current token to return to with tokenCursorReset
+unsigned long tokenCursorMark(const TokenCursor *cursor) {
+    return cursor->head;
+}
+
+// go back (or forward) to a mark, fails when its token left the ring
+int tokenCursorReset(TokenCursor *cursor, unsigned long mark) {
+    if (mark > cursor->tail ||
+        (cursor->tail > TOKEN_CURSOR_SIZE &&
+         mark < cursor->tail - TOKEN_CURSOR_SIZE)) {
+        return 1;
+    }
+
+    cursor->head = mark;
+    return 0;
+}
+
+/// PRIVATE FUNCTIONS
+
+// lex batches until token needed is in the ring or TK_EOF was lexed
+static void tokenCursorFill(TokenCursor *cursor, unsigned long needed) {
+    Lexer *lexer = cursor->lexer;
+
+    while (cursor->tail <= needed && !cursor->eof) {
+        // slots before the current token are free, none when peeking past
+        // the ring
+        unsigned long batch = TOKEN_CURSOR_SIZE - (cursor->tail - cursor->head);
+        if (batch > TOKEN_CURSOR_BATCH) {
+            batch = TOKEN_CURSOR_BATCH;
+        }
+        if (batch == 0) {
+            break;
+        }
+
+        unsigned long tail = cursor->tail;
+        unsigned long end = tail + batch;
+        int eof = 0;
+        while (tail < end && !eof) {
+            Token tok = lexerGetNextToken(lexer);
+            unsigned long slot = tail & TOKEN_CURSOR_MASK;
+            cursor->tokens[slot] = tok;
+            cursor->begins[slot] = lexer->content_base + lexer->index;
+            eof = tok.type == TK_EOF;
+            tail++;
+        }
+        cursor->tail = tail;
+        cursor->eof = eof;
+    }
+}
@@ -0,0 +1,464 @@
+// diag header implementation
+//
+// `diag.c` keeps records small: messages and source lines are copied into
+// one growing text buffer and records hold offsets into it, so reporting an
+// error allocates only when a buffer doubles. A flush renders every waiting
+// record into a second buffer and hands it to fwrite once. Source lines are
+// kept for human output only, JSON and SARIF give the span instead.
+
+#include "diag.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIAG_FLUSH_RECORDS 1024 // human and JSON records kept before a flush
+#define DIAG_FLUSH_TEXT 65536   // or bytes of their text
+
+#define DIAG_SARIF_HEAD                                                       \
+    "{\"version\":\"2.1.0\",\"$schema\":"                                     \
+    "\"https://json.schemastore.org/sarif-2.1.0.json\",\"runs\":[{\"tool\":" \
+    "{\"driver\":{\"name\":\"renaisscript\",\"informationUri\":"             \
+    "\"https://github.com/steguiosaur/renaisscript\"}},\"results\":["
+#define DIAG_SARIF_TAIL "]}]}\n"
+
+static unsigned long diagnosticsFormat(Diagnostics *diagnostics,
+                                       char **buffer, unsigned long *length,
+                                       unsigned long *capacity,
+                                       const char *format, va_list args);
+static unsigned long diagnosticsTextf(Diagnostics *diagnostics,
+                                      const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+static void diagnosticsAdd(Diagnostics *diagnostics, const DiagSite *site,
+                           unsigned long message,
+                           unsigned long message_length);
+static int diagnosticsReserve(char **buffer, unsigned long *capacity,
+                              unsigned long needed);
+static void diagnosticsRenderHuman(Diagnostics *diagnostics,
+                                   const Diagnostic *record);
+static void diagnosticsRenderJson(Diagnostics *diagnostics,
+                                  const Diagnostic *record);
+static void diagnosticsRenderSarif(Diagnostics *diagnostics,
+                                   const Diagnostic *record);
+static void diagnosticsPrintf(Diagnostics *diagnostics, const char *format,
+                              ...) __attribute__((format(printf, 2, 3)));
+static void diagnosticsPut(Diagnostics *diagnostics, const char *bytes,
+                           unsigned long length);
+static void diagnosticsPutFill(Diagnostics *diagnostics, char fill,
+                               unsigned long count);
+static void diagnosticsPutJson(Diagnostics *diagnostics, const char *bytes,
+                               unsigned long length);
+static unsigned long diagnosticsUtf8Length(const unsigned char *bytes,
+                                           unsigned long length);
+static int diagnosticsWrite(Diagnostics *diagnostics);
+
+/// PUBLIC FUNCTIONS
+
+// start collecting the errors of filename, written to out in format with at
+// most limit of them kept (0 for all)
+void diagnosticsInit(Diagnostics *diagnostics, const char *filename,
+                     DiagFormat format, unsigned long limit, FILE *out) {
+    memset(diagnostics, 0, sizeof(Diagnostics));
+    diagnostics->format = format;
+    diagnostics->limit = limit;
+    diagnostics->filename = filename;
+    diagnostics->out = out;
+}
+
+// whether the next error is past the limit, reporters may skip building its
+// site but must still call diagnosticsReport to count it
+int diagnosticsFull(const Diagnostics *diagnostics) {
+    return diagnostics->limit != 0 &&
+           diagnostics->reported >= diagnostics->limit;
+}
+
+// add an error at site with a printf-style message, human and JSON records
+// are flushed once enough of them are waiting
+void diagnosticsReport(Diagnostics *diagnostics, const DiagSite *site,
+                       const char *format, ...) {
+    int full = diagnosticsFull(diagnostics);
+    diagnostics->reported++;
+    if (full) {
+        return;
+    }
+
+    unsigned long message = diagnostics->text_length;
+    va_list args;
+    va_start(args, format);
+    unsigned long length = diagnosticsFormat(
+        diagnostics, &diagnostics->text, &diagnostics->text_length,
+        &diagnostics->text_capacity, format, args);
+    va_end(args);
+    diagnosticsAdd(diagnostics, site, message, length);
+
+    if (diagnostics->format != DIAG_SARIF &&
+        (diagnostics->count >= DIAG_FLUSH_RECORDS ||
+         diagnostics->text_length >= DIAG_FLUSH_TEXT)) {
+        diagnosticsFlush(diagnostics);
+    }
+}
+
+// write the waiting human or JSON records to out in one write, nothing for
+// SARIF (written whole by diagnosticsFinish) or a NULL diagnostics
+int diagnosticsFlush(Diagnostics *diagnostics) {
+    if (diagnostics == NULL || diagnostics->format == DIAG_SARIF) {
+        return 0;
+    }
+
+    for (unsigned long i = 0; i < diagnostics->count; i++) {
+        if (diagnostics->format == DIAG_HUMAN) {
+            diagnosticsRenderHuman(diagnostics, &diagnostics->records[i]);
+        } else {
+            diagnosticsRenderJson(diagnostics, &diagnostics->records[i]);
+        }
+    }
+    return diagnosticsWrite(diagnostics);
+}
+
+// write what is still waiting, a count of the errors past the limit and the
+// SARIF log, then free the records
+int diagnosticsFinish(Diagnostics *diagnostics) {
+    // errors past the limit are summarized as one record of the whole file
+    if (diagnostics->limit != 0 &&
+        diagnostics->reported > diagnostics->limit) {
+        unsigned long message = diagnostics->text_length;
+        unsigned long length = diagnosticsTextf(
+            diagnostics, "%lu errors past the limit of %lu not shown",
+            diagnostics->reported - diagnostics->limit, diagnostics->limit);
+        DiagSite site = {.code = "ERROR_LIMIT"};
+        diagnosticsAdd(diagnostics, &site, message, length);
+    }
+
+    int return_error;
+    if (diagnostics->format == DIAG_SARIF) {
+        diagnosticsPut(diagnostics, DIAG_SARIF_HEAD,
+                       sizeof(DIAG_SARIF_HEAD) - 1);
+        for (unsigned long i = 0; i < diagnostics->count; i++) {
+            if (i > 0) {
+                diagnosticsPut(diagnostics, ",", 1);
+            }
+            diagnosticsRenderSarif(diagnostics, &diagnostics->records[i]);
+        }
+        diagnosticsPut(diagnostics, DIAG_SARIF_TAIL,
+                       sizeof(DIAG_SARIF_TAIL) - 1);
+        return_error = diagnosticsWrite(diagnostics);
+    } else {
+        return_error = diagnosticsFlush(diagnostics);
+    }
+
+    free(diagnostics->records);
+    free(diagnostics->text);
+    free(diagnostics->render);
+    diagnostics->records = NULL;
+    diagnostics->text = NULL;
+    diagnostics->render = NULL;
+    diagnostics->capacity = 0;
+    diagnostics->text_capacity = 0;
+    diagnostics->render_capacity = 0;
+    return return_error;
+}
+
+/// PRIVATE FUNCTIONS
+
+// printf-style append to buffer, returns the bytes appended
+static unsigned long diagnosticsFormat(Diagnostics *diagnostics,
+                                       char **buffer, unsigned long *length,
+                                       unsigned long *capacity,
+                                       const char *format, va_list args) {
+    va_list retry;
+    va_copy(retry, args);
+    unsigned long room = *capacity - *length;
+    int written = vsnprintf(*buffer == NULL ? NULL : *buffer + *length, room,
+                            format, args);
+    if (written < 0) {
+        written = 0;
+    } else if ((unsigned long)written >= room) {
+        // room for the terminator vsnprintf writes
+        if (diagnosticsReserve(buffer, capacity,
+                               *length + (unsigned long)written + 1)) {
+            diagnostics->failed = 1;
+            written = 0;
+        } else {
+            vsnprintf(*buffer + *length, (size_t)written + 1, format, retry);
+        }
+    }
+    va_end(retry);
+
+    *length += (unsigned long)written;
+    return (unsigned long)written;
+}
+
+// printf-style append to the record text, returns the bytes appended
+static unsigned long diagnosticsTextf(Diagnostics *diagnostics,
+                                      const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    unsigned long length = diagnosticsFormat(
+        diagnostics, &diagnostics->text, &diagnostics->text_length,
+        &diagnostics->text_capacity, format, args);
+    va_end(args);
+    return length;
+}
+
+// keep a record of site with its message, and its source line for human
+// output, a failed allocation drops it
+static void diagnosticsAdd(Diagnostics *diagnostics, const DiagSite *site,
+                           unsigned long message,
+                           unsigned long message_length) {
+    if (diagnostics->count == diagnostics->capacity) {
+        unsigned long capacity =
+            diagnostics->capacity == 0 ? 64 : diagnostics->capacity * 2;
+        Diagnostic *records =
+            realloc(diagnostics->records, capacity * sizeof(Diagnostic));
+        if (records == NULL) {
+            diagnostics->failed = 1;
+            return;
+        }
+        diagnostics->records = records;
+        diagnostics->capacity = capacity;
+    }
+
+    Diagnostic *record = &diagnostics->records[diagnostics->count];
+    *record = (Diagnostic){site->code,          site->line,
+                           site->column,        site->offset,
+                           site->length,        message,
+                           message_length,      0,
+                           0,                   site->marker_skip,
+                           site->marker_carets, site->marker_note};
+    if (diagnostics->format == DIAG_HUMAN && site->source != NULL) {
+        unsigned long end = diagnostics->text_length + site->source_length;
+        if (diagnosticsReserve(&diagnostics->text,
+                               &diagnostics->text_capacity, end)) {
+            diagnostics->failed = 1;
+            return;
+        }
+        memcpy(diagnostics->text + diagnostics->text_length, site->source,
+               site->source_length);
+        record->source = diagnostics->text_length;
+        record->source_length = site->source_length;
+        diagnostics->text_length = end;
+    }
+    diagnostics->count++;
+}
+
+// grow buffer to hold at least needed bytes, at least doubling it
+static int diagnosticsReserve(char **buffer, unsigned long *capacity,
+                              unsigned long needed) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+    unsigned long grown = *capacity < 256 ? 256 : *capacity * 2;
+    if (grown < needed) {
+        grown = needed;
+    }
+    char *resized = realloc(*buffer, grown);
+    if (resized == NULL) {
+        return 1;
+    }
+    *buffer = resized;
+    *capacity = grown;
+    return 0;
+}
+
+// message, source line and markers under the span from its column
+static void diagnosticsRenderHuman(Diagnostics *diagnostics,
+                                   const Diagnostic *record) {
+    const char *message = diagnostics->text + record->message;
+    if (record->line == 0) {
+        diagnosticsPrintf(diagnostics, "ERROR: %s: %.*s [%s]\n",
+                          diagnostics->filename, (int)record->message_length,
+                          message, record->code);
+        return;
+    }
+
+    diagnosticsPrintf(diagnostics,
+                      "ERROR: %s (line %lu) (column %lu): %.*s [%s]\n"
+                      " %5lu | ",
+                      diagnostics->filename, record->line, record->column,
+                      (int)record->message_length, message, record->code,
+                      record->line);
+    diagnosticsPut(diagnostics, diagnostics->text + record->source,
+                   record->source_length);
+    diagnosticsPut(diagnostics, "\n       | ", 10);
+    diagnosticsPutFill(diagnostics, ' ',
+                       record->column - 1 + record->marker_skip);
+    diagnosticsPutFill(diagnostics, '^', record->marker_carets);
+    if (record->marker_note != NULL) {
+        diagnosticsPut(diagnostics, record->marker_note,
+                       strlen(record->marker_note));
+    }
+    diagnosticsPut(diagnostics, "\n", 1);
+}
+
+// one object per line, positions left out for errors of the whole file
+static void diagnosticsRenderJson(Diagnostics *diagnostics,
+                                  const Diagnostic *record) {
+    diagnosticsPut(diagnostics, "{\"file\":", 8);
+    diagnosticsPutJson(diagnostics, diagnostics->filename,
+                       strlen(diagnostics->filename));
+    if (record->line != 0) {
+        diagnosticsPrintf(diagnostics,
+                          ",\"line\":%lu,\"column\":%lu,\"offset\":%lu,"
+                          "\"length\":%lu",
+                          record->line, record->column, record->offset,
+                          record->length);
+    }
+    diagnosticsPrintf(diagnostics, ",\"code\":\"%s\",\"message\":",
+                      record->code);
+    diagnosticsPutJson(diagnostics, diagnostics->text + record->message,
+                       record->message_length);
+    diagnosticsPut(diagnostics, "}\n", 2);
+}
+
+// a SARIF result, the code is its rule and the span its region in bytes
+static void diagnosticsRenderSarif(Diagnostics *diagnostics,
+                                   const Diagnostic *record) {
+    diagnosticsPrintf(diagnostics,
+                      "{\"ruleId\":\"%s\",\"level\":\"error\","
+                      "\"message\":{\"text\":",
+                      record->code);
+    diagnosticsPutJson(diagnostics, diagnostics->text + record->message,
+                       record->message_length);
+    static const char location[] = "},\"locations\":[{\"physicalLocation\":"
+                                   "{\"artifactLocation\":{\"uri\":";
+    diagnosticsPut(diagnostics, location, sizeof(location) - 1);
+    diagnosticsPutJson(diagnostics, diagnostics->filename,
+                       strlen(diagnostics->filename));
+    diagnosticsPut(diagnostics, "}", 1);
+    if (record->line != 0) {
+        diagnosticsPrintf(diagnostics,
+                          ",\"region\":{\"startLine\":%lu,"
+                          "\"startColumn\":%lu,\"byteOffset\":%lu,"
+                          "\"byteLength\":%lu}",
+                          record->line, record->column, record->offset,
+                          record->length);
+    }
+    diagnosticsPut(diagnostics, "}}]}", 4);
+}
+
+// printf-style append to the rendered output
+static void diagnosticsPrintf(Diagnostics *diagnostics, const char *format,
+                              ...) {
+    va_list args;
+    va_start(args, format);
+    diagnosticsFormat(diagnostics, &diagnostics->render,
+                      &diagnostics->render_length,
+                      &diagnostics->render_capacity, format, args);
+    va_end(args);
+}
+
+// append bytes to the rendered output
+static void diagnosticsPut(Diagnostics *diagnostics, const char *bytes,
+                           unsigned long length) {
+    unsigned long end = diagnostics->render_length + length;
+    if (diagnosticsReserve(&diagnostics->render,
+                           &diagnostics->render_capacity, end)) {
+        diagnostics->failed = 1;
+        return;
+    }
+    memcpy(diagnostics->render + diagnostics->render_length, bytes, length);
+    diagnostics->render_length = end;
+}
+
+// append count copies of fill to the rendered output
+static void diagnosticsPutFill(Diagnostics *diagnostics, char fill,
+                               unsigned long count) {
+    unsigned long end = diagnostics->render_length + count;
+    if (diagnosticsReserve(&diagnostics->render,
+                           &diagnostics->render_capacity, end)) {
+        diagnostics->failed = 1;
+        return;
+    }
+    memset(diagnostics->render + diagnostics->render_length, fill, count);
+    diagnostics->render_length = end;
+}
+
+// append bytes as a JSON string, escaping quotes, backslashes and control
+// characters. Well-formed UTF-8 is copied as it is, any other byte is
+// written as \u00XX so the output stays valid UTF-8.
+static void diagnosticsPutJson(Diagnostics *diagnostics, const char *bytes,
+                               unsigned long length) {
+    diagnosticsPut(diagnostics, "\"", 1);
+    unsigned long run = 0;
+    for (unsigned long i = 0; i < length;) {
+        unsigned char byte = (unsigned char)bytes[i];
+        if (byte >= 0x20 && byte < 0x80 && byte != '"' && byte != '\\') {
+            i++;
+            continue;
+        }
+        if (byte >= 0x80) {
+            unsigned long sequence = diagnosticsUtf8Length(
+                (const unsigned char *)bytes + i, length - i);
+            if (sequence > 0) {
+                i += sequence;
+                continue;
+            }
+        }
+
+        diagnosticsPut(diagnostics, bytes + run, i - run);
+        run = ++i;
+        if (byte == '"' || byte == '\\') {
+            char escape[2] = {'\\', (char)byte};
+            diagnosticsPut(diagnostics, escape, 2);
+        } else if (byte == '\n') {
+            diagnosticsPut(diagnostics, "\\n", 2);
+        } else {
+            diagnosticsPrintf(diagnostics, "\\u%04x", byte);
+        }
+    }
+    diagnosticsPut(diagnostics, bytes + run, length - run);
+    diagnosticsPut(diagnostics, "\"", 1);
+}
+
+// bytes of the well-formed UTF-8 sequence starting a non-ASCII byte, 0 for
+// stray continuation bytes, overlong forms, surrogates and code points past
+// U+10FFFF
+static unsigned long diagnosticsUtf8Length(const unsigned char *bytes,
+                                           unsigned long length) {
+    unsigned long sequence;
+    unsigned char low = 0x80; // bounds of the second byte
+    unsigned char high = 0xbf;
+    if (bytes[0] >= 0xc2 && bytes[0] <= 0xdf) {
+        sequence = 2;
+    } else if (bytes[0] >= 0xe0 && bytes[0] <= 0xef) {
+        sequence = 3;
+        low = bytes[0] == 0xe0 ? 0xa0 : 0x80;
+        high = bytes[0] == 0xed ? 0x9f : 0xbf;
+    } else if (bytes[0] >= 0xf0 && bytes[0] <= 0xf4) {
+        sequence = 4;
+        low = bytes[0] == 0xf0 ? 0x90 : 0x80;
+        high = bytes[0] == 0xf4 ? 0x8f : 0xbf;
+    } else {
+        return 0;
+    }
+
+    if (sequence > length || bytes[1] < low || bytes[1] > high) {
+        return 0;
+    }
+    for (unsigned long i = 2; i < sequence; i++) {
+        if (bytes[i] < 0x80 || bytes[i] > 0xbf) {
+            return 0;
+        }
+    }
+    return sequence;
+}
+
+// hand the rendered output to out in one write and start over
+static int diagnosticsWrite(Diagnostics *diagnostics) {
+    int return_error = diagnostics->failed;
+    if (diagnostics->render_length > 0 &&
+        fwrite(diagnostics->render, 1, diagnostics->render_length,
+               diagnostics->out) != diagnostics->render_length) {
+        return_error = 1;
+    }
+    if (diagnostics->failed) {
+        fprintf(diagnostics->out, "ERROR: diagnostics memory allocation "
+                                  "failure [DIAGNOSTICS_ALLOCATION_ERROR]\n");
+        diagnostics->failed = 0;
+    }
+
+    diagnostics->count = 0;
+    diagnostics->text_length = 0;
+    diagnostics->render_length = 0;
+    return return_error;
+}
@@ -1,110 +1,361 @@
 // fileread header implementation
 //
 // `fileread.c` scans if file is the accepted extension file (*.rens ||
-// *.rn). It also allocates memory for a dynamic array where the contents of the
-// file is stored.
-// Responsible for writing the symbol table text file when -s option is raised
+// *.rn). It memory maps the file read-only where supported, falling back to a
+// dynamic array where the contents of the file is stored.
+// Responsible for writing the symbol table text file when -s option is raised,
+// formatting rows into one growing buffer written in large chunks
 
 #include "fileread.h"
+#include "lexer.h" // LEXER_PADDING
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-char *file_contents = NULL; // access file character array
-char *str_out = NULL;       // store symbol table
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RENS_HAVE_MMAP 1
+#endif
 
-int getRensFileContents(const char *filename) {
-    // detect rens or rn file extension
-    if (!(strstr(filename, ".rens") || strstr(filename, ".rn"))) {
-        printf(
-            "ERROR: unrecognized file extension '%s' [FILE_EXTENSION_ERROR]\n",
-            filename);
+#define STRING_OUTPUT_CHUNK 65536 // symbol table bytes buffered per write
+
+static const char empty_contents[LEXER_PADDING] = {0};
+
+static int checkRensExtension(const char *filename, FILE *out);
+static int readRensFileStream(FILE *file_ptr, const char *filename,
+                              RensFile *file, FILE *out);
+static int reserveStringOutput(StringOutput *output, unsigned long needed);
+static int writeStringOutput(const StringOutput *output, FILE *file_ptr);
+
+int getRensFileContents(const char *filename, RensFile *file, FILE *out) {
+    memset(file, 0, sizeof(RensFile));
+    if (checkRensExtension(filename, out)) {
         return 1;
     }
 
-    // open given filename input
-    FILE *file_ptr = fopen(filename, "r");
-    if (file_ptr == NULL) {
-        printf("error: '%s'\n", filename);
+#ifdef RENS_HAVE_MMAP
+    int file_desc = open(filename, O_RDONLY);
+    if (file_desc == -1) {
+        fprintf(out, "error: '%s'\n", filename);
         return 1;
     }
 
-    // set array size to be allocated on heap via length of chars in file
-    fseek(file_ptr, 0, SEEK_END);
-    unsigned long size = ftell(file_ptr);
-    fseek(file_ptr, 0, SEEK_SET);
+    struct stat file_stat;
+    if (fstat(file_desc, &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+        file->size = (unsigned long)file_stat.st_size;
+
+        // mmap rejects empty ranges, the lexer only needs padding
+        if (file->size == 0) {
+            close(file_desc);
+            file->contents = empty_contents;
+            return 0;
+        }
+
+        // reserve zeroed pages for the padding, then map the file over them
+        // (the tail of the last file page is zero filled by mmap)
+        unsigned long page_size = (unsigned long)sysconf(_SC_PAGESIZE);
+        unsigned long mapped_length =
+            (file->size + LEXER_PADDING + page_size - 1) / page_size *
+            page_size;
+        void *region = mmap(NULL, mapped_length, PROT_READ,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        void *mapping = MAP_FAILED;
+        if (region != MAP_FAILED) {
+            mapping = mmap(region, file->size, PROT_READ,
+                           MAP_PRIVATE | MAP_FIXED, file_desc, 0);
+            if (mapping == MAP_FAILED) {
+                munmap(region, mapped_length);
+            }
+        }
+        close(file_desc);
+        if (mapping == MAP_FAILED) {
+            fprintf(out, "ERROR: file contents memory mapping failure "
+                         "[CONTENT_MAPPING_ERROR]\n");
+            return 1;
+        }
+
+        // contents are read once front to back by the lexer
+        posix_madvise(mapping, file->size, POSIX_MADV_SEQUENTIAL);
 
-    // allocate memory for array
-    file_contents = (char *)malloc(size + 1);
-    if (file_contents == NULL) {
-        printf("ERROR: file contents memory allocation failure "
-               "[CONTENT_ALLOCATION_ERROR]\n");
-        fclose(file_ptr);
+        file->contents = mapping;
+        file->mapped = 1;
+        file->mapped_length = mapped_length;
+        return 0;
+    }
+    close(file_desc);
+#endif
+
+    // fall back to buffered reads for pipes, devices and non-POSIX systems
+    FILE *file_ptr = fopen(filename, "rb");
+    if (file_ptr == NULL) {
+        fprintf(out, "error: '%s'\n", filename);
         return 1;
     }
 
-    // put all characters in file to the array
-    fread(file_contents, 1, size, file_ptr);
-    (file_contents)[size] = '\0';
+    int status = readRensFileStream(file_ptr, filename, file, out);
+    fclose(file_ptr);
+    return status;
+}
+
+// read a rens file into buffer, grown to capacity bytes when too small and
+// followed by LEXER_PADDING zero bytes. Reading again into the same buffer
+// reuses its pages, a fresh mapping faults every page in.
+int readRensFileInto(const char *filename, char **buffer,
+                     unsigned long *capacity, unsigned long *size,
+                     FILE *out) {
+    *size = 0;
+    if (checkRensExtension(filename, out)) {
+        return 1;
+    }
+    FILE *file_ptr = fopen(filename, "rb");
+    if (file_ptr == NULL) {
+        fprintf(out, "error: '%s'\n", filename);
+        return 1;
+    }
 
+    int status = 0;
+    while (1) {
+        if (*size + LEXER_PADDING >= *capacity) {
+            unsigned long grown_capacity =
+                *capacity ? *capacity * 2 : STRING_OUTPUT_CHUNK;
+            char *grown = realloc(*buffer, grown_capacity);
+            if (grown == NULL) {
+                fprintf(out, "ERROR: file contents memory allocation failure "
+                             "[CONTENT_ALLOCATION_ERROR]\n");
+                status = 1;
+                break;
+            }
+            *buffer = grown;
+            *capacity = grown_capacity;
+        }
+        unsigned long got = fread(*buffer + *size, 1,
+                                  *capacity - LEXER_PADDING - *size,
+                                  file_ptr);
+        *size += got;
+        if (got == 0) {
+            if (ferror(file_ptr)) {
+                fprintf(out, "error: '%s'\n", filename);
+                status = 1;
+            }
+            break;
+        }
+    }
     fclose(file_ptr);
+
+    if (status == 0) {
+        memset(*buffer + *size, 0, LEXER_PADDING);
+    }
+    return status;
+}
+
+// prepare symbol table output: rows stream to file (if non-NULL) in chunks,
+// or are kept in memory when keep_output is set, errors are printed to out
+int openCollectedStringOutput(StringOutput *output, FILE *file,
+                              int keep_output, FILE *out) {
+    memset(output, 0, sizeof(StringOutput));
+    output->file = file;
+    output->out = out;
+    output->kept = keep_output;
+    if (reserveStringOutput(output, STRING_OUTPUT_CHUNK)) {
+        return 1;
+    }
+
+    static const char header[] = "LINENO.   COLUMN   TOKEN           LEXEME\n";
+    memcpy(output->buffer, header, sizeof(header) - 1);
+    output->length = sizeof(header) - 1;
+
     return 0;
 }
 
-// free allocated file_contents memory
-void cleanupFileContents() {
-    if (file_contents != NULL) {
-        free(file_contents);
+// release file contents mapping or allocated memory
+void cleanupFileContents(RensFile *file) {
+#ifdef RENS_HAVE_MMAP
+    if (file->mapped) {
+        munmap((void *)file->contents, file->mapped_length);
+    }
+#endif
+    if (!file->mapped && file->contents != NULL && file->size != 0) {
+        free((void *)file->contents);
+    }
+    memset(file, 0, sizeof(RensFile));
+}
+
+// continously collect token and lexeme strings on lexer, a row that cannot be
+// flushed or buffered is an error
+int collectStringOutput(StringOutput *output, const unsigned long lineno,
+                        const unsigned long col, const char *tok_name,
+                        const char *lexeme, const unsigned long lexeme_len) {
+    if (output->failed) {
+        return 1;
+    }
+
+    // the lexeme is copied, an int precision cannot hold 2 GiB lexemes, up
+    // to a NUL byte like %.*s
+    const char *nul = memchr(lexeme, '\0', lexeme_len);
+    unsigned long copied =
+        nul != NULL ? (unsigned long)(nul - lexeme) : lexeme_len;
+    while (1) {
+        unsigned long space = output->capacity - output->length;
+        char *row = output->buffer + output->length;
+        int prefix = snprintf(row, space, "%-9lu %-8lu %-15s ", lineno, col,
+                              tok_name);
+        if (prefix < 0) {
+            fprintf(output->out, "ERROR: failed formatting symbol table row "
+                                 "[OUTPUT_FORMAT_ERROR]\n");
+            output->failed = 1;
+            return 1;
+        }
+        unsigned long needed = (unsigned long)prefix + copied + 1;
+        if (needed <= space) {
+            memcpy(row + prefix, lexeme, copied);
+            row[needed - 1] = '\n';
+            output->length += needed;
+            return 0;
+        }
+
+        // row did not fit, make room and format it again
+        if (reserveStringOutput(output, needed + 1)) {
+            output->failed = 1;
+            return 1;
+        }
     }
-    file_contents = NULL;
 }
 
-// continously collect token and lexeme strings on lexer
-void collectStringOutput(const unsigned long lineno, const unsigned long col,
-                         const char *tok_name, char *lexeme) {
-    unsigned long needed = snprintf(NULL, 0, "%-9lu %-8lu %-15s %-s\n", lineno,
-                                    col, tok_name, lexeme);
-    char *buffer = (char *)malloc(needed + 1);
-    sprintf(buffer, "%-9lu %-8lu %-15s %-s\n", lineno, col, tok_name, lexeme);
-
-    if (str_out == NULL) {
-        str_out = (char *)malloc(strlen(buffer) + 44);
-        strcpy(str_out, "LINENO.   COLUMN   TOKEN           LEXEME\n");
-        strcat(str_out, buffer);
-    } else {
-        str_out =
-            (char *)realloc(str_out, strlen(buffer) + strlen(str_out) + 1);
-        strcat(str_out, buffer);
-    }
-
-    free(buffer);
+// print symbol table kept in memory by openCollectedStringOutput
+void printCollectedStringOutput(const StringOutput *output, FILE *out) {
+    fwrite(output->buffer, 1, output->length, out);
 }
 
-void printCollectedStringOutput() { printf("%s", str_out); }
+// write collected strings not yet flushed to the symbol file
+int storeCollectedStringOutput(StringOutput *output) {
+    if (output->file == NULL) {
+        fprintf(output->out, "ERROR: no symbol file opened. Call "
+                             "openCollectedStringOutput() with a non-NULL "
+                             "file [NULL_FILE_ERROR]\n");
+        return 1;
+    }
 
-// write collected strings from str_out to file
-int storeCollectedStringOutput(const char *filename) {
-    if (filename == NULL) {
-        printf("ERROR: received NULL as file. Filter"
-               "storeCollectedStringOutput() for a non-NULL value"
-               "[NULL_FILE_ERROR]\n");
+    if (output->failed) {
         return 1;
     }
 
-    if (str_out != NULL) {
-        FILE *file_ptr = fopen(filename, "w");
-        fprintf(file_ptr, "%s", str_out);
-        fclose(file_ptr);
+    int status = writeStringOutput(output, output->file);
+    output->length = 0;
+    return status;
+}
+
+// free allocated output buffer memory
+void cleanupCollectedString(StringOutput *output) {
+    if (output->buffer != NULL) {
+        free(output->buffer);
+    }
+    memset(output, 0, sizeof(StringOutput));
+}
+
+// detect rens or rn file extension
+static int checkRensExtension(const char *filename, FILE *out) {
+    if (!(strstr(filename, ".rens") || strstr(filename, ".rn"))) {
+        fprintf(
+            out,
+            "ERROR: unrecognized file extension '%s' [FILE_EXTENSION_ERROR]\n",
+            filename);
+        return 1;
+    }
+    return 0;
+}
+
+// make room for at least needed more bytes in the buffer, flushing rows to
+// the symbol file unless they are kept for printing
+static int reserveStringOutput(StringOutput *output, unsigned long needed) {
+    if (!output->kept && output->file != NULL && output->length > 0) {
+        if (writeStringOutput(output, output->file)) {
+            return 1;
+        }
+        output->length = 0;
+    }
+
+    if (output->capacity - output->length >= needed) {
+        return 0;
+    }
+
+    unsigned long capacity = output->capacity * 2;
+    if (capacity < output->length + needed) {
+        capacity = output->length + needed;
     }
+    char *grown = realloc(output->buffer, capacity);
+    if (grown == NULL) {
+        fprintf(output->out, "ERROR: symbol table memory allocation failure "
+                             "[OUTPUT_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+
+    output->buffer = grown;
+    output->capacity = capacity;
+    return 0;
+}
 
+// write buffered rows to file_ptr
+static int writeStringOutput(const StringOutput *output, FILE *file_ptr) {
+    if (fwrite(output->buffer, 1, output->length, file_ptr) !=
+        output->length) {
+        fprintf(output->out,
+                "ERROR: failed writing symbol table [OUTPUT_WRITE_ERROR]\n");
+        return 1;
+    }
     return 0;
 }
 
-// free allocated str_out memory
-void cleanupCollectedString() {
-    if (str_out != NULL) {
-        free(str_out);
+// read a stream of unknown size into heap allocated file contents, errors
+// name filename
+static int readRensFileStream(FILE *file_ptr, const char *filename,
+                              RensFile *file, FILE *out) {
+    unsigned long capacity = 1 << 16;
+    unsigned long size = 0;
+    char *contents = malloc(capacity + LEXER_PADDING);
+    int allocated = contents != NULL;
+
+    while (allocated) {
+        size += fread(contents + size, 1, capacity - size, file_ptr);
+        if (size < capacity) {
+            break;
+        }
+
+        // contents stays allocated when growing fails, freed below
+        char *grown = realloc(contents, capacity * 2 + LEXER_PADDING);
+        allocated = grown != NULL;
+        if (allocated) {
+            contents = grown;
+            capacity *= 2;
+        }
     }
-    str_out = NULL;
+
+    if (!allocated) {
+        free(contents);
+        fprintf(out, "ERROR: file contents memory allocation failure "
+                     "[CONTENT_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+
+    // a short read ends the stream unless reading failed
+    if (ferror(file_ptr)) {
+        free(contents);
+        fprintf(out, "error: '%s'\n", filename);
+        return 1;
+    }
+
+    // an empty stream keeps the allocation out of cleanupFileContents
+    file->size = size;
+    if (size == 0) {
+        free(contents);
+        file->contents = empty_contents;
+        return 0;
+    }
+
+    memset(contents + size, 0, LEXER_PADDING);
+    file->contents = contents;
+    return 0;
 }
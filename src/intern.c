@@ -0,0 +1,188 @@
+// intern header implementation
+//
+// `intern.c` keeps symbols in slots probed linearly from the name hash, a
+// zero slot being empty. An insert claims a symbol and room for the name
+// with atomic counters, writes the entry, then publishes the symbol into an
+// empty slot with a release compare-and-swap; lookups acquire slots, so a
+// visible symbol always has its entry written. Slots are never cleared and
+// entries never move, which keeps probing safe during inserts. A claimed
+// symbol that loses to an equal name is left behind as an empty entry.
+
+#include "intern.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct InternEntryStruct {
+    const char *name; // NULL for symbols lost to a racing insert
+    uint32_t length;
+    uint32_t hash;
+} InternEntry;
+
+struct InternTableStruct {
+    _Atomic uint32_t *slots; // symbol of each slot, 0 when empty
+    uint32_t mask;           // slot count - 1, slots are at most 3/4 full
+    InternEntry *entries;    // entry of symbol s at s - 1
+    uint32_t capacity;
+    atomic_uint next; // symbols claimed so far, may pass capacity
+    char *bytes;
+    unsigned long byte_capacity;
+    atomic_ulong byte_count;
+};
+
+static uint32_t internClaim(InternTable *table, const char *name,
+                            uint32_t length, uint32_t hash);
+
+/// PUBLIC FUNCTIONS
+
+// table for up to capacity names of byte_capacity bytes in total (each with
+// a terminator), NULL when out of memory
+InternTable *internCreate(uint32_t capacity, unsigned long byte_capacity) {
+    if (capacity == 0 || capacity > UINT32_MAX / 2) {
+        return NULL;
+    }
+
+    // next power of two holding capacity symbols at 3/4 load
+    uint64_t slot_count = 16;
+    while (slot_count * 3 < (uint64_t)capacity * 4) {
+        slot_count *= 2;
+    }
+
+    InternTable *table = calloc(1, sizeof(InternTable));
+    if (table == NULL) {
+        return NULL;
+    }
+    // pages of unused entries, slots and bytes are never touched
+    table->slots = calloc(slot_count, sizeof(uint32_t));
+    table->entries = malloc(capacity * sizeof(InternEntry));
+    table->bytes = malloc(byte_capacity ? byte_capacity : 1);
+    if (table->slots == NULL || table->entries == NULL ||
+        table->bytes == NULL) {
+        internDestroy(&table);
+        return NULL;
+    }
+
+    table->mask = (uint32_t)(slot_count - 1);
+    table->capacity = capacity;
+    table->byte_capacity = byte_capacity;
+    atomic_init(&table->next, 0);
+    atomic_init(&table->byte_count, 0);
+    return table;
+}
+
+// identifiers of n bytes of source are at most (n + 1) / 2 names (two
+// identifiers are at least one byte apart) of n + 1 bytes with terminators,
+// plus room for names claimed twice by racing inserts
+InternTable *internCreateFor(unsigned long content_length) {
+    unsigned long capacity = content_length / 2 + 1;
+    if (capacity > UINT32_MAX / 2) {
+        capacity = UINT32_MAX / 2;
+    }
+    return internCreate((uint32_t)capacity,
+                        content_length + content_length / 4 + 4096);
+}
+
+// symbol of name (from 1), hash being INTERN_HASH_STEP over its bytes. The
+// same symbol for the same name on every thread, 0 once the table is full.
+uint32_t internSymbol(InternTable *table, const char *name, uint32_t length,
+                      uint32_t hash) {
+    uint32_t claimed = 0;
+    uint32_t i = hash & table->mask;
+    for (uint32_t probes = 0; probes <= table->mask; probes++) {
+        uint32_t symbol =
+            atomic_load_explicit(&table->slots[i], memory_order_acquire);
+
+        // publish a claimed symbol, or compare with the one that won the slot
+        if (symbol == 0) {
+            if (claimed == 0 &&
+                (claimed = internClaim(table, name, length, hash)) == 0) {
+                return 0;
+            }
+            if (atomic_compare_exchange_strong_explicit(
+                    &table->slots[i], &symbol, claimed, memory_order_release,
+                    memory_order_acquire)) {
+                return claimed;
+            }
+        }
+
+        const InternEntry *entry = &table->entries[symbol - 1];
+        if (entry->hash == hash && entry->length == length &&
+            memcmp(entry->name, name, length) == 0) {
+            if (claimed != 0) {
+                table->entries[claimed - 1].name = NULL;
+            }
+            return symbol;
+        }
+        i = (i + 1) & table->mask;
+    }
+
+    if (claimed != 0) {
+        table->entries[claimed - 1].name = NULL;
+    }
+    return 0;
+}
+
+// terminated copy of the name of symbol, NULL for symbols given out by
+// racing inserts of a name that was published under another symbol
+const char *internName(const InternTable *table, uint32_t symbol,
+                       uint32_t *length) {
+    if (symbol == 0 || symbol > internCount(table)) {
+        return NULL;
+    }
+    const InternEntry *entry = &table->entries[symbol - 1];
+    *length = entry->length;
+    return entry->name;
+}
+
+// symbols given out so far, every symbol is at most this
+uint32_t internCount(const InternTable *table) {
+    uint32_t count = atomic_load_explicit(
+        &((InternTable *)table)->next, memory_order_acquire);
+    return count < table->capacity ? count : table->capacity;
+}
+
+// free the table and every name
+void internDestroy(InternTable **table) {
+    if (*table) {
+        free((void *)(*table)->slots);
+        free((*table)->entries);
+        free((*table)->bytes);
+        free(*table);
+    }
+
+    *table = NULL;
+}
+
+/// PRIVATE FUNCTIONS
+
+// copy name into the table under a new symbol, 0 when symbols or bytes run
+// out (the symbol then stays an empty entry)
+static uint32_t internClaim(InternTable *table, const char *name,
+                            uint32_t length, uint32_t hash) {
+    // a full table stops counting, next cannot wrap around
+    if (atomic_load_explicit(&table->next, memory_order_relaxed) >=
+        table->capacity) {
+        return 0;
+    }
+    uint32_t index =
+        atomic_fetch_add_explicit(&table->next, 1, memory_order_relaxed);
+    if (index >= table->capacity) {
+        return 0;
+    }
+
+    InternEntry *entry = &table->entries[index];
+    unsigned long offset = atomic_fetch_add_explicit(
+        &table->byte_count, (unsigned long)length + 1, memory_order_relaxed);
+    if (offset > table->byte_capacity ||
+        length + 1UL > table->byte_capacity - offset) {
+        *entry = (InternEntry){NULL, 0, 0};
+        return 0;
+    }
+
+    char *copy = table->bytes + offset;
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+    *entry = (InternEntry){copy, length, hash};
+    return index + 1;
+}
@@ -0,0 +1,355 @@
+// 'lexdfa.c' - table-driven lexer engine
+//
+// Classifies every byte through a 256-entry character class table and
+// recognizes operators, identifiers and numbers by walking a state transition
+// table. Contents must be followed by LEXER_PADDING zero bytes: the zero class
+// has no transitions, so the inner loops stop on the padding instead of
+// checking content_length. Whitespace, comments, character and string
+// literals keep the exact quirks of the switch engine in lexer.c.
+
+#include "lexer.h"
+
+#include <stdint.h>
+
+// character classes, whitespace classes first for a single range check
+typedef enum {
+    CC_OTHER,
+    CC_SPACE,
+    CC_NEWLINE,
+    CC_HASH,
+    CC_NUL,
+    CC_ALPHA,
+    CC_DIGIT,
+    CC_DOT,
+    CC_SQUOTE,
+    CC_DQUOTE,
+    CC_LCURLY,
+    CC_RCURLY,
+    CC_LPAREN,
+    CC_RPAREN,
+    CC_LBRACKET,
+    CC_RBRACKET,
+    CC_COMMA,
+    CC_SEMICOLON,
+    CC_COLON,
+    CC_PERCENT,
+    CC_PLUS,
+    CC_MINUS,
+    CC_EQUAL,
+    CC_BANG,
+    CC_SLASH,
+    CC_STAR,
+    CC_GT,
+    CC_LT,
+    CC_AMP,
+    CC_PIPE,
+    CC_COUNT,
+} CharClass;
+
+// recognizer states, DS_STOP ends the token on the current character
+typedef enum {
+    DS_STOP,
+    DS_ILLEGAL,
+    DS_EOF,
+    DS_LCURLY,
+    DS_RCURLY,
+    DS_LPAREN,
+    DS_RPAREN,
+    DS_LBRACKET,
+    DS_RBRACKET,
+    DS_COMMA,
+    DS_DOT,
+    DS_SEMICOLON,
+    DS_COLON,
+    DS_MODULO,
+    DS_ASSIGNMOD,
+    DS_PLUS,
+    DS_INCREMENT,
+    DS_ASSIGNINC,
+    DS_MINUS,
+    DS_DECREMENT,
+    DS_ASSIGNDEC,
+    DS_ASSIGN,
+    DS_EQUAL,
+    DS_BANG,
+    DS_NOTEQUAL,
+    DS_SLASH,
+    DS_ASSIGNDIV,
+    DS_FLOORDIV,
+    DS_ASTERISK,
+    DS_ASSIGNMUL,
+    DS_EXPONENT,
+    DS_GT,
+    DS_GEQUAL,
+    DS_LT,
+    DS_LEQUAL,
+    DS_AMPERSAND,
+    DS_AND,
+    DS_PIPE,
+    DS_OR,
+    DS_IDENT,
+    DS_INT,
+    DS_FLOAT,
+    DS_FLOATERR,
+    DS_CHARLIT, // hand-written scanners from here on
+    DS_STRINGLIT,
+    DS_COUNT,
+} DfaState;
+
+static const uint8_t dfa_class[256] = {
+    [' '] = CC_SPACE,    ['\t'] = CC_SPACE,    ['\r'] = CC_SPACE,
+    ['\n'] = CC_NEWLINE, ['#'] = CC_HASH,      ['\0'] = CC_NUL,
+    ['_'] = CC_ALPHA,    ['.'] = CC_DOT,       ['\''] = CC_SQUOTE,
+    ['"'] = CC_DQUOTE,   ['{'] = CC_LCURLY,    ['}'] = CC_RCURLY,
+    ['('] = CC_LPAREN,   [')'] = CC_RPAREN,    ['['] = CC_LBRACKET,
+    [']'] = CC_RBRACKET, [','] = CC_COMMA,     [';'] = CC_SEMICOLON,
+    [':'] = CC_COLON,    ['%'] = CC_PERCENT,   ['+'] = CC_PLUS,
+    ['-'] = CC_MINUS,    ['='] = CC_EQUAL,     ['!'] = CC_BANG,
+    ['/'] = CC_SLASH,    ['*'] = CC_STAR,      ['>'] = CC_GT,
+    ['<'] = CC_LT,       ['&'] = CC_AMP,       ['|'] = CC_PIPE,
+    ['0'] = CC_DIGIT, ['1'] = CC_DIGIT, ['2'] = CC_DIGIT, ['3'] = CC_DIGIT,
+    ['4'] = CC_DIGIT, ['5'] = CC_DIGIT, ['6'] = CC_DIGIT, ['7'] = CC_DIGIT,
+    ['8'] = CC_DIGIT, ['9'] = CC_DIGIT,
+    ['a'] = CC_ALPHA, ['b'] = CC_ALPHA, ['c'] = CC_ALPHA, ['d'] = CC_ALPHA,
+    ['e'] = CC_ALPHA, ['f'] = CC_ALPHA, ['g'] = CC_ALPHA, ['h'] = CC_ALPHA,
+    ['i'] = CC_ALPHA, ['j'] = CC_ALPHA, ['k'] = CC_ALPHA, ['l'] = CC_ALPHA,
+    ['m'] = CC_ALPHA, ['n'] = CC_ALPHA, ['o'] = CC_ALPHA, ['p'] = CC_ALPHA,
+    ['q'] = CC_ALPHA, ['r'] = CC_ALPHA, ['s'] = CC_ALPHA, ['t'] = CC_ALPHA,
+    ['u'] = CC_ALPHA, ['v'] = CC_ALPHA, ['w'] = CC_ALPHA, ['x'] = CC_ALPHA,
+    ['y'] = CC_ALPHA, ['z'] = CC_ALPHA,
+    ['A'] = CC_ALPHA, ['B'] = CC_ALPHA, ['C'] = CC_ALPHA, ['D'] = CC_ALPHA,
+    ['E'] = CC_ALPHA, ['F'] = CC_ALPHA, ['G'] = CC_ALPHA, ['H'] = CC_ALPHA,
+    ['I'] = CC_ALPHA, ['J'] = CC_ALPHA, ['K'] = CC_ALPHA, ['L'] = CC_ALPHA,
+    ['M'] = CC_ALPHA, ['N'] = CC_ALPHA, ['O'] = CC_ALPHA, ['P'] = CC_ALPHA,
+    ['Q'] = CC_ALPHA, ['R'] = CC_ALPHA, ['S'] = CC_ALPHA, ['T'] = CC_ALPHA,
+    ['U'] = CC_ALPHA, ['V'] = CC_ALPHA, ['W'] = CC_ALPHA, ['X'] = CC_ALPHA,
+    ['Y'] = CC_ALPHA, ['Z'] = CC_ALPHA,
+};
+
+// first state of a token by the class of its first character
+static const uint8_t dfa_start[CC_COUNT] = {
+    [CC_OTHER] = DS_ILLEGAL,      [CC_NUL] = DS_EOF,
+    [CC_ALPHA] = DS_IDENT,        [CC_DIGIT] = DS_INT,
+    [CC_DOT] = DS_DOT,            [CC_SQUOTE] = DS_CHARLIT,
+    [CC_DQUOTE] = DS_STRINGLIT,   [CC_LCURLY] = DS_LCURLY,
+    [CC_RCURLY] = DS_RCURLY,      [CC_LPAREN] = DS_LPAREN,
+    [CC_RPAREN] = DS_RPAREN,      [CC_LBRACKET] = DS_LBRACKET,
+    [CC_RBRACKET] = DS_RBRACKET,  [CC_COMMA] = DS_COMMA,
+    [CC_SEMICOLON] = DS_SEMICOLON, [CC_COLON] = DS_COLON,
+    [CC_PERCENT] = DS_MODULO,     [CC_PLUS] = DS_PLUS,
+    [CC_MINUS] = DS_MINUS,        [CC_EQUAL] = DS_ASSIGN,
+    [CC_BANG] = DS_BANG,          [CC_SLASH] = DS_SLASH,
+    [CC_STAR] = DS_ASTERISK,      [CC_GT] = DS_GT,
+    [CC_LT] = DS_LT,              [CC_AMP] = DS_AMPERSAND,
+    [CC_PIPE] = DS_PIPE,
+};
+
+// next state by current state and the class of the next character
+static const uint8_t dfa_transition[DS_COUNT][CC_COUNT] = {
+    [DS_MODULO] = {[CC_EQUAL] = DS_ASSIGNMOD},
+    [DS_PLUS] = {[CC_PLUS] = DS_INCREMENT, [CC_EQUAL] = DS_ASSIGNINC},
+    [DS_MINUS] = {[CC_MINUS] = DS_DECREMENT, [CC_EQUAL] = DS_ASSIGNDEC},
+    [DS_ASSIGN] = {[CC_EQUAL] = DS_EQUAL},
+    [DS_BANG] = {[CC_EQUAL] = DS_NOTEQUAL},
+    [DS_SLASH] = {[CC_EQUAL] = DS_ASSIGNDIV, [CC_SLASH] = DS_FLOORDIV},
+    [DS_ASTERISK] = {[CC_EQUAL] = DS_ASSIGNMUL, [CC_STAR] = DS_EXPONENT},
+    [DS_GT] = {[CC_EQUAL] = DS_GEQUAL},
+    [DS_LT] = {[CC_EQUAL] = DS_LEQUAL},
+    [DS_AMPERSAND] = {[CC_AMP] = DS_AND},
+    [DS_PIPE] = {[CC_PIPE] = DS_OR},
+    [DS_IDENT] = {[CC_ALPHA] = DS_IDENT},
+    [DS_INT] = {[CC_DIGIT] = DS_INT, [CC_DOT] = DS_FLOAT},
+    [DS_FLOAT] = {[CC_DIGIT] = DS_FLOAT, [CC_DOT] = DS_FLOATERR},
+    [DS_FLOATERR] = {[CC_DIGIT] = DS_FLOATERR, [CC_DOT] = DS_FLOATERR},
+};
+
+// token type produced when a token stops in a state
+static const uint8_t dfa_accept[DS_COUNT] = {
+    [DS_ILLEGAL] = TK_ILLEGALCHR,  [DS_EOF] = TK_EOF,
+    [DS_LCURLY] = TK_LCURLY,       [DS_RCURLY] = TK_RCURLY,
+    [DS_LPAREN] = TK_LPAREN,       [DS_RPAREN] = TK_RPAREN,
+    [DS_LBRACKET] = TK_LBRACKET,   [DS_RBRACKET] = TK_RBRACKET,
+    [DS_COMMA] = TK_COMMA,         [DS_DOT] = TK_DOT,
+    [DS_SEMICOLON] = TK_SEMICOLON, [DS_COLON] = TK_COLON,
+    [DS_MODULO] = TK_MODULO,       [DS_ASSIGNMOD] = TK_ASSIGNMOD,
+    [DS_PLUS] = TK_PLUS,           [DS_INCREMENT] = TK_INCREMENT,
+    [DS_ASSIGNINC] = TK_ASSIGNINC, [DS_MINUS] = TK_MINUS,
+    [DS_DECREMENT] = TK_DECREMENT, [DS_ASSIGNDEC] = TK_ASSIGNDEC,
+    [DS_ASSIGN] = TK_ASSIGN,       [DS_EQUAL] = TK_EQUAL,
+    [DS_BANG] = TK_BANG,           [DS_NOTEQUAL] = TK_NOTEQUAL,
+    [DS_SLASH] = TK_SLASH,         [DS_ASSIGNDIV] = TK_ASSIGNDIV,
+    [DS_FLOORDIV] = TK_FLOORDIV,   [DS_ASTERISK] = TK_ASTERISK,
+    [DS_ASSIGNMUL] = TK_ASSIGNMUL, [DS_EXPONENT] = TK_EXPONENT,
+    [DS_GT] = TK_GT,               [DS_GEQUAL] = TK_GEQUAL,
+    [DS_LT] = TK_LT,               [DS_LEQUAL] = TK_LEQUAL,
+    [DS_AMPERSAND] = TK_AMPERSAND, [DS_AND] = TK_AND,
+    [DS_PIPE] = TK_ILLEGALCHR,     [DS_OR] = TK_OR,
+    [DS_IDENT] = TK_IDENTIFIER,    [DS_INT] = TK_INTLIT,
+    [DS_FLOAT] = TK_FLTLIT,        [DS_FLOATERR] = TK_FLOATERR,
+};
+
+static unsigned long dfaSkipComment(const Lexer *lexer,
+                                    const unsigned char *text,
+                                    unsigned long pos);
+static Token dfaCharLiteral(Lexer *lexer, const unsigned char *text,
+                            unsigned long pos);
+static Token dfaStringLiteral(Lexer *lexer, const unsigned char *text,
+                              unsigned long pos);
+static Token dfaIdentifier(Lexer *lexer, const unsigned char *text,
+                           unsigned long pos);
+static Token dfaTokenCreate(Lexer *lexer, const unsigned char *text,
+                            unsigned long pos, TokenType type);
+
+/// PUBLIC FUNCTIONS
+
+// table-driven engine, same token stream as the default switch engine
+Token lexerDfaGetNextToken(Lexer *lexer) {
+    const unsigned char *text = (const unsigned char *)lexer->contents;
+    unsigned long pos = lexer->read_index; // position of the current character
+    uint8_t cls = dfa_class[text[pos]];
+
+    // skip whitespaces and comments, lines are resolved by lexerGetPosition
+    while (cls >= CC_SPACE && cls <= CC_HASH) {
+        if (cls == CC_HASH) {
+            pos = dfaSkipComment(lexer, text, pos);
+        }
+        pos++;
+        cls = dfa_class[text[pos]];
+
+        // longer runs (indentation, blank lines) go through the scan kernel
+        if (cls == CC_SPACE || cls == CC_NEWLINE) {
+            pos = lexer->scan->skip_blanks(lexer->contents, pos,
+                                           lexer->content_length);
+            cls = dfa_class[text[pos]];
+        }
+    }
+
+    lexer->index = pos; // mark token starting index
+
+    uint8_t state = dfa_start[cls];
+    if (state == DS_CHARLIT) {
+        return dfaCharLiteral(lexer, text, pos);
+    }
+    if (state == DS_STRINGLIT) {
+        return dfaStringLiteral(lexer, text, pos);
+    }
+    if (state == DS_IDENT) {
+        return dfaIdentifier(lexer, text, pos);
+    }
+
+    // longest match, the padding class stops every state
+    uint8_t next = dfa_transition[state][dfa_class[text[pos + 1]]];
+    while (next != DS_STOP) {
+        state = next;
+        pos++;
+        next = dfa_transition[state][dfa_class[text[pos + 1]]];
+    }
+
+    return dfaTokenCreate(lexer, text, pos, dfa_accept[state]);
+}
+
+/// PRIVATE FUNCTIONS
+
+// skip a '#' line or '##' block comment starting at pos and return the
+// position of its last character
+static unsigned long dfaSkipComment(const Lexer *lexer,
+                                    const unsigned char *text,
+                                    unsigned long pos) {
+    // block comment ends before the next '##' (or a zero byte), the rest of
+    // the line after its closing '#' is skipped as a line comment
+    if (text[pos + 1] == '#') {
+        pos++;
+        while (text[pos + 1] != '#' && text[pos + 1] != '\0') {
+            pos = lexer->scan->find_comment_end(lexer->contents, pos + 1,
+                                                lexer->content_length) -
+                  1;
+            if (text[pos + 1] == '#') {
+                pos++;
+            }
+        }
+        pos++;
+    }
+
+    // line comment ends before a newline, zero bytes only end it at the end
+    if (text[pos] == '#') {
+        pos = lexer->scan->find_newline(lexer->contents, pos + 1,
+                                        lexer->content_length) -
+              1;
+    }
+
+    return pos;
+}
+
+// character literal starting with the quote at pos
+static Token dfaCharLiteral(Lexer *lexer, const unsigned char *text,
+                            unsigned long pos) {
+    pos++;
+    if (text[pos] == '\'') {
+        return dfaTokenCreate(lexer, text, pos, TK_EMPTYCHERR);
+    }
+
+    if (text[pos] == '\\' &&
+        (text[pos + 1] == '\\' || text[pos + 1] == '\'' ||
+         text[pos + 1] == '0' || text[pos + 1] == 'n' ||
+         text[pos + 1] == 't' || text[pos + 1] == 'r')) {
+        pos++;
+    }
+
+    pos++;
+    if (text[pos] == '\'') {
+        return dfaTokenCreate(lexer, text, pos, TK_CHARACLIT);
+    }
+
+    pos++;
+    return dfaTokenCreate(lexer, text, pos, TK_MULTICHERR);
+}
+
+// string literal starting with the double quote at pos
+static Token dfaStringLiteral(Lexer *lexer, const unsigned char *text,
+                              unsigned long pos) {
+    pos++;
+    while (text[pos] != '"' && text[pos + 1] != '\0') {
+        if (text[pos] == '\\') {
+            if (text[pos + 1] == '"') {
+                pos++;
+            }
+            pos++;
+            continue;
+        }
+
+        // plain characters run up to the next quote, backslash or zero byte
+        unsigned long end = lexer->scan->find_string_special(
+            lexer->contents, pos + 1, lexer->content_length);
+        pos = text[end] == '\0' ? end - 1 : end;
+    }
+
+    if (text[pos + 1] != '\0') {
+        return dfaTokenCreate(lexer, text, pos, TK_STRINGLIT);
+    }
+    return dfaTokenCreate(lexer, text, pos, TK_STREOFERR);
+}
+
+// identifier or keyword starting at pos, hashed for interning as it is
+// scanned
+static Token dfaIdentifier(Lexer *lexer, const unsigned char *text,
+                           unsigned long pos) {
+    uint32_t hash = INTERN_HASH_STEP(INTERN_HASH_SEED, text[pos]);
+    while (dfa_class[text[pos + 1]] == CC_ALPHA) {
+        pos++;
+        hash = INTERN_HASH_STEP(hash, text[pos]);
+    }
+
+    TokenType type = lexerIdReservedKeyword(lexer->contents + lexer->index,
+                                            pos + 1 - lexer->index);
+    lexer->ch = (char)text[pos];
+    lexer->read_index = pos + 1;
+    return tokenCreateIdentifier(lexer, type, hash);
+}
+
+// leave lexer on the last character of the token at pos and slice it
+static Token dfaTokenCreate(Lexer *lexer, const unsigned char *text,
+                            unsigned long pos, TokenType type) {
+    lexer->ch = (char)text[pos];
+    lexer->read_index = pos + 1;
+    return tokenCreate(lexer, type);
+}
@@ -1,41 +1,307 @@
 // 'lexer.c' - lexical analyzer functionalities
 
 #include "lexer.h"
+#include "kwhash.h" // generated keyword perfect hash
 
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static Token *tokenCreate(TokenType type, char *lexeme);
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#ifndef LEXER_STREAM_CHUNK
+#define LEXER_STREAM_CHUNK 65536 // streaming buffer size and read request
+#endif
+#define LEXER_STREAM_LINE_KEEP 4096 // keep this much of a line for diagnostics
 
 static void lexerSkipWhitespace(Lexer *lexer);
+static void lexerSkipBlankRun(Lexer *lexer);
+static void lexerSkipStringBody(Lexer *lexer);
 static void lexerReadNextChar(Lexer *lexer);
 static char lexerPeekNextChar(Lexer *lexer);
-static char *lexerGetLexAsString(Lexer *lexer);
+static int lexerStreamRefill(Lexer *lexer);
+static void lexerReportError(Lexer *lexer, const Token *token,
+                             Diagnostics *diagnostics);
 
 static int isValidIdentifier(char chr);
 static int isValidNumber(char chr);
 
-static TokenType lexerIdReservedKeyword(const char *ident, unsigned long len);
+static Token lexerSwitchGetNextToken(Lexer *lexer);
 
 /// PUBLIC FUNCTIONS
 
 // start lexical analysis
-Lexer *initLexer(const char *contents) {
+Lexer *initLexer(const char *contents, unsigned long content_length) {
     Lexer *lexer = calloc(1, sizeof(Lexer));
 
     lexer->contents = contents;
-    lexer->content_length = strlen(contents);
+    lexer->content_length = content_length;
     lexer->index = 0;
     lexer->read_index = 0;
-    lexer->line_number = 1;
-    lexer->curr_line_start = 0;
+    lexer->line_cursor.line = 1;
+    lexer->stream_fd = -1;
+    lexer->engine = LEXER_ENGINE_SWITCH;
+    lexer->scan = scanGetBestKernels();
+
+    return lexer;
+}
+
+// select the engine used by lexerGetNextToken, the table-driven engine needs
+// resident contents followed by LEXER_PADDING zero bytes
+int lexerSetEngine(Lexer *lexer, LexerEngine engine) {
+    if (engine == LEXER_ENGINE_DFA && lexer->stream_fd >= 0) {
+        return 1;
+    }
+
+    lexer->engine = engine;
+    return 0;
+}
+
+// intern every identifier lexed from now on into symbols (NULL stops),
+// lexers on many threads may share one table
+void lexerSetSymbols(Lexer *lexer, InternTable *symbols) {
+    lexer->symbols = symbols;
+}
+
+// collect the errors reported on lexer (lexerErrorHandler, parseReportError)
+// into diagnostics instead of writing each one out (NULL stops)
+void lexerSetDiagnostics(Lexer *lexer, Diagnostics *diagnostics) {
+    lexer->diagnostics = diagnostics;
+}
+
+// start lexical analysis reading fixed-size chunks from a file descriptor
+Lexer *initLexerStream(int file_desc) {
+    Lexer *lexer = initLexer("", 0);
+    if (lexer == NULL) {
+        return NULL;
+    }
+
+    lexer->stream_buffer = malloc(LEXER_STREAM_CHUNK);
+    if (lexer->stream_buffer == NULL) {
+        free(lexer);
+        return NULL;
+    }
+
+    lexer->contents = lexer->stream_buffer;
+    lexer->stream_capacity = LEXER_STREAM_CHUNK;
+    lexer->stream_fd = file_desc;
 
     return lexer;
 }
 
 // iterate lexer to create and return tokens (tokenization and classification)
-Token *lexerGetNextToken(Lexer *lexer) {
+Token lexerGetNextToken(Lexer *lexer) {
+    if (lexer->engine == LEXER_ENGINE_DFA) {
+        return lexerDfaGetNextToken(lexer);
+    }
+    return lexerSwitchGetNextToken(lexer);
+}
+
+// pass tokens here to filter error type tokens, reporting them to the
+// diagnostics of lexer or, without any, writing each one to out
+int lexerErrorHandler(Lexer *lexer, const Token *token, const char *filename,
+                      FILE *out) {
+    if (!(token->type == TK_ILLEGALCHR || token->type == TK_EMPTYCHERR ||
+          token->type == TK_MULTICHERR || token->type == TK_FLOATERR ||
+          token->type == TK_STREOFERR)) {
+        return 0;
+    }
+
+    Diagnostics single;
+    Diagnostics *diagnostics = lexer->diagnostics;
+    if (diagnostics == NULL) {
+        diagnosticsInit(&single, filename, DIAG_HUMAN, 0, out);
+        diagnostics = &single;
+    }
+    lexerReportError(lexer, token, diagnostics);
+    if (diagnostics == &single) {
+        diagnosticsFinish(&single);
+    }
+    return 1;
+}
+
+// pointer to the lexeme of token in the buffered lexer contents
+const char *lexerGetLexeme(const Lexer *lexer, const Token *token) {
+    return lexer->contents + (token->start - lexer->content_base);
+}
+
+// line and column (from 1) of the character at an input offset, streaming
+// lexers resolve offsets of the current token or later only
+int lexerGetPosition(Lexer *lexer, unsigned long offset, unsigned long *line,
+                     unsigned long *column, FILE *out) {
+    unsigned long line_start;
+
+    if (lexer->stream_fd >= 0) {
+        lineCursorAdvance(&lexer->line_cursor, lexer->scan, lexer->contents,
+                          lexer->content_base, offset);
+        *line = lexer->line_cursor.line;
+        line_start = lexer->line_cursor.line_start;
+    } else {
+        // index every line start on the first lookup only
+        if (lexer->line_index.starts == NULL &&
+            lineIndexBuild(&lexer->line_index, lexer->scan, lexer->contents,
+                           lexer->content_length, out)) {
+            return 1;
+        }
+        lineIndexFind(&lexer->line_index, offset, line, &line_start);
+    }
+
+    *column = offset - line_start + 1;
+    return 0;
+}
+
+// free lexer allocated memory
+void lexerCleanUp(Lexer **lexer) {
+    if (*lexer) {
+        lineIndexCleanup(&(*lexer)->line_index);
+        free((*lexer)->stream_buffer);
+        free(*lexer);
+    }
+
+    *lexer = NULL;
+}
+
+// lex all of lexer->contents into a packed token buffer ending with TK_EOF
+int lexerTokenizeAll(Lexer *lexer, TokenBuffer *buffer, FILE *out) {
+    return lexerTokenizeRange(lexer, buffer, ULONG_MAX, out);
+}
+
+// lex into buffer up to TK_EOF or the first other token starting at or after
+// end, leaving the lexer where that token would be lexed again
+int lexerTokenizeRange(Lexer *lexer, TokenBuffer *buffer, unsigned long end,
+                       FILE *out) {
+    if (lexer->content_length > UINT32_MAX) {
+        fprintf(out, "ERROR: contents exceed 4 GiB token buffer offset limit "
+                     "[TOKEN_BUFFER_LIMIT_ERROR]\n");
+        return 1;
+    }
+
+    // start from a rough bytes-per-token estimate and double as needed
+    unsigned long range_end = end < lexer->content_length
+                                  ? end
+                                  : lexer->content_length;
+    unsigned long range =
+        range_end > lexer->read_index ? range_end - lexer->read_index : 0;
+    if (tokenBufferReserve(buffer, buffer->count + range / 8 + 16, out)) {
+        return 1;
+    }
+
+    while (1) {
+        unsigned long read_index = lexer->read_index;
+
+        Token tok = lexerGetNextToken(lexer);
+        if (tok.type != TK_EOF && lexer->index >= end) {
+            lexer->read_index = read_index;
+            return 0;
+        }
+
+        if (tokenBufferAppend(buffer, lexer, &tok, out)) {
+            return 1;
+        }
+        if (tok.type == TK_EOF) {
+            return 0;
+        }
+    }
+}
+
+// append the token last produced by lexer to buffer
+int tokenBufferAppend(TokenBuffer *buffer, const Lexer *lexer,
+                      const Token *token, FILE *out) {
+    if (buffer->count == buffer->capacity &&
+        tokenBufferReserve(buffer, buffer->capacity * 2 + 16, out)) {
+        return 1;
+    }
+
+    unsigned long i = buffer->count++;
+    buffer->types[i] = (uint8_t)token->type;
+    buffer->starts[i] = (uint32_t)token->start;
+    buffer->lengths[i] = (uint32_t)token->length;
+    buffer->begins[i] = (uint32_t)lexer->index;
+
+    // buffers of uninterned tokens carry no symbols array
+    if (token->symbol != 0 && buffer->symbols == NULL &&
+        tokenBufferTrackSymbols(buffer, out)) {
+        return 1;
+    }
+    if (buffer->symbols != NULL) {
+        buffer->symbols[i] = token->symbol;
+    }
+    return 0;
+}
+
+// add the symbols array (zeroed) to a buffer without one
+int tokenBufferTrackSymbols(TokenBuffer *buffer, FILE *out) {
+    if (buffer->symbols != NULL) {
+        return 0;
+    }
+
+    buffer->symbols = calloc(buffer->capacity + 1, sizeof(uint32_t));
+    if (buffer->symbols == NULL) {
+        fprintf(out, "ERROR: token buffer memory allocation failure "
+                     "[TOKEN_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+    return 0;
+}
+
+// grow token buffer arrays to hold at least capacity tokens
+int tokenBufferReserve(TokenBuffer *buffer, unsigned long capacity,
+                       FILE *out) {
+    if (capacity <= buffer->capacity) {
+        return 0;
+    }
+
+    uint8_t *types = realloc(buffer->types, capacity * sizeof(uint8_t));
+    if (types != NULL) {
+        buffer->types = types;
+    }
+
+    // every offset array has the same element type
+    uint32_t **arrays[] = {&buffer->starts, &buffer->lengths, &buffer->begins,
+                           &buffer->symbols};
+    int failed = types == NULL;
+    for (unsigned long i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        if (*arrays[i] == NULL && arrays[i] == &buffer->symbols) {
+            continue; // symbols are added by tokenBufferTrackSymbols
+        }
+        uint32_t *grown = realloc(*arrays[i], capacity * sizeof(uint32_t));
+        if (grown == NULL) {
+            failed = 1;
+        } else {
+            *arrays[i] = grown;
+        }
+    }
+
+    if (failed) {
+        fprintf(out, "ERROR: token buffer memory allocation failure "
+                     "[TOKEN_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+
+    buffer->capacity = capacity;
+    return 0;
+}
+
+// free token buffer arrays
+void tokenBufferCleanup(TokenBuffer *buffer) {
+    free(buffer->types);
+    free(buffer->starts);
+    free(buffer->lengths);
+    free(buffer->begins);
+    free(buffer->symbols);
+
+    memset(buffer, 0, sizeof(TokenBuffer));
+}
+
+/// PRIVATE FUNCTIONS
+
+// character-by-character engine with bounds checked reads
+static Token lexerSwitchGetNextToken(Lexer *lexer) {
     lexerReadNextChar(lexer);
     lexerSkipWhitespace(lexer);
 
@@ -43,109 +309,109 @@ Token *lexerGetNextToken(Lexer *lexer) {
 
     switch (lexer->ch) {
     case '{':
-        return tokenCreate(TK_LCURLY, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_LCURLY);
     case '}':
-        return tokenCreate(TK_RCURLY, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_RCURLY);
     case '(':
-        return tokenCreate(TK_LPAREN, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_LPAREN);
     case ')':
-        return tokenCreate(TK_RPAREN, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_RPAREN);
     case '[':
-        return tokenCreate(TK_LBRACKET, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_LBRACKET);
     case ']':
-        return tokenCreate(TK_RBRACKET, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_RBRACKET);
     case ',':
-        return tokenCreate(TK_COMMA, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_COMMA);
     case '.':
-        return tokenCreate(TK_DOT, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_DOT);
     case ';':
-        return tokenCreate(TK_SEMICOLON, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_SEMICOLON);
     case ':':
-        return tokenCreate(TK_COLON, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_COLON);
     case '%':
         if (lexerPeekNextChar(lexer) == '=') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_ASSIGNMOD, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_ASSIGNMOD);
         }
-        return tokenCreate(TK_MODULO, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_MODULO);
     case '+':
         if (lexerPeekNextChar(lexer) == '+') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_INCREMENT, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_INCREMENT);
         }
         if (lexerPeekNextChar(lexer) == '=') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_ASSIGNINC, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_ASSIGNINC);
         }
-        return tokenCreate(TK_PLUS, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_PLUS);
     case '-':
         if (lexerPeekNextChar(lexer) == '-') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_DECREMENT, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_DECREMENT);
         }
         if (lexerPeekNextChar(lexer) == '=') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_ASSIGNDEC, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_ASSIGNDEC);
         }
-        return tokenCreate(TK_MINUS, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_MINUS);
     case '=':
         if (lexerPeekNextChar(lexer) == '=') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_EQUAL, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_EQUAL);
         }
-        return tokenCreate(TK_ASSIGN, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_ASSIGN);
     case '!':
         if (lexerPeekNextChar(lexer) == '=') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_NOTEQUAL, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_NOTEQUAL);
         }
-        return tokenCreate(TK_BANG, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_BANG);
     case '/':
         if (lexerPeekNextChar(lexer) == '=') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_ASSIGNDIV, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_ASSIGNDIV);
         }
         if (lexerPeekNextChar(lexer) == '/') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_FLOORDIV, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_FLOORDIV);
         }
-        return tokenCreate(TK_SLASH, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_SLASH);
     case '*':
         if (lexerPeekNextChar(lexer) == '=') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_ASSIGNMUL, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_ASSIGNMUL);
         }
         if (lexerPeekNextChar(lexer) == '*') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_EXPONENT, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_EXPONENT);
         }
-        return tokenCreate(TK_ASTERISK, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_ASTERISK);
     case '>':
         if (lexerPeekNextChar(lexer) == '=') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_GEQUAL, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_GEQUAL);
         }
-        return tokenCreate(TK_GT, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_GT);
     case '<':
         if (lexerPeekNextChar(lexer) == '=') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_LEQUAL, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_LEQUAL);
         }
-        return tokenCreate(TK_LT, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_LT);
     case '&':
         if (lexerPeekNextChar(lexer) == '&') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_AND, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_AND);
         }
-        return tokenCreate(TK_AMPERSAND, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_AMPERSAND);
     case '|':
         if (lexerPeekNextChar(lexer) == '|') {
             lexerReadNextChar(lexer);
-            return tokenCreate(TK_OR, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_OR);
         }
         break;
     case '\0':
-        return tokenCreate(TK_EOF, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_EOF);
     default:
         break;
     }
@@ -156,7 +422,7 @@ Token *lexerGetNextToken(Lexer *lexer) {
 
         // error if character empty character constant
         if (lexer->ch == '\'') {
-            return tokenCreate(TK_EMPTYCHERR, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_EMPTYCHERR);
         }
 
         if (lexer->ch == '\\' && (lexerPeekNextChar(lexer) == '\\' ||
@@ -170,13 +436,13 @@ Token *lexerGetNextToken(Lexer *lexer) {
 
         lexerReadNextChar(lexer);
         if (lexer->ch == '\'') {
-            return tokenCreate(TK_CHARACLIT, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_CHARACLIT);
         }
 
         if (lexer->ch != '\'') {
             lexerReadNextChar(lexer);
         }
-        return tokenCreate(TK_MULTICHERR, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_MULTICHERR);
     }
 
     // detect string literals
@@ -187,27 +453,30 @@ Token *lexerGetNextToken(Lexer *lexer) {
                 lexerReadNextChar(lexer);
             }
             lexerReadNextChar(lexer);
+            lexerSkipStringBody(lexer);
         }
 
         if (lexerPeekNextChar(lexer) != '\0') {
-            return tokenCreate(TK_STRINGLIT, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_STRINGLIT);
         }
 
-        return tokenCreate(TK_STREOFERR, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_STREOFERR);
     }
 
     // detect identifier and keyword types
     if (isValidIdentifier(lexer->ch)) {
+        // the intern hash is taken in the same pass
+        uint32_t hash = INTERN_HASH_STEP(INTERN_HASH_SEED, lexer->ch);
         while (isValidIdentifier(lexerPeekNextChar(lexer))) {
             lexerReadNextChar(lexer);
+            hash = INTERN_HASH_STEP(hash, lexer->ch);
         }
 
         const char *value = lexer->contents + lexer->index;
         unsigned long len = lexer->read_index - lexer->index;
-        char *lexeme = strndup(value, len);
 
         TokenType type = lexerIdReservedKeyword(value, len);
-        return tokenCreate(type, lexeme);
+        return tokenCreateIdentifier(lexer, type, hash);
     }
 
     // detect integer literals
@@ -222,159 +491,78 @@ Token *lexerGetNextToken(Lexer *lexer) {
         }
 
         if (dot_count == 0) {
-            return tokenCreate(TK_INTLIT, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_INTLIT);
         }
 
         if (dot_count == 1) {
-            return tokenCreate(TK_FLTLIT, lexerGetLexAsString(lexer));
+            return tokenCreate(lexer, TK_FLTLIT);
         }
 
-        return tokenCreate(TK_FLOATERR, lexerGetLexAsString(lexer));
+        return tokenCreate(lexer, TK_FLOATERR);
     }
 
-    return tokenCreate(TK_ILLEGALCHR, lexerGetLexAsString(lexer));
+    return tokenCreate(lexer, TK_ILLEGALCHR);
 }
 
-// pass tokens here to filter error type tokens
-int lexerErrorHandler(Lexer *lexer, Token *token, const char *filename) {
-    if (!(token->type == TK_ILLEGALCHR || token->type == TK_EMPTYCHERR ||
-          token->type == TK_MULTICHERR || token->type == TK_FLOATERR ||
-          token->type == TK_STREOFERR)) {
-        return 0;
-    }
-    unsigned long column = lexer->index - lexer->curr_line_start + 1;
-    const char *line_start = lexer->contents + lexer->curr_line_start;
-    unsigned long line_end = lexer->curr_line_start;
-    while (lexer->contents[line_end] != '\n') {
-        line_end++;
-    }
-    char *curr_line = strndup(line_start, line_end - lexer->curr_line_start);
 
-    switch (token->type) {
-    case TK_ILLEGALCHR: // illegal character error
-        printf("ERROR: %s (line %lu) (column %lu): '%s' not recognized as "
-               "token or symbol [ILLEGAL_CHARACTER_ERROR] \n",
-               filename, lexer->line_number, column, token->lexeme);
-        printf(" %5lu | %s\n", lexer->line_number, curr_line);
-        printf("       | ");
-        for (int i = 0; i < column - 1; i++) {
-            putchar(' ');
-        }
-        printf("^\n");
-        return 1;
-    case TK_EMPTYCHERR: // empty character literal error
-        printf("ERROR: %s (line %lu) (column %lu): missing character literal "
-               "'' value [EMPTY_CHARACTER_ERROR] \n",
-               filename, lexer->line_number, column);
-        printf(" %5lu | %s\n", lexer->line_number, curr_line);
-        printf("       | ");
-        for (int i = 0; i < column - 1; i++) {
-            putchar(' ');
-        }
-        printf("^^\n");
-        return 1;
-    case TK_MULTICHERR: // multi character error
-        printf("ERROR: %s (line %lu) (column %lu): multiple value assigned on "
-               "character literal '%s' [MULTIPLE_CHARACTER_ERROR]\n",
-               filename, lexer->line_number, column, token->lexeme);
-        printf(" %5lu | %s\n", lexer->line_number, curr_line);
-        printf("       | ");
-        for (int i = 0; i < column - 1; i++) {
-            putchar(' ');
-        }
-        for (int i = 0; i < strlen(token->lexeme) + 2; i++) {
-            putchar('^');
-        }
-        printf("\n");
-        return 1;
-    case TK_FLOATERR: // invalid suffix on float literal
-        printf("ERROR: %s (line %lu) (column %lu): multiple decimal point "
-               "occurrences detected on %s [FLOAT_SUFFIX_ERROR]\n",
-               filename, lexer->line_number, column, token->lexeme);
-        printf(" %5lu | %s\n", lexer->line_number, curr_line);
-        printf("       | ");
-        for (int i = 0; i < column - 1; i++) {
-            putchar(' ');
-        }
-        int excess_dot = 0;
-        for (int i = 0; i < strlen(token->lexeme); i++) {
-            if (token->lexeme[i] == '.') {
-                excess_dot++;
-            }
-            if (excess_dot < 2) {
-                putchar(' ');
-            } else {
-                putchar('^');
-            }
-        }
-        printf("\n");
-        return 1;
-    case TK_STREOFERR: // unterminated string literal error
-        printf("ERROR: %s (line %lu) (column %lu): unterminated string literal "
-               "reached EOF [UNTERMINATED_STRING_ERROR]\n",
-               filename, lexer->line_number, column);
-        printf(" %5lu | %s\n", lexer->line_number, curr_line);
-        printf("       | ");
-        for (int i = 0; i < column - 1; i++) {
-            putchar(' ');
-        }
-        printf("^ ~~ expected another '\"' double quote\n");
-        return 1;
-    default:
-        return 0;
-    }
-}
+// token builder slicing tracked index to read_index in lexer->contents
+// (shared by the lexer engines, to be used by parser or syntax analyzer)
+Token tokenCreate(Lexer *lexer, TokenType type) {
+    unsigned long start = lexer->index;
+    unsigned long len = lexer->read_index - lexer->index;
 
-// free lexer allocated memory
-void lexerCleanUp(Lexer **lexer) {
-    if (*lexer) {
-        free(*lexer);
+    // discard quotes and double quotes in character and string literals
+    if ((lexer->ch == '\'' || lexer->ch == '"') && len >= 2) {
+        start++;
+        len = len - 2;
     }
 
-    *lexer = NULL;
-}
-
-// free token allocated memory
-void tokenCleanup(Token **token) {
-    if (*token && (*token)->lexeme) {
-        free((*token)->lexeme);
+    // clamp reads past the end of contents (EOF and unterminated literals)
+    if (start > lexer->content_length) {
+        start = lexer->content_length;
     }
-
-    if (*token) {
-        free(*token);
+    if (type == TK_EOF) {
+        len = 0;
+    } else if (len > lexer->content_length - start) {
+        len = lexer->content_length - start;
     }
 
-    *token = NULL;
+    Token token = {type, lexer->content_base + start, len, 0};
+    return token;
 }
 
-/// PRIVATE FUNCTIONS
-
-// token builder (to be used by parser or syntax analyzer)
-static Token *tokenCreate(TokenType type, char *lexeme) {
-    Token *token = calloc(1, sizeof(Token));
-
-    token->lexeme = lexeme;
-    token->type = type;
-
+// identifier or keyword token, identifiers interned by their scanned hash
+// into the symbols of lexer (when set)
+Token tokenCreateIdentifier(Lexer *lexer, TokenType type, uint32_t hash) {
+    Token token = tokenCreate(lexer, type);
+    if (type == TK_IDENTIFIER && lexer->symbols != NULL &&
+        token.length <= UINT32_MAX) {
+        token.symbol =
+            internSymbol(lexer->symbols, lexerGetLexeme(lexer, &token),
+                         (uint32_t)token.length, hash);
+    }
     return token;
 }
 
 // skip whitespaces, unneeded file escape sequences, and comments
 static void lexerSkipWhitespace(Lexer *lexer) {
+    lexer->skipping = 1; // streaming refills may drop skipped bytes
+
     while (lexer->ch == ' ' || lexer->ch == '\t' || lexer->ch == '\n' ||
            lexer->ch == '\r' || lexer->ch == '#') {
 
-        // track current line number
-        if (lexer->ch == '\n') {
-            lexer->line_number++;
-            lexer->curr_line_start = lexer->read_index;
-        }
-
         // skip block line comment
         if (lexer->ch == '#' && lexerPeekNextChar(lexer) == '#') {
             lexerReadNextChar(lexer);
             while (lexerPeekNextChar(lexer) != '#' &&
                    lexerPeekNextChar(lexer) != '\0') {
+                // jump to the byte before the next '#' or zero byte buffered
+                unsigned long end = lexer->scan->find_comment_end(
+                    lexer->contents, lexer->read_index, lexer->content_length);
+                if (end > lexer->read_index + 1) {
+                    lexer->ch = lexer->contents[end - 2];
+                    lexer->read_index = end - 1;
+                }
                 lexerReadNextChar(lexer);
                 if (lexerPeekNextChar(lexer) == '#') {
                     lexerReadNextChar(lexer);
@@ -383,20 +571,62 @@ static void lexerSkipWhitespace(Lexer *lexer) {
             lexerReadNextChar(lexer);
         }
 
-        // skip single line comment
+        // skip single line comment (may end at EOF without a newline)
         if (lexer->ch == '#') {
-            while (lexerPeekNextChar(lexer) != '\n') {
-                lexerReadNextChar(lexer);
+            while (lexerPeekNextChar(lexer) != '\n' &&
+                   lexer->read_index < lexer->content_length) {
+                // read up to the next newline buffered in one jump
+                unsigned long end = lexer->scan->find_newline(
+                    lexer->contents, lexer->read_index, lexer->content_length);
+                lexer->ch = lexer->contents[end - 1];
+                lexer->read_index = end;
             }
         }
 
+        lexerSkipBlankRun(lexer);
         lexerReadNextChar(lexer);
     }
+
+    lexer->skipping = 0;
+}
+
+// consume the whitespace run following the current character up to the end of
+// the buffered contents
+static void lexerSkipBlankRun(Lexer *lexer) {
+    if (lexer->read_index >= lexer->content_length) {
+        return;
+    }
+
+    unsigned long end = lexer->scan->skip_blanks(
+        lexer->contents, lexer->read_index, lexer->content_length);
+    if (end == lexer->read_index) {
+        return;
+    }
+
+    lexer->ch = lexer->contents[end - 1];
+    lexer->read_index = end;
+}
+
+// consume string literal characters up to the next quote, backslash or zero
+// byte buffered, leaving the last plain character as the current one
+static void lexerSkipStringBody(Lexer *lexer) {
+    if (lexer->ch == '"' || lexer->ch == '\\' || lexer->ch == '\0' ||
+        lexer->read_index >= lexer->content_length) {
+        return;
+    }
+
+    unsigned long end = lexer->scan->find_string_special(
+        lexer->contents, lexer->read_index, lexer->content_length);
+    if (end > lexer->read_index) {
+        lexer->ch = lexer->contents[end - 1];
+        lexer->read_index = end;
+    }
 }
 
 // access next char value in lexer
 static void lexerReadNextChar(Lexer *lexer) {
-    if (lexer->read_index >= lexer->content_length) {
+    if (lexer->read_index >= lexer->content_length &&
+        !lexerStreamRefill(lexer)) {
         lexer->ch = '\0';
     } else {
         lexer->ch = lexer->contents[lexer->read_index];
@@ -407,118 +637,205 @@ static void lexerReadNextChar(Lexer *lexer) {
 
 // view next char value in lexer
 static char lexerPeekNextChar(Lexer *lexer) {
-    if (lexer->read_index >= lexer->content_length) {
+    if (lexer->read_index >= lexer->content_length &&
+        !lexerStreamRefill(lexer)) {
         return '\0';
     }
     return lexer->contents[lexer->read_index];
 }
 
-// return ptr of tracked lexeme index and end read_index in lexer->contents
-static char *lexerGetLexAsString(Lexer *lexer) {
-    const char *value = lexer->contents + lexer->index;
-    unsigned long len = lexer->read_index - lexer->index;
-
-    // discard quotes and double quotes in character and string literals
-    if (lexer->ch == '\'' || lexer->ch == '"') {
-        value++;
-        len = len - 2;
-    }
-
-    char *lexeme = strndup(value, len);
-    return lexeme;
-}
-
-static int isValidIdentifier(const char chr) {
-    return 'a' <= chr && chr <= 'z' || 'A' <= chr && chr <= 'Z' || chr == '_';
-}
-
-static int isValidNumber(const char chr) { return '0' <= chr && '9' >= chr; }
-
-// detect if given identifier is a reserved keyword and return the type
-static TokenType lexerIdReservedKeyword(const char *ident, unsigned long len) {
-    if (strncmp(ident, "maketh", len) == 0) {
-        return TK_LET;
-    }
-
-    if (strncmp(ident, "define", len) == 0) {
-        return TK_FUNCTION;
-    }
-
-    if (strncmp(ident, "yay", len) == 0) {
-        return TK_TRUE;
-    }
-
-    if (strncmp(ident, "nay", len) == 0) {
-        return TK_FALSE;
+// slide the unconsumed tail of a streaming buffer down and read another chunk
+// (returns 1 when more contents became available)
+static int lexerStreamRefill(Lexer *lexer) {
+    if (lexer->stream_fd < 0 || lexer->stream_eof) {
+        return 0;
     }
 
-    if (strncmp(ident, "if", len) == 0) {
-        return TK_IF;
+#if defined(__unix__) || defined(__APPLE__)
+    // keep the current token, nothing while skipping whitespace and comments
+    unsigned long keep = lexer->index;
+    if (lexer->skipping || keep > lexer->content_length) {
+        keep = lexer->read_index > 0 ? lexer->read_index - 1 : 0;
     }
-
-    if (strncmp(ident, "else", len) == 0) {
-        return TK_ELSE;
+    if (keep > lexer->content_length) {
+        keep = lexer->content_length;
     }
 
-    if (strncmp(ident, "returneth", len) == 0) {
-        return TK_RETURN;
+    // count the lines of dropped bytes, keeping a short current line whole
+    LineCursor *cursor = &lexer->line_cursor;
+    lineCursorAdvance(cursor, lexer->scan, lexer->contents,
+                      lexer->content_base, lexer->content_base + keep);
+    if (cursor->line_start >= lexer->content_base &&
+        lexer->content_base + keep - cursor->line_start <=
+            LEXER_STREAM_LINE_KEEP) {
+        keep = cursor->line_start - lexer->content_base;
     }
 
-    if (strncmp(ident, "sayeth", len) == 0) {
-        return TK_OUT;
+    // offsets stay relative to contents
+    if (keep > 0) {
+        memmove(lexer->stream_buffer, lexer->stream_buffer + keep,
+                lexer->content_length - keep);
+        lexer->content_length -= keep;
+        lexer->content_base += keep;
+        lexer->index -= keep;
+        lexer->read_index -= keep;
     }
 
-    if (strncmp(ident, "heareth", len) == 0) {
-        return TK_IN;
+    // only a single token longer than the buffer grows it
+    unsigned long space = lexer->stream_capacity - lexer->content_length;
+    if (space < LEXER_STREAM_CHUNK / 2) {
+        char *grown = realloc(lexer->stream_buffer, lexer->stream_capacity * 2);
+        if (grown == NULL) {
+            lexer->stream_eof = 1;
+            return 0;
+        }
+        lexer->stream_buffer = grown;
+        lexer->stream_capacity *= 2;
     }
+    lexer->contents = lexer->stream_buffer;
 
-    if (strncmp(ident, "count", len) == 0) {
-        return TK_INT;
-    }
+    char *tail = lexer->stream_buffer + lexer->content_length;
+    ssize_t count;
+    do {
+        count = read(lexer->stream_fd, tail,
+                     lexer->stream_capacity - lexer->content_length);
+    } while (count < 0 && errno == EINTR);
 
-    if (strncmp(ident, "glyph", len) == 0) {
-        return TK_CHAR;
+    if (count <= 0) {
+        lexer->stream_eof = 1;
+        return 0;
     }
 
-    if (strncmp(ident, "portion", len) == 0) {
-        return TK_FLOAT;
-    }
+    lexer->content_length += (unsigned long)count;
+    return 1;
+#else
+    return 0;
+#endif
+}
 
-    if (strncmp(ident, "fraction", len) == 0) {
-        return TK_DOUBLE;
-    }
+static int isValidIdentifier(const char chr) {
+    return 'a' <= chr && chr <= 'z' || 'A' <= chr && chr <= 'Z' || chr == '_';
+}
 
-    if (strncmp(ident, "verdict", len) == 0) {
-        return TK_BOOL;
-    }
+static int isValidNumber(const char chr) { return '0' <= chr && '9' >= chr; }
 
-    if (strncmp(ident, "nought", len) == 0) {
-        return TK_VOID;
+// detect if given identifier is a reserved keyword and return the type
+// (kw_table and KW_HASH are generated from tokens.def at build time)
+TokenType lexerIdReservedKeyword(const char *ident, unsigned long len) {
+    if (len < KW_MIN_LENGTH || len > KW_MAX_LENGTH) {
+        return TK_IDENTIFIER;
     }
 
-    if (strncmp(ident, "thither", len) == 0) {
-        return TK_GOTO;
+    unsigned long slot = KW_HASH(ident, len);
+    if (kw_table[slot].length == len &&
+        memcmp(kw_table[slot].word, ident, len) == 0) {
+        return kw_table[slot].type;
     }
 
-    if (strncmp(ident, "switch", len) == 0) {
-        return TK_SWITCH;
-    }
+    return TK_IDENTIFIER;
+}
 
-    if (strncmp(ident, "case", len) == 0) {
-        return TK_CASE;
-    }
+// add the error of token, last produced by lexer, to diagnostics with its
+// span and, for human output, the source line and markers under the span
+static void lexerReportError(Lexer *lexer, const Token *token,
+                             Diagnostics *diagnostics) {
+    static const char *const codes[] = {
+        [TK_ILLEGALCHR] = "ILLEGAL_CHARACTER_ERROR",
+        [TK_EMPTYCHERR] = "EMPTY_CHARACTER_ERROR",
+        [TK_MULTICHERR] = "MULTIPLE_CHARACTER_ERROR",
+        [TK_FLOATERR] = "FLOAT_SUFFIX_ERROR",
+        [TK_STREOFERR] = "UNTERMINATED_STRING_ERROR",
+    };
+
+    // errors past the limit are only counted, not located
+    unsigned long begin = lexer->content_base + lexer->index;
+    DiagSite site = {.code = codes[token->type]};
+    if (diagnosticsFull(diagnostics)) {
+        diagnosticsReport(diagnostics, &site, "%s", "");
+        return;
+    }
+    if (lexerGetPosition(lexer, begin, &site.line, &site.column,
+                         diagnostics->out)) {
+        return;
+    }
+
+    // the span takes in the quotes stripped from literal lexemes
+    site.offset = begin;
+    site.length = token->start + token->length - begin;
+    if (token->start > begin) {
+        site.length++;
+    }
+
+    if (diagnostics->format == DIAG_HUMAN) {
+        unsigned long line_base = begin - site.column + 1;
+
+        // a streaming lexer may not have read up to the end of the line yet
+        unsigned long line_length = 0;
+        while (1) {
+            const char *rest = lexer->contents + lexer->index + line_length;
+            unsigned long rest_length = lexer->content_length - lexer->index;
+            while (line_length < rest_length && *rest != '\n') {
+                line_length++;
+                rest++;
+            }
+            if (line_length < rest_length ||
+                line_length > LEXER_STREAM_LINE_KEEP ||
+                !lexerStreamRefill(lexer)) {
+                break;
+            }
+        }
 
-    if (strncmp(ident, "cease", len) == 0) {
-        return TK_BREAK;
+        // a streaming lexer may have discarded the start of a very long line
+        unsigned long line_offset = lexer->index;
+        if (line_base >= lexer->content_base) {
+            line_offset = line_base - lexer->content_base;
+        }
+        site.source = lexer->contents + line_offset;
+        site.source_length = lexer->index + line_length - line_offset;
     }
 
-    if (strncmp(ident, "rehearse", len) == 0) {
-        return TK_WHILE;
+    const char *lexeme = lexerGetLexeme(lexer, token);
+    int lexeme_len = (int)token->length;
+    switch (token->type) {
+    case TK_ILLEGALCHR: // illegal character error
+        site.marker_carets = 1;
+        diagnosticsReport(diagnostics, &site,
+                          "'%.*s' not recognized as token or symbol",
+                          lexeme_len, lexeme);
+        break;
+    case TK_EMPTYCHERR: // empty character literal error
+        site.marker_carets = 2;
+        diagnosticsReport(diagnostics, &site,
+                          "missing character literal '' value");
+        break;
+    case TK_MULTICHERR: // multi character error
+        site.marker_carets = token->length + 2;
+        diagnosticsReport(diagnostics, &site,
+                          "multiple value assigned on character literal "
+                          "'%.*s'",
+                          lexeme_len, lexeme);
+        break;
+    case TK_FLOATERR: { // invalid suffix on float literal
+        // mark from the second decimal point on
+        const char *dot = memchr(lexeme, '.', token->length);
+        if (dot != NULL) {
+            dot = memchr(dot + 1, '.', token->length - 1 -
+                                           (unsigned long)(dot - lexeme));
+        }
+        site.marker_skip =
+            dot != NULL ? (unsigned long)(dot - lexeme) : token->length;
+        site.marker_carets = token->length - site.marker_skip;
+        diagnosticsReport(diagnostics, &site,
+                          "multiple decimal point occurrences detected on "
+                          "%.*s",
+                          lexeme_len, lexeme);
+        break;
     }
-
-    if (strncmp(ident, "persist", len) == 0) {
-        return TK_CONTINUE;
+    default: // unterminated string literal error
+        site.marker_carets = 1;
+        site.marker_note = " ~~ expected another '\"' double quote";
+        diagnosticsReport(diagnostics, &site,
+                          "unterminated string literal reached EOF");
+        break;
     }
-
-    return TK_IDENTIFIER;
 }
@@ -0,0 +1,172 @@
+// 'lexinc.c' - incremental relexing of edited resident contents
+//
+// A token is lexed from the byte it begins at and reads at most one byte past
+// its end, so every token beginning before the edit start is unchanged and
+// the last of them is a safe point to lex again from. Relexing stops at the
+// first token beginning after the inserted bytes where an old token begins
+// at the same place shifted by the edit: from there both streams see the same
+// bytes and produce the same tokens, which only move by the edit length. An
+// edit that opens a '##' comment or string literal relexes up to where it
+// closes again. Line numbers are never stored in tokens, the line index of
+// the lexer is edited in place (see lineIndexEdit).
+
+#include "lexer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned long lexerRelexStart(const TokenBuffer *buffer,
+                                     unsigned long offset);
+static int lexerRelexSplice(TokenBuffer *buffer, unsigned long first,
+                            unsigned long last, const TokenBuffer *relexed,
+                            const LexerEdit *edit, FILE *out);
+
+/// PUBLIC FUNCTIONS
+
+// point a resident lexer at contents after edit and update buffer, the tokens
+// of the contents before it, relexing only from the last token before the
+// edit until the tokens line up with the old stream again
+int lexerRelex(Lexer *lexer, const char *contents, unsigned long content_length,
+               const LexerEdit *edit, TokenBuffer *buffer, FILE *out) {
+    unsigned long old_length = lexer->content_length;
+    if (lexer->stream_fd >= 0 || edit->start > old_length ||
+        edit->removed_length > old_length - edit->start ||
+        content_length !=
+            old_length - edit->removed_length + edit->inserted_length) {
+        fprintf(out, "ERROR: edit does not match the lexed contents "
+                     "[LEXER_EDIT_ERROR]\n");
+        return 1;
+    }
+    if (content_length > UINT32_MAX) {
+        fprintf(out, "ERROR: contents exceed 4 GiB token buffer offset limit "
+                     "[TOKEN_BUFFER_LIMIT_ERROR]\n");
+        return 1;
+    }
+
+    lexer->contents = contents;
+    lexer->content_length = content_length;
+    if (lexer->line_index.starts != NULL &&
+        lineIndexEdit(&lexer->line_index, lexer->scan, contents, edit->start,
+                      edit->removed_length, edit->inserted_length, out)) {
+        return 1;
+    }
+
+    // relex the last token beginning before the edit, or from the start
+    unsigned long first = lexerRelexStart(buffer, edit->start);
+    if (first > 0) {
+        first--;
+        lexer->read_index = buffer->begins[first];
+    } else {
+        lexer->read_index = 0;
+    }
+
+    // relexed tokens at or after inserted_end resynchronize, old tokens are
+    // compared in old offsets
+    unsigned long inserted_end = edit->start + edit->inserted_length;
+    unsigned long last = first;
+    TokenBuffer relexed = {0};
+    int status = 0;
+    while (1) {
+        unsigned long read_index = lexer->read_index;
+
+        Token tok = lexerGetNextToken(lexer);
+        if (lexer->index >= inserted_end) {
+            unsigned long old_begin =
+                lexer->index - edit->inserted_length + edit->removed_length;
+            while (last < buffer->count && buffer->begins[last] < old_begin) {
+                last++;
+            }
+            if (last < buffer->count && buffer->begins[last] == old_begin) {
+                lexer->read_index = read_index;
+                break;
+            }
+        }
+
+        status = tokenBufferAppend(&relexed, lexer, &tok, out);
+        if (status || tok.type == TK_EOF) {
+            last = buffer->count;
+            break;
+        }
+    }
+
+    if (status == 0) {
+        status = lexerRelexSplice(buffer, first, last, &relexed, edit, out);
+    }
+    tokenBufferCleanup(&relexed);
+
+    // leave the lexer at the end like lexerTokenizeAll does
+    lexer->read_index = content_length + 1;
+    return status;
+}
+
+/// PRIVATE FUNCTIONS
+
+// number of tokens beginning before offset
+static unsigned long lexerRelexStart(const TokenBuffer *buffer,
+                                     unsigned long offset) {
+    unsigned long low = 0;
+    unsigned long high = buffer->count;
+    while (low < high) {
+        unsigned long middle = low + (high - low) / 2;
+        if (buffer->begins[middle] < offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// replace tokens [first, last) of buffer by the relexed tokens and move the
+// tokens after them by the edit length
+static int lexerRelexSplice(TokenBuffer *buffer, unsigned long first,
+                            unsigned long last, const TokenBuffer *relexed,
+                            const LexerEdit *edit, FILE *out) {
+    unsigned long tail = buffer->count - last;
+    unsigned long count = first + relexed->count + tail;
+    if (count > buffer->capacity &&
+        tokenBufferReserve(buffer, count * 2, out)) {
+        return 1;
+    }
+    if (relexed->symbols != NULL && tokenBufferTrackSymbols(buffer, out)) {
+        return 1;
+    }
+
+    // edits keeping the token count and the length touch no tail at all
+    unsigned long to = first + relexed->count;
+    if (to != last) {
+        memmove(buffer->types + to, buffer->types + last, tail);
+        memmove(buffer->starts + to, buffer->starts + last, tail * 4);
+        memmove(buffer->lengths + to, buffer->lengths + last, tail * 4);
+        memmove(buffer->begins + to, buffer->begins + last, tail * 4);
+        if (buffer->symbols != NULL) {
+            memmove(buffer->symbols + to, buffer->symbols + last, tail * 4);
+        }
+    }
+
+    // offsets wrap modulo 2^32 like the edit length does
+    uint32_t shift =
+        (uint32_t)(edit->inserted_length - edit->removed_length);
+    for (unsigned long i = to; i < count && shift != 0; i++) {
+        buffer->starts[i] += shift;
+        buffer->begins[i] += shift;
+    }
+
+    // an edit inside skipped text may leave nothing to relex
+    if (relexed->count > 0) {
+        memcpy(buffer->types + first, relexed->types, relexed->count);
+        memcpy(buffer->starts + first, relexed->starts, relexed->count * 4);
+        memcpy(buffer->lengths + first, relexed->lengths, relexed->count * 4);
+        memcpy(buffer->begins + first, relexed->begins, relexed->count * 4);
+    }
+    if (buffer->symbols != NULL) {
+        for (unsigned long i = 0; i < relexed->count; i++) {
+            buffer->symbols[first + i] =
+                relexed->symbols != NULL ? relexed->symbols[i] : 0;
+        }
+    }
+    buffer->count = count;
+    return 0;
+}
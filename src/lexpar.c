@@ -0,0 +1,301 @@
+// 'lexpar.c' - parallel lexing of resident contents
+//
+// Contents are split into ranges starting right after a newline, and every
+// range is lexed speculatively on the thread pool as if a line started
+// there. A range may really start inside a '##' block comment or a string
+// literal, so a serial fix-up pass lexes from the end of the previous range
+// until one of its tokens begins where a speculative token begins. From that
+// token on both lexers see the same bytes and produce the same tokens (lines
+// are not tracked while lexing, see lexerGetPosition). A final parallel pass
+// copies the ranges into one buffer. Range lexers share the intern table of
+// the lexer, so words of misread ranges may hold symbols no token keeps.
+
+#include "lexer.h"
+#include "threadpool.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LEXER_PARALLEL_CHUNK (1UL << 20) // default speculative range size
+
+typedef struct LexerRangeStruct {
+    unsigned long begin;
+    unsigned long end;
+    int status;
+
+    // speculative tokens and the read index after the last one
+    TokenBuffer speculative;
+    unsigned long speculative_end;
+
+    // fix-up: serial tokens before the first speculative token accepted
+    TokenBuffer bridge;
+    unsigned long sync;   // first accepted speculative token
+    unsigned long offset; // position in the merged buffer
+} LexerRange;
+
+typedef struct LexerParallelStruct {
+    const Lexer *lexer;
+    LexerRange *ranges;
+    TokenBuffer *merged;
+    FILE *out; // errors of every range
+} LexerParallel;
+
+static unsigned long lexerSplitRanges(const Lexer *lexer, LexerRange *ranges,
+                                      unsigned long range_count);
+static void lexerRangeSpeculate(void *context, unsigned long index);
+static int lexerRangeFixup(const Lexer *lexer, LexerRange *ranges,
+                           unsigned long range_count, TokenBuffer *merged,
+                           FILE *out);
+static void lexerRangeMerge(void *context, unsigned long index);
+static void lexerMergeSymbols(TokenBuffer *merged, unsigned long at,
+                              const TokenBuffer *range, unsigned long from,
+                              unsigned long count);
+static Lexer *lexerCreateAt(const Lexer *lexer, unsigned long read_index);
+static void lexerRunPool(unsigned int thread_count, unsigned long task_count,
+                         ThreadPoolTask task, void *context);
+
+/// PUBLIC FUNCTIONS
+
+// lex the resident contents of a fresh lexer on thread_count threads (0 for
+// one per core) in ranges of about chunk_size bytes (0 for a default), giving
+// the tokens of lexerTokenizeAll
+int lexerTokenizeParallel(Lexer *lexer, unsigned int thread_count,
+                          unsigned long chunk_size, TokenBuffer *buffer,
+                          FILE *out) {
+    if (lexer->stream_fd >= 0) {
+        return lexerTokenizeAll(lexer, buffer, out);
+    }
+    if (lexer->content_length > UINT32_MAX) {
+        fprintf(out, "ERROR: contents exceed 4 GiB token buffer offset limit "
+                     "[TOKEN_BUFFER_LIMIT_ERROR]\n");
+        return 1;
+    }
+
+    if (thread_count == 0) {
+        thread_count = threadPoolCoreCount();
+    }
+    if (chunk_size == 0) {
+        chunk_size = LEXER_PARALLEL_CHUNK;
+    }
+
+    unsigned long range_count = lexer->content_length / chunk_size + 1;
+    LexerRange *ranges = calloc(range_count, sizeof(LexerRange));
+    if (ranges == NULL) {
+        fprintf(out, "ERROR: lexer range memory allocation failure "
+                     "[TOKEN_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+    range_count = lexerSplitRanges(lexer, ranges, range_count);
+
+    LexerParallel parallel = {lexer, ranges, buffer, out};
+    lexerRunPool(thread_count, range_count, lexerRangeSpeculate, &parallel);
+
+    int status = lexerRangeFixup(lexer, ranges, range_count, buffer, out);
+    if (status == 0) {
+        lexerRunPool(thread_count, range_count, lexerRangeMerge, &parallel);
+        for (unsigned long i = 0; i < range_count; i++) {
+            status |= ranges[i].status;
+        }
+    }
+
+    for (unsigned long i = 0; i < range_count; i++) {
+        tokenBufferCleanup(&ranges[i].speculative);
+        tokenBufferCleanup(&ranges[i].bridge);
+    }
+    free(ranges);
+
+    // leave the lexer at the end like lexerTokenizeAll does
+    lexer->read_index = lexer->content_length + 1;
+    return status;
+}
+
+/// PRIVATE FUNCTIONS
+
+// cut contents after the first newline past every chunk boundary
+static unsigned long lexerSplitRanges(const Lexer *lexer, LexerRange *ranges,
+                                      unsigned long range_count) {
+    unsigned long length = lexer->content_length;
+    unsigned long chunk = length / range_count + 1;
+    unsigned long count = 0;
+    unsigned long begin = 0;
+
+    while (begin < length || count == 0) {
+        unsigned long end = length;
+        if (begin + chunk < length) {
+            end = lexer->scan->find_newline(lexer->contents, begin + chunk,
+                                            length);
+            end = end < length ? end + 1 : length;
+        }
+        ranges[count].begin = begin;
+        ranges[count].end = end;
+        count++;
+        begin = end;
+    }
+
+    // the last range takes every token up to TK_EOF
+    ranges[count - 1].end = ULONG_MAX;
+    return count;
+}
+
+// lex one range as if a line started at its beginning
+static void lexerRangeSpeculate(void *context, unsigned long index) {
+    LexerParallel *parallel = context;
+    LexerRange *range = &parallel->ranges[index];
+
+    Lexer *lexer = lexerCreateAt(parallel->lexer, range->begin);
+    if (lexer == NULL) {
+        range->status = 1;
+        return;
+    }
+
+    range->status = lexerTokenizeRange(lexer, &range->speculative,
+                                       range->end, parallel->out);
+    range->speculative_end = lexer->read_index;
+    lexerCleanUp(&lexer);
+}
+
+// lex serially from the end of each range until a token begins where a
+// speculative token of the next range begins, then continue from its end
+static int lexerRangeFixup(const Lexer *lexer, LexerRange *ranges,
+                           unsigned long range_count, TokenBuffer *merged,
+                           FILE *out) {
+    for (unsigned long i = 0; i < range_count; i++) {
+        if (ranges[i].status) {
+            return 1;
+        }
+    }
+
+    Lexer *serial = lexerCreateAt(lexer, 0);
+    if (serial == NULL) {
+        return 1;
+    }
+
+    int done = 0;
+    unsigned long offset = 0;
+    for (unsigned long i = 0; i < range_count; i++) {
+        LexerRange *range = &ranges[i];
+        TokenBuffer *speculative = &range->speculative;
+        range->sync = speculative->count;
+        range->offset = offset;
+
+        unsigned long next = 0; // speculative token compared next
+        while (!done) {
+            unsigned long read_index = serial->read_index;
+
+            Token tok = lexerGetNextToken(serial);
+            if (tok.type == TK_EOF) {
+                done = 1;
+            } else if (serial->index >= range->end) {
+                serial->read_index = read_index;
+                break;
+            }
+
+            while (next < speculative->count &&
+                   speculative->begins[next] < serial->index) {
+                next++;
+            }
+            if (next < speculative->count &&
+                speculative->begins[next] == serial->index) {
+                range->sync = next;
+
+                // continue serially after the last speculative token
+                serial->read_index = range->speculative_end;
+                done = speculative->types[speculative->count - 1] == TK_EOF;
+                break;
+            }
+
+            if (tokenBufferAppend(&range->bridge, serial, &tok, out)) {
+                lexerCleanUp(&serial);
+                return 1;
+            }
+        }
+
+        offset += range->bridge.count + speculative->count - range->sync;
+    }
+    lexerCleanUp(&serial);
+
+    // merged buffer arrays are filled by every range in parallel
+    if (tokenBufferReserve(merged, offset, out) ||
+        (lexer->symbols != NULL && tokenBufferTrackSymbols(merged, out))) {
+        return 1;
+    }
+    merged->count = offset;
+    return 0;
+}
+
+// copy the bridge and the accepted speculative tokens of one range into the
+// merged buffer
+static void lexerRangeMerge(void *context, unsigned long index) {
+    LexerParallel *parallel = context;
+    LexerRange *range = &parallel->ranges[index];
+    TokenBuffer *merged = parallel->merged;
+    const TokenBuffer *bridge = &range->bridge;
+    const TokenBuffer *speculative = &range->speculative;
+
+    unsigned long at = range->offset;
+    memcpy(merged->types + at, bridge->types, bridge->count);
+    memcpy(merged->starts + at, bridge->starts, bridge->count * 4);
+    memcpy(merged->lengths + at, bridge->lengths, bridge->count * 4);
+    memcpy(merged->begins + at, bridge->begins, bridge->count * 4);
+    lexerMergeSymbols(merged, at, bridge, 0, bridge->count);
+    at += bridge->count;
+
+    unsigned long count = speculative->count - range->sync;
+    unsigned long from = range->sync;
+    memcpy(merged->types + at, speculative->types + from, count);
+    memcpy(merged->starts + at, speculative->starts + from, count * 4);
+    memcpy(merged->lengths + at, speculative->lengths + from, count * 4);
+    memcpy(merged->begins + at, speculative->begins + from, count * 4);
+    lexerMergeSymbols(merged, at, speculative, from, count);
+}
+
+// copy count symbols from a range buffer, zero when it interned none
+static void lexerMergeSymbols(TokenBuffer *merged, unsigned long at,
+                              const TokenBuffer *range, unsigned long from,
+                              unsigned long count) {
+    if (merged->symbols == NULL) {
+        return;
+    }
+    if (range->symbols == NULL) {
+        memset(merged->symbols + at, 0, count * 4);
+    } else {
+        memcpy(merged->symbols + at, range->symbols + from, count * 4);
+    }
+}
+
+// fresh resident lexer over the contents of lexer, positioned at read_index
+static Lexer *lexerCreateAt(const Lexer *lexer, unsigned long read_index) {
+    Lexer *created = initLexer(lexer->contents, lexer->content_length);
+    if (created == NULL) {
+        return NULL;
+    }
+
+    lexerSetEngine(created, lexer->engine);
+    lexerSetSymbols(created, lexer->symbols);
+    created->scan = lexer->scan;
+    created->read_index = read_index;
+    return created;
+}
+
+// run every task on the pool, inline when a single thread is enough
+static void lexerRunPool(unsigned int thread_count, unsigned long task_count,
+                         ThreadPoolTask task, void *context) {
+    if (thread_count > task_count) {
+        thread_count = (unsigned int)task_count;
+    }
+
+    ThreadPool *pool = NULL;
+    if (thread_count > 1) {
+        pool = threadPoolCreate(thread_count, task_count, task, context);
+    }
+    if (pool == NULL) {
+        for (unsigned long i = 0; i < task_count; i++) {
+            task(context, i);
+        }
+        return;
+    }
+    threadPoolDestroy(&pool);
+}
@@ -0,0 +1,189 @@
+// 'lineidx.c' - line start index and streaming line cursor
+
+#include "lineidx.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned long lineIndexUpperBound(const LineIndex *index,
+                                         unsigned long offset);
+
+/// PUBLIC FUNCTIONS
+
+// index the line starts of length bytes of contents, allocation failures are
+// printed to out
+int lineIndexBuild(LineIndex *index, const ScanKernels *scan,
+                   const char *contents, unsigned long length, FILE *out) {
+    // start from a rough bytes-per-line estimate and double as needed
+    unsigned long capacity = length / 32 + 16;
+    unsigned long *starts = malloc(capacity * sizeof(unsigned long));
+    unsigned long count = 0;
+    unsigned long line_start = 0;
+
+    while (starts != NULL) {
+        if (count == capacity) {
+            capacity *= 2;
+            unsigned long *grown =
+                realloc(starts, capacity * sizeof(unsigned long));
+            if (grown == NULL) {
+                free(starts);
+            }
+            starts = grown;
+            continue;
+        }
+
+        starts[count++] = line_start;
+        unsigned long newline =
+            scan->find_newline(contents, line_start, length);
+        if (newline >= length) {
+            break;
+        }
+        line_start = newline + 1;
+    }
+
+    if (starts == NULL) {
+        fprintf(out, "ERROR: line index memory allocation failure "
+                     "[LINE_INDEX_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+
+    index->starts = starts;
+    index->count = count;
+    index->capacity = capacity;
+    index->hint = 0;
+    return 0;
+}
+
+// update a built index after removed_length bytes at start were replaced by
+// inserted_length bytes, contents being the edited input
+int lineIndexEdit(LineIndex *index, const ScanKernels *scan,
+                  const char *contents, unsigned long start,
+                  unsigned long removed_length, unsigned long inserted_length,
+                  FILE *out) {
+    // lines starting after a removed newline, [first, last)
+    unsigned long first = lineIndexUpperBound(index, start);
+    unsigned long last = lineIndexUpperBound(index, start + removed_length);
+
+    unsigned long inserted = 0;
+    unsigned long inserted_end = start + inserted_length;
+    for (unsigned long pos = start;; pos++) {
+        pos = scan->find_newline(contents, pos, inserted_end);
+        if (pos >= inserted_end) {
+            break;
+        }
+        inserted++;
+    }
+
+    unsigned long count = index->count - (last - first) + inserted;
+    if (count > index->capacity) {
+        unsigned long capacity = count * 2;
+        unsigned long *grown =
+            realloc(index->starts, capacity * sizeof(unsigned long));
+        if (grown == NULL) {
+            fprintf(out, "ERROR: line index memory allocation failure "
+                         "[LINE_INDEX_ALLOCATION_ERROR]\n");
+            return 1;
+        }
+        index->starts = grown;
+        index->capacity = capacity;
+    }
+
+    // shift the lines after the edit, then fill in the inserted ones
+    unsigned long *starts = index->starts;
+    unsigned long tail = first + inserted;
+    memmove(starts + tail, starts + last,
+            (index->count - last) * sizeof(unsigned long));
+    for (unsigned long i = tail; i < count; i++) {
+        starts[i] = starts[i] - removed_length + inserted_length;
+    }
+    for (unsigned long i = first, pos = start; i < tail; i++, pos++) {
+        pos = scan->find_newline(contents, pos, inserted_end);
+        starts[i] = pos + 1;
+    }
+
+    index->count = count;
+    index->hint = 0;
+    return 0;
+}
+
+// line number (from 1) and line start of the character at offset
+void lineIndexFind(LineIndex *index, unsigned long offset,
+                   unsigned long *line, unsigned long *line_start) {
+    unsigned long found = index->hint;
+
+    // tokens are mostly resolved in order, on the hinted line or the next
+    if (!(index->starts[found] <= offset &&
+          (found + 1 == index->count || offset < index->starts[found + 1]))) {
+        found++;
+        if (!(found < index->count && index->starts[found] <= offset &&
+              (found + 1 == index->count ||
+               offset < index->starts[found + 1]))) {
+            // last line start at or before offset
+            unsigned long low = 0;
+            unsigned long high = index->count;
+            while (high - low > 1) {
+                unsigned long middle = low + (high - low) / 2;
+                if (index->starts[middle] <= offset) {
+                    low = middle;
+                } else {
+                    high = middle;
+                }
+            }
+            found = low;
+        }
+    }
+
+    index->hint = found;
+    *line = found + 1;
+    *line_start = index->starts[found];
+}
+
+// free line start array
+void lineIndexCleanup(LineIndex *index) {
+    free(index->starts);
+    index->starts = NULL;
+    index->count = 0;
+    index->hint = 0;
+}
+
+// count newlines from the cursor up to the input offset, reading them from
+// window (the input bytes starting at input offset window_base)
+void lineCursorAdvance(LineCursor *cursor, const ScanKernels *scan,
+                       const char *window, unsigned long window_base,
+                       unsigned long offset) {
+    if (offset <= cursor->offset) {
+        return;
+    }
+
+    unsigned long pos = cursor->offset - window_base;
+    unsigned long end = offset - window_base;
+    while (1) {
+        pos = scan->find_newline(window, pos, end);
+        if (pos >= end) {
+            break;
+        }
+        cursor->line++;
+        cursor->line_start = window_base + pos + 1;
+        pos++;
+    }
+    cursor->offset = offset;
+}
+
+/// PRIVATE FUNCTIONS
+
+// first line starting after offset (count when none does)
+static unsigned long lineIndexUpperBound(const LineIndex *index,
+                                         unsigned long offset) {
+    unsigned long low = 0;
+    unsigned long high = index->count;
+    while (low < high) {
+        unsigned long middle = low + (high - low) / 2;
+        if (index->starts[middle] <= offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
@@ -1,62 +1,32 @@
-#include "fileread.h" // char *file_contents
-#include "lexer.h"    // lexical analyzer and tokens
-#include "optflags.h" // char *inputfile, *outputfile
+#include "optflags.h" // OptionFlags
+#include "server.h"   // --server and --connect
+#include "watch.h"    // --watch
 
 #include <stdio.h>
 
 int main(const int argc, char **argv) {
     // optflags.h - parse command line arguments
-    if (parseOptionFlags(argc, argv)) {
+    OptionFlags flags;
+    if (parseOptionFlags(&flags, argc, argv)) {
+        cleanupOptionFlags(&flags);
         return 1;
     }
 
-    // fileread.h - validate extension and get contents in file
-    if (inputfile != NULL) {
-        if (getRensFileContents(inputfile)) {
-            return 1;
-        }
-    }
-
     unsigned int return_error = 0;
 
-    // process inputfile's characters
-    if (file_contents != NULL) {
-        Lexer *lexer = initLexer(file_contents);
-
-        Token *tok = lexerGetNextToken(lexer);
-        while (tok->type != TK_EOF) {
-
-            // print error and exit fail if token type ERR and INVALID detected
-            if (lexerErrorHandler(lexer, tok, inputfile)) {
-                return_error = 1;
-            }
-
-            // for symbol table file output
-            if (symbolout == 1 || symbolfile != NULL) {
-                collectStringOutput(lexer->line_number,
-                                    lexer->index - lexer->curr_line_start + 1,
-                                    tk_map[tok->type], tok->lexeme);
-            }
-
-            tokenCleanup(&tok);
-            tok = lexerGetNextToken(lexer);
-        }
-
-        if (symbolout) {
-            printCollectedStringOutput();
-        }
-
-        // write symbol table on specified symbol file in arguments
-        if (symbolfile != NULL) {
-            storeCollectedStringOutput(symbolfile);
-        }
-
-        tokenCleanup(&tok);
-        lexerCleanUp(&lexer);
-        cleanupCollectedString();
-        cleanupFileContents();
+    // process inputfiles' characters here, or on a warm server process
+    if (flags.serversocket != NULL) {
+        return_error = serverListen(flags.serversocket, flags.jobcount);
+    } else if (flags.connectsocket != NULL && flags.inputfile_count > 0) {
+        return_error = serverRequest(flags.connectsocket, &flags);
+    } else if (flags.watch && flags.inputfile_count > 0) {
+        return_error = watchFiles(&flags, stdout, stderr);
+    } else {
+        return_error = runOptionFlags(&flags, stdout, stderr);
     }
 
+    cleanupOptionFlags(&flags);
+
     if (return_error) {
         return 1;
     }
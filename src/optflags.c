@@ -1,32 +1,102 @@
 // optflags header implementation
 //
-// `optflags.c` handles option flags using getopt to parse through arguments
-// and set input and output files.
+// `optflags.c` handles option flags using getopt_long to parse through
+// arguments and set input and output files in OptionFlags.
 //
 // See getopt(3) manual
 // https://man7.org/linux/man-pages/man3/getopt.3.html
 
 #include "optflags.h"
+#include "allocstat.h" // --stats allocation counters
+#include "diag.h"      // DiagFormat
+#include "lexer.h"     // LexerEngine
+#include "optimize.h"  // OPTIMIZE_MAX_LEVEL
+#include "stats.h"     // StatsFormat
+#include "vm.h"        // VmDispatch
 
 #include <getopt.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-const char *inputfile = NULL;  // access the specified file
-const char *outputfile = NULL; // output executable name
-const char *symbolfile = NULL;  // write symbol table to file
-int symbolout = 0;  // print symbol table to stdout
+#define RESPONSE_FILE_DEPTH 8 // nested '@file' limit, stops include cycles
+
+// long options without a short form use values past the char range
+enum {
+    OPT_ENGINE = 256,
+    OPT_LEX_THREADS,
+    OPT_STATS,
+    OPT_RTOK,
+    OPT_RTOK_SOURCE,
+    OPT_AST,
+    OPT_RUN,
+    OPT_DISPATCH,
+    OPT_BYTECODE,
+    OPT_RUNTIME,
+    OPT_SYMBOLS,
+    OPT_CACHE,
+    OPT_CACHE_SIZE,
+    OPT_SERVER,
+    OPT_CONNECT,
+    OPT_WATCH,
+    OPT_DIAGNOSTICS,
+    OPT_ERROR_LIMIT,
+};
+
+static const struct option long_options[] = {
+    {"engine", required_argument, NULL, OPT_ENGINE},
+    {"lex-threads", required_argument, NULL, OPT_LEX_THREADS},
+    {"stats", optional_argument, NULL, OPT_STATS},
+    {"rtok", required_argument, NULL, OPT_RTOK},
+    {"rtok-source", no_argument, NULL, OPT_RTOK_SOURCE},
+    {"ast", no_argument, NULL, OPT_AST},
+    {"run", no_argument, NULL, OPT_RUN},
+    {"dispatch", required_argument, NULL, OPT_DISPATCH},
+    {"bytecode", no_argument, NULL, OPT_BYTECODE},
+    {"runtime", required_argument, NULL, OPT_RUNTIME},
+    {"symbols", no_argument, NULL, OPT_SYMBOLS},
+    {"cache", required_argument, NULL, OPT_CACHE},
+    {"cache-size", required_argument, NULL, OPT_CACHE_SIZE},
+    {"server", required_argument, NULL, OPT_SERVER},
+    {"connect", required_argument, NULL, OPT_CONNECT},
+    {"watch", no_argument, NULL, OPT_WATCH},
+    {"diagnostics", required_argument, NULL, OPT_DIAGNOSTICS},
+    {"error-limit", required_argument, NULL, OPT_ERROR_LIMIT},
+    {NULL, 0, NULL, 0},
+};
 
 static void displayVersionInfo();
 static void displayHelpGuide();
+static int expandArguments(ArgumentList *arguments, int argc, char *argv[],
+                           int depth);
+static int expandResponseFile(ArgumentList *arguments, const char *filename,
+                              int depth);
+static int appendArgument(ArgumentList *arguments, const char *value,
+                          unsigned long length);
 
 /// PUBLIC FUNCTIONS
 
-int parseOptionFlags(const int argc, char *argv[]) {
+// detect argument type ( -h || -o <outputfile> [-s] || -v ) && inputfiles,
+// expanding '@file' arguments to the whitespace separated words in file
+int parseOptionFlags(OptionFlags *flags, int argc, char *argv[]) {
+    memset(flags, 0, sizeof(OptionFlags));
+    compileOptionsDefault(&flags->compile);
+    flags->statsformat = STATS_NONE;
     opterr = 0; // remove default getopt() error
+    optind = 0; // rescan from the start, a server parses every request
+
+    // replace '@file' arguments with the arguments listed in file
+    ArgumentList *arguments = &flags->arguments;
+    if (expandArguments(arguments, argc, argv, 0) ||
+        appendArgument(arguments, NULL, 0)) {
+        return 1;
+    }
+    argc = arguments->count - 1;
+    argv = arguments->values;
 
     while (1) {
         // define flag options with and without argument
-        int flag = getopt(argc, argv, "o:s:Svh");
+        int flag = getopt_long(argc, argv, "o:s:Sj:O::vh", long_options, NULL);
 
         // no option flags detected starting with '-'
         if (flag == -1) {
@@ -35,13 +105,41 @@ int parseOptionFlags(const int argc, char *argv[]) {
 
         switch (flag) {
         case 'o':
-            outputfile = optarg;
+            flags->outputfile = optarg;
+            flags->compile.output_file = optarg;
             break;
         case 's':
-            symbolfile = optarg;
+            flags->symbolfile = optarg;
             break;
         case 'S':
-            symbolout = 1;
+            flags->compile.symbol_out = 1;
+            break;
+        case 'j': {
+            char *end = NULL;
+            unsigned long count = strtoul(optarg, &end, 10);
+            if (*optarg < '1' || *optarg > '9' || *end != '\0' ||
+                count > 4096) {
+                printf("ERROR: invalid job count '%s' [JOB_COUNT_ERROR]\n",
+                       optarg);
+                return 1;
+            }
+            flags->jobcount = (unsigned int)count;
+            break;
+        }
+        case 'O':
+            // a bare -O is -O1
+            if (optarg == NULL) {
+                flags->compile.optimize = 1;
+            } else if (optarg[0] >= '0' &&
+                       optarg[0] <= '0' + OPTIMIZE_MAX_LEVEL &&
+                       optarg[1] == '\0') {
+                flags->compile.optimize = optarg[0] - '0';
+            } else {
+                printf("ERROR: unknown optimization level '%s' "
+                       "[UNKNOWN_OPTIMIZE_ERROR]\n",
+                       optarg);
+                return 1;
+            }
             break;
         case 'v':
             displayVersionInfo();
@@ -49,17 +147,154 @@ int parseOptionFlags(const int argc, char *argv[]) {
         case 'h':
             displayHelpGuide();
             return 0;
+        case OPT_ENGINE:
+            if (strcmp(optarg, "switch") == 0) {
+                flags->compile.engine = LEXER_ENGINE_SWITCH;
+            } else if (strcmp(optarg, "dfa") == 0) {
+                flags->compile.engine = LEXER_ENGINE_DFA;
+            } else {
+                printf("ERROR: unknown lexer engine '%s' "
+                       "[UNKNOWN_ENGINE_ERROR]\n",
+                       optarg);
+                return 1;
+            }
+            break;
+        case OPT_LEX_THREADS: {
+            char *end = NULL;
+            unsigned long count = strtoul(optarg, &end, 10);
+            if (*optarg < '0' || *optarg > '9' || *end != '\0' ||
+                count > 4096) {
+                printf("ERROR: invalid lexer thread count '%s' "
+                       "[JOB_COUNT_ERROR]\n",
+                       optarg);
+                return 1;
+            }
+            flags->compile.lex_threads = (unsigned int)count;
+            break;
+        }
+        case OPT_STATS:
+            if (optarg == NULL || strcmp(optarg, "human") == 0) {
+                flags->statsformat = STATS_HUMAN;
+            } else if (strcmp(optarg, "json") == 0) {
+                flags->statsformat = STATS_JSON;
+            } else {
+                printf("ERROR: unknown stats format '%s' "
+                       "[UNKNOWN_STATS_ERROR]\n",
+                       optarg);
+                return 1;
+            }
+            break;
+        case OPT_RTOK:
+            flags->compile.rtok_file = optarg;
+            break;
+        case OPT_RTOK_SOURCE:
+            flags->compile.rtok_source = 1;
+            break;
+        case OPT_AST:
+            flags->compile.ast_out = 1;
+            break;
+        case OPT_RUN:
+            flags->compile.run = 1;
+            break;
+        case OPT_DISPATCH:
+            if (strcmp(optarg, "goto") == 0) {
+                flags->compile.dispatch = VM_DISPATCH_GOTO;
+            } else if (strcmp(optarg, "switch") == 0) {
+                flags->compile.dispatch = VM_DISPATCH_SWITCH;
+            } else {
+                printf("ERROR: unknown dispatch loop '%s' "
+                       "[UNKNOWN_DISPATCH_ERROR]\n",
+                       optarg);
+                return 1;
+            }
+            break;
+        case OPT_BYTECODE:
+            flags->compile.bytecode_out = 1;
+            break;
+        case OPT_RUNTIME:
+            flags->compile.runtime_file = optarg;
+            break;
+        case OPT_SYMBOLS:
+            flags->compile.symbols_out = 1;
+            break;
+        case OPT_CACHE:
+            flags->compile.cache_dir = optarg;
+            break;
+        case OPT_CACHE_SIZE: {
+            // megabytes, or bytes with a k, m or g suffix
+            char *end = NULL;
+            unsigned long size = strtoul(optarg, &end, 10);
+            unsigned int shift = 20;
+            if (*end == 'k' || *end == 'm' || *end == 'g') {
+                shift = *end == 'k' ? 10 : *end == 'm' ? 20 : 30;
+                end++;
+            }
+            if (*optarg < '0' || *optarg > '9' || *end != '\0' ||
+                size > (1UL << 40) >> shift) {
+                printf("ERROR: invalid cache size '%s' "
+                       "[CACHE_SIZE_ERROR]\n",
+                       optarg);
+                return 1;
+            }
+            flags->compile.cache_size = size << shift;
+            break;
+        }
+        case OPT_SERVER:
+            flags->serversocket = optarg;
+            break;
+        case OPT_CONNECT:
+            flags->connectsocket = optarg;
+            break;
+        case OPT_WATCH:
+            flags->watch = 1;
+            break;
+        case OPT_DIAGNOSTICS:
+            if (strcmp(optarg, "human") == 0) {
+                flags->compile.diagnostics = DIAG_HUMAN;
+            } else if (strcmp(optarg, "json") == 0) {
+                flags->compile.diagnostics = DIAG_JSON;
+            } else if (strcmp(optarg, "sarif") == 0) {
+                flags->compile.diagnostics = DIAG_SARIF;
+            } else {
+                printf("ERROR: unknown diagnostics format '%s' "
+                       "[UNKNOWN_DIAGNOSTICS_ERROR]\n",
+                       optarg);
+                return 1;
+            }
+            break;
+        case OPT_ERROR_LIMIT: {
+            char *end = NULL;
+            unsigned long limit = strtoul(optarg, &end, 10);
+            if (*optarg < '0' || *optarg > '9' || *end != '\0') {
+                printf("ERROR: invalid error limit '%s' "
+                       "[ERROR_LIMIT_ERROR]\n",
+                       optarg);
+                return 1;
+            }
+            flags->compile.error_limit = limit;
+            break;
+        }
         default:
             displayHelpGuide();
-            printf("ERROR: option or flag '-%c' undefined "
-                   "[UNKNOWN_OPTION_ERROR]\n", optopt);
+            if (optopt > 0 && optopt < OPT_ENGINE) {
+                printf("ERROR: option or flag '-%c' undefined "
+                       "[UNKNOWN_OPTION_ERROR]\n", optopt);
+            } else {
+                printf("ERROR: option or flag '%s' undefined "
+                       "[UNKNOWN_OPTION_ERROR]\n", argv[optind - 1]);
+            }
             return 1;
         }
     }
 
-    // set outputfile to a.out if no '-o <fileout>' option specified
-    if (outputfile == NULL) {
-        outputfile = "a.out";
+    // a server takes its input files from clients
+    if (flags->serversocket != NULL) {
+        if (optind < argc || flags->connectsocket != NULL || flags->watch) {
+            printf("ERROR: --server takes no input files, --connect or "
+                   "--watch [SERVER_INPUT_ERROR]\n");
+            return 1;
+        }
+        return 0;
     }
 
     // no argument found after command or option '-o'
@@ -70,48 +305,330 @@ int parseOptionFlags(const int argc, char *argv[]) {
         return 1;
     }
 
-    // get only 1 file argument and fail if > 1
-    if (optind < argc - 1) {
-        printf("ERROR: unparsed argument/s detected: ");
-        for (int i = optind + 1; i < argc; i++) {
-            printf("%s ", argv[i]);
+    flags->inputfiles = malloc((argc - optind) * sizeof(const char *));
+    if (flags->inputfiles == NULL) {
+        printf("ERROR: argument memory allocation failure "
+               "[ARGUMENT_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        // detect incomplete option flag ('-' alone reads from stdin)
+        if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            printf("ERROR: incomplete option flag '%s' on argument %d"
+                   "[INCOMPLETE_FLAG_ERROR]\n",
+                   argv[i], i);
+            return 1;
         }
-        printf("[UNPARSED_ARGUMENTS_ERROR]\n");
+
+        // every unparsed argument is an input file, compiled in order
+        flags->inputfiles[flags->inputfile_count++] = argv[i];
+    }
+
+    // token files hold the tokens of one resident file
+    if (flags->compile.rtok_file != NULL &&
+        (flags->inputfile_count != 1 ||
+         strcmp(flags->inputfiles[0], "-") == 0)) {
+        printf("ERROR: --rtok needs exactly one input file, not stdin "
+               "[RTOK_INPUT_ERROR]\n");
+        return 1;
+    }
+
+    // one executable is built from one resident file
+    if (flags->outputfile != NULL &&
+        (flags->inputfile_count != 1 ||
+         strcmp(flags->inputfiles[0], "-") == 0)) {
+        printf("ERROR: -o needs exactly one input file, not stdin "
+               "[OUTPUT_INPUT_ERROR]\n");
         return 1;
     }
 
-    // detect incomplete option flag
-    if (argv[optind][0] == '-') {
-        printf("ERROR: incomplete option flag '%s' on argument %d"
-               "[INCOMPLETE_FLAG_ERROR]\n",
-               argv[optind], optind);
+    // the parser reads lexemes of earlier tokens, stdin is not kept
+    for (unsigned long i = 0; i < flags->inputfile_count; i++) {
+        if ((flags->compile.ast_out || flags->compile.symbols_out) &&
+            strcmp(flags->inputfiles[i], "-") == 0) {
+            printf("ERROR: --ast and --symbols need input files, not stdin "
+                   "[AST_INPUT_ERROR]\n");
+            return 1;
+        }
+        if ((flags->compile.run || flags->compile.bytecode_out) &&
+            strcmp(flags->inputfiles[i], "-") == 0) {
+            printf("ERROR: --run and --bytecode need input files, not stdin "
+                   "[RUN_INPUT_ERROR]\n");
+            return 1;
+        }
+        if (flags->connectsocket != NULL &&
+            strcmp(flags->inputfiles[i], "-") == 0) {
+            printf("ERROR: --connect needs input files, not stdin "
+                   "[SERVER_INPUT_ERROR]\n");
+            return 1;
+        }
+        if (flags->watch && strcmp(flags->inputfiles[i], "-") == 0) {
+            printf("ERROR: --watch needs input files, not stdin "
+                   "[WATCH_INPUT_ERROR]\n");
+            return 1;
+        }
+    }
+
+    // a watch keeps its files in this process
+    if (flags->watch && flags->connectsocket != NULL) {
+        printf("ERROR: --watch compiles here, not with --connect "
+               "[WATCH_INPUT_ERROR]\n");
         return 1;
     }
 
-    // assign single unparsed argument to inputfile
-    if (inputfile == NULL) {
-        inputfile = argv[optind];
+    return 0;
+}
+
+// compile the input files of parsed flags, printing to out and the --stats
+// report to err, returns 1 when any file failed
+int runOptionFlags(const OptionFlags *flags, FILE *out, FILE *err) {
+    if (flags->inputfile_count == 0) {
         return 0;
     }
 
-    printf("ERROR: uncaught error [UNCAUGHT_ERROR]\n");
-    return 1;
+    // -s collects every file's table in order
+    FILE *symbol_file = NULL;
+    if (flags->symbolfile != NULL) {
+        symbol_file = fopen(flags->symbolfile, "w");
+        if (symbol_file == NULL) {
+            fprintf(out, "error: '%s'\n", flags->symbolfile);
+            return 1;
+        }
+    }
+
+    // stats.h - phase timings and counts when --stats is given, counting the
+    // allocations made since (a server adds its concurrent requests)
+    CompileStats stats = {0};
+    CompileStats *stats_ptr = flags->statsformat != STATS_NONE ? &stats : NULL;
+    AllocStat allocs_before;
+    int no_allocs = allocStatGet(&allocs_before);
+    double start = statsClock(stats_ptr);
+
+    int return_error = compileRensFiles(
+        flags->inputfiles, flags->inputfile_count, flags->jobcount,
+        &flags->compile, out, symbol_file, stats_ptr);
+
+    if (symbol_file != NULL && fclose(symbol_file) != 0) {
+        return_error = 1;
+    }
+
+    if (stats_ptr != NULL) {
+        AllocStat allocs;
+        no_allocs |= allocStatGet(&allocs);
+        allocs.count -= allocs_before.count;
+        allocs.bytes -= allocs_before.bytes;
+        fflush(out);
+        statsPrint(&stats, statsClock(stats_ptr) - start,
+                   no_allocs ? NULL : &allocs, (StatsFormat)flags->statsformat,
+                   err);
+    }
+    return return_error;
+}
+
+// free expanded arguments and input file list
+void cleanupOptionFlags(OptionFlags *flags) {
+    for (int i = 0; i < flags->arguments.count; i++) {
+        free(flags->arguments.values[i]);
+    }
+    free(flags->arguments.values);
+    free(flags->inputfiles);
+    flags->arguments = (ArgumentList){NULL, 0, 0};
+    flags->inputfiles = NULL;
+    flags->inputfile_count = 0;
 }
 
 /// PRIVATE FUNCTIONS
 
 static void displayVersionInfo() {
-    printf("Renaisscript compiler version 0.1.0\n");
+    printf("Renaisscript compiler version " COMPILE_VERSION "\n");
 }
 
 static void displayHelpGuide() {
     printf("Usage: renaisscript [option...] [rensfile...].rens\n"
            "\n"
+           "  -                 read rensfile source from stdin\n"
            "  -h                print help guide and exit successfully\n"
-           "  -o <filename>     write output to file\n"
+           "  -o <filename>     compile the input file to a native x86-64\n"
+           "                    executable, or assembly when it ends in .s\n"
            "  -s <filename>     write symbol table to file\n"
            "  -S                print symbol table to stdout\n"
+           "  -j <count>        compile files on count threads (default: "
+           "cores)\n"
+           "  -O<level>         bytecode passes: 0 (default), 1 folds "
+           "constants\n"
+           "                    and branches, 2 adds cse and dead stores\n"
            "  -v                print version and exit successfully\n"
+           "  --engine=<name>   lexer engine: switch (default) or dfa\n"
+           "  --lex-threads=<count>\n"
+           "                    lex each file on count threads (0: cores)\n"
+           "  --stats[=<format>]\n"
+           "                    print phase timings, token counts and memory\n"
+           "                    use to stderr: human (default) or json\n"
+           "  --rtok=<filename> write binary token file of the input file\n"
+           "  --rtok-source     embed the source in the token file\n"
+           "  --ast             print the syntax tree of each input file\n"
+           "  --symbols         print the names of each input file: kind,\n"
+           "                    first definition and reference count\n"
+           "  --run             compile each input file to bytecode and run "
+           "it\n"
+           "  --dispatch=<name> --run loop: goto (default) or switch\n"
+           "  --bytecode        print the bytecode of each input file\n"
+           "  --cache=<dir>     replay outputs of unchanged files from dir,\n"
+           "                    store new ones (not with --run, -o or --rtok)\n"
+           "  --cache-size=<size>\n"
+           "                    bytes kept in the cache, least recently used\n"
+           "                    go first: megabytes or k, m, g (default: 256)\n"
+           "  --runtime=<filename>\n"
+           "                    runtime archive linked by -o (default:\n"
+           "                    librenaisscript_rt.a beside renaisscript)\n"
+           "  --server=<socket> stay running, compiling the files of clients\n"
+           "                    of socket on -j threads (default: cores)\n"
+           "  --connect=<socket>\n"
+           "                    compile on the server listening on socket\n"
+           "  --watch           compile again whenever an input file is "
+           "saved,\n"
+           "                    printing the output of changed files\n"
+           "  --diagnostics=<format>\n"
+           "                    write errors as human (default), json (one\n"
+           "                    object per line) or sarif (a log per file)\n"
+           "  --error-limit=<count>\n"
+           "                    keep the first count errors of each file,\n"
+           "                    summarize the rest (default: 0, keep all)\n"
+           "  @<filename>       read arguments from file\n"
            "\n"
            "Report issues on github.com/steguiosaur/renaisscript/issues\n");
 }
+
+// copy argv to arguments, expanding '@file' (a lone '@' is kept)
+static int expandArguments(ArgumentList *arguments, int argc, char *argv[],
+                           int depth) {
+    for (int i = 0; i < argc; i++) {
+        int status =
+            argv[i][0] == '@' && argv[i][1] != '\0' && (depth || i)
+                ? expandResponseFile(arguments, argv[i] + 1, depth + 1)
+                : appendArgument(arguments, argv[i], strlen(argv[i]));
+        if (status) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// split a response file on whitespace, quotes group and '\\' escapes
+static int expandResponseFile(ArgumentList *arguments, const char *filename,
+                              int depth) {
+    FILE *file_ptr = fopen(filename, "r");
+    if (file_ptr == NULL || depth > RESPONSE_FILE_DEPTH) {
+        printf("ERROR: response file '%s' unreadable or nested too deep "
+               "[RESPONSE_FILE_ERROR]\n",
+               filename);
+        if (file_ptr != NULL) {
+            fclose(file_ptr);
+        }
+        return 1;
+    }
+
+    ArgumentList words = {NULL, 0, 0};
+    char *word = NULL;
+    unsigned long length = 0;
+    unsigned long capacity = 0;
+    int in_word = 0;
+    int quote = 0;
+    int status = 0;
+    int chr;
+
+    while (!status) {
+        chr = fgetc(file_ptr);
+
+        // whitespace or the end of file outside quotes ends a word
+        if (chr == EOF || (!quote && (chr == ' ' || chr == '\t' ||
+                                      chr == '\n' || chr == '\r'))) {
+            if (in_word) {
+                word[length] = '\0';
+                if (words.count == words.capacity) {
+                    words.capacity = words.capacity ? words.capacity * 2 : 16;
+                    char **grown = realloc(words.values,
+                                           words.capacity * sizeof(char *));
+                    if (grown == NULL) {
+                        status = 1;
+                        break;
+                    }
+                    words.values = grown;
+                }
+                words.values[words.count++] = word;
+                word = NULL;
+                length = capacity = 0;
+                in_word = 0;
+            }
+            if (chr == EOF) {
+                break;
+            }
+            continue;
+        }
+
+        if (quote ? chr == quote : (chr == '"' || chr == '\'')) {
+            quote = quote ? 0 : chr;
+            in_word = 1;
+        } else {
+            if (chr == '\\' && quote != '\'') {
+                int next = fgetc(file_ptr);
+                chr = next == EOF ? chr : next;
+            }
+            if (length + 2 > capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                char *grown = realloc(word, capacity);
+                if (grown == NULL) {
+                    status = 1;
+                    break;
+                }
+                word = grown;
+            }
+            word[length++] = (char)chr;
+            in_word = 1;
+        }
+    }
+    fclose(file_ptr);
+
+    if (status) {
+        printf("ERROR: response file memory allocation failure "
+               "[ARGUMENT_ALLOCATION_ERROR]\n");
+    } else {
+        status = expandArguments(arguments, words.count, words.values, depth);
+    }
+
+    free(word);
+    for (int i = 0; i < words.count; i++) {
+        free(words.values[i]);
+    }
+    free(words.values);
+    return status;
+}
+
+// append a copy of value to arguments (NULL terminates the list)
+static int appendArgument(ArgumentList *arguments, const char *value,
+                          unsigned long length) {
+    if (arguments->count == arguments->capacity) {
+        int capacity = arguments->capacity ? arguments->capacity * 2 : 16;
+        char **grown = realloc(arguments->values, capacity * sizeof(char *));
+        if (grown == NULL) {
+            printf("ERROR: argument memory allocation failure "
+                   "[ARGUMENT_ALLOCATION_ERROR]\n");
+            return 1;
+        }
+        arguments->values = grown;
+        arguments->capacity = capacity;
+    }
+
+    char *copy = NULL;
+    if (value != NULL) {
+        copy = strndup(value, length);
+        if (copy == NULL) {
+            printf("ERROR: argument memory allocation failure "
+                   "[ARGUMENT_ALLOCATION_ERROR]\n");
+            return 1;
+        }
+    }
+    arguments->values[arguments->count++] = copy;
+    return 0;
+}
@@ -0,0 +1,1149 @@
+// optimize header implementation
+//
+// `optimize.c` runs every pass as one walk over the code that rewrites
+// instructions in place and marks the ones to delete, then optimizeCompact
+// closes the gaps, re-aims jumps and moves function entries. Block-local
+// passes forget what they know at every leader: function entries, jump
+// targets and instructions after jumps and returns. Functions are laid out
+// in order, so function f ends where function f + 1 begins.
+
+#include "optimize.h"
+#include "vm.h" // vmFloorDivide, vmPower, vmTruncate, VM_PORTION_FORMAT
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOADI_MIN (-VM_SBX_BIAS)
+#define LOADI_MAX (VM_SBX_BIAS - 1)
+#define SC_MIN (-VM_SC_BIAS)
+#define SC_MAX (VM_SC_BIAS - 1)
+#define THREAD_HOPS 8   // jumps followed when threading a jump
+#define BRANCH_ROUNDS 8 // branch pass repeats while it changes code
+
+const char *const optimize_pass_names[OPTIMIZE_PASS_COUNT] = {
+    [OPTIMIZE_FOLD] = "fold",
+    [OPTIMIZE_CSE] = "cse",
+    [OPTIMIZE_BRANCHES] = "branches",
+    [OPTIMIZE_DEAD_STORES] = "dead-stores",
+};
+
+typedef struct OptimizerStruct {
+    VmProgram *program;
+    OptimizeStats *stats;
+    uint8_t *removed; // per code word, deleted by the running pass
+    uint8_t *leaders; // per code word, first instruction of a basic block
+    uint32_t *map;    // per code word, scratch of the running pass
+    uint32_t *work;   // instruction indexes, scratch of the running pass
+    int out_of_memory;
+} Optimizer;
+
+// registers of one window
+typedef struct RegisterSetStruct {
+    uint64_t bits[VM_MAX_REGISTERS / 64];
+} RegisterSet;
+
+// expression computed earlier in the current block (cse)
+typedef struct ValueEntryStruct {
+    uint64_t op; // opcode, memory reads carry the epoch above the low byte
+    uint64_t b;
+    uint64_t c;
+    uint64_t number; // value number of the result
+    uint32_t reg;    // register last given the result
+    uint32_t block;  // block of the entry, 0 when free
+} ValueEntry;
+
+typedef enum FoldEnum {
+    FOLD_NONE,
+    FOLD_COUNT,  // result.i, a count, glyph or verdict
+    FOLD_VALUE,  // result.f, a portion or fraction
+    FOLD_STRING, // result.s allocated, owned by the program once loaded
+} Fold;
+
+static void optimizeFold(Optimizer *o);
+static Fold foldInstruction(uint32_t i, const uint8_t *known,
+                            const VmValue *values, VmValue *result);
+static void reduceInstruction(Optimizer *o, uint32_t pc,
+                              const uint8_t *known, const VmValue *values);
+static void optimizeCse(Optimizer *o);
+static ValueEntry *findValue(ValueEntry *entries, uint32_t capacity,
+                             uint32_t block, uint64_t op, uint64_t b,
+                             uint64_t c);
+static int optimizeBranches(Optimizer *o);
+static void optimizeDeadStores(Optimizer *o);
+static RegisterSet liveOut(const Optimizer *o, const RegisterSet *live,
+                           const uint32_t *firsts, uint32_t block,
+                           uint32_t blocks);
+static void transfer(const VmProgram *program, uint32_t pc,
+                     RegisterSet *live);
+static void optimizeCompact(Optimizer *o, OptimizePass pass);
+static void findLeaders(Optimizer *o);
+static int rewriteConstant(Optimizer *o, uint32_t pc, Fold fold,
+                           VmValue value);
+static int immediate(const uint8_t *known, const VmValue *values,
+                     uint32_t reg, int negate, int *value);
+static char *copyText(const char *text, size_t length);
+static int growArray(Optimizer *o, void **array, uint32_t *capacity,
+                     uint32_t count, size_t size);
+static uint32_t functionEnd(const VmProgram *program, uint32_t function);
+static uint32_t instructionWidth(uint32_t i);
+static uint32_t jumpTarget(uint32_t i, uint32_t pc);
+static int aimJump(uint32_t *i, uint32_t pc, uint32_t target);
+static int isJump(uint32_t op);
+static int writesA(uint32_t op);
+static int isPure(uint32_t op);
+static int isValue(uint32_t op);
+static int isCommutative(uint32_t op);
+
+/// PUBLIC FUNCTIONS
+
+// run the passes of level (0 to OPTIMIZE_MAX_LEVEL) over program, adding
+// instructions rewritten and removed by each pass to stats (when non-NULL),
+// running out of memory is printed to out
+int optimizeProgram(VmProgram *program, int level, OptimizeStats *stats,
+                    FILE *out) {
+    OptimizeStats unused = {0};
+    Optimizer optimizer = {.program = program,
+                           .stats = stats != NULL ? stats : &unused};
+    Optimizer *o = &optimizer;
+
+    uint32_t count = program->code_count;
+    for (uint32_t pc = 0; pc < count;
+         pc += instructionWidth(program->code[pc])) {
+        o->stats->instructions++;
+    }
+    if (level <= 0 || count == 0) {
+        return 0;
+    }
+
+    o->removed = calloc(count + 1, 1);
+    o->leaders = calloc(count + 1, 1);
+    o->map = malloc((count + 1) * sizeof(uint32_t));
+    o->work = malloc((count + 1) * sizeof(uint32_t));
+    o->out_of_memory = o->removed == NULL || o->leaders == NULL ||
+                       o->map == NULL || o->work == NULL;
+
+    if (!o->out_of_memory) {
+        optimizeFold(o);
+        optimizeCompact(o, OPTIMIZE_FOLD);
+    }
+    if (!o->out_of_memory && level >= 2) {
+        optimizeCse(o);
+        optimizeCompact(o, OPTIMIZE_CSE);
+    }
+    for (int round = 0; !o->out_of_memory && round < BRANCH_ROUNDS;
+         round++) {
+        int changed = optimizeBranches(o);
+        optimizeCompact(o, OPTIMIZE_BRANCHES);
+        if (!changed) {
+            break;
+        }
+    }
+    if (!o->out_of_memory && level >= 2) {
+        optimizeDeadStores(o);
+        optimizeCompact(o, OPTIMIZE_DEAD_STORES);
+    }
+
+    free(o->removed);
+    free(o->leaders);
+    free(o->map);
+    free(o->work);
+    if (o->out_of_memory) {
+        fprintf(out, "ERROR: optimizer memory allocation failure "
+                     "[OPTIMIZE_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+    return 0;
+}
+
+/// PRIVATE FUNCTIONS
+
+// replace instructions whose operands are known in the block by loads of
+// their result, then known small operands by immediates
+static void optimizeFold(Optimizer *o) {
+    VmProgram *program = o->program;
+    uint32_t *code = program->code;
+    uint8_t known[VM_MAX_REGISTERS] = {0};
+    VmValue values[VM_MAX_REGISTERS] = {{0}};
+
+    findLeaders(o);
+    for (uint32_t pc = 0; pc < program->code_count && !o->out_of_memory;
+         pc += instructionWidth(code[pc])) {
+        if (o->leaders[pc]) {
+            memset(known, 0, sizeof(known));
+        }
+
+        VmValue result;
+        Fold fold = foldInstruction(code[pc], known, values, &result);
+        if (fold == FOLD_NONE || !rewriteConstant(o, pc, fold, result)) {
+            reduceInstruction(o, pc, known, values);
+        }
+
+        // what the instruction leaves in its registers
+        uint32_t i = code[pc];
+        uint32_t a = VM_A(i);
+        switch (VM_OP(i)) {
+        case OP_LOADI:
+            known[a] = 1;
+            values[a].i = VM_SBX(i);
+            break;
+        case OP_LOADK:
+            known[a] = 1;
+            values[a] = program->constants[VM_BX(i)];
+            break;
+        case OP_LOADKX:
+            known[a] = 1;
+            values[a] = program->constants[code[pc + 1]];
+            break;
+        case OP_MOVE:
+            known[a] = known[VM_B(i)];
+            values[a] = values[VM_B(i)];
+            break;
+        case OP_CALL:
+            memset(known + a, 0, VM_MAX_REGISTERS - a);
+            break;
+        default:
+            if (writesA(VM_OP(i))) {
+                known[a] = 0;
+            }
+            break;
+        }
+    }
+}
+
+// result of instruction i when its operands are known, computed the way the
+// loops of vmloop.h compute it. Divisions by zero are left to fail at run
+// time.
+static Fold foldInstruction(uint32_t i, const uint8_t *known,
+                            const VmValue *values, VmValue *result) {
+    uint32_t op = VM_OP(i);
+    uint32_t b = VM_B(i);
+    uint32_t c = VM_C(i);
+    switch ((VmFormat)vm_opcode_formats[op]) {
+    case VM_FORMAT_ABC:
+        if (!known[b] || !known[c]) {
+            return FOLD_NONE;
+        }
+        break;
+    case VM_FORMAT_AB:
+    case VM_FORMAT_ABSC:
+        if (!known[b]) {
+            return FOLD_NONE;
+        }
+        break;
+    default:
+        return FOLD_NONE;
+    }
+
+    int64_t x = values[b].i;
+    int64_t y = values[c].i;
+    double f = values[b].f;
+    double g = values[c].f;
+    const char *s = values[b].s;
+    const char *t = values[c].s;
+    int sc = VM_SC(i);
+    char text[32];
+
+    switch ((VmOpcode)op) {
+    case OP_ADD_I:
+        result->i = (int64_t)((uint64_t)x + (uint64_t)y);
+        break;
+    case OP_SUB_I:
+        result->i = (int64_t)((uint64_t)x - (uint64_t)y);
+        break;
+    case OP_MUL_I:
+        result->i = (int64_t)((uint64_t)x * (uint64_t)y);
+        break;
+    case OP_DIV_I:
+        if (y == 0) {
+            return FOLD_NONE;
+        }
+        result->i = y == -1 ? (int64_t)(0 - (uint64_t)x) : x / y;
+        break;
+    case OP_FLOORDIV_I:
+        if (y == 0) {
+            return FOLD_NONE;
+        }
+        result->i = vmFloorDivide(x, y);
+        break;
+    case OP_MOD_I:
+        if (y == 0) {
+            return FOLD_NONE;
+        }
+        result->i = y == -1 ? 0 : x % y;
+        break;
+    case OP_POW_I:
+        result->i = vmPower(x, y);
+        break;
+    case OP_ADDI:
+        result->i = (int64_t)((uint64_t)x + (uint64_t)(int64_t)sc);
+        break;
+    case OP_ADD_F:
+        result->f = f + g;
+        return FOLD_VALUE;
+    case OP_SUB_F:
+        result->f = f - g;
+        return FOLD_VALUE;
+    case OP_MUL_F:
+        result->f = f * g;
+        return FOLD_VALUE;
+    case OP_DIV_F:
+        result->f = f / g;
+        return FOLD_VALUE;
+    case OP_FLOORDIV_F:
+        result->f = floor(f / g);
+        return FOLD_VALUE;
+    case OP_MOD_F:
+        result->f = fmod(f, g);
+        return FOLD_VALUE;
+    case OP_POW_F:
+        result->f = pow(f, g);
+        return FOLD_VALUE;
+    case OP_NEG_I:
+        result->i = (int64_t)(0 - (uint64_t)x);
+        break;
+    case OP_NEG_F:
+        result->f = -f;
+        return FOLD_VALUE;
+    case OP_NOT:
+        result->i = x == 0;
+        break;
+    case OP_I2F:
+        result->f = (double)x;
+        return FOLD_VALUE;
+    case OP_F2I:
+        result->i = vmTruncate(f);
+        break;
+    case OP_BOOL_I:
+        result->i = x != 0;
+        break;
+    case OP_BOOL_F:
+        result->i = f != 0.0;
+        break;
+    case OP_CHAR_I:
+        result->i = (unsigned char)x;
+        break;
+    case OP_EQ_I:
+        result->i = x == y;
+        break;
+    case OP_NE_I:
+        result->i = x != y;
+        break;
+    case OP_LT_I:
+        result->i = x < y;
+        break;
+    case OP_LE_I:
+        result->i = x <= y;
+        break;
+    case OP_EQI:
+        result->i = x == sc;
+        break;
+    case OP_NEI:
+        result->i = x != sc;
+        break;
+    case OP_LTI:
+        result->i = x < sc;
+        break;
+    case OP_LEI:
+        result->i = x <= sc;
+        break;
+    case OP_GTI:
+        result->i = x > sc;
+        break;
+    case OP_GEI:
+        result->i = x >= sc;
+        break;
+    case OP_EQ_F:
+        result->i = f == g;
+        break;
+    case OP_NE_F:
+        result->i = f != g;
+        break;
+    case OP_LT_F:
+        result->i = f < g;
+        break;
+    case OP_LE_F:
+        result->i = f <= g;
+        break;
+    case OP_EQ_S:
+        result->i = strcmp(s, t) == 0;
+        break;
+    case OP_NE_S:
+        result->i = strcmp(s, t) != 0;
+        break;
+    case OP_LT_S:
+        result->i = strcmp(s, t) < 0;
+        break;
+    case OP_LE_S:
+        result->i = strcmp(s, t) <= 0;
+        break;
+    case OP_GETCHAR:
+        if (y < 0 || memchr(s, '\0', (size_t)y + 1) != NULL) {
+            return FOLD_NONE;
+        }
+        result->i = (unsigned char)s[y];
+        break;
+    case OP_CONCAT: {
+        size_t left_length = strlen(s);
+        size_t right_length = strlen(t);
+        char *joined = malloc(left_length + right_length + 1);
+        if (joined == NULL) {
+            return FOLD_NONE;
+        }
+        memcpy(joined, s, left_length);
+        memcpy(joined + left_length, t, right_length + 1);
+        result->s = joined;
+        return FOLD_STRING;
+    }
+    case OP_TOSTR_I:
+        snprintf(text, sizeof(text), "%" PRId64, x);
+        result->s = copyText(text, strlen(text));
+        return result->s == NULL ? FOLD_NONE : FOLD_STRING;
+    case OP_TOSTR_F:
+        snprintf(text, sizeof(text), VM_PORTION_FORMAT, f);
+        result->s = copyText(text, strlen(text));
+        return result->s == NULL ? FOLD_NONE : FOLD_STRING;
+    case OP_TOSTR_C:
+        text[0] = (char)x;
+        result->s = copyText(text, 1);
+        return result->s == NULL ? FOLD_NONE : FOLD_STRING;
+    case OP_TOSTR_B:
+        // a copy, so every string constant is one of program->strings
+        result->s = copyText(x ? "yay" : "nay", 3);
+        return result->s == NULL ? FOLD_NONE : FOLD_STRING;
+    default:
+        return FOLD_NONE;
+    }
+    return FOLD_COUNT;
+}
+
+// immediate forms of instructions with one small known count operand, and
+// moves of known small values as loads so the source may die
+static void reduceInstruction(Optimizer *o, uint32_t pc,
+                              const uint8_t *known, const VmValue *values) {
+    uint32_t *code = o->program->code;
+    uint32_t i = code[pc];
+    uint32_t a = VM_A(i);
+    uint32_t b = VM_B(i);
+    uint32_t c = VM_C(i);
+    uint32_t reduced = i;
+    int k;
+
+    // comparisons with the constant on the left turn around
+    switch (VM_OP(i)) {
+    case OP_MOVE:
+        if (known[b] && values[b].i >= LOADI_MIN && values[b].i <= LOADI_MAX) {
+            reduced = VM_ABX(OP_LOADI, a, values[b].i + VM_SBX_BIAS);
+        }
+        break;
+    case OP_ADD_I:
+        if (immediate(known, values, c, 0, &k)) {
+            reduced = VM_ABC(OP_ADDI, a, b, k + VM_SC_BIAS);
+        } else if (immediate(known, values, b, 0, &k)) {
+            reduced = VM_ABC(OP_ADDI, a, c, k + VM_SC_BIAS);
+        }
+        break;
+    case OP_SUB_I:
+        if (immediate(known, values, c, 1, &k)) {
+            reduced = VM_ABC(OP_ADDI, a, b, k + VM_SC_BIAS);
+        }
+        break;
+    case OP_ADDI:
+        if (VM_SC(i) == 0 && a == b) {
+            o->removed[pc] = 1;
+        } else if (VM_SC(i) == 0) {
+            reduced = VM_ABC(OP_MOVE, a, b, 0);
+        }
+        break;
+    case OP_EQ_I:
+        if (immediate(known, values, c, 0, &k)) {
+            reduced = VM_ABC(OP_EQI, a, b, k + VM_SC_BIAS);
+        } else if (immediate(known, values, b, 0, &k)) {
+            reduced = VM_ABC(OP_EQI, a, c, k + VM_SC_BIAS);
+        }
+        break;
+    case OP_NE_I:
+        if (immediate(known, values, c, 0, &k)) {
+            reduced = VM_ABC(OP_NEI, a, b, k + VM_SC_BIAS);
+        } else if (immediate(known, values, b, 0, &k)) {
+            reduced = VM_ABC(OP_NEI, a, c, k + VM_SC_BIAS);
+        }
+        break;
+    case OP_LT_I:
+        if (immediate(known, values, c, 0, &k)) {
+            reduced = VM_ABC(OP_LTI, a, b, k + VM_SC_BIAS);
+        } else if (immediate(known, values, b, 0, &k)) {
+            reduced = VM_ABC(OP_GTI, a, c, k + VM_SC_BIAS);
+        }
+        break;
+    case OP_LE_I:
+        if (immediate(known, values, c, 0, &k)) {
+            reduced = VM_ABC(OP_LEI, a, b, k + VM_SC_BIAS);
+        } else if (immediate(known, values, b, 0, &k)) {
+            reduced = VM_ABC(OP_GEI, a, c, k + VM_SC_BIAS);
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (reduced != i || o->removed[pc]) {
+        code[pc] = reduced;
+        o->stats->rewritten[OPTIMIZE_FOLD] += !o->removed[pc];
+    }
+}
+
+// local value numbering: an expression over the same value numbers as an
+// earlier one in the block becomes a move from the register holding it, or
+// goes when its register already does. Array and global reads are keyed by
+// an epoch that stores and calls advance.
+static void optimizeCse(Optimizer *o) {
+    VmProgram *program = o->program;
+    uint32_t *code = program->code;
+    uint64_t numbers[VM_MAX_REGISTERS];
+    uint64_t next_number = 0;
+    uint64_t epoch = 0;
+    uint32_t block = 0;
+
+    // a block adds at most one entry per instruction, half stay free
+    uint32_t capacity = 16;
+    while (capacity < program->code_count * 2) {
+        capacity *= 2;
+    }
+    ValueEntry *entries = calloc(capacity, sizeof(ValueEntry));
+    if (entries == NULL) {
+        o->out_of_memory = 1;
+        return;
+    }
+
+    findLeaders(o);
+    for (uint32_t pc = 0; pc < program->code_count;
+         pc += instructionWidth(code[pc])) {
+        if (o->leaders[pc]) {
+            block++;
+            for (uint32_t r = 0; r < VM_MAX_REGISTERS; r++) {
+                numbers[r] = ++next_number;
+            }
+        }
+
+        uint32_t i = code[pc];
+        uint32_t op = VM_OP(i);
+        uint32_t a = VM_A(i);
+        uint32_t b = VM_B(i);
+        uint64_t key_op = op;
+        uint64_t key_b = 0;
+        uint64_t key_c = 0;
+        switch (op) {
+        case OP_LOADI:
+        case OP_LOADK:
+            key_b = VM_BX(i);
+            break;
+        case OP_LOADKX:
+            key_b = code[pc + 1];
+            break;
+        case OP_MOVE:
+            if (numbers[a] == numbers[b]) {
+                o->removed[pc] = 1;
+            }
+            numbers[a] = numbers[b];
+            continue;
+        case OP_GETGLOBAL:
+            key_op |= epoch << 8;
+            key_b = VM_BX(i);
+            break;
+        case OP_SETGLOBAL:
+            key_op = OP_GETGLOBAL | epoch << 8;
+            *findValue(entries, capacity, block, key_op, VM_BX(i), 0) =
+                (ValueEntry){key_op, VM_BX(i), 0, numbers[a], a, block};
+            continue;
+        case OP_SETINDEX:
+            epoch++;
+            continue;
+        case OP_CALL:
+            epoch++;
+            for (uint32_t r = a; r < VM_MAX_REGISTERS; r++) {
+                numbers[r] = ++next_number;
+            }
+            continue;
+        default:
+            if (!isValue(op)) {
+                if (writesA(op)) {
+                    numbers[a] = ++next_number;
+                }
+                continue;
+            }
+            if (op == OP_GETINDEX) {
+                key_op |= epoch << 8;
+            }
+            key_b = numbers[b];
+            if (vm_opcode_formats[op] == VM_FORMAT_ABC) {
+                key_c = numbers[VM_C(i)];
+            } else if (vm_opcode_formats[op] == VM_FORMAT_ABSC) {
+                key_c = VM_C(i);
+            }
+            if (isCommutative(op) && key_b > key_c) {
+                uint64_t swap = key_b;
+                key_b = key_c;
+                key_c = swap;
+            }
+            break;
+        }
+
+        ValueEntry *entry =
+            findValue(entries, capacity, block, key_op, key_b, key_c);
+        if (entry->block != block) {
+            numbers[a] = ++next_number;
+            *entry = (ValueEntry){key_op, key_b, key_c, numbers[a], a, block};
+            continue;
+        }
+
+        // loads are as cheap as moves, only redundant ones go
+        int load = op == OP_LOADI || op == OP_LOADK || op == OP_LOADKX;
+        if (numbers[a] == entry->number) {
+            o->removed[pc] = 1;
+        } else if (!load && numbers[entry->reg] == entry->number) {
+            code[pc] = VM_ABC(OP_MOVE, a, entry->reg, 0);
+            o->stats->rewritten[OPTIMIZE_CSE]++;
+        } else {
+            entry->reg = a;
+        }
+        numbers[a] = entry->number;
+    }
+    free(entries);
+}
+
+// entry of the key in block, or the free slot for it
+static ValueEntry *findValue(ValueEntry *entries, uint32_t capacity,
+                             uint32_t block, uint64_t op, uint64_t b,
+                             uint64_t c) {
+    uint64_t hash = (op * 0x9e3779b97f4a7c15u) ^ (b * 0xc2b2ae3d27d4eb4fu) ^
+                    (c * 0x165667b19e3779f9u);
+    uint32_t mask = capacity - 1;
+    uint32_t index = (uint32_t)(hash ^ hash >> 32) & mask;
+    while (entries[index].block == block &&
+           (entries[index].op != op || entries[index].b != b ||
+            entries[index].c != c)) {
+        index = (index + 1) & mask;
+    }
+    return &entries[index];
+}
+
+// settle conditional jumps on values loaded in the block, thread jumps to
+// jumps, drop code no path reaches and jumps to the next instruction.
+// Returns whether anything changed.
+static int optimizeBranches(Optimizer *o) {
+    VmProgram *program = o->program;
+    uint32_t *code = program->code;
+    uint8_t known[VM_MAX_REGISTERS] = {0};
+    int64_t values[VM_MAX_REGISTERS] = {0};
+    int changed = 0;
+
+    findLeaders(o);
+    for (uint32_t pc = 0; pc < program->code_count;
+         pc += instructionWidth(code[pc])) {
+        if (o->leaders[pc]) {
+            memset(known, 0, sizeof(known));
+        }
+
+        uint32_t i = code[pc];
+        uint32_t op = VM_OP(i);
+        uint32_t a = VM_A(i);
+        if (isJump(op)) {
+            uint32_t target = jumpTarget(i, pc);
+            for (int hop = 0;
+                 hop < THREAD_HOPS && VM_OP(code[target]) == OP_JMP; hop++) {
+                target = jumpTarget(code[target], target);
+            }
+
+            // a settled jump keeps its target when the threaded one is far
+            uint32_t aimed = i;
+            if (op != OP_JMP && known[a]) {
+                if ((op == OP_JMPT) == (values[a] != 0)) {
+                    aimed = VM_AX(OP_JMP, VM_SAX_BIAS);
+                } else {
+                    o->removed[pc] = 1;
+                }
+            }
+            if (!o->removed[pc] && !aimJump(&aimed, pc, target) &&
+                !aimJump(&aimed, pc, jumpTarget(i, pc))) {
+                aimed = i;
+            }
+            i = aimed;
+            if (o->removed[pc] || i != code[pc]) {
+                o->stats->rewritten[OPTIMIZE_BRANCHES] += !o->removed[pc];
+                code[pc] = i;
+                changed = 1;
+            }
+        }
+
+        if (op == OP_LOADI) {
+            known[a] = 1;
+            values[a] = VM_SBX(i);
+        } else if (op == OP_CALL) {
+            memset(known + a, 0, VM_MAX_REGISTERS - a);
+        } else if (writesA(op)) {
+            known[a] = 0;
+        }
+    }
+
+    // reachable instructions from each function entry, map as flags
+    for (uint32_t f = 0; f < program->function_count; f++) {
+        uint32_t start = program->functions[f].entry;
+        uint32_t end = functionEnd(program, f);
+        memset(o->map + start, 0, (end - start) * sizeof(uint32_t));
+
+        uint32_t count = 0;
+        o->work[count++] = start;
+        o->map[start] = 1;
+        while (count > 0) {
+            uint32_t pc = o->work[--count];
+            uint32_t i = code[pc];
+            uint32_t op = VM_OP(i);
+            uint32_t next[2];
+            uint32_t next_count = 0;
+            if (o->removed[pc] ||
+                (op != OP_JMP && op != OP_RET && op != OP_RET0)) {
+                next[next_count++] = pc + instructionWidth(i);
+            }
+            if (!o->removed[pc] && isJump(op)) {
+                next[next_count++] = jumpTarget(i, pc);
+            }
+            for (uint32_t n = 0; n < next_count; n++) {
+                if (next[n] < end && !o->map[next[n]]) {
+                    o->map[next[n]] = 1;
+                    o->work[count++] = next[n];
+                }
+            }
+        }
+
+        for (uint32_t pc = start; pc < end; pc += instructionWidth(code[pc])) {
+            if (!o->map[pc] && !o->removed[pc]) {
+                o->removed[pc] = 1;
+                changed = 1;
+            }
+        }
+    }
+
+    // jumps over nothing but removed code
+    for (uint32_t pc = 0; pc < program->code_count;
+         pc += instructionWidth(code[pc])) {
+        uint32_t i = code[pc];
+        if (o->removed[pc] || !isJump(VM_OP(i))) {
+            continue;
+        }
+        uint32_t target = jumpTarget(i, pc);
+        uint32_t next = pc + 1;
+        while (next < target && o->removed[next]) {
+            next += instructionWidth(code[next]);
+        }
+        if (next == target) {
+            o->removed[pc] = 1;
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+// liveness of registers over the blocks of each function, then pure
+// instructions writing a register no later instruction reads are removed
+static void optimizeDeadStores(Optimizer *o) {
+    VmProgram *program = o->program;
+    uint32_t *code = program->code;
+    RegisterSet *live = malloc((program->code_count + 1) * sizeof(RegisterSet));
+    uint32_t *firsts = malloc((program->code_count + 1) * sizeof(uint32_t));
+    if (live == NULL || firsts == NULL) {
+        free(live);
+        free(firsts);
+        o->out_of_memory = 1;
+        return;
+    }
+
+    // work lists the function's instructions, firsts the index in work of
+    // each block's first one and map the block of each leader
+    findLeaders(o);
+    for (uint32_t f = 0; f < program->function_count; f++) {
+        uint32_t end = functionEnd(program, f);
+        uint32_t count = 0;
+        uint32_t blocks = 0;
+        for (uint32_t pc = program->functions[f].entry; pc < end;
+             pc += instructionWidth(code[pc])) {
+            if (o->leaders[pc]) {
+                o->map[pc] = blocks;
+                firsts[blocks++] = count;
+            }
+            o->work[count++] = pc;
+        }
+        firsts[blocks] = count;
+        memset(live, 0, blocks * sizeof(RegisterSet));
+
+        // registers live at each block's start, grown to a fixed point
+        int changed = 1;
+        while (changed) {
+            changed = 0;
+            for (uint32_t b = blocks; b-- > 0;) {
+                RegisterSet set = liveOut(o, live, firsts, b, blocks);
+                for (uint32_t n = firsts[b + 1]; n-- > firsts[b];) {
+                    transfer(program, o->work[n], &set);
+                }
+                if (memcmp(&set, &live[b], sizeof(RegisterSet)) != 0) {
+                    live[b] = set;
+                    changed = 1;
+                }
+            }
+        }
+
+        for (uint32_t b = 0; b < blocks; b++) {
+            RegisterSet set = liveOut(o, live, firsts, b, blocks);
+            for (uint32_t n = firsts[b + 1]; n-- > firsts[b];) {
+                uint32_t pc = o->work[n];
+                uint32_t op = VM_OP(code[pc]);
+                uint32_t a = VM_A(code[pc]);
+                if (writesA(op) && isPure(op) &&
+                    !(set.bits[a / 64] >> (a % 64) & 1)) {
+                    o->removed[pc] = 1;
+                } else {
+                    transfer(program, pc, &set);
+                }
+            }
+        }
+    }
+    free(live);
+    free(firsts);
+}
+
+// registers live after the last instruction of block
+static RegisterSet liveOut(const Optimizer *o, const RegisterSet *live,
+                           const uint32_t *firsts, uint32_t block,
+                           uint32_t blocks) {
+    uint32_t pc = o->work[firsts[block + 1] - 1];
+    uint32_t i = o->program->code[pc];
+    uint32_t op = VM_OP(i);
+
+    uint32_t successors[2];
+    uint32_t count = 0;
+    if (op != OP_JMP && op != OP_RET && op != OP_RET0 && block + 1 < blocks) {
+        successors[count++] = block + 1;
+    }
+    if (isJump(op)) {
+        successors[count++] = o->map[jumpTarget(i, pc)];
+    }
+
+    RegisterSet set = {{0}};
+    for (uint32_t s = 0; s < count; s++) {
+        for (uint32_t w = 0; w < VM_MAX_REGISTERS / 64; w++) {
+            set.bits[w] |= live[successors[s]].bits[w];
+        }
+    }
+    return set;
+}
+
+// registers live before the instruction at pc, given those live after it
+static void transfer(const VmProgram *program, uint32_t pc,
+                     RegisterSet *live) {
+    uint32_t i = program->code[pc];
+    uint32_t op = VM_OP(i);
+    uint32_t a = VM_A(i);
+    uint32_t uses[3];
+    uint32_t count = 0;
+
+    switch ((VmFormat)vm_opcode_formats[op]) {
+    case VM_FORMAT_AB:
+    case VM_FORMAT_ABSC:
+        uses[count++] = VM_B(i);
+        break;
+    case VM_FORMAT_ABC:
+        uses[count++] = VM_B(i);
+        uses[count++] = VM_C(i);
+        break;
+    default:
+        break;
+    }
+    if (op != OP_PRINTK && !writesA(op) &&
+        vm_opcode_formats[op] != VM_FORMAT_NONE &&
+        vm_opcode_formats[op] != VM_FORMAT_SAX) {
+        uses[count++] = a;
+    }
+
+    if (writesA(op)) {
+        live->bits[a / 64] &= ~(UINT64_C(1) << (a % 64));
+    }
+    for (uint32_t u = 0; u < count; u++) {
+        live->bits[uses[u] / 64] |= UINT64_C(1) << (uses[u] % 64);
+    }
+
+    // arguments fill the registers above the result
+    if (op == OP_CALL) {
+        uint32_t params = program->functions[VM_BX(i)].params;
+        for (uint32_t r = a + 1; r <= a + params && r < VM_MAX_REGISTERS;
+             r++) {
+            live->bits[r / 64] |= UINT64_C(1) << (r % 64);
+        }
+    }
+}
+
+// delete the instructions marked removed, counting them for pass
+static void optimizeCompact(Optimizer *o, OptimizePass pass) {
+    VmProgram *program = o->program;
+    uint32_t *code = program->code;
+    uint32_t count = 0;
+    unsigned long removed = 0;
+
+    // removed instructions map to the next kept one
+    for (uint32_t pc = 0; pc < program->code_count;) {
+        uint32_t width = instructionWidth(code[pc]);
+        for (uint32_t w = 0; w < width; w++) {
+            o->map[pc + w] = count + (o->removed[pc] ? 0 : w);
+        }
+        if (o->removed[pc]) {
+            removed++;
+        } else {
+            count += width;
+        }
+        pc += width;
+    }
+    o->map[program->code_count] = count;
+    o->stats->removed[pass] += removed;
+    if (removed == 0) {
+        return;
+    }
+
+    // kept instructions only move down, jumps get shorter
+    for (uint32_t pc = 0; pc < program->code_count;) {
+        uint32_t i = code[pc];
+        uint32_t width = instructionWidth(i);
+        if (!o->removed[pc]) {
+            uint32_t at = o->map[pc];
+            if (isJump(VM_OP(i))) {
+                aimJump(&i, at, o->map[jumpTarget(i, pc)]);
+            }
+            code[at] = i;
+            program->code_tokens[at] = program->code_tokens[pc];
+            if (width == 2) {
+                code[at + 1] = code[pc + 1];
+                program->code_tokens[at + 1] = program->code_tokens[pc + 1];
+            }
+        }
+        o->removed[pc] = 0;
+        pc += width;
+    }
+    for (uint32_t f = 0; f < program->function_count; f++) {
+        program->functions[f].entry = o->map[program->functions[f].entry];
+    }
+    program->code_count = count;
+}
+
+// mark function entries, jump targets and instructions after jumps and
+// returns
+static void findLeaders(Optimizer *o) {
+    const VmProgram *program = o->program;
+    memset(o->leaders, 0, program->code_count + 1);
+    for (uint32_t f = 0; f < program->function_count; f++) {
+        o->leaders[program->functions[f].entry] = 1;
+    }
+    for (uint32_t pc = 0; pc < program->code_count;
+         pc += instructionWidth(program->code[pc])) {
+        uint32_t i = program->code[pc];
+        uint32_t op = VM_OP(i);
+        if (isJump(op)) {
+            o->leaders[jumpTarget(i, pc)] = 1;
+        }
+        if (isJump(op) || op == OP_RET || op == OP_RET0) {
+            o->leaders[pc + 1] = 1;
+        }
+    }
+}
+
+// load the folded value into the instruction's register, 0 when it keeps
+// the instruction (constant table full or out of memory)
+static int rewriteConstant(Optimizer *o, uint32_t pc, Fold fold,
+                           VmValue value) {
+    VmProgram *program = o->program;
+    uint32_t a = VM_A(program->code[pc]);
+    if (fold == FOLD_COUNT && value.i >= LOADI_MIN && value.i <= LOADI_MAX) {
+        program->code[pc] = VM_ABX(OP_LOADI, a, value.i + VM_SBX_BIAS);
+        o->stats->rewritten[OPTIMIZE_FOLD]++;
+        return 1;
+    }
+
+    // the program frees folded strings with the ones it compiled
+    if (fold == FOLD_STRING) {
+        if (growArray(o, (void **)&program->strings,
+                      &program->string_capacity, program->string_count,
+                      sizeof(char *))) {
+            free((char *)value.s);
+            return 0;
+        }
+        program->strings[program->string_count++] = (char *)value.s;
+    }
+    if (program->constant_count > UINT16_MAX ||
+        growArray(o, (void **)&program->constants,
+                  &program->constant_capacity, program->constant_count,
+                  sizeof(VmValue))) {
+        return 0;
+    }
+    program->constants[program->constant_count] = value;
+    program->code[pc] = VM_ABX(OP_LOADK, a, program->constant_count++);
+    o->stats->rewritten[OPTIMIZE_FOLD]++;
+    return 1;
+}
+
+// known count of reg (negated) within the sC range
+static int immediate(const uint8_t *known, const VmValue *values,
+                     uint32_t reg, int negate, int *value) {
+    if (!known[reg]) {
+        return 0;
+    }
+    int64_t v = values[reg].i;
+    if (negate ? v < -SC_MAX || v > -SC_MIN : v < SC_MIN || v > SC_MAX) {
+        return 0;
+    }
+    *value = (int)(negate ? -v : v);
+    return 1;
+}
+
+static char *copyText(const char *text, size_t length) {
+    char *copy = malloc(length + 1);
+    if (copy != NULL) {
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+// make room for one more element after count, doubling the capacity
+static int growArray(Optimizer *o, void **array, uint32_t *capacity,
+                     uint32_t count, size_t size) {
+    if (count < *capacity) {
+        return 0;
+    }
+    uint32_t grown = *capacity ? *capacity * 2 : 16;
+    void *resized = grown > *capacity ? realloc(*array, grown * size) : NULL;
+    if (resized == NULL) {
+        o->out_of_memory = 1;
+        return 1;
+    }
+    *array = resized;
+    *capacity = grown;
+    return 0;
+}
+
+static uint32_t functionEnd(const VmProgram *program, uint32_t function) {
+    return function + 1 < program->function_count
+               ? program->functions[function + 1].entry
+               : program->code_count;
+}
+
+// LOADKX takes its constant index from the next word
+static uint32_t instructionWidth(uint32_t i) {
+    return VM_OP(i) == OP_LOADKX ? 2 : 1;
+}
+
+static uint32_t jumpTarget(uint32_t i, uint32_t pc) {
+    return pc + 1 + (VM_OP(i) == OP_JMP ? VM_SAX(i) : VM_SBX(i));
+}
+
+// point the jump i at pc to target, 0 when the offset does not fit
+static int aimJump(uint32_t *i, uint32_t pc, uint32_t target) {
+    int64_t offset = (int64_t)target - (int64_t)pc - 1;
+    if (VM_OP(*i) == OP_JMP) {
+        if (offset < -VM_SAX_BIAS || offset >= VM_SAX_BIAS) {
+            return 0;
+        }
+        *i = VM_AX(OP_JMP, offset + VM_SAX_BIAS);
+    } else {
+        if (offset < -VM_SBX_BIAS || offset >= VM_SBX_BIAS) {
+            return 0;
+        }
+        *i = VM_ABX(VM_OP(*i), VM_A(*i), offset + VM_SBX_BIAS);
+    }
+    return 1;
+}
+
+static int isJump(uint32_t op) {
+    return op == OP_JMP || op == OP_JMPF || op == OP_JMPT;
+}
+
+// instructions that leave R[A] holding a new value
+static int writesA(uint32_t op) {
+    switch (op) {
+    case OP_SETGLOBAL:
+    case OP_JMP:
+    case OP_JMPF:
+    case OP_JMPT:
+    case OP_RET:
+    case OP_RET0:
+    case OP_SETINDEX:
+    case OP_PRINT_I:
+    case OP_PRINT_F:
+    case OP_PRINT_C:
+    case OP_PRINT_B:
+    case OP_PRINT_S:
+    case OP_PRINTK:
+    case OP_PRINTNL:
+        return 0;
+    default:
+        return 1;
+    }
+}
+
+// instructions with no effect but R[A] that cannot fail, removable when
+// R[A] is never read (string building may only run out of memory)
+static int isPure(uint32_t op) {
+    switch (op) {
+    case OP_DIV_I:
+    case OP_FLOORDIV_I:
+    case OP_MOD_I:
+    case OP_CALL:
+    case OP_NEWARRAY:
+    case OP_GETINDEX:
+    case OP_GETCHAR:
+    case OP_READ_I:
+    case OP_READ_F:
+    case OP_READ_C:
+    case OP_READ_B:
+    case OP_READ_S:
+        return 0;
+    default:
+        return writesA(op);
+    }
+}
+
+// instructions cse may key by operator and operands
+static int isValue(uint32_t op) {
+    switch (op) {
+    case OP_MOVE:
+    case OP_LOADI:
+    case OP_LOADK:
+    case OP_LOADKX:
+    case OP_GETGLOBAL:
+        return 0;
+    case OP_DIV_I:
+    case OP_FLOORDIV_I:
+    case OP_MOD_I:
+    case OP_GETINDEX:
+    case OP_GETCHAR:
+        return 1;
+    default:
+        return isPure(op);
+    }
+}
+
+static int isCommutative(uint32_t op) {
+    switch (op) {
+    case OP_ADD_I:
+    case OP_MUL_I:
+    case OP_EQ_I:
+    case OP_NE_I:
+    case OP_ADD_F:
+    case OP_MUL_F:
+    case OP_EQ_F:
+    case OP_NE_F:
+    case OP_EQ_S:
+    case OP_NE_S:
+        return 1;
+    default:
+        return 0;
+    }
+}
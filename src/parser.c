@@ -0,0 +1,786 @@
+// parser header implementation
+//
+// `parser.c` descends one function per grammar rule over the token buffer:
+//
+//   program    = { function | statement } EOF
+//   function   = "define" type name "(" [ param { "," param } ] ")" block
+//   param      = type name [ "[" "]" ]
+//   statement  = "maketh" type name [ "[" [ expr ] "]" ] [ "=" expr ] ";"
+//              | "if" "(" expr ")" block [ "else" ( if | block ) ]
+//              | "rehearse" "(" expr ")" block
+//              | "switch" "(" expr ")" "{" { case } "}"
+//              | ( "cease" | "persist" ) [ name ] ";" | "thither" name ";"
+//              | "returneth" [ expr ] ";" | name ":" statement
+//              | block | [ expr ] ";"
+//   case       = "case" ( "*" | expr ) ":" { statement }
+//   expr       = binary [ assign-op expr ]
+//   binary     = unary { binary-op unary }     by precedence, '**' right
+//   unary      = ( "!" | "-" | "+" | "++" | "--" | "&" ) unary | postfix
+//   postfix    = primary { "(" [ expr { "," expr } ] ")" | "[" expr "]"
+//                        | "++" | "--" }
+//
+// Nodes of a list are pushed on a scratch stack while they are parsed and
+// copied into the tree's extra array once the list is complete, so nested
+// lists never interleave. A failed rule sets panic and returns 0, the
+// statement list it is in skips to the next statement and clears it.
+
+#include "parser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct ParserStruct {
+    Lexer *lexer;
+    const TokenBuffer *tokens;
+    const char *filename;
+    FILE *out;
+    Ast *ast;
+    uint32_t current;    // token index
+    uint32_t *scratch;   // nodes of unfinished lists
+    uint32_t scratch_count;
+    unsigned int depth;  // nesting of statements and expressions
+    int panic;           // error reported, skipping to the next statement
+    int status;
+} Parser;
+
+// binding power of binary operators, 0 for other tokens
+static const uint8_t binary_precedence[TK_TYPE_COUNT] = {
+    [TK_OR] = 1,       [TK_AND] = 2,      [TK_EQUAL] = 3,
+    [TK_NOTEQUAL] = 3, [TK_LT] = 4,       [TK_LEQUAL] = 4,
+    [TK_GT] = 4,       [TK_GEQUAL] = 4,   [TK_PLUS] = 5,
+    [TK_MINUS] = 5,    [TK_ASTERISK] = 6, [TK_SLASH] = 6,
+    [TK_FLOORDIV] = 6, [TK_MODULO] = 6,   [TK_EXPONENT] = 7,
+};
+
+static uint32_t parseFunction(Parser *parser);
+static uint32_t parseStatement(Parser *parser);
+static uint32_t parseStatementList(Parser *parser, int in_case,
+                                   uint32_t *end);
+static uint32_t parseBlock(Parser *parser);
+static uint32_t parseVarDecl(Parser *parser);
+static uint32_t parseIf(Parser *parser);
+static uint32_t parseSwitch(Parser *parser);
+static uint32_t parseCase(Parser *parser);
+static uint32_t parseJump(Parser *parser, AstKind kind);
+static uint32_t parseExpression(Parser *parser);
+static uint32_t parseBinary(Parser *parser, int min_precedence);
+static uint32_t parseUnary(Parser *parser);
+static uint32_t parsePostfix(Parser *parser);
+static uint32_t parsePrimary(Parser *parser);
+static uint32_t parseCondition(Parser *parser);
+static uint32_t parserAddNode(Parser *parser, AstKind kind, uint32_t token,
+                              uint32_t lhs, uint32_t rhs);
+static uint32_t parserAddRange(Parser *parser, uint32_t scratch_start,
+                               uint32_t *end);
+static uint32_t parserAddPair(Parser *parser, uint32_t first,
+                              uint32_t second);
+static void parserPush(Parser *parser, uint32_t node);
+static int parserEnter(Parser *parser);
+static TokenType parserPeek(const Parser *parser, uint32_t n);
+static uint32_t parserAdvance(Parser *parser);
+static int parserExpect(Parser *parser, TokenType type, const char *what);
+static int parserExpectType(Parser *parser);
+static void parserSynchronize(Parser *parser, uint32_t start);
+static void parserError(Parser *parser, const char *message,
+                        const char *code);
+
+/// PUBLIC FUNCTIONS
+
+// parse the tokens of lexer's resident contents into ast, printing syntax
+// errors to out. ast holds the statements parsed even on failure and is
+// freed with astCleanup either way.
+int parseTokens(Lexer *lexer, const TokenBuffer *tokens, const char *filename,
+                FILE *out, Ast *ast) {
+    if (astInit(ast, tokens, out)) {
+        return 1;
+    }
+    if (tokens->count == 0 || tokens->types[tokens->count - 1] != TK_EOF) {
+        fprintf(out, "ERROR: token buffer does not end in TK_EOF "
+                     "[PARSE_INPUT_ERROR]\n");
+        return 1;
+    }
+
+    Parser parser = {.lexer = lexer,
+                     .tokens = tokens,
+                     .filename = filename,
+                     .out = out,
+                     .ast = ast};
+    parser.scratch = malloc(ast->node_capacity * sizeof(uint32_t));
+    if (parser.scratch == NULL) {
+        fprintf(out, "ERROR: parser memory allocation failure "
+                     "[PARSE_ALLOCATION_ERROR]\n");
+        return 1;
+    }
+
+    // top level functions and statements
+    while (parserPeek(&parser, 0) != TK_EOF) {
+        uint32_t start = parser.current;
+        uint32_t node = parserPeek(&parser, 0) == TK_FUNCTION
+                            ? parseFunction(&parser)
+                            : parseStatement(&parser);
+        if (parser.panic) {
+            parserSynchronize(&parser, start);
+            // a stray '}' stops synchronizing but closes nothing here
+            if (parserPeek(&parser, 0) == TK_RCURLY) {
+                parserAdvance(&parser);
+            }
+        } else {
+            parserPush(&parser, node);
+        }
+    }
+
+    uint32_t end;
+    uint32_t start = parserAddRange(&parser, 0, &end);
+    ast->lhs[0] = start;
+    ast->rhs[0] = end;
+
+    free(parser.scratch);
+    return parser.status;
+}
+
+// report an error at token index with the line of source it is on to the
+// diagnostics of lexer (or straight to out without any), nothing at tokens
+// with lexical errors (lexerErrorHandler reported those)
+void parseReportError(Lexer *lexer, const TokenBuffer *tokens, uint32_t index,
+                      const char *filename, FILE *out, const char *message,
+                      const char *code) {
+    TokenType type = (TokenType)tokens->types[index];
+    if (type < TK_EOF) {
+        return;
+    }
+
+    Diagnostics single;
+    Diagnostics *diagnostics = lexer->diagnostics;
+    if (diagnostics == NULL) {
+        diagnosticsInit(&single, filename, DIAG_HUMAN, 0, out);
+        diagnostics = &single;
+    }
+
+    // errors past the limit are only counted, not located
+    unsigned long begin = tokens->begins[index];
+    DiagSite site = {.code = code};
+    if (diagnosticsFull(diagnostics)) {
+        diagnosticsReport(diagnostics, &site, "%s", "");
+    } else if (!lexerGetPosition(lexer, begin, &site.line, &site.column,
+                                 diagnostics->out)) {
+        site.offset = begin;
+        site.length = tokens->starts[index] + tokens->lengths[index] - begin;
+        site.marker_carets = 1;
+
+        // the source line holding the token
+        site.source = lexer->contents + begin - (site.column - 1);
+        site.source_length = site.column - 1;
+        while (begin + site.source_length - (site.column - 1) <
+                   lexer->content_length &&
+               site.source[site.source_length] != '\n') {
+            site.source_length++;
+        }
+
+        if (type == TK_EOF) {
+            diagnosticsReport(diagnostics, &site, "%s, found end of file",
+                              message);
+        } else {
+            Token tok = {.type = type,
+                         .start = tokens->starts[index],
+                         .length = tokens->lengths[index]};
+            diagnosticsReport(diagnostics, &site, "%s, found '%.*s'",
+                              message, (int)tok.length,
+                              lexerGetLexeme(lexer, &tok));
+        }
+    }
+
+    if (diagnostics == &single) {
+        diagnosticsFinish(&single);
+    }
+}
+
+/// PRIVATE FUNCTIONS
+
+static uint32_t parseFunction(Parser *parser) {
+    uint32_t define = parserAdvance(parser);
+    if (parserExpectType(parser) ||
+        parserExpect(parser, TK_IDENTIFIER, "function name") ||
+        parserExpect(parser, TK_LPAREN, "'('")) {
+        return 0;
+    }
+
+    uint32_t scratch_start = parser->scratch_count;
+    while (parserPeek(parser, 0) != TK_RPAREN) {
+        if (parser->scratch_count > scratch_start &&
+            parserExpect(parser, TK_COMMA, "',' or ')'")) {
+            break;
+        }
+        if (parserExpectType(parser)) {
+            break;
+        }
+        uint32_t name = parser->current;
+        if (parserExpect(parser, TK_IDENTIFIER, "parameter name")) {
+            break;
+        }
+        if (parserPeek(parser, 0) == TK_LBRACKET) {
+            parserAdvance(parser);
+            if (parserExpect(parser, TK_RBRACKET, "']'")) {
+                break;
+            }
+        }
+        parserPush(parser, parserAddNode(parser, AST_PARAM, name, 0, 0));
+    }
+    if (parser->panic) {
+        parser->scratch_count = scratch_start;
+        return 0;
+    }
+    parserAdvance(parser);
+
+    uint32_t params_end;
+    uint32_t params_start = parserAddRange(parser, scratch_start, &params_end);
+    uint32_t body = parseBlock(parser);
+    if (parser->panic) {
+        return 0;
+    }
+    return parserAddNode(parser, AST_FUNCTION, define,
+                         parserAddPair(parser, params_start, params_end),
+                         body);
+}
+
+static uint32_t parseStatement(Parser *parser) {
+    if (parserEnter(parser)) {
+        return 0;
+    }
+
+    uint32_t node = 0;
+    switch (parserPeek(parser, 0)) {
+    case TK_LET:
+        node = parseVarDecl(parser);
+        break;
+    case TK_IF:
+        node = parseIf(parser);
+        break;
+    case TK_WHILE: {
+        uint32_t keyword = parserAdvance(parser);
+        uint32_t condition = parseCondition(parser);
+        uint32_t body = parser->panic ? 0 : parseBlock(parser);
+        node = parserAddNode(parser, AST_WHILE, keyword, condition, body);
+        break;
+    }
+    case TK_SWITCH:
+        node = parseSwitch(parser);
+        break;
+    case TK_BREAK:
+        node = parseJump(parser, AST_BREAK);
+        break;
+    case TK_CONTINUE:
+        node = parseJump(parser, AST_CONTINUE);
+        break;
+    case TK_GOTO:
+        node = parseJump(parser, AST_GOTO);
+        break;
+    case TK_RETURN: {
+        uint32_t keyword = parserAdvance(parser);
+        uint32_t value = 0;
+        if (parserPeek(parser, 0) != TK_SEMICOLON) {
+            value = parseExpression(parser);
+        }
+        if (!parser->panic && !parserExpect(parser, TK_SEMICOLON, "';'")) {
+            node = parserAddNode(parser, AST_RETURN, keyword, value, 0);
+        }
+        break;
+    }
+    case TK_LCURLY:
+        node = parseBlock(parser);
+        break;
+    case TK_FUNCTION:
+        parserError(parser, "functions are defined at top level only",
+                    "SYNTAX_ERROR");
+        break;
+    case TK_IDENTIFIER:
+        // a label names the statement after its ':'
+        if (parserPeek(parser, 1) == TK_COLON) {
+            uint32_t label = parserAdvance(parser);
+            parserAdvance(parser);
+            uint32_t statement = parseStatement(parser);
+            node = parserAddNode(parser, AST_LABEL, label, statement, 0);
+            break;
+        }
+        // fallthrough
+    default: {
+        uint32_t expression = 0;
+        if (parserPeek(parser, 0) != TK_SEMICOLON) {
+            expression = parseExpression(parser);
+        }
+        uint32_t semicolon = parser->current;
+        if (!parser->panic && !parserExpect(parser, TK_SEMICOLON, "';'")) {
+            node = parserAddNode(parser, AST_EXPR_STMT, semicolon, expression,
+                                 0);
+        }
+        break;
+    }
+    }
+
+    parser->depth--;
+    return parser->panic ? 0 : node;
+}
+
+// statements up to '}' (and 'case' in_case), returns the extra range start
+static uint32_t parseStatementList(Parser *parser, int in_case,
+                                   uint32_t *end) {
+    uint32_t scratch_start = parser->scratch_count;
+    while (1) {
+        TokenType type = parserPeek(parser, 0);
+        if (type == TK_RCURLY || type == TK_EOF ||
+            (in_case && type == TK_CASE)) {
+            break;
+        }
+
+        uint32_t start = parser->current;
+        uint32_t node = parseStatement(parser);
+        if (parser->panic) {
+            parserSynchronize(parser, start);
+        } else {
+            parserPush(parser, node);
+        }
+    }
+    return parserAddRange(parser, scratch_start, end);
+}
+
+static uint32_t parseBlock(Parser *parser) {
+    uint32_t curly = parser->current;
+    if (parserExpect(parser, TK_LCURLY, "'{'")) {
+        return 0;
+    }
+
+    uint32_t end;
+    uint32_t start = parseStatementList(parser, 0, &end);
+    if (parserExpect(parser, TK_RCURLY, "'}'")) {
+        return 0;
+    }
+    return parserAddNode(parser, AST_BLOCK, curly, start, end);
+}
+
+static uint32_t parseVarDecl(Parser *parser) {
+    uint32_t keyword = parserAdvance(parser);
+    if (parserExpectType(parser) ||
+        parserExpect(parser, TK_IDENTIFIER, "variable name")) {
+        return 0;
+    }
+
+    uint32_t length = 0;
+    if (parserPeek(parser, 0) == TK_LBRACKET) {
+        parserAdvance(parser);
+        if (parserPeek(parser, 0) != TK_RBRACKET) {
+            length = parseExpression(parser);
+        }
+        if (parser->panic || parserExpect(parser, TK_RBRACKET, "']'")) {
+            return 0;
+        }
+    }
+
+    uint32_t value = 0;
+    if (parserPeek(parser, 0) == TK_ASSIGN) {
+        parserAdvance(parser);
+        value = parseExpression(parser);
+    }
+    if (parser->panic || parserExpect(parser, TK_SEMICOLON, "';'")) {
+        return 0;
+    }
+    return parserAddNode(parser, AST_VAR_DECL, keyword, length, value);
+}
+
+static uint32_t parseIf(Parser *parser) {
+    uint32_t keyword = parserAdvance(parser);
+    uint32_t condition = parseCondition(parser);
+    uint32_t then = parser->panic ? 0 : parseBlock(parser);
+
+    uint32_t otherwise = 0;
+    if (!parser->panic && parserPeek(parser, 0) == TK_ELSE) {
+        parserAdvance(parser);
+        if (parserPeek(parser, 0) == TK_IF) {
+            if (!parserEnter(parser)) {
+                otherwise = parseIf(parser);
+                parser->depth--;
+            }
+        } else {
+            otherwise = parseBlock(parser);
+        }
+    }
+    if (parser->panic) {
+        return 0;
+    }
+    return parserAddNode(parser, AST_IF, keyword, condition,
+                         parserAddPair(parser, then, otherwise));
+}
+
+static uint32_t parseSwitch(Parser *parser) {
+    uint32_t keyword = parserAdvance(parser);
+    uint32_t subject = parseCondition(parser);
+    if (parser->panic || parserExpect(parser, TK_LCURLY, "'{'")) {
+        return 0;
+    }
+
+    uint32_t scratch_start = parser->scratch_count;
+    while (parserPeek(parser, 0) == TK_CASE) {
+        uint32_t node = parseCase(parser);
+        if (parser->panic) {
+            parser->scratch_count = scratch_start;
+            return 0;
+        }
+        parserPush(parser, node);
+    }
+    if (parserExpect(parser, TK_RCURLY, "'case' or '}'")) {
+        parser->scratch_count = scratch_start;
+        return 0;
+    }
+
+    uint32_t end;
+    uint32_t start = parserAddRange(parser, scratch_start, &end);
+    return parserAddNode(parser, AST_SWITCH, keyword, subject,
+                         parserAddPair(parser, start, end));
+}
+
+static uint32_t parseCase(Parser *parser) {
+    uint32_t keyword = parserAdvance(parser);
+
+    // '*' matches any value
+    uint32_t value;
+    if (parserPeek(parser, 0) == TK_ASTERISK) {
+        value = parserAddNode(parser, AST_WILDCARD, parserAdvance(parser), 0,
+                              0);
+    } else {
+        value = parseExpression(parser);
+    }
+    if (parser->panic || parserExpect(parser, TK_COLON, "':'")) {
+        return 0;
+    }
+
+    uint32_t end;
+    uint32_t start = parseStatementList(parser, 1, &end);
+    return parserAddNode(parser, AST_CASE, keyword, value,
+                         parserAddPair(parser, start, end));
+}
+
+// cease, persist and thither with their label (required by thither)
+static uint32_t parseJump(Parser *parser, AstKind kind) {
+    uint32_t keyword = parserAdvance(parser);
+    if (parserPeek(parser, 0) == TK_IDENTIFIER) {
+        parserAdvance(parser);
+    } else if (kind == AST_GOTO) {
+        parserExpect(parser, TK_IDENTIFIER, "label");
+        return 0;
+    }
+    if (parserExpect(parser, TK_SEMICOLON, "';'")) {
+        return 0;
+    }
+    return parserAddNode(parser, kind, keyword, 0, 0);
+}
+
+static uint32_t parseExpression(Parser *parser) {
+    if (parserEnter(parser)) {
+        return 0;
+    }
+
+    uint32_t node = parseBinary(parser, 1);
+    switch (parserPeek(parser, 0)) {
+    case TK_ASSIGN:
+    case TK_ASSIGNINC:
+    case TK_ASSIGNDEC:
+    case TK_ASSIGNMUL:
+    case TK_ASSIGNDIV:
+    case TK_ASSIGNMOD: {
+        if (parser->panic) {
+            break;
+        }
+        // assignments group to the right
+        uint32_t op = parserAdvance(parser);
+        uint32_t value = parseExpression(parser);
+        node = parserAddNode(parser, AST_ASSIGN, op, node, value);
+        break;
+    }
+    default:
+        break;
+    }
+
+    parser->depth--;
+    return parser->panic ? 0 : node;
+}
+
+// operators binding at least min_precedence, left to right except '**'
+static uint32_t parseBinary(Parser *parser, int min_precedence) {
+    uint32_t left = parseUnary(parser);
+    while (!parser->panic) {
+        TokenType type = parserPeek(parser, 0);
+        int precedence = binary_precedence[type];
+        if (precedence == 0 || precedence < min_precedence) {
+            break;
+        }
+
+        // '**' chains recurse once per operator
+        if (parserEnter(parser)) {
+            return 0;
+        }
+        uint32_t op = parserAdvance(parser);
+        uint32_t right = parseBinary(
+            parser, type == TK_EXPONENT ? precedence : precedence + 1);
+        parser->depth--;
+        left = parserAddNode(parser, AST_BINARY, op, left, right);
+    }
+    return left;
+}
+
+static uint32_t parseUnary(Parser *parser) {
+    switch (parserPeek(parser, 0)) {
+    case TK_BANG:
+    case TK_MINUS:
+    case TK_PLUS:
+    case TK_INCREMENT:
+    case TK_DECREMENT:
+    case TK_AMPERSAND: {
+        if (parserEnter(parser)) {
+            return 0;
+        }
+        uint32_t op = parserAdvance(parser);
+        uint32_t operand = parseUnary(parser);
+        parser->depth--;
+        return parserAddNode(parser, AST_UNARY, op, operand, 0);
+    }
+    default:
+        return parsePostfix(parser);
+    }
+}
+
+static uint32_t parsePostfix(Parser *parser) {
+    uint32_t node = parsePrimary(parser);
+    while (!parser->panic) {
+        switch (parserPeek(parser, 0)) {
+        case TK_LPAREN: {
+            uint32_t paren = parserAdvance(parser);
+            uint32_t scratch_start = parser->scratch_count;
+            while (!parser->panic && parserPeek(parser, 0) != TK_RPAREN) {
+                if (parser->scratch_count > scratch_start &&
+                    parserExpect(parser, TK_COMMA, "',' or ')'")) {
+                    break;
+                }
+                uint32_t argument = parseExpression(parser);
+                if (!parser->panic) {
+                    parserPush(parser, argument);
+                }
+            }
+            if (parser->panic) {
+                parser->scratch_count = scratch_start;
+                return 0;
+            }
+            parserAdvance(parser);
+
+            uint32_t end;
+            uint32_t start = parserAddRange(parser, scratch_start, &end);
+            node = parserAddNode(parser, AST_CALL, paren, node,
+                                 parserAddPair(parser, start, end));
+            break;
+        }
+        case TK_LBRACKET: {
+            uint32_t bracket = parserAdvance(parser);
+            uint32_t index = parseExpression(parser);
+            if (parser->panic || parserExpect(parser, TK_RBRACKET, "']'")) {
+                return 0;
+            }
+            node = parserAddNode(parser, AST_INDEX, bracket, node, index);
+            break;
+        }
+        case TK_INCREMENT:
+        case TK_DECREMENT:
+            node = parserAddNode(parser, AST_POSTFIX, parserAdvance(parser),
+                                 node, 0);
+            break;
+        default:
+            return node;
+        }
+    }
+    return 0;
+}
+
+static uint32_t parsePrimary(Parser *parser) {
+    AstKind kind;
+    switch (parserPeek(parser, 0)) {
+    case TK_IDENTIFIER:
+        kind = AST_IDENTIFIER;
+        break;
+    case TK_OUT:
+    case TK_IN:
+        kind = AST_BUILTIN;
+        break;
+    case TK_INTLIT:
+        kind = AST_INTEGER;
+        break;
+    case TK_FLTLIT:
+        kind = AST_FLOAT;
+        break;
+    case TK_CHARACLIT:
+        kind = AST_CHARACTER;
+        break;
+    case TK_STRINGLIT:
+        kind = AST_STRING;
+        break;
+    case TK_TRUE:
+    case TK_FALSE:
+        kind = AST_BOOLEAN;
+        break;
+    case TK_LPAREN: {
+        // grouping needs no node of its own
+        parserAdvance(parser);
+        uint32_t node = parseExpression(parser);
+        if (parser->panic || parserExpect(parser, TK_RPAREN, "')'")) {
+            return 0;
+        }
+        return node;
+    }
+    default:
+        parserError(parser, "expected expression", "SYNTAX_ERROR");
+        return 0;
+    }
+    return parserAddNode(parser, kind, parserAdvance(parser), 0, 0);
+}
+
+// parenthesized condition of if, rehearse and switch
+static uint32_t parseCondition(Parser *parser) {
+    if (parserExpect(parser, TK_LPAREN, "'('")) {
+        return 0;
+    }
+    uint32_t node = parseExpression(parser);
+    if (parser->panic || parserExpect(parser, TK_RPAREN, "')'")) {
+        return 0;
+    }
+    return node;
+}
+
+// every node owns a distinct token, so the arena never runs out
+static uint32_t parserAddNode(Parser *parser, AstKind kind, uint32_t token,
+                              uint32_t lhs, uint32_t rhs) {
+    if (parser->panic) {
+        return 0;
+    }
+    return astAddNode(parser->ast, kind, token, lhs, rhs);
+}
+
+// move the scratch nodes from scratch_start into extra
+static uint32_t parserAddRange(Parser *parser, uint32_t scratch_start,
+                               uint32_t *end) {
+    uint32_t count = parser->scratch_count - scratch_start;
+    uint32_t start =
+        astAddExtra(parser->ast, parser->scratch + scratch_start, count);
+    parser->scratch_count = scratch_start;
+    *end = start + count;
+    return start;
+}
+
+static uint32_t parserAddPair(Parser *parser, uint32_t first,
+                              uint32_t second) {
+    uint32_t words[2] = {first, second};
+    return astAddExtra(parser->ast, words, 2);
+}
+
+static void parserPush(Parser *parser, uint32_t node) {
+    parser->scratch[parser->scratch_count++] = node;
+}
+
+// count one nesting level, fails past PARSER_MAX_DEPTH
+static int parserEnter(Parser *parser) {
+    if (parser->depth >= PARSER_MAX_DEPTH) {
+        parserError(parser, "nesting too deep", "SYNTAX_DEPTH_ERROR");
+        return 1;
+    }
+    parser->depth++;
+    return 0;
+}
+
+// type of the token n places ahead, TK_EOF past the end
+static TokenType parserPeek(const Parser *parser, uint32_t n) {
+    unsigned long index = (unsigned long)parser->current + n;
+    if (index >= parser->tokens->count) {
+        return TK_EOF;
+    }
+    return (TokenType)parser->tokens->types[index];
+}
+
+// index of the current token, moving past it (never past TK_EOF)
+static uint32_t parserAdvance(Parser *parser) {
+    uint32_t index = parser->current;
+    if (index + 1 < parser->tokens->count) {
+        parser->current++;
+    }
+    return index;
+}
+
+// consume a token of type or report what was expected
+static int parserExpect(Parser *parser, TokenType type, const char *what) {
+    if (parserPeek(parser, 0) == type) {
+        parserAdvance(parser);
+        return 0;
+    }
+
+    char message[64];
+    snprintf(message, sizeof(message), "expected %s", what);
+    parserError(parser, message, "SYNTAX_ERROR");
+    return 1;
+}
+
+// consume a type keyword
+static int parserExpectType(Parser *parser) {
+    switch (parserPeek(parser, 0)) {
+    case TK_INT:
+    case TK_CHAR:
+    case TK_FLOAT:
+    case TK_DOUBLE:
+    case TK_BOOL:
+    case TK_VOID:
+        parserAdvance(parser);
+        return 0;
+    default:
+        parserError(parser, "expected type", "SYNTAX_ERROR");
+        return 1;
+    }
+}
+
+// skip past the failed statement from start: after its ';', or up to a '}'
+// or the keyword of the next statement, consuming at least one token
+static void parserSynchronize(Parser *parser, uint32_t start) {
+    if (parser->current == start) {
+        parserAdvance(parser);
+    }
+
+    while (1) {
+        switch (parserPeek(parser, 0)) {
+        case TK_SEMICOLON:
+            parserAdvance(parser);
+            // fallthrough
+        case TK_EOF:
+        case TK_RCURLY:
+        case TK_FUNCTION:
+        case TK_LET:
+        case TK_IF:
+        case TK_WHILE:
+        case TK_SWITCH:
+        case TK_CASE:
+        case TK_BREAK:
+        case TK_CONTINUE:
+        case TK_GOTO:
+        case TK_RETURN:
+            parser->panic = 0;
+            return;
+        default:
+            parserAdvance(parser);
+            break;
+        }
+    }
+}
+
+// report a syntax error at the current token, once per failed statement,
+// silently at tokens with lexical errors
+static void parserError(Parser *parser, const char *message,
+                        const char *code) {
+    parser->status = 1;
+    if (parser->panic) {
+        return;
+    }
+    parser->panic = 1;
+
+    parseReportError(parser->lexer, parser->tokens, parser->current,
+                     parser->filename, parser->out, message, code);
+}
@@ -0,0 +1,263 @@
+// rtok header implementation
+//
+// `rtok.c` writes records in fixed chunks through stdio and validates every
+// header offset once on open, so readers index records without bounds
+// checks of their own. Files are mapped read-only where supported, falling
+// back to reading them into a heap buffer.
+
+#include "rtok.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RTOK_HAVE_MMAP 1
+#endif
+
+#define RTOK_WRITE_CHUNK 1024 // records formatted per fwrite
+
+static int rtokLoad(const char *filename, RtokFile *file);
+static int rtokValidate(RtokFile *file);
+
+/// PUBLIC FUNCTIONS
+
+// write the tokens lexerTokenizeAll gave for the resident contents of lexer
+// to file, with the source bytes when with_source is set, errors are printed
+// to out
+int rtokWrite(FILE *file, Lexer *lexer, const TokenBuffer *tokens,
+              int with_source, FILE *out) {
+    unsigned long count = tokens->count;
+    if (count > 0 && tokens->types[count - 1] == TK_EOF) {
+        count--;
+    }
+
+    unsigned long names_length = 0;
+    for (int i = 0; i < TK_TYPE_COUNT; i++) {
+        names_length += strlen(tk_map[i]) + 1;
+    }
+
+    RtokHeader header = {0};
+    memcpy(header.magic, "RTOK", 4);
+    header.version = RTOK_VERSION;
+    header.byte_order = RTOK_BYTE_ORDER;
+    header.header_size = sizeof(RtokHeader);
+    header.record_size = sizeof(RtokRecord);
+    header.type_count = TK_TYPE_COUNT;
+    header.flags = with_source ? RTOK_HAS_SOURCE : 0;
+    header.token_count = count;
+    header.names_offset = sizeof(RtokHeader);
+    header.records_offset = (header.names_offset + names_length + 7) / 8 * 8;
+    if (with_source) {
+        header.source_offset =
+            header.records_offset + count * sizeof(RtokRecord);
+    }
+    header.source_length = lexer->content_length;
+
+    static const char padding[8] = {0};
+    int failed = fwrite(&header, sizeof(header), 1, file) != 1;
+    for (int i = 0; i < TK_TYPE_COUNT && !failed; i++) {
+        unsigned long length = strlen(tk_map[i]) + 1;
+        failed = fwrite(tk_map[i], 1, length, file) != length;
+    }
+    unsigned long pad =
+        header.records_offset - header.names_offset - names_length;
+    if (!failed && pad > 0) {
+        failed = fwrite(padding, 1, pad, file) != pad;
+    }
+
+    // records resolve positions in token order, the line index hint hits
+    RtokRecord chunk[RTOK_WRITE_CHUNK];
+    memset(chunk, 0, sizeof(chunk));
+    for (unsigned long i = 0; i < count && !failed;) {
+        unsigned long filled = 0;
+        for (; filled < RTOK_WRITE_CHUNK && i < count; filled++, i++) {
+            unsigned long line;
+            unsigned long column;
+            if (lexerGetPosition(lexer, tokens->begins[i], &line, &column,
+                                 out)) {
+                return 1;
+            }
+
+            RtokRecord *record = &chunk[filled];
+            record->offset = tokens->starts[i];
+            record->length = tokens->lengths[i];
+            record->line = (uint32_t)line;
+            record->column = (uint32_t)column;
+            record->type = tokens->types[i];
+        }
+        failed = fwrite(chunk, sizeof(RtokRecord), filled, file) != filled;
+    }
+
+    if (!failed && with_source) {
+        failed = fwrite(lexer->contents, 1, lexer->content_length, file) !=
+                 lexer->content_length;
+    }
+
+    if (failed) {
+        fprintf(out, "ERROR: failed writing token file [OUTPUT_WRITE_ERROR]\n");
+        return 1;
+    }
+    return 0;
+}
+
+// map and validate a token file, errors are printed to out
+int rtokOpen(const char *filename, RtokFile *file, FILE *out) {
+    memset(file, 0, sizeof(RtokFile));
+    if (rtokLoad(filename, file)) {
+        fprintf(out, "ERROR: cannot read token file '%s' [RTOK_READ_ERROR]\n",
+                filename);
+        rtokClose(file);
+        return 1;
+    }
+
+    if (rtokValidate(file)) {
+        fprintf(out,
+                "ERROR: '%s' is not a version %d token file "
+                "[RTOK_FORMAT_ERROR]\n",
+                filename, RTOK_VERSION);
+        rtokClose(file);
+        return 1;
+    }
+    return 0;
+}
+
+// name of a record type, "?" when out of range
+const char *rtokTypeName(const RtokFile *file, unsigned int type) {
+    if (type >= file->header->type_count) {
+        return "?";
+    }
+    return file->type_names[type];
+}
+
+// unmap or free a token file
+void rtokClose(RtokFile *file) {
+#ifdef RTOK_HAVE_MMAP
+    if (file->mapped) {
+        munmap(file->data, file->data_length);
+    }
+#endif
+    if (!file->mapped) {
+        free(file->data);
+    }
+    memset(file, 0, sizeof(RtokFile));
+}
+
+/// PRIVATE FUNCTIONS
+
+// whole file into file->data, mapped when possible
+static int rtokLoad(const char *filename, RtokFile *file) {
+#ifdef RTOK_HAVE_MMAP
+    int file_desc = open(filename, O_RDONLY);
+    if (file_desc == -1) {
+        return 1;
+    }
+
+    struct stat file_stat;
+    if (fstat(file_desc, &file_stat) == 0 && S_ISREG(file_stat.st_mode) &&
+        file_stat.st_size > 0) {
+        void *mapping = mmap(NULL, (size_t)file_stat.st_size, PROT_READ,
+                             MAP_PRIVATE, file_desc, 0);
+        close(file_desc);
+        if (mapping == MAP_FAILED) {
+            return 1;
+        }
+        file->data = mapping;
+        file->data_length = (unsigned long)file_stat.st_size;
+        file->mapped = 1;
+        return 0;
+    }
+    close(file_desc);
+#endif
+
+    // fall back to buffered reads for pipes and non-POSIX systems
+    FILE *file_ptr = fopen(filename, "rb");
+    if (file_ptr == NULL) {
+        return 1;
+    }
+
+    unsigned long capacity = 0;
+    char *data = NULL;
+    int failed = 0;
+    while (!failed) {
+        if (file->data_length == capacity) {
+            capacity = capacity * 2 + 65536;
+            char *grown = realloc(data, capacity);
+            if (grown == NULL) {
+                failed = 1;
+                break;
+            }
+            data = grown;
+        }
+        unsigned long count = fread(data + file->data_length, 1,
+                                    capacity - file->data_length, file_ptr);
+        file->data_length += count;
+        if (count == 0) {
+            break;
+        }
+    }
+
+    failed |= ferror(file_ptr);
+    fclose(file_ptr);
+    file->data = data;
+    return failed;
+}
+
+// check header offsets against the file length, record slices against the
+// source and index the type names
+static int rtokValidate(RtokFile *file) {
+    const RtokHeader *header = file->data;
+    unsigned long length = file->data_length;
+
+    if (length < sizeof(RtokHeader) || memcmp(header->magic, "RTOK", 4) != 0 ||
+        header->version != RTOK_VERSION ||
+        header->byte_order != RTOK_BYTE_ORDER ||
+        header->header_size < sizeof(RtokHeader) ||
+        header->record_size != sizeof(RtokRecord) ||
+        header->type_count > 256 || header->names_offset > length ||
+        header->records_offset > length || header->records_offset % 4 != 0 ||
+        header->token_count >
+            (length - header->records_offset) / sizeof(RtokRecord)) {
+        return 1;
+    }
+    if ((header->flags & RTOK_HAS_SOURCE) &&
+        (header->source_offset > length ||
+         header->source_length > length - header->source_offset)) {
+        return 1;
+    }
+
+    // every name must end before the records
+    const char *names = (const char *)file->data + header->names_offset;
+    const char *names_end = (const char *)file->data + header->records_offset;
+    for (unsigned int i = 0; i < header->type_count; i++) {
+        const char *end =
+            names < names_end ? memchr(names, '\0', names_end - names) : NULL;
+        if (end == NULL) {
+            return 1;
+        }
+        file->type_names[i] = names;
+        names = end + 1;
+    }
+
+    // readers slice the source with records unchecked
+    const RtokRecord *records =
+        (const RtokRecord *)((const char *)file->data + header->records_offset);
+    for (uint64_t i = 0;
+         (header->flags & RTOK_HAS_SOURCE) && i < header->token_count; i++) {
+        if ((uint64_t)records[i].offset + records[i].length >
+            header->source_length) {
+            return 1;
+        }
+    }
+
+    file->header = header;
+    file->records = records;
+    file->token_count = header->token_count;
+    if (header->flags & RTOK_HAS_SOURCE) {
+        file->source = (const char *)file->data + header->source_offset;
+    }
+    return 0;
+}
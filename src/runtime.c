@@ -0,0 +1,218 @@
+// runtime header implementation
+//
+// `runtime.c` is the C half of a native executable. `main` allocates the
+// register stack the generated code works in and runs the program on a
+// thread with a machine stack large enough for VM_MAX_FRAMES calls, the
+// limits of vmRun apply unchanged. Helpers follow the handlers of vmloop.h.
+
+#include "runtime.h"
+#include "vm.h" // VM_STACK_SIZE, vmFloorDivide, VM_PORTION_FORMAT
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct RtRunStruct {
+    VmValue *stack;
+    int64_t exit_value;
+} RtRun;
+
+static void *rtStart(void *context);
+static const char *rtReadLine(void);
+static const char *rtCopyString(const char *text, size_t length,
+                                const char *memory_report);
+
+/// PUBLIC FUNCTIONS
+
+int main(void) {
+    RtRun run = {calloc(VM_STACK_SIZE, sizeof(VmValue)), 0};
+    if (run.stack == NULL) {
+        rtError("ERROR: register stack allocation failure "
+                "[RUNTIME_ERROR]\n");
+    }
+
+    // the main thread's stack may be too small, run on it only when a
+    // thread cannot be made
+    pthread_attr_t attributes;
+    pthread_t thread;
+    int threaded = pthread_attr_init(&attributes) == 0;
+    if (threaded) {
+        threaded =
+            pthread_attr_setstacksize(&attributes, RT_THREAD_STACK) == 0 &&
+            pthread_create(&thread, &attributes, rtStart, &run) == 0;
+        pthread_attr_destroy(&attributes);
+    }
+    if (threaded) {
+        pthread_join(thread, NULL);
+    } else {
+        rtStart(&run);
+    }
+
+    fflush(stdout);
+    free(run.stack);
+    return (int)run.exit_value;
+}
+
+void rtError(const char *report) {
+    fflush(stdout);
+    fputs(report, stdout);
+    fflush(stdout);
+    exit(1);
+}
+
+void rtPrintCount(int64_t value) {
+    printf("%" PRId64, value);
+}
+
+void rtPrintPortion(double value) {
+    printf(VM_PORTION_FORMAT, value);
+}
+
+void rtPrintGlyph(int64_t value) {
+    putchar((int)value);
+}
+
+void rtPrintVerdict(int64_t value) {
+    fputs(value ? "yay" : "nay", stdout);
+}
+
+void rtPrintString(const char *value) {
+    fputs(value, stdout);
+}
+
+void rtPrintNewline(void) {
+    putchar('\n');
+}
+
+int64_t rtReadCount(void) {
+    return strtoll(rtReadLine(), NULL, 10);
+}
+
+double rtReadPortion(void) {
+    return strtod(rtReadLine(), NULL);
+}
+
+int64_t rtReadGlyph(void) {
+    return (unsigned char)rtReadLine()[0];
+}
+
+// yay, y, true or a nonzero number
+int64_t rtReadVerdict(void) {
+    const char *text = rtReadLine();
+    return text[0] == 'y' || text[0] == 'Y' || text[0] == 't' ||
+           text[0] == 'T' || strtoll(text, NULL, 10) != 0;
+}
+
+const char *rtReadString(const char *memory_report) {
+    const char *line = rtReadLine();
+    return rtCopyString(line, strlen(line), memory_report);
+}
+
+int64_t rtFloorDivide(int64_t dividend, int64_t divisor) {
+    return vmFloorDivide(dividend, divisor);
+}
+
+int64_t rtPower(int64_t base, int64_t exponent) {
+    return vmPower(base, exponent);
+}
+
+int64_t rtTruncate(double value) {
+    return vmTruncate(value);
+}
+
+VmArray *rtNewArray(int64_t length, const char *memory_report) {
+    if ((uint64_t)length > (SIZE_MAX - sizeof(VmArray)) / sizeof(VmValue)) {
+        rtError(memory_report);
+    }
+    VmArray *array =
+        calloc(1, sizeof(VmArray) + (size_t)length * sizeof(VmValue));
+    if (array == NULL) {
+        rtError(memory_report);
+    }
+    array->length = length;
+    return array;
+}
+
+// the terminator must come after the index
+int64_t rtGetChar(const char *text, int64_t index, const char *report) {
+    if (index < 0 || memchr(text, '\0', (size_t)index + 1) != NULL) {
+        rtError(report);
+    }
+    return (unsigned char)text[index];
+}
+
+const char *rtConcat(const char *left, const char *right,
+                     const char *memory_report) {
+    size_t left_length = strlen(left);
+    size_t right_length = strlen(right);
+    char *joined = malloc(left_length + right_length + 1);
+    if (joined == NULL) {
+        rtError(memory_report);
+    }
+    memcpy(joined, left, left_length);
+    memcpy(joined + left_length, right, right_length + 1);
+    return joined;
+}
+
+const char *rtCountText(int64_t value, const char *memory_report) {
+    char text[32];
+    snprintf(text, sizeof(text), "%" PRId64, value);
+    return rtCopyString(text, strlen(text), memory_report);
+}
+
+const char *rtPortionText(double value, const char *memory_report) {
+    char text[32];
+    snprintf(text, sizeof(text), VM_PORTION_FORMAT, value);
+    return rtCopyString(text, strlen(text), memory_report);
+}
+
+const char *rtGlyphText(int64_t value, const char *memory_report) {
+    char text = (char)value;
+    return rtCopyString(&text, 1, memory_report);
+}
+
+const char *rtVerdictText(int64_t value) {
+    return value ? "yay" : "nay";
+}
+
+/// PRIVATE FUNCTIONS
+
+static void *rtStart(void *context) {
+    RtRun *run = context;
+    run->exit_value = rtProgram(run->stack, run->stack + VM_STACK_SIZE);
+    return NULL;
+}
+
+// next line of input without its newline, empty at end of input. Only the
+// program thread reads, the line buffer is reused.
+static const char *rtReadLine(void) {
+    static char *line = NULL;
+    static size_t capacity = 0;
+    fflush(stdout);
+    ssize_t length = getline(&line, &capacity, stdin);
+    if (length < 0) {
+        length = 0;
+        if (line == NULL && (line = malloc(1)) == NULL) {
+            return "";
+        }
+    }
+    while (length > 0 &&
+           (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+        length--;
+    }
+    line[length] = '\0';
+    return line;
+}
+
+static const char *rtCopyString(const char *text, size_t length,
+                                const char *memory_report) {
+    char *copy = malloc(length + 1);
+    if (copy == NULL) {
+        rtError(memory_report);
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
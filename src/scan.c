@@ -0,0 +1,295 @@
+// 'scan.c' - scalar, SSE2 and AVX2 byte scanning kernels
+//
+// The vector kernels compare a whole block against the wanted bytes, turn the
+// result into a bit mask and stop at its lowest set bit. Tails shorter than a
+// block go through the scalar kernels, so no load reads past text[end - 1].
+// AVX2 kernels clear the upper register halves before returning to avoid
+// AVX-SSE transition stalls in the surrounding non-VEX code.
+
+#include "scan.h"
+
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_HAVE_X86 1
+#include <immintrin.h>
+#define SCAN_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+static unsigned long scalarFindNewline(const char *text, unsigned long pos,
+                                       unsigned long end);
+static unsigned long scalarFindCommentEnd(const char *text, unsigned long pos,
+                                          unsigned long end);
+static unsigned long scalarFindStringSpecial(const char *text,
+                                             unsigned long pos,
+                                             unsigned long end);
+static unsigned long scalarSkipBlanks(const char *text, unsigned long pos,
+                                      unsigned long end);
+
+#ifdef SCAN_HAVE_X86
+static unsigned long sse2FindNewline(const char *text, unsigned long pos,
+                                     unsigned long end);
+static unsigned long sse2FindCommentEnd(const char *text, unsigned long pos,
+                                        unsigned long end);
+static unsigned long sse2FindStringSpecial(const char *text, unsigned long pos,
+                                           unsigned long end);
+static unsigned long sse2SkipBlanks(const char *text, unsigned long pos,
+                                    unsigned long end);
+
+static unsigned long avx2FindNewline(const char *text, unsigned long pos,
+                                     unsigned long end);
+static unsigned long avx2FindCommentEnd(const char *text, unsigned long pos,
+                                        unsigned long end);
+static unsigned long avx2FindStringSpecial(const char *text, unsigned long pos,
+                                           unsigned long end);
+static unsigned long avx2SkipBlanks(const char *text, unsigned long pos,
+                                    unsigned long end);
+#endif
+
+static const ScanKernels scan_kernels[SCAN_COUNT] = {
+    [SCAN_SCALAR] = {"scalar", scalarFindNewline, scalarFindCommentEnd,
+                     scalarFindStringSpecial, scalarSkipBlanks},
+#ifdef SCAN_HAVE_X86
+    [SCAN_SSE2] = {"sse2", sse2FindNewline, sse2FindCommentEnd,
+                   sse2FindStringSpecial, sse2SkipBlanks},
+    [SCAN_AVX2] = {"avx2", avx2FindNewline, avx2FindCommentEnd,
+                   avx2FindStringSpecial, avx2SkipBlanks},
+#endif
+};
+
+/// PUBLIC FUNCTIONS
+
+// kernels of the given variant, NULL when the CPU or compiler lacks it
+const ScanKernels *scanGetKernels(ScanLevel level) {
+    if ((int)level < 0 || level >= SCAN_COUNT ||
+        scan_kernels[level].name == NULL) {
+        return NULL;
+    }
+
+#ifdef SCAN_HAVE_X86
+    if ((level == SCAN_SSE2 && !__builtin_cpu_supports("sse2")) ||
+        (level == SCAN_AVX2 && !__builtin_cpu_supports("avx2"))) {
+        return NULL;
+    }
+#endif
+
+    return &scan_kernels[level];
+}
+
+// fastest kernels supported by the running CPU
+const ScanKernels *scanGetBestKernels(void) {
+    for (int level = SCAN_COUNT - 1; level > SCAN_SCALAR; level--) {
+        const ScanKernels *kernels = scanGetKernels((ScanLevel)level);
+        if (kernels != NULL) {
+            return kernels;
+        }
+    }
+    return &scan_kernels[SCAN_SCALAR];
+}
+
+/// PRIVATE FUNCTIONS
+
+static unsigned long scalarFindNewline(const char *text, unsigned long pos,
+                                       unsigned long end) {
+    while (pos < end && text[pos] != '\n') {
+        pos++;
+    }
+    return pos;
+}
+
+static unsigned long scalarFindCommentEnd(const char *text, unsigned long pos,
+                                          unsigned long end) {
+    while (pos < end && text[pos] != '#' && text[pos] != '\0') {
+        pos++;
+    }
+    return pos;
+}
+
+static unsigned long scalarFindStringSpecial(const char *text,
+                                             unsigned long pos,
+                                             unsigned long end) {
+    while (pos < end && text[pos] != '"' && text[pos] != '\\' &&
+           text[pos] != '\0') {
+        pos++;
+    }
+    return pos;
+}
+
+static unsigned long scalarSkipBlanks(const char *text, unsigned long pos,
+                                      unsigned long end) {
+    while (pos < end && (text[pos] == ' ' || text[pos] == '\t' ||
+                         text[pos] == '\r' || text[pos] == '\n')) {
+        pos++;
+    }
+    return pos;
+}
+
+#ifdef SCAN_HAVE_X86
+
+SCAN_TARGET("sse2")
+static unsigned long sse2FindNewline(const char *text, unsigned long pos,
+                                     unsigned long end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    for (; end - pos >= 16; pos += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(text + pos));
+        unsigned int mask =
+            (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        if (mask != 0) {
+            return pos + (unsigned long)__builtin_ctz(mask);
+        }
+    }
+    return scalarFindNewline(text, pos, end);
+}
+
+SCAN_TARGET("sse2")
+static unsigned long sse2FindCommentEnd(const char *text, unsigned long pos,
+                                        unsigned long end) {
+    const __m128i hash = _mm_set1_epi8('#');
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; end - pos >= 16; pos += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(text + pos));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(block, hash),
+                                   _mm_cmpeq_epi8(block, zero));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(hit);
+        if (mask != 0) {
+            return pos + (unsigned long)__builtin_ctz(mask);
+        }
+    }
+    return scalarFindCommentEnd(text, pos, end);
+}
+
+SCAN_TARGET("sse2")
+static unsigned long sse2FindStringSpecial(const char *text, unsigned long pos,
+                                           unsigned long end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; end - pos >= 16; pos += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(text + pos));
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                         _mm_cmpeq_epi8(block, backslash)),
+            _mm_cmpeq_epi8(block, zero));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(hit);
+        if (mask != 0) {
+            return pos + (unsigned long)__builtin_ctz(mask);
+        }
+    }
+    return scalarFindStringSpecial(text, pos, end);
+}
+
+SCAN_TARGET("sse2")
+static unsigned long sse2SkipBlanks(const char *text, unsigned long pos,
+                                    unsigned long end) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    for (; end - pos >= 16; pos += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(text + pos));
+        __m128i blank = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, space),
+                         _mm_cmpeq_epi8(block, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, carriage),
+                         _mm_cmpeq_epi8(block, newline)));
+
+        unsigned int other = ~(unsigned int)_mm_movemask_epi8(blank) & 0xFFFFu;
+        if (other != 0) {
+            return pos + (unsigned long)__builtin_ctz(other);
+        }
+    }
+    return scalarSkipBlanks(text, pos, end);
+}
+
+SCAN_TARGET("avx2")
+static unsigned long avx2FindNewline(const char *text, unsigned long pos,
+                                     unsigned long end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    for (; end - pos >= 32; pos += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(text + pos));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(block, newline));
+        if (mask != 0) {
+            _mm256_zeroupper();
+            return pos + (unsigned long)__builtin_ctz(mask);
+        }
+    }
+    _mm256_zeroupper();
+    return scalarFindNewline(text, pos, end);
+}
+
+SCAN_TARGET("avx2")
+static unsigned long avx2FindCommentEnd(const char *text, unsigned long pos,
+                                        unsigned long end) {
+    const __m256i hash = _mm256_set1_epi8('#');
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (; end - pos >= 32; pos += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(text + pos));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(block, hash),
+                                      _mm256_cmpeq_epi8(block, zero));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+        if (mask != 0) {
+            _mm256_zeroupper();
+            return pos + (unsigned long)__builtin_ctz(mask);
+        }
+    }
+    _mm256_zeroupper();
+    return scalarFindCommentEnd(text, pos, end);
+}
+
+SCAN_TARGET("avx2")
+static unsigned long avx2FindStringSpecial(const char *text, unsigned long pos,
+                                           unsigned long end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (; end - pos >= 32; pos += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(text + pos));
+        __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, quote),
+                            _mm256_cmpeq_epi8(block, backslash)),
+            _mm256_cmpeq_epi8(block, zero));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+        if (mask != 0) {
+            _mm256_zeroupper();
+            return pos + (unsigned long)__builtin_ctz(mask);
+        }
+    }
+    _mm256_zeroupper();
+    return scalarFindStringSpecial(text, pos, end);
+}
+
+SCAN_TARGET("avx2")
+static unsigned long avx2SkipBlanks(const char *text, unsigned long pos,
+                                    unsigned long end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i carriage = _mm256_set1_epi8('\r');
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    for (; end - pos >= 32; pos += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(text + pos));
+        __m256i blank = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, space),
+                            _mm256_cmpeq_epi8(block, tab)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, carriage),
+                            _mm256_cmpeq_epi8(block, newline)));
+
+        uint32_t other = ~(uint32_t)_mm256_movemask_epi8(blank);
+        if (other != 0) {
+            _mm256_zeroupper();
+            return pos + (unsigned long)__builtin_ctz(other);
+        }
+    }
+    _mm256_zeroupper();
+    return scalarSkipBlanks(text, pos, end);
+}
+
+#endif // SCAN_HAVE_X86
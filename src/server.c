@@ -0,0 +1,504 @@
+// server header implementation
+//
+// `server.c` accepts on one listening socket from every worker thread, each
+// running a whole request on the same path as the command line
+// (runOptionFlags) with output captured in memory streams. Workers unshare
+// their working directory so requests from clients in different
+// directories run at once; getopt keeps its state in globals, so only
+// argument parsing is serialized.
+//
+// A request is a string count followed by length prefixed strings: the
+// client's working directory, its stdin bytes and its arguments. The reply
+// is frames of a kind byte and a length prefixed payload, 'o' for stdout
+// and 'e' for stderr text, ended by 'x' with the exit status. Integers are
+// native 32-bit, both ends run on one machine.
+
+#define _GNU_SOURCE // unshare, CLONE_FS, accept4
+
+#include "server.h"
+#include "threadpool.h" // threadPoolCoreCount
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVER_BACKLOG 128
+#define SERVER_TIMEOUT 10               // seconds a client may stall a read
+#define SERVER_STRING_LIMIT 65536       // strings of one request
+#define SERVER_REQUEST_LIMIT (1UL << 30) // bytes of one request
+#define SERVER_CHUNK_SIZE 65536         // reply bytes copied at once
+
+// strings of a request, NULL terminated so arguments can be argv
+typedef struct ServerRequestStruct {
+    char **strings;
+    uint32_t *lengths;
+    uint32_t count;
+} ServerRequest;
+
+// getopt state is global, requests without a private working directory
+// change the one of the process
+static pthread_mutex_t server_parse_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t server_directory_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *serverWork(void *context);
+static void serverHandle(int client_fd, int private_cwd);
+static int serverCompile(const ServerRequest *request, FILE *out, FILE *err);
+static int serverReadRequest(int fd, ServerRequest *request);
+static void serverRequestCleanup(ServerRequest *request);
+static int serverSendRequest(int fd, const char *cwd, const char *input,
+                             size_t input_length,
+                             const ArgumentList *arguments);
+static int serverReadInput(char **input, size_t *input_length);
+static int serverReceive(int fd, int *exit_status);
+static int serverWriteFrame(int fd, char kind, const void *data,
+                            uint32_t length);
+static int serverAddress(const char *socket_path,
+                         struct sockaddr_un *address);
+static int serverReadAll(int fd, void *data, size_t length);
+static int serverWriteAll(int fd, const void *data, size_t length);
+
+/// PUBLIC FUNCTIONS
+
+// accept requests on socket_path with thread_count workers (0 for one per
+// core) until SIGINT, SIGTERM or SIGHUP, then remove the socket
+int serverListen(const char *socket_path, unsigned int thread_count) {
+    struct sockaddr_un address;
+    if (serverAddress(socket_path, &address)) {
+        return 1;
+    }
+    if (thread_count == 0) {
+        thread_count = threadPoolCoreCount();
+    }
+
+    // a socket nobody accepts on is left over from a stopped server
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd >= 0 &&
+        connect(listen_fd, (struct sockaddr *)&address, sizeof(address)) ==
+            0) {
+        printf("ERROR: a server already listens on '%s' "
+               "[SERVER_SOCKET_ERROR]\n",
+               socket_path);
+        close(listen_fd);
+        return 1;
+    }
+    struct stat info;
+    if (lstat(socket_path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+        unlink(socket_path);
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+    }
+
+    // requests run with the server's rights, only its user may connect; no
+    // other thread runs yet to see the process umask change
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    mode_t mask = umask(0177);
+    int bound = listen_fd >= 0 &&
+                bind(listen_fd, (struct sockaddr *)&address,
+                     sizeof(address)) == 0;
+    umask(mask);
+    if (!bound || listen(listen_fd, SERVER_BACKLOG) != 0) {
+        printf("ERROR: cannot listen on '%s': %s [SERVER_SOCKET_ERROR]\n",
+               socket_path, strerror(errno));
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+        return 1;
+    }
+
+    // workers inherit the blocked signals, only this thread takes them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    unsigned int started = 0;
+    while (started < thread_count) {
+        pthread_t worker;
+        if (pthread_create(&worker, NULL, serverWork, &listen_fd) != 0) {
+            break;
+        }
+        pthread_detach(worker);
+        started++;
+    }
+    if (started == 0) {
+        printf("ERROR: server thread creation failure [THREAD_POOL_ERROR]\n");
+        unlink(socket_path);
+        close(listen_fd);
+        return 1;
+    }
+
+    printf("renaisscript server listening on '%s' with %u threads\n",
+           socket_path, started);
+    fflush(stdout);
+
+    // requests still running end with the process
+    int signal_number;
+    sigwait(&signals, &signal_number);
+    unlink(socket_path);
+    return 0;
+}
+
+// compile the files of flags on the server of socket_path, printing its
+// output to stdout and stderr, returns the server's exit status
+int serverRequest(const char *socket_path, const OptionFlags *flags) {
+    struct sockaddr_un address;
+    if (serverAddress(socket_path, &address)) {
+        return 1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 ||
+        connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        printf("ERROR: no server listens on '%s' [SERVER_CONNECT_ERROR]\n",
+               socket_path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+
+    // --run reads the client's stdin, sent whole unless it is a terminal
+    char *input = NULL;
+    size_t input_length = 0;
+    char *cwd = getcwd(NULL, 0);
+    int exit_status = 1;
+    int return_error =
+        cwd == NULL ||
+        (flags->compile.run && !isatty(STDIN_FILENO) &&
+         serverReadInput(&input, &input_length)) ||
+        serverSendRequest(fd, cwd, input, input_length, &flags->arguments) ||
+        serverReceive(fd, &exit_status);
+    if (return_error) {
+        fflush(stdout);
+        printf("ERROR: request to the server on '%s' failed "
+               "[SERVER_CONNECT_ERROR]\n",
+               socket_path);
+    }
+
+    free(cwd);
+    free(input);
+    close(fd);
+    return return_error || exit_status != 0;
+}
+
+/// PRIVATE FUNCTIONS
+
+// accept and run requests one at a time until the socket closes
+static void *serverWork(void *context) {
+    const int *listen_fd = context;
+
+    // a private working directory lets requests from any directory overlap
+    int private_cwd = unshare(CLONE_FS) == 0;
+
+    while (1) {
+        int client_fd = accept4(*listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno == EBADF || errno == EINVAL || errno == ENOTSOCK) {
+                return NULL;
+            }
+            continue;
+        }
+
+        struct timeval timeout = {SERVER_TIMEOUT, 0};
+        setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                   sizeof(timeout));
+        serverHandle(client_fd, private_cwd);
+        close(client_fd);
+    }
+}
+
+// run one request in the client's directory, replying with its output
+static void serverHandle(int client_fd, int private_cwd) {
+    ServerRequest request;
+    if (serverReadRequest(client_fd, &request)) {
+        return;
+    }
+
+    char *out_text = NULL;
+    char *err_text = NULL;
+    size_t out_length = 0;
+    size_t err_length = 0;
+    FILE *out = open_memstream(&out_text, &out_length);
+    FILE *err = open_memstream(&err_text, &err_length);
+
+    if (!private_cwd) {
+        pthread_mutex_lock(&server_directory_lock);
+    }
+    int status = 1;
+    if (out != NULL && err != NULL) {
+        if (chdir(request.strings[0]) != 0) {
+            fprintf(out,
+                    "ERROR: server cannot enter '%s' "
+                    "[SERVER_DIRECTORY_ERROR]\n",
+                    request.strings[0]);
+        } else {
+            status = serverCompile(&request, out, err);
+        }
+    }
+    if (!private_cwd) {
+        pthread_mutex_unlock(&server_directory_lock);
+    }
+
+    // memory stream lengths are only set once they are closed
+    if ((out != NULL && fclose(out) != 0) ||
+        (err != NULL && fclose(err) != 0) || out == NULL || err == NULL ||
+        out_length > UINT32_MAX || err_length > UINT32_MAX) {
+        out_length = err_length = 0;
+        status = 1;
+    }
+    int32_t exit_status = status;
+    if (serverWriteFrame(client_fd, 'o', out_text, (uint32_t)out_length) ==
+            0 &&
+        serverWriteFrame(client_fd, 'e', err_text, (uint32_t)err_length) ==
+            0) {
+        serverWriteFrame(client_fd, 'x', &exit_status, sizeof(exit_status));
+    }
+
+    free(out_text);
+    free(err_text);
+    serverRequestCleanup(&request);
+}
+
+// parse the arguments of request and compile its files, --run reading its
+// stdin bytes
+static int serverCompile(const ServerRequest *request, FILE *out, FILE *err) {
+    OptionFlags flags;
+    pthread_mutex_lock(&server_parse_lock);
+    int status = parseOptionFlags(&flags, (int)request->count - 2,
+                                  request->strings + 2);
+    pthread_mutex_unlock(&server_parse_lock);
+
+    FILE *input = NULL;
+    if (!status) {
+        input = fmemopen(request->strings[1], request->lengths[1], "r");
+        status = input == NULL;
+    }
+    if (status) {
+        fprintf(out, "ERROR: server failed reading the request "
+                     "[SERVER_ARGUMENT_ERROR]\n");
+    } else {
+        flags.compile.input = input;
+        status = runOptionFlags(&flags, out, err);
+    }
+
+    if (input != NULL) {
+        fclose(input);
+    }
+    cleanupOptionFlags(&flags);
+    return status;
+}
+
+// read the count and strings of a request
+static int serverReadRequest(int fd, ServerRequest *request) {
+    memset(request, 0, sizeof(ServerRequest));
+    uint32_t count;
+    if (serverReadAll(fd, &count, sizeof(count)) || count < 3 ||
+        count > SERVER_STRING_LIMIT) {
+        return 1;
+    }
+
+    request->strings = calloc((size_t)count + 1, sizeof(char *));
+    request->lengths = calloc(count, sizeof(uint32_t));
+    if (request->strings == NULL || request->lengths == NULL) {
+        serverRequestCleanup(request);
+        return 1;
+    }
+
+    unsigned long total = 0;
+    for (; request->count < count; request->count++) {
+        uint32_t length;
+        if (serverReadAll(fd, &length, sizeof(length)) ||
+            length > SERVER_REQUEST_LIMIT - total) {
+            serverRequestCleanup(request);
+            return 1;
+        }
+        total += length;
+
+        char *string = malloc((size_t)length + 1);
+        if (string == NULL || serverReadAll(fd, string, length)) {
+            free(string);
+            serverRequestCleanup(request);
+            return 1;
+        }
+        string[length] = '\0';
+        request->strings[request->count] = string;
+        request->lengths[request->count] = length;
+    }
+    return 0;
+}
+
+static void serverRequestCleanup(ServerRequest *request) {
+    for (uint32_t i = 0; i < request->count; i++) {
+        free(request->strings[i]);
+    }
+    free(request->strings);
+    free(request->lengths);
+    memset(request, 0, sizeof(ServerRequest));
+}
+
+// write the working directory, stdin bytes and arguments in one buffer
+static int serverSendRequest(int fd, const char *cwd, const char *input,
+                             size_t input_length,
+                             const ArgumentList *arguments) {
+    // the arguments end in a NULL terminator
+    uint32_t count = (uint32_t)arguments->count - 1 + 2;
+    if (input_length > SERVER_REQUEST_LIMIT) {
+        return 1;
+    }
+
+    char *buffer = NULL;
+    size_t length = 0;
+    FILE *request = open_memstream(&buffer, &length);
+    if (request == NULL) {
+        return 1;
+    }
+    fwrite(&count, sizeof(count), 1, request);
+    for (uint32_t i = 0; i < count; i++) {
+        const char *string = i == 0   ? cwd
+                             : i == 1 ? input
+                                      : arguments->values[i - 2];
+        uint32_t string_length =
+            i == 1 ? (uint32_t)input_length : (uint32_t)strlen(string);
+        fwrite(&string_length, sizeof(string_length), 1, request);
+        if (string_length > 0) {
+            fwrite(string, 1, string_length, request);
+        }
+    }
+
+    int return_error = fclose(request) != 0 ||
+                       serverWriteAll(fd, buffer, length);
+    free(buffer);
+    return return_error;
+}
+
+// read the whole of stdin
+static int serverReadInput(char **input, size_t *input_length) {
+    size_t capacity = 0;
+    while (1) {
+        if (*input_length == capacity) {
+            capacity = capacity ? capacity * 2 : SERVER_CHUNK_SIZE;
+            char *grown = realloc(*input, capacity);
+            if (grown == NULL || capacity > SERVER_REQUEST_LIMIT) {
+                free(grown != NULL ? grown : *input);
+                *input = NULL;
+                return 1;
+            }
+            *input = grown;
+        }
+        size_t got =
+            fread(*input + *input_length, 1, capacity - *input_length, stdin);
+        *input_length += got;
+        if (got == 0) {
+            return ferror(stdin) != 0;
+        }
+    }
+}
+
+// copy reply frames to stdout and stderr until the exit status
+static int serverReceive(int fd, int *exit_status) {
+    char chunk[SERVER_CHUNK_SIZE];
+    while (1) {
+        char kind;
+        uint32_t length;
+        if (serverReadAll(fd, &kind, 1) ||
+            serverReadAll(fd, &length, sizeof(length))) {
+            return 1;
+        }
+
+        if (kind == 'x') {
+            int32_t status;
+            if (length != sizeof(status) ||
+                serverReadAll(fd, &status, sizeof(status))) {
+                return 1;
+            }
+            *exit_status = status;
+            return 0;
+        }
+        if (kind != 'o' && kind != 'e') {
+            return 1;
+        }
+
+        // stdout is flushed first, as runOptionFlags does before --stats
+        FILE *stream = kind == 'o' ? stdout : stderr;
+        fflush(stdout);
+        while (length > 0) {
+            uint32_t part =
+                length < sizeof(chunk) ? length : (uint32_t)sizeof(chunk);
+            if (serverReadAll(fd, chunk, part)) {
+                return 1;
+            }
+            fwrite(chunk, 1, part, stream);
+            length -= part;
+        }
+    }
+}
+
+// a kind byte, the payload length, then the payload
+static int serverWriteFrame(int fd, char kind, const void *data,
+                            uint32_t length) {
+    char header[1 + sizeof(uint32_t)];
+    header[0] = kind;
+    memcpy(header + 1, &length, sizeof(length));
+    return serverWriteAll(fd, header, sizeof(header)) ||
+           serverWriteAll(fd, data, length);
+}
+
+static int serverAddress(const char *socket_path,
+                         struct sockaddr_un *address) {
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address->sun_path)) {
+        printf("ERROR: socket path '%s' is too long [SERVER_SOCKET_ERROR]\n",
+               socket_path);
+        return 1;
+    }
+    strcpy(address->sun_path, socket_path);
+    return 0;
+}
+
+// read exactly length bytes, 1 on errors and early ends
+static int serverReadAll(int fd, void *data, size_t length) {
+    char *bytes = data;
+    while (length > 0) {
+        ssize_t got = read(fd, bytes, length);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return 1;
+        }
+        bytes += got;
+        length -= (size_t)got;
+    }
+    return 0;
+}
+
+// write exactly length bytes, a closed peer is an error, not SIGPIPE
+static int serverWriteAll(int fd, const void *data, size_t length) {
+    const char *bytes = data;
+    while (length > 0) {
+        ssize_t sent = send(fd, bytes, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return 1;
+        }
+        bytes += sent;
+        length -= (size_t)sent;
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+// stats header implementation
+//
+// `stats.c` keeps clock reads out of per-token loops: callers take one lap
+// per phase. Peak RSS comes from getrusage where available.
+
+#include "stats.h"
+
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define STATS_HAVE_RUSAGE 1
+#endif
+
+static const char *const stats_phase_names[STATS_PHASE_COUNT] = {
+    [STATS_READ] = "read",
+    [STATS_LEX] = "lex",
+    [STATS_DIAGNOSTICS] = "diagnostics",
+    [STATS_PARSE] = "parse",
+    [STATS_BYTECODE] = "bytecode",
+    [STATS_OPTIMIZE] = "optimize",
+    [STATS_CODEGEN] = "codegen",
+    [STATS_RUN] = "run",
+    [STATS_SYMBOLS] = "symbols",
+    [STATS_CACHE] = "cache",
+};
+
+static long statsPeakRss(void);
+
+/// PUBLIC FUNCTIONS
+
+// monotonic clock in seconds, 0 without stats (no clock read)
+double statsClock(const CompileStats *stats) {
+    if (stats == NULL) {
+        return 0;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+// add the time since start to phase, returns the clock for the next phase
+double statsLap(CompileStats *stats, StatsPhase phase, double start) {
+    if (stats == NULL) {
+        return 0;
+    }
+
+    double now = statsClock(stats);
+    stats->phase_seconds[phase] += now - start;
+    return now;
+}
+
+// add stats of one file to total
+void statsAdd(CompileStats *total, const CompileStats *stats) {
+    for (int i = 0; i < STATS_PHASE_COUNT; i++) {
+        total->phase_seconds[i] += stats->phase_seconds[i];
+    }
+    for (int i = 0; i < TK_TYPE_COUNT; i++) {
+        total->token_counts[i] += stats->token_counts[i];
+    }
+    total->optimize.instructions += stats->optimize.instructions;
+    for (int i = 0; i < OPTIMIZE_PASS_COUNT; i++) {
+        total->optimize.rewritten[i] += stats->optimize.rewritten[i];
+        total->optimize.removed[i] += stats->optimize.removed[i];
+    }
+    total->bytes_read += stats->bytes_read;
+    total->files += stats->files;
+    total->cache_hits += stats->cache_hits;
+    total->cache_misses += stats->cache_misses;
+}
+
+// print the report with allocs (NULL when not counted) and the process peak
+// RSS to out
+void statsPrint(const CompileStats *stats, double total_seconds,
+                const AllocStat *allocs, StatsFormat format, FILE *out) {
+    long peak_rss = statsPeakRss();
+    const OptimizeStats *optimize = &stats->optimize;
+
+    unsigned long tokens = 0;
+    for (int i = 0; i < TK_TYPE_COUNT; i++) {
+        tokens += stats->token_counts[i];
+    }
+
+    if (format == STATS_JSON) {
+        fprintf(out, "{\"files\":%lu,\"bytes_read\":%lu,\"seconds\":{",
+                stats->files, stats->bytes_read);
+        for (int i = 0; i < STATS_PHASE_COUNT; i++) {
+            fprintf(out, "\"%s\":%.6f,", stats_phase_names[i],
+                    stats->phase_seconds[i]);
+        }
+        fprintf(out, "\"total\":%.6f},", total_seconds);
+        fprintf(out, "\"cache\":{\"hits\":%lu,\"misses\":%lu},",
+                stats->cache_hits, stats->cache_misses);
+
+        // unknown values are null rather than a misleading zero
+        if (allocs == NULL) {
+            fprintf(out, "\"allocations\":null,\"allocated_bytes\":null,");
+        } else {
+            fprintf(out, "\"allocations\":%lu,\"allocated_bytes\":%lu,",
+                    allocs->count, allocs->bytes);
+        }
+        if (peak_rss < 0) {
+            fprintf(out, "\"peak_rss_kib\":null,");
+        } else {
+            fprintf(out, "\"peak_rss_kib\":%ld,", peak_rss);
+        }
+
+        fprintf(out, "\"tokens\":{\"total\":%lu", tokens);
+        for (int i = 0; i < TK_TYPE_COUNT; i++) {
+            fprintf(out, ",\"%s\":%lu", tk_map[i], stats->token_counts[i]);
+        }
+
+        fprintf(out, "},\"optimize\":{\"instructions\":%lu",
+                optimize->instructions);
+        for (int i = 0; i < OPTIMIZE_PASS_COUNT; i++) {
+            fprintf(out, ",\"%s\":{\"rewritten\":%lu,\"removed\":%lu}",
+                    optimize_pass_names[i], optimize->rewritten[i],
+                    optimize->removed[i]);
+        }
+        fprintf(out, "}}\n");
+        return;
+    }
+
+    fprintf(out, "STATS: %lu file(s), %lu bytes read\n", stats->files,
+            stats->bytes_read);
+    for (int i = 0; i < STATS_PHASE_COUNT; i++) {
+        fprintf(out, "  %-16s %10.6f s\n", stats_phase_names[i],
+                stats->phase_seconds[i]);
+    }
+    fprintf(out, "  %-16s %10.6f s\n", "total", total_seconds);
+    if (stats->cache_hits + stats->cache_misses > 0) {
+        fprintf(out, "  %-16s %lu hit(s), %lu miss(es)\n", "cache",
+                stats->cache_hits, stats->cache_misses);
+    }
+    if (allocs == NULL) {
+        fprintf(out, "  %-16s unavailable\n", "allocations");
+    } else {
+        fprintf(out, "  %-16s %lu (%lu bytes)\n", "allocations",
+                allocs->count, allocs->bytes);
+    }
+    if (peak_rss < 0) {
+        fprintf(out, "  %-16s unavailable\n", "peak rss");
+    } else {
+        fprintf(out, "  %-16s %ld KiB\n", "peak rss", peak_rss);
+    }
+
+    // only token types seen
+    fprintf(out, "  %-16s %lu\n", "tokens", tokens);
+    for (int i = 0; i < TK_TYPE_COUNT; i++) {
+        if (stats->token_counts[i] > 0) {
+            fprintf(out, "    %-14s %lu\n", tk_map[i], stats->token_counts[i]);
+        }
+    }
+
+    // instructions left after each pass, only when bytecode was compiled
+    if (optimize->instructions > 0) {
+        unsigned long left = optimize->instructions;
+        fprintf(out, "  %-16s %lu\n", "instructions", left);
+        for (int i = 0; i < OPTIMIZE_PASS_COUNT; i++) {
+            left -= optimize->removed[i];
+            fprintf(out, "    %-14s %lu (%lu rewritten, %lu removed)\n",
+                    optimize_pass_names[i], left, optimize->rewritten[i],
+                    optimize->removed[i]);
+        }
+    }
+}
+
+/// PRIVATE FUNCTIONS
+
+// peak resident set size of the process in KiB, -1 where unknown
+static long statsPeakRss(void) {
+#ifdef STATS_HAVE_RUSAGE
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return -1;
+}
@@ -0,0 +1,162 @@
+// symtab header implementation
+//
+// `symtab.c` walks the node arrays of a tree in one pass, since names sit at
+// fixed tokens of their nodes (see ast.h) no recursion is needed. Rows are
+// found by symbol through a dense index, then sorted into source order.
+
+#include "symtab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const char *const symbol_kind_names[SYMBOL_KIND_COUNT] = {
+    [SYMBOL_UNDEFINED] = "undefined", [SYMBOL_FUNCTION] = "function",
+    [SYMBOL_PARAMETER] = "parameter", [SYMBOL_VARIABLE] = "variable",
+    [SYMBOL_ARRAY] = "array",         [SYMBOL_LABEL] = "label",
+};
+
+static uint32_t symtabNameToken(const Ast *ast, uint32_t node,
+                                SymbolKind *kind);
+static int symtabCompareRows(const void *first, const void *second);
+
+/// PUBLIC FUNCTIONS
+
+// collect a row for every interned name of ast
+int symtabBuild(SymbolTable *table, const Ast *ast, FILE *out) {
+    memset(table, 0, sizeof(SymbolTable));
+    const uint32_t *symbols = ast->tokens->symbols;
+    if (symbols == NULL) {
+        return 0;
+    }
+
+    // size the index by the highest symbol, the rows by the named nodes
+    uint32_t highest = 0;
+    uint32_t named = 0;
+    for (uint32_t node = 1; node < ast->node_count; node++) {
+        SymbolKind kind;
+        uint32_t token = symtabNameToken(ast, node, &kind);
+        if (token != UINT32_MAX && symbols[token] != 0) {
+            highest = symbols[token] > highest ? symbols[token] : highest;
+            named++;
+        }
+    }
+
+    uint32_t *row_of = calloc((size_t)highest + 1, sizeof(uint32_t));
+    table->rows = malloc(((size_t)named + 1) * sizeof(SymbolRow));
+    if (row_of == NULL || table->rows == NULL) {
+        fprintf(out, "ERROR: symbol table memory allocation failure "
+                     "[SYMBOL_ALLOCATION_ERROR]\n");
+        free(row_of);
+        symtabCleanup(table);
+        return 1;
+    }
+
+    for (uint32_t node = 1; node < ast->node_count; node++) {
+        SymbolKind kind;
+        uint32_t token = symtabNameToken(ast, node, &kind);
+        if (token == UINT32_MAX || symbols[token] == 0) {
+            continue;
+        }
+
+        uint32_t symbol = symbols[token];
+        if (row_of[symbol] == 0) {
+            table->rows[table->row_count] =
+                (SymbolRow){symbol, token, 0, SYMBOL_UNDEFINED};
+            row_of[symbol] = ++table->row_count;
+        }
+
+        // nodes are not in token order, keep the earliest definition
+        SymbolRow *row = &table->rows[row_of[symbol] - 1];
+        if (kind == SYMBOL_UNDEFINED) {
+            row->references++;
+            if (row->kind == SYMBOL_UNDEFINED && token < row->definition) {
+                row->definition = token;
+            }
+        } else if (row->kind == SYMBOL_UNDEFINED ||
+                   token < row->definition) {
+            row->definition = token;
+            row->kind = (uint8_t)kind;
+        }
+    }
+
+    free(row_of);
+    qsort(table->rows, table->row_count, sizeof(SymbolRow),
+          symtabCompareRows);
+    return 0;
+}
+
+// print the rows with names from names and positions from the tokens of
+// lexer's resident contents
+int symtabPrint(const SymbolTable *table, const Ast *ast, Lexer *lexer,
+                const InternTable *names, FILE *out) {
+    fprintf(out, "%-15s %-10s %-9s %-8s %s\n", "NAME", "KIND", "LINENO.",
+            "COLUMN", "REFERENCES");
+    for (uint32_t i = 0; i < table->row_count; i++) {
+        const SymbolRow *row = &table->rows[i];
+        uint32_t length;
+        const char *name = internName(names, row->symbol, &length);
+        unsigned long line;
+        unsigned long column;
+        if (name == NULL ||
+            lexerGetPosition(lexer, ast->tokens->starts[row->definition],
+                             &line, &column, out)) {
+            return 1;
+        }
+        fprintf(out, "%-15s %-10s %-9lu %-8lu %u\n", name,
+                symbol_kind_names[row->kind], line, column, row->references);
+    }
+    return ferror(out) != 0;
+}
+
+// free the rows
+void symtabCleanup(SymbolTable *table) {
+    free(table->rows);
+    memset(table, 0, sizeof(SymbolTable));
+}
+
+/// PRIVATE FUNCTIONS
+
+// token naming node (UINT32_MAX for none) and the kind it defines, or
+// SYMBOL_UNDEFINED for references
+static uint32_t symtabNameToken(const Ast *ast, uint32_t node,
+                                SymbolKind *kind) {
+    uint32_t token = ast->main_tokens[node];
+    const uint8_t *types = ast->tokens->types;
+
+    *kind = SYMBOL_UNDEFINED;
+    switch ((AstKind)ast->kinds[node]) {
+    case AST_FUNCTION:
+        *kind = SYMBOL_FUNCTION;
+        return token + 2;
+    case AST_PARAM:
+        *kind = SYMBOL_PARAMETER;
+        return token;
+    case AST_VAR_DECL:
+        *kind = types[token + 3] == TK_LBRACKET ? SYMBOL_ARRAY
+                                                : SYMBOL_VARIABLE;
+        return token + 2;
+    case AST_LABEL:
+        *kind = SYMBOL_LABEL;
+        return token;
+    case AST_IDENTIFIER:
+        return token;
+    case AST_BREAK:
+    case AST_CONTINUE:
+    case AST_GOTO:
+        return types[token + 1] == TK_IDENTIFIER ? token + 1 : UINT32_MAX;
+    default:
+        return UINT32_MAX;
+    }
+}
+
+// defined names first, each group in token order
+static int symtabCompareRows(const void *first, const void *second) {
+    const SymbolRow *a = first;
+    const SymbolRow *b = second;
+    int a_undefined = a->kind == SYMBOL_UNDEFINED;
+    int b_undefined = b->kind == SYMBOL_UNDEFINED;
+    if (a_undefined != b_undefined) {
+        return a_undefined - b_undefined;
+    }
+    return (a->definition > b->definition) - (a->definition < b->definition);
+}
@@ -0,0 +1,211 @@
+// threadpool header implementation
+//
+// `threadpool.c` runs a fixed set of numbered tasks on POSIX threads. Each
+// worker owns a mutex guarded queue, stealing from the back of the others
+// when its own is empty. No task is added after creation, so a worker exits
+// once every queue is empty.
+
+#include "threadpool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct ThreadPoolQueueStruct {
+    pthread_mutex_t lock;
+    unsigned long *tasks;
+    unsigned long head; // next own task
+    unsigned long tail; // one past the next stolen task
+} ThreadPoolQueue;
+
+typedef struct ThreadPoolWorkerStruct {
+    ThreadPool *pool;
+    unsigned int id;
+    pthread_t thread;
+    int started;
+} ThreadPoolWorker;
+
+struct ThreadPoolStruct {
+    ThreadPoolTask task;
+    void *context;
+    unsigned long task_count;
+
+    unsigned int thread_count;
+    ThreadPoolQueue *queues;
+    ThreadPoolWorker *workers;
+
+    // finished tasks, waited on in order by threadPoolWaitTask
+    pthread_mutex_t done_lock;
+    pthread_cond_t done_cond;
+    unsigned char *done;
+};
+
+static void *threadPoolWorkerRun(void *argument);
+static int threadPoolTakeOwn(ThreadPoolQueue *queue, unsigned long *index);
+static int threadPoolSteal(ThreadPoolQueue *queue, unsigned long *index);
+static void threadPoolFinishTask(ThreadPool *pool, unsigned long index);
+static void threadPoolFree(ThreadPool *pool);
+
+/// PUBLIC FUNCTIONS
+
+// start thread_count workers running task(context, index) for every index
+ThreadPool *threadPoolCreate(unsigned int thread_count,
+                             unsigned long task_count, ThreadPoolTask task,
+                             void *context) {
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    pool->task = task;
+    pool->context = context;
+    pool->task_count = task_count;
+    pool->thread_count = thread_count;
+    pool->queues = calloc(thread_count, sizeof(ThreadPoolQueue));
+    pool->workers = calloc(thread_count, sizeof(ThreadPoolWorker));
+    pool->done = calloc(task_count + 1, 1);
+    if (pool->queues == NULL || pool->workers == NULL || pool->done == NULL) {
+        threadPoolFree(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->done_lock, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    // deal tasks round-robin so every worker starts near the front
+    unsigned long per_queue = task_count / thread_count + 1;
+    for (unsigned int id = 0; id < thread_count; id++) {
+        ThreadPoolQueue *queue = &pool->queues[id];
+        queue->tasks = malloc(per_queue * sizeof(unsigned long));
+        if (queue->tasks == NULL) {
+            threadPoolFree(pool);
+            return NULL;
+        }
+        pthread_mutex_init(&queue->lock, NULL);
+        for (unsigned long index = id; index < task_count;
+             index += thread_count) {
+            queue->tasks[queue->tail++] = index;
+        }
+    }
+
+    // queues of workers failing to start are stolen by the others
+    unsigned int started = 0;
+    for (unsigned int id = 0; id < thread_count; id++) {
+        ThreadPoolWorker *worker = &pool->workers[id];
+        worker->pool = pool;
+        worker->id = id;
+        worker->started = pthread_create(&worker->thread, NULL,
+                                         threadPoolWorkerRun, worker) == 0;
+        started += worker->started;
+    }
+    if (started == 0) {
+        threadPoolWorkerRun(&pool->workers[0]);
+    }
+
+    return pool;
+}
+
+// block until the task at index has finished
+void threadPoolWaitTask(ThreadPool *pool, unsigned long index) {
+    pthread_mutex_lock(&pool->done_lock);
+    while (!pool->done[index]) {
+        pthread_cond_wait(&pool->done_cond, &pool->done_lock);
+    }
+    pthread_mutex_unlock(&pool->done_lock);
+}
+
+// wait for every task, join the workers and free the pool
+void threadPoolDestroy(ThreadPool **pool) {
+    if (*pool == NULL) {
+        return;
+    }
+
+    for (unsigned int id = 0; id < (*pool)->thread_count; id++) {
+        if ((*pool)->workers[id].started) {
+            pthread_join((*pool)->workers[id].thread, NULL);
+        }
+    }
+    threadPoolFree(*pool);
+    *pool = NULL;
+}
+
+// number of online processors, at least 1
+unsigned int threadPoolCoreCount(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (unsigned int)cores : 1;
+}
+
+/// PRIVATE FUNCTIONS
+
+// run own tasks front to back, then steal until every queue is empty
+static void *threadPoolWorkerRun(void *argument) {
+    ThreadPoolWorker *worker = argument;
+    ThreadPool *pool = worker->pool;
+    unsigned long index;
+
+    while (1) {
+        int found = threadPoolTakeOwn(&pool->queues[worker->id], &index);
+        for (unsigned int step = 1; !found && step < pool->thread_count;
+             step++) {
+            unsigned int victim = (worker->id + step) % pool->thread_count;
+            found = threadPoolSteal(&pool->queues[victim], &index);
+        }
+        if (!found) {
+            return NULL;
+        }
+
+        pool->task(pool->context, index);
+        threadPoolFinishTask(pool, index);
+    }
+}
+
+static int threadPoolTakeOwn(ThreadPoolQueue *queue, unsigned long *index) {
+    int found = 0;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head < queue->tail) {
+        *index = queue->tasks[queue->head++];
+        found = 1;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+static int threadPoolSteal(ThreadPoolQueue *queue, unsigned long *index) {
+    int found = 0;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head < queue->tail) {
+        *index = queue->tasks[--queue->tail];
+        found = 1;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+static void threadPoolFinishTask(ThreadPool *pool, unsigned long index) {
+    pthread_mutex_lock(&pool->done_lock);
+    pool->done[index] = 1;
+    pthread_cond_broadcast(&pool->done_cond);
+    pthread_mutex_unlock(&pool->done_lock);
+}
+
+static void threadPoolFree(ThreadPool *pool) {
+    if (pool->queues != NULL) {
+        for (unsigned int id = 0; id < pool->thread_count; id++) {
+            if (pool->queues[id].tasks != NULL) {
+                pthread_mutex_destroy(&pool->queues[id].lock);
+                free(pool->queues[id].tasks);
+            }
+        }
+    }
+    if (pool->done != NULL && pool->queues != NULL && pool->workers != NULL) {
+        pthread_mutex_destroy(&pool->done_lock);
+        pthread_cond_destroy(&pool->done_cond);
+    }
+    free(pool->queues);
+    free(pool->workers);
+    free(pool->done);
+    free(pool);
+}
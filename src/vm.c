@@ -0,0 +1,212 @@
+// vm header implementation
+//
+// `vm.c` sets up a run (register stack, call frames, globals) and hands it
+// to one of the loops of `vmloop.h`. Helpers the handlers share stay out of
+// the loop: division, conversions, strings and input. Strings and arrays
+// made while running are chained on a list and freed when the run ends, so
+// handlers never free anything.
+
+#include "vm.h"
+#include "parser.h" // parseReportError
+
+#include <inttypes.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct VmFrameStruct {
+    const uint32_t *return_pc; // instruction after the call
+    VmValue *base;             // register window of the caller
+} VmFrame;
+
+// header of every string and array made while running
+typedef union VmObjectUnion {
+    union VmObjectUnion *next;
+    max_align_t align;
+} VmObject;
+
+typedef struct VmStruct {
+    const VmProgram *program;
+    const VmRunOptions *options;
+    VmValue *stack;
+    VmFrame *frames;
+    VmValue *globals;
+    VmObject *objects;
+    char *line; // last line read, without its newline
+    size_t line_capacity;
+} Vm;
+
+static int vmParseVerdict(const char *text);
+static void *vmAlloc(Vm *vm, size_t size);
+static VmArray *vmNewArray(Vm *vm, int64_t length);
+static const char *vmCopyString(Vm *vm, const char *text, size_t length);
+static const char *vmConcat(Vm *vm, const char *left, const char *right);
+static const char *vmReadLine(Vm *vm);
+static void vmError(Vm *vm, uint32_t pc, const char *message);
+
+#if VM_HAVE_COMPUTED_GOTO
+#define VM_LOOP_NAME vmLoopGoto
+#define VM_LOOP_GOTO 1
+#define VM_LOOP_COUNT 0
+#include "vmloop.h"
+#undef VM_LOOP_NAME
+#undef VM_LOOP_GOTO
+#undef VM_LOOP_COUNT
+#endif
+
+#define VM_LOOP_NAME vmLoopSwitch
+#define VM_LOOP_GOTO 0
+#define VM_LOOP_COUNT 0
+#include "vmloop.h"
+#undef VM_LOOP_NAME
+#undef VM_LOOP_GOTO
+#undef VM_LOOP_COUNT
+
+#define VM_LOOP_NAME vmLoopCounted
+#define VM_LOOP_GOTO 0
+#define VM_LOOP_COUNT 1
+#include "vmloop.h"
+#undef VM_LOOP_NAME
+#undef VM_LOOP_GOTO
+#undef VM_LOOP_COUNT
+
+/// PUBLIC FUNCTIONS
+
+// goto dispatch, no counting, stdin and stdout, errors positioned in lexer
+void vmRunOptionsDefault(VmRunOptions *options, Lexer *lexer,
+                         const char *filename) {
+    options->dispatch = VM_DISPATCH_GOTO;
+    options->count_instructions = 0;
+    options->in = stdin;
+    options->out = stdout;
+    options->lexer = lexer;
+    options->filename = filename;
+}
+
+// run program from function 0, 1 on a runtime error (printed to out)
+int vmRun(const VmProgram *program, const VmRunOptions *options,
+          VmResult *result) {
+    result->exit_value = 0;
+    result->instructions = 0;
+    if (program->function_count == 0 || program->code_count == 0) {
+        return 0;
+    }
+
+    Vm vm = {.program = program, .options = options};
+    vm.stack = calloc(VM_STACK_SIZE, sizeof(VmValue));
+    vm.frames = malloc(VM_MAX_FRAMES * sizeof(VmFrame));
+    vm.globals = calloc(program->global_count + 1, sizeof(VmValue));
+    if (vm.stack == NULL || vm.frames == NULL || vm.globals == NULL) {
+        fprintf(options->out, "ERROR: virtual machine memory allocation "
+                              "failure [VM_ALLOCATION_ERROR]\n");
+        free(vm.stack);
+        free(vm.frames);
+        free(vm.globals);
+        return 1;
+    }
+
+    int status;
+    if (options->count_instructions) {
+        status = vmLoopCounted(&vm, result);
+    }
+#if VM_HAVE_COMPUTED_GOTO
+    else if (options->dispatch == VM_DISPATCH_GOTO) {
+        status = vmLoopGoto(&vm, result);
+    }
+#endif
+    else {
+        status = vmLoopSwitch(&vm, result);
+    }
+    fflush(options->out);
+
+    while (vm.objects != NULL) {
+        VmObject *next = vm.objects->next;
+        free(vm.objects);
+        vm.objects = next;
+    }
+    free(vm.line);
+    free(vm.stack);
+    free(vm.frames);
+    free(vm.globals);
+    return status;
+}
+
+/// PRIVATE FUNCTIONS
+
+// yay, y, true or a nonzero number
+static int vmParseVerdict(const char *text) {
+    return text[0] == 'y' || text[0] == 'Y' || text[0] == 't' ||
+           text[0] == 'T' || strtoll(text, NULL, 10) != 0;
+}
+
+static void *vmAlloc(Vm *vm, size_t size) {
+    VmObject *object = malloc(sizeof(VmObject) + size);
+    if (object == NULL) {
+        return NULL;
+    }
+    object->next = vm->objects;
+    vm->objects = object;
+    return object + 1;
+}
+
+static VmArray *vmNewArray(Vm *vm, int64_t length) {
+    if ((uint64_t)length > (SIZE_MAX - sizeof(VmArray)) / sizeof(VmValue)) {
+        return NULL;
+    }
+    size_t size = sizeof(VmArray) + (size_t)length * sizeof(VmValue);
+    VmArray *array = vmAlloc(vm, size);
+    if (array != NULL) {
+        memset(array, 0, size);
+        array->length = length;
+    }
+    return array;
+}
+
+static const char *vmCopyString(Vm *vm, const char *text, size_t length) {
+    char *copy = vmAlloc(vm, length + 1);
+    if (copy != NULL) {
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+static const char *vmConcat(Vm *vm, const char *left, const char *right) {
+    size_t left_length = strlen(left);
+    size_t right_length = strlen(right);
+    char *joined = vmAlloc(vm, left_length + right_length + 1);
+    if (joined != NULL) {
+        memcpy(joined, left, left_length);
+        memcpy(joined + left_length, right, right_length + 1);
+    }
+    return joined;
+}
+
+// next line of input without its newline, empty at end of input. Output
+// is flushed first so prompts show before the program waits.
+static const char *vmReadLine(Vm *vm) {
+    fflush(vm->options->out);
+    ssize_t length = getline(&vm->line, &vm->line_capacity, vm->options->in);
+    if (length < 0) {
+        length = 0;
+        if (vm->line == NULL && (vm->line = malloc(1)) == NULL) {
+            return "";
+        }
+    }
+    while (length > 0 &&
+           (vm->line[length - 1] == '\n' || vm->line[length - 1] == '\r')) {
+        length--;
+    }
+    vm->line[length] = '\0';
+    return vm->line;
+}
+
+// report at the source of instruction pc
+static void vmError(Vm *vm, uint32_t pc, const char *message) {
+    const VmRunOptions *options = vm->options;
+    fflush(options->out);
+    parseReportError(options->lexer, vm->program->tokens,
+                     vm->program->code_tokens[pc], options->filename,
+                     options->out, message, "RUNTIME_ERROR");
+}
@@ -0,0 +1,458 @@
+// `vmloop.h` - dispatch loop of the renaisscript virtual machine
+//
+// Included by vm.c once per loop, with no include guard, after defining:
+//
+//   VM_LOOP_NAME    name of the loop function
+//   VM_LOOP_GOTO    1 to thread handlers with computed goto, 0 for a switch
+//   VM_LOOP_COUNT   1 to count executed instructions
+//
+// The program counter, register window and frame depth stay in locals so
+// the compiler keeps them in machine registers. Handlers are written once
+// with VM_CASE and VM_NEXT, which expand to labels and `goto *` for the
+// threaded loop and to cases and `continue` for the switch.
+
+static int VM_LOOP_NAME(Vm *vm, VmResult *result) {
+    const VmProgram *program = vm->program;
+    const uint32_t *code = program->code;
+    const VmValue *constants = program->constants;
+    const VmFunction *functions = program->functions;
+    VmValue *globals = vm->globals;
+    VmFrame *frames = vm->frames;
+    const VmValue *stack_end = vm->stack + VM_STACK_SIZE;
+    FILE *out = vm->options->out;
+
+    VmValue *R = vm->stack;
+    const uint32_t *pc = code + functions[0].entry;
+    uint32_t depth = 0;
+    uint32_t i;
+    VmValue value;
+#if VM_LOOP_COUNT
+    unsigned long count = 0;
+#define VM_FETCH() (count++, i = *pc++)
+#else
+#define VM_FETCH() (i = *pc++)
+#endif
+
+#define RA R[VM_A(i)]
+#define RB R[VM_B(i)]
+#define RC R[VM_C(i)]
+#define VM_FAIL(message)                                                       \
+    do {                                                                       \
+        vmError(vm, (uint32_t)(pc - 1 - code), message);                       \
+        goto fail;                                                             \
+    } while (0)
+
+#if VM_LOOP_GOTO
+    static const void *const labels[OP_COUNT] = {
+#define OPCODE(name, format) [OP_##name] = &&L_##name,
+#include "opcodes.def"
+#undef OPCODE
+    };
+#define VM_CASE(name) L_##name:
+#define VM_NEXT goto *labels[VM_OP(VM_FETCH())]
+    VM_NEXT;
+#else
+#define VM_CASE(name) case OP_##name:
+#define VM_NEXT continue
+    for (;;) {
+        switch (VM_OP(VM_FETCH())) {
+#endif
+
+    VM_CASE(MOVE) {
+        RA = RB;
+        VM_NEXT;
+    }
+    VM_CASE(LOADI) {
+        RA.i = VM_SBX(i);
+        VM_NEXT;
+    }
+    VM_CASE(LOADK) {
+        RA = constants[VM_BX(i)];
+        VM_NEXT;
+    }
+    VM_CASE(LOADKX) {
+        RA = constants[*pc++];
+        VM_NEXT;
+    }
+    VM_CASE(GETGLOBAL) {
+        RA = globals[VM_BX(i)];
+        VM_NEXT;
+    }
+    VM_CASE(SETGLOBAL) {
+        globals[VM_BX(i)] = RA;
+        VM_NEXT;
+    }
+
+    // counts wrap around instead of overflowing
+    VM_CASE(ADD_I) {
+        RA.i = (int64_t)((uint64_t)RB.i + (uint64_t)RC.i);
+        VM_NEXT;
+    }
+    VM_CASE(SUB_I) {
+        RA.i = (int64_t)((uint64_t)RB.i - (uint64_t)RC.i);
+        VM_NEXT;
+    }
+    VM_CASE(MUL_I) {
+        RA.i = (int64_t)((uint64_t)RB.i * (uint64_t)RC.i);
+        VM_NEXT;
+    }
+    VM_CASE(DIV_I) {
+        if (RC.i == 0) {
+            VM_FAIL("division by zero");
+        }
+        RA.i = RC.i == -1 ? (int64_t)(0 - (uint64_t)RB.i) : RB.i / RC.i;
+        VM_NEXT;
+    }
+    VM_CASE(FLOORDIV_I) {
+        if (RC.i == 0) {
+            VM_FAIL("division by zero");
+        }
+        RA.i = vmFloorDivide(RB.i, RC.i);
+        VM_NEXT;
+    }
+    VM_CASE(MOD_I) {
+        if (RC.i == 0) {
+            VM_FAIL("division by zero");
+        }
+        RA.i = RC.i == -1 ? 0 : RB.i % RC.i;
+        VM_NEXT;
+    }
+    VM_CASE(POW_I) {
+        RA.i = vmPower(RB.i, RC.i);
+        VM_NEXT;
+    }
+    VM_CASE(ADDI) {
+        RA.i = (int64_t)((uint64_t)RB.i + (uint64_t)(int64_t)VM_SC(i));
+        VM_NEXT;
+    }
+
+    VM_CASE(ADD_F) {
+        RA.f = RB.f + RC.f;
+        VM_NEXT;
+    }
+    VM_CASE(SUB_F) {
+        RA.f = RB.f - RC.f;
+        VM_NEXT;
+    }
+    VM_CASE(MUL_F) {
+        RA.f = RB.f * RC.f;
+        VM_NEXT;
+    }
+    VM_CASE(DIV_F) {
+        RA.f = RB.f / RC.f;
+        VM_NEXT;
+    }
+    VM_CASE(FLOORDIV_F) {
+        RA.f = floor(RB.f / RC.f);
+        VM_NEXT;
+    }
+    VM_CASE(MOD_F) {
+        RA.f = fmod(RB.f, RC.f);
+        VM_NEXT;
+    }
+    VM_CASE(POW_F) {
+        RA.f = pow(RB.f, RC.f);
+        VM_NEXT;
+    }
+
+    VM_CASE(NEG_I) {
+        RA.i = (int64_t)(0 - (uint64_t)RB.i);
+        VM_NEXT;
+    }
+    VM_CASE(NEG_F) {
+        RA.f = -RB.f;
+        VM_NEXT;
+    }
+    VM_CASE(NOT) {
+        RA.i = RB.i == 0;
+        VM_NEXT;
+    }
+    VM_CASE(I2F) {
+        RA.f = (double)RB.i;
+        VM_NEXT;
+    }
+    VM_CASE(F2I) {
+        RA.i = vmTruncate(RB.f);
+        VM_NEXT;
+    }
+    VM_CASE(BOOL_I) {
+        RA.i = RB.i != 0;
+        VM_NEXT;
+    }
+    VM_CASE(BOOL_F) {
+        RA.i = RB.f != 0.0;
+        VM_NEXT;
+    }
+    VM_CASE(CHAR_I) {
+        RA.i = (unsigned char)RB.i;
+        VM_NEXT;
+    }
+
+    VM_CASE(EQ_I) {
+        RA.i = RB.i == RC.i;
+        VM_NEXT;
+    }
+    VM_CASE(NE_I) {
+        RA.i = RB.i != RC.i;
+        VM_NEXT;
+    }
+    VM_CASE(LT_I) {
+        RA.i = RB.i < RC.i;
+        VM_NEXT;
+    }
+    VM_CASE(LE_I) {
+        RA.i = RB.i <= RC.i;
+        VM_NEXT;
+    }
+    VM_CASE(EQI) {
+        RA.i = RB.i == VM_SC(i);
+        VM_NEXT;
+    }
+    VM_CASE(NEI) {
+        RA.i = RB.i != VM_SC(i);
+        VM_NEXT;
+    }
+    VM_CASE(LTI) {
+        RA.i = RB.i < VM_SC(i);
+        VM_NEXT;
+    }
+    VM_CASE(LEI) {
+        RA.i = RB.i <= VM_SC(i);
+        VM_NEXT;
+    }
+    VM_CASE(GTI) {
+        RA.i = RB.i > VM_SC(i);
+        VM_NEXT;
+    }
+    VM_CASE(GEI) {
+        RA.i = RB.i >= VM_SC(i);
+        VM_NEXT;
+    }
+    VM_CASE(EQ_F) {
+        RA.i = RB.f == RC.f;
+        VM_NEXT;
+    }
+    VM_CASE(NE_F) {
+        RA.i = RB.f != RC.f;
+        VM_NEXT;
+    }
+    VM_CASE(LT_F) {
+        RA.i = RB.f < RC.f;
+        VM_NEXT;
+    }
+    VM_CASE(LE_F) {
+        RA.i = RB.f <= RC.f;
+        VM_NEXT;
+    }
+    VM_CASE(EQ_S) {
+        RA.i = strcmp(RB.s, RC.s) == 0;
+        VM_NEXT;
+    }
+    VM_CASE(NE_S) {
+        RA.i = strcmp(RB.s, RC.s) != 0;
+        VM_NEXT;
+    }
+    VM_CASE(LT_S) {
+        RA.i = strcmp(RB.s, RC.s) < 0;
+        VM_NEXT;
+    }
+    VM_CASE(LE_S) {
+        RA.i = strcmp(RB.s, RC.s) <= 0;
+        VM_NEXT;
+    }
+
+    VM_CASE(JMP) {
+        pc += VM_SAX(i);
+        VM_NEXT;
+    }
+    VM_CASE(JMPF) {
+        if (!RA.i) {
+            pc += VM_SBX(i);
+        }
+        VM_NEXT;
+    }
+    VM_CASE(JMPT) {
+        if (RA.i) {
+            pc += VM_SBX(i);
+        }
+        VM_NEXT;
+    }
+
+    // the callee's window starts above the result register
+    VM_CASE(CALL) {
+        const VmFunction *fn = &functions[VM_BX(i)];
+        VmValue *base = R + VM_A(i) + 1;
+        if (depth == VM_MAX_FRAMES || base + fn->registers > stack_end) {
+            VM_FAIL("call stack overflow");
+        }
+        frames[depth++] = (VmFrame){pc, R};
+        R = base;
+        pc = code + fn->entry;
+        VM_NEXT;
+    }
+    VM_CASE(RET) {
+        value = RA;
+        goto leave;
+    }
+    VM_CASE(RET0) {
+        value.i = 0;
+        goto leave;
+    }
+
+    VM_CASE(NEWARRAY) {
+        if (RB.i < 0) {
+            VM_FAIL("negative array length");
+        }
+        RA.a = vmNewArray(vm, RB.i);
+        if (RA.a == NULL) {
+            VM_FAIL("out of memory");
+        }
+        VM_NEXT;
+    }
+    VM_CASE(GETINDEX) {
+        const VmArray *array = RB.a;
+        if (array == NULL || (uint64_t)RC.i >= (uint64_t)array->length) {
+            VM_FAIL("index out of bounds");
+        }
+        RA = array->items[RC.i];
+        VM_NEXT;
+    }
+    VM_CASE(SETINDEX) {
+        VmArray *array = RA.a;
+        if (array == NULL || (uint64_t)RB.i >= (uint64_t)array->length) {
+            VM_FAIL("index out of bounds");
+        }
+        array->items[RB.i] = RC;
+        VM_NEXT;
+    }
+    VM_CASE(GETCHAR) {
+        // the terminator must come after the index
+        if (RC.i < 0 || memchr(RB.s, '\0', (size_t)RC.i + 1) != NULL) {
+            VM_FAIL("index out of bounds");
+        }
+        RA.i = (unsigned char)RB.s[RC.i];
+        VM_NEXT;
+    }
+    VM_CASE(CONCAT) {
+        RA.s = vmConcat(vm, RB.s, RC.s);
+        if (RA.s == NULL) {
+            VM_FAIL("out of memory");
+        }
+        VM_NEXT;
+    }
+
+    VM_CASE(TOSTR_I) {
+        char text[32];
+        snprintf(text, sizeof(text), "%" PRId64, RB.i);
+        if ((RA.s = vmCopyString(vm, text, strlen(text))) == NULL) {
+            VM_FAIL("out of memory");
+        }
+        VM_NEXT;
+    }
+    VM_CASE(TOSTR_F) {
+        char text[32];
+        snprintf(text, sizeof(text), VM_PORTION_FORMAT, RB.f);
+        if ((RA.s = vmCopyString(vm, text, strlen(text))) == NULL) {
+            VM_FAIL("out of memory");
+        }
+        VM_NEXT;
+    }
+    VM_CASE(TOSTR_C) {
+        char text = (char)RB.i;
+        if ((RA.s = vmCopyString(vm, &text, 1)) == NULL) {
+            VM_FAIL("out of memory");
+        }
+        VM_NEXT;
+    }
+    VM_CASE(TOSTR_B) {
+        RA.s = RB.i ? "yay" : "nay";
+        VM_NEXT;
+    }
+
+    VM_CASE(PRINT_I) {
+        fprintf(out, "%" PRId64, RA.i);
+        VM_NEXT;
+    }
+    VM_CASE(PRINT_F) {
+        fprintf(out, VM_PORTION_FORMAT, RA.f);
+        VM_NEXT;
+    }
+    VM_CASE(PRINT_C) {
+        fputc((int)RA.i, out);
+        VM_NEXT;
+    }
+    VM_CASE(PRINT_B) {
+        fputs(RA.i ? "yay" : "nay", out);
+        VM_NEXT;
+    }
+    VM_CASE(PRINT_S) {
+        fputs(RA.s, out);
+        VM_NEXT;
+    }
+    VM_CASE(PRINTK) {
+        fputs(constants[VM_BX(i)].s, out);
+        VM_NEXT;
+    }
+    VM_CASE(PRINTNL) {
+        fputc('\n', out);
+        VM_NEXT;
+    }
+
+    VM_CASE(READ_I) {
+        RA.i = strtoll(vmReadLine(vm), NULL, 10);
+        VM_NEXT;
+    }
+    VM_CASE(READ_F) {
+        RA.f = strtod(vmReadLine(vm), NULL);
+        VM_NEXT;
+    }
+    VM_CASE(READ_C) {
+        RA.i = (unsigned char)vmReadLine(vm)[0];
+        VM_NEXT;
+    }
+    VM_CASE(READ_B) {
+        RA.i = vmParseVerdict(vmReadLine(vm));
+        VM_NEXT;
+    }
+    VM_CASE(READ_S) {
+        const char *line = vmReadLine(vm);
+        if ((RA.s = vmCopyString(vm, line, strlen(line))) == NULL) {
+            VM_FAIL("out of memory");
+        }
+        VM_NEXT;
+    }
+
+    // return value to the caller's result register, or end the run
+leave:
+    if (depth == 0) {
+        result->exit_value = value.i;
+#if VM_LOOP_COUNT
+        result->instructions = count;
+#endif
+        return 0;
+    }
+    depth--;
+    pc = frames[depth].return_pc;
+    R = frames[depth].base;
+    R[VM_A(pc[-1])] = value;
+    VM_NEXT;
+
+    fail:
+#if VM_LOOP_COUNT
+    result->instructions = count;
+#endif
+    return 1;
+
+#if !VM_LOOP_GOTO
+        }
+    }
+#endif
+
+#undef VM_FETCH
+#undef RA
+#undef RB
+#undef RC
+#undef VM_FAIL
+#undef VM_CASE
+#undef VM_NEXT
+}
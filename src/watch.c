@@ -0,0 +1,286 @@
+// watch header implementation
+//
+// `watch.c` watches the directories of the input files rather than the
+// files, since editors often save by renaming a new file over the old one,
+// which a watch on the old file would lose. Events are collected until
+// WATCH_DEBOUNCE_MS pass without one, so a burst of writes is one round.
+// A round reads again only the files named by its events, on a thread pool
+// like a batch, and prints the output of those whose contents changed in
+// input order. The -s file is rewritten from the rows kept for every file.
+
+#include "watch.h"
+#include "allocstat.h"  // --stats allocation counters
+#include "stats.h"      // CompileStats
+#include "threadpool.h" // ThreadPool
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define WATCH_DEBOUNCE_MS 2 // quiet time ending a burst of events
+
+// whole saves only: a file still open for writing may be half written
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO)
+
+// one input file and what its last compile left in memory
+typedef struct WatchFileStruct {
+    const char *filename;
+    const char *name; // last path component, as events name it
+    int watch;        // inotify watch of the directory holding it
+    int pending;      // named by an event since the last round
+    CompileUnit unit;
+    char *symbol_text; // -s rows of the last changed contents
+    size_t symbol_length;
+    char *out_text; // output of this round
+    size_t out_length;
+    CompileStats stats;
+} WatchFile;
+
+typedef struct WatchRoundStruct {
+    WatchFile *files;
+    unsigned long *pending; // indices of the files read again
+    const OptionFlags *flags;
+} WatchRound;
+
+static int watchAdd(int inotify_fd, WatchFile *file);
+static int watchWait(int inotify_fd, WatchFile *files, unsigned long count,
+                     FILE *out);
+static void watchRound(WatchRound *round, unsigned long count, FILE *out,
+                       FILE *err);
+static void watchRun(void *context, unsigned long index);
+
+/// PUBLIC FUNCTIONS
+
+// compile the files of flags on every save until interrupted, printing to
+// out and --stats reports of each round to err, returns 1 when watching
+// fails
+int watchFiles(const OptionFlags *flags, FILE *out, FILE *err) {
+    unsigned long count = flags->inputfile_count;
+    WatchFile *files = calloc(count, sizeof(WatchFile));
+    unsigned long *pending = malloc(count * sizeof(unsigned long));
+    int inotify_fd = inotify_init1(IN_CLOEXEC);
+    int return_error = files == NULL || pending == NULL || inotify_fd < 0;
+    if (return_error) {
+        fprintf(out, "ERROR: cannot start watching input files "
+                     "[WATCH_ERROR]\n");
+    }
+
+    for (unsigned long i = 0; i < count && !return_error; i++) {
+        files[i].filename = flags->inputfiles[i];
+        files[i].pending = 1;
+        return_error = watchAdd(inotify_fd, &files[i]);
+        if (return_error) {
+            fprintf(out, "ERROR: cannot watch the directory of '%s' "
+                         "[WATCH_ERROR]\n",
+                    files[i].filename);
+        }
+    }
+
+    // every file is compiled in the first round
+    WatchRound round = {files, pending, flags};
+    while (!return_error) {
+        unsigned long pending_count = 0;
+        for (unsigned long i = 0; i < count; i++) {
+            if (files[i].pending) {
+                files[i].pending = 0;
+                pending[pending_count++] = i;
+            }
+        }
+        if (pending_count > 0) {
+            watchRound(&round, pending_count, out, err);
+        }
+        return_error = watchWait(inotify_fd, files, count, out);
+    }
+
+    for (unsigned long i = 0; i < count && files != NULL; i++) {
+        compileUnitCleanup(&files[i].unit);
+        free(files[i].symbol_text);
+    }
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+    }
+    free(files);
+    free(pending);
+    return 1;
+}
+
+/// PRIVATE FUNCTIONS
+
+// watch the directory of file, sharing the watch of files beside it
+static int watchAdd(int inotify_fd, WatchFile *file) {
+    const char *slash = strrchr(file->filename, '/');
+    file->name = slash != NULL ? slash + 1 : file->filename;
+
+    char *directory = slash == NULL ? strdup(".")
+                      : slash == file->filename
+                          ? strdup("/")
+                          : strndup(file->filename,
+                                    (size_t)(slash - file->filename));
+    if (directory == NULL) {
+        return 1;
+    }
+    file->watch = inotify_add_watch(inotify_fd, directory, WATCH_EVENTS);
+    free(directory);
+    return file->watch < 0;
+}
+
+// block until an event names an input file, then collect events until none
+// come for WATCH_DEBOUNCE_MS, marking the files they name pending
+static int watchWait(int inotify_fd, WatchFile *files, unsigned long count,
+                     FILE *out) {
+    char buffer[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    int pending = 0;
+
+    while (1) {
+        struct pollfd poll_fd = {inotify_fd, POLLIN, 0};
+        int ready = poll(&poll_fd, 1, pending ? WATCH_DEBOUNCE_MS : -1);
+        if (ready == 0) {
+            return 0;
+        }
+        ssize_t length = ready < 0 ? -1 : read(inotify_fd, buffer,
+                                               sizeof(buffer));
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            fprintf(out, "ERROR: failed reading file events [WATCH_ERROR]\n");
+            return 1;
+        }
+
+        for (char *at = buffer; at < buffer + length;) {
+            const struct inotify_event *event = (void *)at;
+            at += sizeof(struct inotify_event) + event->len;
+
+            // dropped events may have named any file
+            int overflow = (event->mask & IN_Q_OVERFLOW) != 0;
+            for (unsigned long i = 0; i < count; i++) {
+                if (overflow ||
+                    (event->wd == files[i].watch && event->len > 0 &&
+                     strcmp(event->name, files[i].name) == 0)) {
+                    files[i].pending = 1;
+                    pending = 1;
+                }
+            }
+        }
+    }
+}
+
+// read the pending files again, print the output of the changed ones in
+// input order and rewrite -s with every file's rows
+static void watchRound(WatchRound *round, unsigned long count, FILE *out,
+                       FILE *err) {
+    const OptionFlags *flags = round->flags;
+    unsigned int thread_count = flags->jobcount;
+    if (thread_count == 0) {
+        thread_count = threadPoolCoreCount();
+    }
+    if (thread_count > count) {
+        thread_count = (unsigned int)count;
+    }
+
+    AllocStat allocs_before;
+    int no_allocs = allocStatGet(&allocs_before);
+    CompileStats stats = {0};
+    double start = statsClock(&stats);
+
+    ThreadPool *pool = NULL;
+    if (thread_count > 1) {
+        pool = threadPoolCreate(thread_count, count, watchRun, round);
+    }
+
+    // a single worker, or no pool, compiles here in order
+    int changed = 0;
+    for (unsigned long i = 0; i < count; i++) {
+        if (pool != NULL) {
+            threadPoolWaitTask(pool, i);
+        } else {
+            watchRun(round, i);
+        }
+
+        WatchFile *file = &round->files[round->pending[i]];
+        if (file->unit.changed && file->out_text != NULL) {
+            fwrite(file->out_text, 1, file->out_length, out);
+        }
+        changed |= file->unit.changed;
+        statsAdd(&stats, &file->stats);
+        free(file->out_text);
+        file->out_text = NULL;
+    }
+    if (pool != NULL) {
+        threadPoolDestroy(&pool);
+    }
+
+    if (changed && flags->symbolfile != NULL) {
+        FILE *symbol_file = fopen(flags->symbolfile, "w");
+        for (unsigned long i = 0; symbol_file != NULL &&
+                                  i < flags->inputfile_count;
+             i++) {
+            const WatchFile *file = &round->files[i];
+            if (file->symbol_text != NULL) {
+                fwrite(file->symbol_text, 1, file->symbol_length,
+                       symbol_file);
+            }
+        }
+        if (symbol_file == NULL || fclose(symbol_file) != 0) {
+            fprintf(out, "error: '%s'\n", flags->symbolfile);
+        }
+    }
+
+    fflush(out);
+    if (flags->statsformat != STATS_NONE && changed) {
+        AllocStat allocs;
+        no_allocs |= allocStatGet(&allocs);
+        allocs.count -= allocs_before.count;
+        allocs.bytes -= allocs_before.bytes;
+        statsPrint(&stats, statsClock(&stats) - start,
+                   no_allocs ? NULL : &allocs,
+                   (StatsFormat)flags->statsformat, err);
+        fflush(err);
+    }
+}
+
+// read one pending file again into memory streams, keeping its last -s
+// rows when the contents did not change
+static void watchRun(void *context, unsigned long index) {
+    WatchRound *round = context;
+    WatchFile *file = &round->files[round->pending[index]];
+    const OptionFlags *flags = round->flags;
+
+    char *symbol_text = NULL;
+    size_t symbol_length = 0;
+    FILE *out = open_memstream(&file->out_text, &file->out_length);
+    FILE *symbols = NULL;
+    if (flags->symbolfile != NULL) {
+        symbols = open_memstream(&symbol_text, &symbol_length);
+    }
+
+    memset(&file->stats, 0, sizeof(CompileStats));
+    if (out == NULL || (flags->symbolfile != NULL && symbols == NULL)) {
+        file->unit.changed = 1;
+        file->unit.status = 1;
+    } else {
+        compileUnitUpdate(&file->unit, file->filename, &flags->compile, out,
+                          symbols,
+                          flags->statsformat != STATS_NONE ? &file->stats
+                                                           : NULL);
+    }
+
+    // closing the streams finalizes text and length
+    if (out != NULL && fclose(out) != 0) {
+        file->unit.status = 1;
+    }
+    if (symbols != NULL && fclose(symbols) != 0) {
+        file->unit.status = 1;
+    }
+    if (file->unit.changed) {
+        free(file->symbol_text);
+        file->symbol_text = symbol_text;
+        file->symbol_length = symbol_length;
+    } else {
+        free(symbol_text);
+    }
+}
@@ -0,0 +1,42 @@
+# `batchorder.cmake` - check -j groups each file's output, failures included
+#
+# cmake -DRENAISSCRIPT=<binary> -DFILES=<file|file> [-DOPTIONS=<opt|opt>]
+#       -P batchorder.cmake
+#
+# Compiling FILES with -j 4 must print what compiling each file alone
+# prints, in input order, and fail when any of them fails. Errors of every
+# file, whichever part of the compiler reports them, belong to its group.
+
+string(REPLACE "|" ";" files "${FILES}")
+string(REPLACE "|" ";" options "${OPTIONS}")
+
+set(expected "")
+set(expected_failed 0)
+foreach(file ${files})
+  execute_process(
+    COMMAND ${RENAISSCRIPT} ${options} ${file}
+    OUTPUT_VARIABLE output
+    RESULT_VARIABLE result)
+  string(APPEND expected "${output}")
+  if(NOT result EQUAL 0)
+    set(expected_failed 1)
+  endif()
+endforeach()
+if(NOT expected_failed)
+  message(FATAL_ERROR "no file of ${FILES} fails")
+endif()
+
+execute_process(
+  COMMAND ${RENAISSCRIPT} ${options} -j 4 ${files}
+  OUTPUT_VARIABLE batch
+  RESULT_VARIABLE batch_result)
+if(batch_result EQUAL 0)
+  message(FATAL_ERROR "-j 4 exited 0 with a failing file")
+endif()
+if(NOT batch STREQUAL expected)
+  file(WRITE "${CMAKE_CURRENT_BINARY_DIR}/batchorder-expected.txt"
+       "${expected}")
+  file(WRITE "${CMAKE_CURRENT_BINARY_DIR}/batchorder-batch.txt" "${batch}")
+  message(FATAL_ERROR "-j 4 output is not the per file output in input "
+                      "order, see batchorder-*.txt")
+endif()
@@ -0,0 +1,99 @@
+# `cache.cmake` - check --cache replays the output of compiling a file
+#
+# cmake -DRENAISSCRIPT=<binary> -DSOURCE=<file> -DCACHE=<dir> -P cache.cmake
+#
+# A first compile misses and a second hits, both printing what an uncached
+# compile prints with the same exit code. A damaged entry misses again.
+# Eviction removes stale temporaries only, never other dotfiles. Past
+# --cache-size it removes the least recently hit entries and never touches
+# other *.rnc files.
+
+file(REMOVE_RECURSE ${CACHE})
+file(MAKE_DIRECTORY ${CACHE})
+set(dotfile ${CACHE}/.gitignore)
+set(stale ${CACHE}/.0123456789abcdef.AbC123)
+file(WRITE ${dotfile} "*\n")
+file(WRITE ${stale} "")
+execute_process(COMMAND touch -d "2 hours ago" ${dotfile} ${stale})
+set(options -S --symbols -O2 --bytecode)
+
+execute_process(
+  COMMAND ${RENAISSCRIPT} ${options} ${SOURCE}
+  OUTPUT_VARIABLE expected
+  RESULT_VARIABLE expected_result)
+
+foreach(run miss hit damaged)
+  if(run STREQUAL "damaged")
+    file(GLOB entries ${CACHE}/*.rnc)
+    foreach(entry ${entries})
+      file(APPEND ${entry} "x")
+    endforeach()
+  endif()
+
+  execute_process(
+    COMMAND ${RENAISSCRIPT} --cache=${CACHE} --stats=json ${options} ${SOURCE}
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE report
+    RESULT_VARIABLE result)
+  string(JSON hits GET "${report}" cache hits)
+  string(JSON misses GET "${report}" cache misses)
+
+  set(expected_hits 0)
+  if(run STREQUAL "hit")
+    set(expected_hits 1)
+  endif()
+  math(EXPR expected_misses "1 - ${expected_hits}")
+
+  if(NOT output STREQUAL expected OR NOT result EQUAL expected_result)
+    message(FATAL_ERROR "${run}: output or exit code ${result} differs")
+  endif()
+  if(NOT hits EQUAL expected_hits OR NOT misses EQUAL expected_misses)
+    message(FATAL_ERROR "${run}: ${hits} hits, ${misses} misses")
+  endif()
+endforeach()
+
+if(NOT EXISTS ${dotfile} OR EXISTS ${stale})
+  message(FATAL_ERROR "eviction removed ${dotfile} or kept ${stale}")
+endif()
+
+# three copies of SOURCE under a limit holding two of their entries: the
+# entry hit least recently goes, a user's keep.rnc older than all stays
+set(lru ${CACHE}/lru)
+file(MAKE_DIRECTORY ${lru})
+file(READ ${SOURCE} contents)
+set(keep ${lru}/keep.rnc)
+file(WRITE ${keep} "")
+execute_process(COMMAND touch -d "2 hours ago" ${keep})
+foreach(copy a b c)
+  file(WRITE ${CACHE}/lru-${copy}.rn "${contents}\n# ${copy}\n")
+endforeach()
+
+macro(compile_copy copy)
+  file(GLOB before ${lru}/*.rnc)
+  execute_process(
+    COMMAND ${RENAISSCRIPT} --cache=${lru} ${ARGN} ${options}
+            ${CACHE}/lru-${copy}.rn
+    OUTPUT_QUIET)
+  file(GLOB after ${lru}/*.rnc)
+  list(REMOVE_ITEM after ${before})
+  if(after)
+    set(entry_${copy} ${after})
+  endif()
+  # distinct modification times on coarse file system clocks
+  execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 0.05)
+endmacro()
+
+compile_copy(a)
+compile_copy(b)
+compile_copy(a)
+file(SIZE ${entry_a} size)
+math(EXPR limit "(${size} * 5 / 2 + 1023) / 1024")
+compile_copy(c --cache-size=${limit}k)
+
+if(NOT EXISTS ${entry_a} OR NOT EXISTS ${entry_c} OR EXISTS ${entry_b})
+  message(FATAL_ERROR "--cache-size=${limit}k did not evict only the entry "
+                      "hit least recently")
+endif()
+if(NOT EXISTS ${keep})
+  message(FATAL_ERROR "eviction removed ${keep}")
+endif()
@@ -0,0 +1,31 @@
+# `compare.cmake` - run two commands and fail when their outputs differ
+#
+# cmake -DFIRST=<cmd|args> -DSECOND=<cmd|args> [-DFIRST_INPUT=<file>]
+#       [-DSECOND_INPUT=<file>] -P compare.cmake
+#
+# Arguments of each command are separated by '|'. *_INPUT files are fed to
+# the command's stdin. Exit codes and stdout must match.
+
+foreach(side FIRST SECOND)
+  string(REPLACE "|" ";" command "${${side}}")
+  set(input_args)
+  if(${side}_INPUT)
+    set(input_args INPUT_FILE "${${side}_INPUT}")
+  endif()
+  execute_process(
+    COMMAND ${command} ${input_args}
+    OUTPUT_VARIABLE ${side}_OUTPUT
+    RESULT_VARIABLE ${side}_RESULT)
+endforeach()
+
+if(NOT FIRST_RESULT STREQUAL SECOND_RESULT)
+  message(FATAL_ERROR "exit codes differ: ${FIRST_RESULT} != ${SECOND_RESULT}")
+endif()
+
+if(NOT FIRST_OUTPUT STREQUAL SECOND_OUTPUT)
+  file(WRITE "${CMAKE_CURRENT_BINARY_DIR}/compare-first.txt" "${FIRST_OUTPUT}")
+  file(WRITE "${CMAKE_CURRENT_BINARY_DIR}/compare-second.txt"
+       "${SECOND_OUTPUT}")
+  message(FATAL_ERROR "outputs differ, see compare-first.txt and "
+                      "compare-second.txt in ${CMAKE_CURRENT_BINARY_DIR}")
+endif()
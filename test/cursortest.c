@@ -0,0 +1,118 @@
+// 'cursortest.c' - token cursor must follow the token stream of the lexer
+//
+// Concatenates the files given as arguments many times over, so the stream
+// wraps the ring buffer, and walks it with random peeks, advances, marks and
+// resets, comparing every token and begin offset to lexerTokenizeAll.
+
+#include "cursor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CURSORTEST_REPEAT 20
+#define CURSORTEST_STEPS 200000
+
+static int walkCursor(const char *contents, unsigned long length,
+                      LexerEngine engine);
+static int compareToken(const TokenBuffer *tokens, unsigned long index,
+                        Token tok, unsigned long begin);
+
+int main(int argc, char *argv[]) {
+    unsigned long capacity = 1 << 22;
+    char *contents = calloc(capacity, 1);
+    unsigned long length = 0;
+
+    for (int i = 1; i < argc; i++) {
+        FILE *file_ptr = fopen(argv[i], "rb");
+        if (file_ptr == NULL) {
+            printf("ERROR: cannot open '%s'\n", argv[i]);
+            free(contents);
+            return 1;
+        }
+        unsigned long file_length =
+            fread(contents + length, 1, 1 << 16, file_ptr);
+        fclose(file_ptr);
+
+        // a newline keeps line comments from running into the next copy
+        contents[length + file_length] = '\n';
+        file_length++;
+        for (int copy = 1; copy < CURSORTEST_REPEAT; copy++) {
+            memcpy(contents + length + copy * file_length, contents + length,
+                   file_length);
+        }
+        length += file_length * CURSORTEST_REPEAT;
+    }
+
+    srand(1);
+    int failed = walkCursor(contents, length, LEXER_ENGINE_SWITCH) ||
+                 walkCursor(contents, length, LEXER_ENGINE_DFA);
+    free(contents);
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static int walkCursor(const char *contents, unsigned long length,
+                      LexerEngine engine) {
+    TokenBuffer tokens = {0};
+    Lexer *lexer = initLexer(contents, length);
+    lexerSetEngine(lexer, engine);
+    int failed = lexerTokenizeAll(lexer, &tokens, stdout);
+    lexerCleanUp(&lexer);
+
+    TokenCursor cursor;
+    lexer = initLexer(contents, length);
+    lexerSetEngine(lexer, engine);
+    failed |= tokenCursorInit(&cursor, lexer, stdout);
+
+    unsigned long current = 0;
+    unsigned long mark = 0;
+    for (int step = 0; step < CURSORTEST_STEPS && !failed; step++) {
+        int action = rand() % 16;
+        if (action < 10) {
+            failed = compareToken(&tokens, current, tokenCursorAdvance(&cursor),
+                                  ~0UL);
+            current += current + 1 < tokens.count;
+        } else if (action < 13) {
+            unsigned int n = rand() % TOKEN_CURSOR_SIZE;
+            failed = compareToken(&tokens, current + n,
+                                  tokenCursorPeek(&cursor, n),
+                                  tokenCursorBegin(&cursor, n));
+        } else if (action < 15) {
+            mark = tokenCursorMark(&cursor);
+            failed = mark != current;
+        } else {
+            // marks stay valid until the cursor lexed a ring past them
+            int reset = tokenCursorReset(&cursor, mark);
+            int kept = cursor.tail <= mark + TOKEN_CURSOR_SIZE;
+            failed = reset == kept;
+            if (!reset) {
+                current = mark;
+            }
+        }
+        if (failed) {
+            printf("ERROR: cursor differs at token %lu, step %d, engine %d\n",
+                   current, step, engine);
+        }
+        if (current + 1 == tokens.count && rand() % 64 == 0) {
+            break;
+        }
+    }
+
+    lexerCleanUp(&lexer);
+    tokenBufferCleanup(&tokens);
+    return failed;
+}
+
+// tok (and begin unless ~0) must be token index, or TK_EOF past the end
+static int compareToken(const TokenBuffer *tokens, unsigned long index,
+                        Token tok, unsigned long begin) {
+    if (index >= tokens->count) {
+        index = tokens->count - 1;
+    }
+    return tok.type != (TokenType)tokens->types[index] ||
+           tok.start != tokens->starts[index] ||
+           tok.length != tokens->lengths[index] ||
+           (begin != ~0UL && begin != tokens->begins[index]);
+}
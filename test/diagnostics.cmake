@@ -0,0 +1,77 @@
+# `diagnostics.cmake` - check --diagnostics formats and --error-limit
+#
+# cmake -DRENAISSCRIPT=<binary> -DSOURCE=<file> [-DOPTIONS=<opt|opt>]
+#       -P diagnostics.cmake
+#
+# JSON lines and the SARIF log must parse and hold one record per error the
+# human output prints, with the same codes in the same order. A limit keeps
+# the first errors and adds one ERROR_LIMIT record counting the rest. Test
+# sources are ASCII apart from bytes that are not UTF-8, which must come out
+# escaped, so both outputs must be printable ASCII.
+
+string(REPLACE "|" ";" options "${OPTIONS}")
+execute_process(
+  COMMAND ${RENAISSCRIPT} ${options} ${SOURCE}
+  OUTPUT_VARIABLE human
+  RESULT_VARIABLE human_result)
+string(REGEX MATCHALL "\\[[A-Z_]+\\]\n" codes "${human}")
+list(TRANSFORM codes REPLACE "^\\[([A-Z_]+)\\]\n$" "\\1")
+list(LENGTH codes count)
+if(count EQUAL 0 OR human_result EQUAL 0)
+  message(FATAL_ERROR "${SOURCE} reports no errors")
+endif()
+
+foreach(limit 0 2)
+  set(expected ${codes})
+  if(limit GREATER 0)
+    list(SUBLIST codes 0 ${limit} expected)
+    list(APPEND expected ERROR_LIMIT)
+  endif()
+
+  execute_process(
+    COMMAND ${RENAISSCRIPT} ${options} --diagnostics=json
+            --error-limit=${limit} ${SOURCE}
+    OUTPUT_VARIABLE json
+    RESULT_VARIABLE json_result)
+  execute_process(
+    COMMAND ${RENAISSCRIPT} ${options} --diagnostics=sarif
+            --error-limit=${limit} ${SOURCE}
+    OUTPUT_VARIABLE sarif
+    RESULT_VARIABLE sarif_result)
+  string(REGEX MATCH "[^\n -~]" raw "${json}${sarif}")
+  if(NOT raw STREQUAL "")
+    message(FATAL_ERROR "limit ${limit}: unescaped byte in JSON or SARIF")
+  endif()
+
+  # one object per line read as an array
+  string(REGEX REPLACE "\n$" "" json "${json}")
+  string(REPLACE "\n" "," json "${json}")
+  string(JSON records LENGTH "[${json}]")
+  set(json_codes)
+  math(EXPR last "${records} - 1")
+  foreach(i RANGE ${last})
+    string(JSON code GET "[${json}]" ${i} code)
+    list(APPEND json_codes ${code})
+  endforeach()
+
+  string(JSON version GET "${sarif}" version)
+  string(JSON results LENGTH "${sarif}" runs 0 results)
+  set(sarif_codes)
+  math(EXPR last "${results} - 1")
+  foreach(i RANGE ${last})
+    string(JSON code GET "${sarif}" runs 0 results ${i} ruleId)
+    list(APPEND sarif_codes ${code})
+  endforeach()
+
+  if(NOT json_codes STREQUAL expected OR NOT sarif_codes STREQUAL expected)
+    message(FATAL_ERROR "limit ${limit}: expected ${expected}, json gave "
+                        "${json_codes}, sarif gave ${sarif_codes}")
+  endif()
+  if(NOT json_result EQUAL human_result OR NOT sarif_result EQUAL
+                                               human_result)
+    message(FATAL_ERROR "limit ${limit}: exit codes differ")
+  endif()
+  if(NOT version STREQUAL "2.1.0")
+    message(FATAL_ERROR "limit ${limit}: SARIF version ${version}")
+  endif()
+endforeach()
@@ -0,0 +1,216 @@
+// 'interntest.c' - identifier interning must give one symbol per name
+//
+// Interns the same names from many threads at once in different orders
+// into one small table, checking every thread got the same symbol for a
+// name and different symbols for different names, then lexes the files
+// given as arguments with both engines, serially and in parallel ranges,
+// checking identifiers share a symbol exactly when their lexemes are equal.
+
+#include "intern.h"
+#include "lexer.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERNTEST_THREADS 8
+#define INTERNTEST_NAMES 5000
+#define INTERNTEST_NAME_SIZE 8
+
+typedef struct InternTestThreadStruct {
+    InternTable *table;
+    unsigned int first; // name this thread starts from
+    uint32_t symbols[INTERNTEST_NAMES];
+} InternTestThread;
+
+static char interntest_names[INTERNTEST_NAMES][INTERNTEST_NAME_SIZE];
+
+static void *internNames(void *context);
+static uint32_t hashName(const char *name, uint32_t length);
+static int checkConcurrent(void);
+static int checkLexing(const char *name, const char *contents,
+                       unsigned long length);
+static int checkSymbols(const char *name, const char *contents,
+                        const TokenBuffer *tokens);
+
+int main(int argc, char *argv[]) {
+    int failed = checkConcurrent();
+
+    for (int i = 1; i < argc && !failed; i++) {
+        FILE *file_ptr = fopen(argv[i], "rb");
+        if (file_ptr == NULL) {
+            printf("ERROR: cannot open '%s'\n", argv[i]);
+            return 1;
+        }
+        char *contents = calloc(1 << 20, 1);
+        unsigned long length =
+            fread(contents, 1, (1 << 20) - LEXER_PADDING, file_ptr);
+        fclose(file_ptr);
+
+        failed = checkLexing(argv[i], contents, length);
+        free(contents);
+    }
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+// every name of interntest_names on one thread, starting at first
+static void *internNames(void *context) {
+    InternTestThread *thread = context;
+    for (unsigned int i = 0; i < INTERNTEST_NAMES; i++) {
+        unsigned int name = (thread->first + i) % INTERNTEST_NAMES;
+        uint32_t length = (uint32_t)strlen(interntest_names[name]);
+        thread->symbols[name] =
+            internSymbol(thread->table, interntest_names[name], length,
+                         hashName(interntest_names[name], length));
+    }
+    return NULL;
+}
+
+static uint32_t hashName(const char *name, uint32_t length) {
+    uint32_t hash = INTERN_HASH_SEED;
+    for (uint32_t i = 0; i < length; i++) {
+        hash = INTERN_HASH_STEP(hash, name[i]);
+    }
+    return hash;
+}
+
+static int checkConcurrent(void) {
+    // base 26 words, so no name is another's prefix of equal length
+    for (unsigned int i = 0; i < INTERNTEST_NAMES; i++) {
+        unsigned int value = i;
+        int length = 0;
+        do {
+            interntest_names[i][length++] = (char)('a' + value % 26);
+            value /= 26;
+        } while (value > 0);
+    }
+
+    // losing inserts keep their symbols, leave room for a few per name
+    InternTable *table = internCreate(INTERNTEST_NAMES * 2,
+                                      INTERNTEST_NAMES * 2 *
+                                          INTERNTEST_NAME_SIZE);
+    InternTestThread *threads =
+        calloc(INTERNTEST_THREADS, sizeof(InternTestThread));
+    pthread_t ids[INTERNTEST_THREADS];
+    if (table == NULL || threads == NULL) {
+        printf("ERROR: intern table allocation failure\n");
+        return 1;
+    }
+    for (int t = 0; t < INTERNTEST_THREADS; t++) {
+        threads[t].table = table;
+        threads[t].first = (unsigned int)t * 7919 % INTERNTEST_NAMES;
+        pthread_create(&ids[t], NULL, internNames, &threads[t]);
+    }
+    for (int t = 0; t < INTERNTEST_THREADS; t++) {
+        pthread_join(ids[t], NULL);
+    }
+
+    int failed = 0;
+    char *seen = calloc(internCount(table) + 1, 1);
+    for (unsigned int i = 0; i < INTERNTEST_NAMES && !failed; i++) {
+        uint32_t symbol = threads[0].symbols[i];
+        uint32_t length = 0;
+        const char *name = internName(table, symbol, &length);
+        if (symbol == 0 || seen[symbol] || name == NULL ||
+            strcmp(name, interntest_names[i]) != 0) {
+            printf("ERROR: name '%s' got symbol %u\n", interntest_names[i],
+                   symbol);
+            failed = 1;
+            break;
+        }
+        seen[symbol] = 1;
+        for (int t = 1; t < INTERNTEST_THREADS; t++) {
+            if (threads[t].symbols[i] != symbol) {
+                printf("ERROR: name '%s' got symbols %u and %u\n",
+                       interntest_names[i], symbol, threads[t].symbols[i]);
+                failed = 1;
+            }
+        }
+    }
+    free(seen);
+    free(threads);
+    internDestroy(&table);
+
+    // a full table hands out no more symbols but finds the ones it has
+    table = internCreate(2, 64);
+    uint32_t first = internSymbol(table, "first", 5, hashName("first", 5));
+    uint32_t second = internSymbol(table, "second", 6, hashName("second", 6));
+    if (internSymbol(table, "third", 5, hashName("third", 5)) != 0 ||
+        internSymbol(table, "first", 5, hashName("first", 5)) != first ||
+        first == 0 || second == 0 || first == second) {
+        printf("ERROR: full intern table\n");
+        failed = 1;
+    }
+    internDestroy(&table);
+    return failed;
+}
+
+static int checkLexing(const char *name, const char *contents,
+                       unsigned long length) {
+    int failed = 0;
+    for (int engine = LEXER_ENGINE_SWITCH; engine <= LEXER_ENGINE_DFA;
+         engine++) {
+        for (unsigned int threads = 1; threads <= 4 && !failed;
+             threads += 3) {
+            InternTable *table = internCreateFor(length);
+            Lexer *lexer = initLexer(contents, length);
+            lexerSetEngine(lexer, (LexerEngine)engine);
+            lexerSetSymbols(lexer, table);
+
+            TokenBuffer tokens = {0};
+            int status =
+                threads == 1
+                    ? lexerTokenizeAll(lexer, &tokens, stdout)
+                    : lexerTokenizeParallel(lexer, threads, 64, &tokens,
+                                            stdout);
+            failed = status || checkSymbols(name, contents, &tokens);
+
+            tokenBufferCleanup(&tokens);
+            lexerCleanUp(&lexer);
+            internDestroy(&table);
+        }
+    }
+    return failed;
+}
+
+// identifiers have symbols, equal exactly for equal lexemes, other tokens
+// have none
+static int checkSymbols(const char *name, const char *contents,
+                        const TokenBuffer *tokens) {
+    int has_identifier = 0;
+    for (unsigned long i = 0; i < tokens->count; i++) {
+        has_identifier |= tokens->types[i] == TK_IDENTIFIER;
+    }
+    if (has_identifier && tokens->symbols == NULL) {
+        printf("ERROR: %s has no symbols\n", name);
+        return 1;
+    }
+
+    for (unsigned long i = 0; i < tokens->count && has_identifier; i++) {
+        int identifier = tokens->types[i] == TK_IDENTIFIER;
+        if (identifier != (tokens->symbols[i] != 0)) {
+            printf("ERROR: %s token %lu has symbol %u\n", name, i,
+                   tokens->symbols[i]);
+            return 1;
+        }
+        for (unsigned long j = 0; j < i && identifier; j++) {
+            if (tokens->types[j] != TK_IDENTIFIER) {
+                continue;
+            }
+            int same = tokens->lengths[i] == tokens->lengths[j] &&
+                       memcmp(contents + tokens->starts[i],
+                              contents + tokens->starts[j],
+                              tokens->lengths[i]) == 0;
+            if (same != (tokens->symbols[i] == tokens->symbols[j])) {
+                printf("ERROR: %s tokens %lu and %lu symbols differ from "
+                       "their lexemes\n",
+                       name, j, i);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+// 'lexinctest.c' - incremental relexing must match lexing the edited file
+//
+// Applies random edits (inserting, removing and replacing pieces that open
+// and close '##' comments and strings) to the files given as arguments and
+// to random sources, relexing after every edit with lexerRelex, and compares
+// the tokens and every token position to a fresh lexerTokenizeAll.
+
+#include "lexer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LEXINCTEST_ROUNDS 200
+#define LEXINCTEST_EDITS 20
+#define LEXINCTEST_MAX_PIECES 80
+
+static const char *const lexinctest_pieces[] = {
+    " ",  "\n", "\t", "#",   "##",  "##\n", "\"",  "\\\"", "'",   "'a'",
+    "a",  "ab", "12", "1.5", "=",   "==",   "+",   "(",    "}\n", ";",
+    "if", "x y", "# c\n", "\"s\"", "## b ##", "\0",
+};
+
+#define LEXINCTEST_PIECE_COUNT                                                 \
+    (int)(sizeof(lexinctest_pieces) / sizeof(lexinctest_pieces[0]))
+
+static int checkEdits(const char *name, const char *contents,
+                      unsigned long length);
+static char *applyEdit(const char *contents, unsigned long length,
+                       LexerEdit *edit, unsigned long *edited_length);
+static int compareRelexed(Lexer *lexer, const TokenBuffer *relexed);
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    srand(1);
+
+    for (int i = 1; i < argc && !failed; i++) {
+        FILE *file_ptr = fopen(argv[i], "rb");
+        if (file_ptr == NULL) {
+            printf("ERROR: cannot open '%s'\n", argv[i]);
+            return 1;
+        }
+        char *contents = calloc(1 << 20, 1);
+        unsigned long length =
+            fread(contents, 1, (1 << 20) - LEXER_PADDING, file_ptr);
+        fclose(file_ptr);
+
+        failed = checkEdits(argv[i], contents, length);
+        free(contents);
+    }
+
+    char *contents = malloc(LEXINCTEST_MAX_PIECES * 8 + LEXER_PADDING);
+    for (int round = 0; round < LEXINCTEST_ROUNDS && !failed; round++) {
+        unsigned long length = 0;
+        int pieces = rand() % LEXINCTEST_MAX_PIECES;
+        for (int i = 0; i < pieces; i++) {
+            const char *text =
+                lexinctest_pieces[rand() % LEXINCTEST_PIECE_COUNT];
+            unsigned long piece_length = text[0] == '\0' ? 1 : strlen(text);
+            memcpy(contents + length, text, piece_length);
+            length += piece_length;
+        }
+        memset(contents + length, 0, LEXER_PADDING);
+        failed = checkEdits("<random>", contents, length);
+    }
+    free(contents);
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+// relex a chain of random edits with both engines
+static int checkEdits(const char *name, const char *contents,
+                      unsigned long length) {
+    for (int engine = LEXER_ENGINE_SWITCH; engine <= LEXER_ENGINE_DFA;
+         engine++) {
+        char *current = malloc(length + LEXER_PADDING);
+        memcpy(current, contents, length + LEXER_PADDING);
+        unsigned long current_length = length;
+
+        TokenBuffer tokens = {0};
+        Lexer *lexer = initLexer(current, current_length);
+        lexerSetEngine(lexer, (LexerEngine)engine);
+        int status = lexerTokenizeAll(lexer, &tokens, stdout);
+
+        // build the line index so edits have to update it
+        unsigned long line;
+        unsigned long column;
+        status |= lexerGetPosition(lexer, 0, &line, &column, stdout);
+
+        for (int i = 0; i < LEXINCTEST_EDITS && !status; i++) {
+            LexerEdit edit;
+            unsigned long edited_length;
+            char *edited =
+                applyEdit(current, current_length, &edit, &edited_length);
+
+            status = lexerRelex(lexer, edited, edited_length, &edit, &tokens,
+                                stdout) ||
+                     compareRelexed(lexer, &tokens);
+            if (status) {
+                printf("ERROR: %s differs with engine %d after edit %d "
+                       "(%lu, -%lu, +%lu)\n",
+                       name, engine, i, edit.start, edit.removed_length,
+                       edit.inserted_length);
+            }
+
+            free(current);
+            current = edited;
+            current_length = edited_length;
+        }
+
+        lexerCleanUp(&lexer);
+        tokenBufferCleanup(&tokens);
+        free(current);
+        if (status) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// copy contents with a random range replaced by random pieces
+static char *applyEdit(const char *contents, unsigned long length,
+                       LexerEdit *edit, unsigned long *edited_length) {
+    char inserted[64];
+    unsigned long inserted_length = 0;
+    int pieces = rand() % 4;
+    for (int i = 0; i < pieces; i++) {
+        const char *text = lexinctest_pieces[rand() % LEXINCTEST_PIECE_COUNT];
+        unsigned long piece_length = text[0] == '\0' ? 1 : strlen(text);
+        memcpy(inserted + inserted_length, text, piece_length);
+        inserted_length += piece_length;
+    }
+
+    edit->start = rand() % (length + 1);
+    edit->removed_length = rand() % 8;
+    if (edit->removed_length > length - edit->start) {
+        edit->removed_length = length - edit->start;
+    }
+    edit->inserted_length = inserted_length;
+
+    unsigned long rest = edit->start + edit->removed_length;
+    *edited_length = length - edit->removed_length + inserted_length;
+    char *edited = calloc(*edited_length + LEXER_PADDING, 1);
+    memcpy(edited, contents, edit->start);
+    memcpy(edited + edit->start, inserted, inserted_length);
+    memcpy(edited + edit->start + inserted_length, contents + rest,
+           length - rest);
+    return edited;
+}
+
+// relexed tokens and positions must match a fresh lexer over the contents
+static int compareRelexed(Lexer *lexer, const TokenBuffer *relexed) {
+    TokenBuffer expect = {0};
+    Lexer *fresh = initLexer(lexer->contents, lexer->content_length);
+    lexerSetEngine(fresh, lexer->engine);
+    int failed = lexerTokenizeAll(fresh, &expect, stdout) ||
+                 expect.count != relexed->count;
+
+    unsigned long count = failed ? 0 : expect.count;
+    failed |= memcmp(expect.types, relexed->types, count) != 0 ||
+              memcmp(expect.starts, relexed->starts, count * 4) != 0 ||
+              memcmp(expect.lengths, relexed->lengths, count * 4) != 0 ||
+              memcmp(expect.begins, relexed->begins, count * 4) != 0;
+
+    for (unsigned long i = 0; i < count && !failed; i++) {
+        unsigned long line;
+        unsigned long column;
+        unsigned long test_line;
+        unsigned long test_column;
+        failed = lexerGetPosition(fresh, expect.begins[i], &line, &column,
+                                  stdout) ||
+                 lexerGetPosition(lexer, expect.begins[i], &test_line,
+                                  &test_column, stdout) ||
+                 line != test_line || column != test_column;
+    }
+
+    lexerCleanUp(&fresh);
+    tokenBufferCleanup(&expect);
+    return failed;
+}
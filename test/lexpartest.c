@@ -0,0 +1,145 @@
+// 'lexpartest.c' - parallel lexing must match serial lexing token for token
+//
+// Lexes the files given as arguments and random sources full of block
+// comments, strings and zero bytes with lexerTokenizeParallel at many range
+// sizes, comparing types, slices and token begins to lexerTokenizeAll, and
+// checks lexerGetPosition against newlines counted up to every token.
+
+#include "lexer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LEXPARTEST_ROUNDS 300
+#define LEXPARTEST_MAX_PIECES 120
+
+static const char *const lexpartest_pieces[] = {
+    " ",  "  ",   "\t", "\n", "\r\n", "#",     "##", "##\n", "\"",     "\\\"",
+    "\\", "'",    "'a'", "a", "abc",  "12",    "1.5", "=",   "+=",     "(",
+    ")",  "{\n",  "}",  ";", "\0",   "    ", "if", "x y", "# c\n", "\"s\"",
+};
+
+static int compareLexing(const char *name, const char *contents,
+                         unsigned long length);
+static int compareBuffers(const TokenBuffer *expect, const TokenBuffer *test);
+static int comparePositions(const char *contents, unsigned long length,
+                            const TokenBuffer *tokens);
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+
+    for (int i = 1; i < argc && !failed; i++) {
+        FILE *file_ptr = fopen(argv[i], "rb");
+        if (file_ptr == NULL) {
+            printf("ERROR: cannot open '%s'\n", argv[i]);
+            return 1;
+        }
+        char *contents = calloc(1 << 20, 1);
+        unsigned long length =
+            fread(contents, 1, (1 << 20) - LEXER_PADDING, file_ptr);
+        fclose(file_ptr);
+
+        failed = compareLexing(argv[i], contents, length);
+        free(contents);
+    }
+
+    srand(1);
+    char *contents = malloc(LEXPARTEST_MAX_PIECES * 8 + LEXER_PADDING);
+    for (int round = 0; round < LEXPARTEST_ROUNDS && !failed; round++) {
+        unsigned long length = 0;
+        int pieces = rand() % LEXPARTEST_MAX_PIECES;
+        for (int i = 0; i < pieces; i++) {
+            int piece = rand() % (int)(sizeof(lexpartest_pieces) /
+                                       sizeof(lexpartest_pieces[0]));
+            const char *text = lexpartest_pieces[piece];
+            unsigned long piece_length = text[0] == '\0' ? 1 : strlen(text);
+            memcpy(contents + length, text, piece_length);
+            length += piece_length;
+        }
+        memset(contents + length, 0, LEXER_PADDING);
+        failed = compareLexing("<random>", contents, length);
+    }
+    free(contents);
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static int compareLexing(const char *name, const char *contents,
+                         unsigned long length) {
+    for (int engine = LEXER_ENGINE_SWITCH; engine <= LEXER_ENGINE_DFA;
+         engine++) {
+        TokenBuffer expect = {0};
+        Lexer *lexer = initLexer(contents, length);
+        lexerSetEngine(lexer, (LexerEngine)engine);
+        int status = lexerTokenizeAll(lexer, &expect, stdout);
+        lexerCleanUp(&lexer);
+        if (!status && comparePositions(contents, length, &expect)) {
+            printf("ERROR: %s line lookup differs\n", name);
+            status = 1;
+        }
+
+        for (unsigned long chunk = 1; chunk <= 64 && !status; chunk++) {
+            TokenBuffer test = {0};
+            lexer = initLexer(contents, length);
+            lexerSetEngine(lexer, (LexerEngine)engine);
+            status = lexerTokenizeParallel(lexer, chunk % 4 + 1, chunk, &test,
+                                           stdout);
+            lexerCleanUp(&lexer);
+
+            if (status || compareBuffers(&expect, &test)) {
+                printf("ERROR: %s differs with engine %d, %lu byte ranges\n",
+                       name, engine, chunk);
+                status = 1;
+            }
+            tokenBufferCleanup(&test);
+        }
+        tokenBufferCleanup(&expect);
+
+        if (status) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int compareBuffers(const TokenBuffer *expect, const TokenBuffer *test) {
+    if (expect->count != test->count) {
+        return 1;
+    }
+
+    unsigned long count = expect->count;
+    return memcmp(expect->types, test->types, count) != 0 ||
+           memcmp(expect->starts, test->starts, count * 4) != 0 ||
+           memcmp(expect->lengths, test->lengths, count * 4) != 0 ||
+           memcmp(expect->begins, test->begins, count * 4) != 0;
+}
+
+static int comparePositions(const char *contents, unsigned long length,
+                            const TokenBuffer *tokens) {
+    Lexer *lexer = initLexer(contents, length);
+    unsigned long line = 1;
+    unsigned long line_start = 0;
+    unsigned long counted = 0;
+    int failed = 0;
+
+    for (unsigned long i = 0; i < tokens->count && !failed; i++) {
+        unsigned long begin = tokens->begins[i];
+        for (; counted < begin && counted < length; counted++) {
+            if (contents[counted] == '\n') {
+                line++;
+                line_start = counted + 1;
+            }
+        }
+
+        unsigned long test_line;
+        unsigned long test_column;
+        failed = lexerGetPosition(lexer, begin, &test_line, &test_column,
+                                  stdout) ||
+                 test_line != line || test_column != begin - line_start + 1;
+    }
+
+    lexerCleanUp(&lexer);
+    return failed;
+}
@@ -0,0 +1,194 @@
+// 'libtest.c' - many lexers and compiles at once in one process
+//
+// Lexes the files given as arguments on many threads at the same time, with
+// both engines, serial and parallel, resolving every token position, and
+// compiles them with -S rows into memory streams. Every result must match
+// the one computed on the main thread first. Built a second time with
+// ThreadSanitizer, where any shared state in the library shows up as a race.
+
+#include "renaisscript.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LIBTEST_THREADS 8
+#define LIBTEST_ROUNDS 4
+#define LIBTEST_MAX_FILES 64
+
+// one input file with its reference tokens and compile output
+typedef struct LibTestFileStruct {
+    const char *name;
+    char *contents;
+    unsigned long length;
+    TokenBuffer tokens;
+    char *out_text;
+    size_t out_length;
+    int out_status; // files with lexical errors fail to compile
+} LibTestFile;
+
+typedef struct LibTestStruct {
+    LibTestFile files[LIBTEST_MAX_FILES];
+    int file_count;
+    atomic_int failures;
+} LibTest;
+
+typedef struct LibTestWorkerStruct {
+    LibTest *test;
+    int index;
+} LibTestWorker;
+
+static int libTestLoad(LibTestFile *file, const char *name);
+static int libTestCompile(const char *name, char **text, size_t *length);
+static int libTestLex(const LibTestFile *file, LexerEngine engine,
+                      unsigned int lex_threads);
+static void *libTestWorkerRun(void *argument);
+
+int main(int argc, char *argv[]) {
+    LibTest test;
+    memset(&test, 0, sizeof(test));
+    atomic_init(&test.failures, 0);
+
+    for (int i = 1; i < argc && i <= LIBTEST_MAX_FILES; i++) {
+        if (libTestLoad(&test.files[test.file_count], argv[i])) {
+            return 1;
+        }
+        test.file_count++;
+    }
+
+    pthread_t threads[LIBTEST_THREADS];
+    LibTestWorker workers[LIBTEST_THREADS];
+    int started = 0;
+    for (; started < LIBTEST_THREADS; started++) {
+        workers[started] = (LibTestWorker){&test, started};
+        if (pthread_create(&threads[started], NULL, libTestWorkerRun,
+                           &workers[started]) != 0) {
+            printf("ERROR: cannot start thread %d\n", started);
+            atomic_fetch_add(&test.failures, 1);
+            break;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < test.file_count; i++) {
+        free(test.files[i].contents);
+        free(test.files[i].out_text);
+        tokenBufferCleanup(&test.files[i].tokens);
+    }
+
+    int failed = atomic_load(&test.failures) != 0;
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+// read a file padded for the dfa engine, lex and compile it once
+static int libTestLoad(LibTestFile *file, const char *name) {
+    FILE *file_ptr = fopen(name, "rb");
+    if (file_ptr == NULL) {
+        printf("ERROR: cannot open '%s'\n", name);
+        return 1;
+    }
+    file->name = name;
+    file->contents = calloc(1 << 20, 1);
+    file->length =
+        fread(file->contents, 1, (1 << 20) - LEXER_PADDING, file_ptr);
+    fclose(file_ptr);
+
+    Lexer *lexer = initLexer(file->contents, file->length);
+    int status = lexerTokenizeAll(lexer, &file->tokens, stdout);
+    lexerCleanUp(&lexer);
+
+    file->out_status =
+        libTestCompile(name, &file->out_text, &file->out_length);
+    if (status || file->out_status < 0) {
+        printf("ERROR: cannot lex or compile '%s'\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+// compile with -S rows into a memory stream, -1 when the stream fails
+static int libTestCompile(const char *name, char **text, size_t *length) {
+    CompileOptions options;
+    compileOptionsDefault(&options);
+    options.symbol_out = 1;
+
+    *text = NULL;
+    FILE *out = open_memstream(text, length);
+    if (out == NULL) {
+        return -1;
+    }
+    CompileStats stats = {0};
+    int status = compileRensFile(name, &options, out, NULL, &stats);
+    return fclose(out) != 0 ? -1 : status;
+}
+
+// lex a shared file and compare tokens and positions to the reference
+static int libTestLex(const LibTestFile *file, LexerEngine engine,
+                      unsigned int lex_threads) {
+    TokenBuffer tokens = {0};
+    Lexer *lexer = initLexer(file->contents, file->length);
+    lexerSetEngine(lexer, engine);
+    int status = lex_threads == 1
+                     ? lexerTokenizeAll(lexer, &tokens, stdout)
+                     : lexerTokenizeParallel(lexer, lex_threads, 64, &tokens,
+                                             stdout);
+
+    const TokenBuffer *expect = &file->tokens;
+    unsigned long count = expect->count;
+    status = status || tokens.count != count ||
+             memcmp(tokens.types, expect->types, count) != 0 ||
+             memcmp(tokens.starts, expect->starts, count * 4) != 0 ||
+             memcmp(tokens.lengths, expect->lengths, count * 4) != 0 ||
+             memcmp(tokens.begins, expect->begins, count * 4) != 0;
+
+    // every lexer builds its own line index
+    for (unsigned long i = 0; i < count && !status; i++) {
+        unsigned long line;
+        unsigned long column;
+        status = lexerGetPosition(lexer, tokens.begins[i], &line, &column,
+                                  stdout) ||
+                 line == 0 || column == 0;
+    }
+
+    lexerCleanUp(&lexer);
+    tokenBufferCleanup(&tokens);
+    return status;
+}
+
+static void *libTestWorkerRun(void *argument) {
+    LibTestWorker *worker = argument;
+    LibTest *test = worker->test;
+
+    for (int round = 0; round < LIBTEST_ROUNDS; round++) {
+        for (int i = 0; i < test->file_count; i++) {
+            // threads start on different files and engines
+            const LibTestFile *file =
+                &test->files[(i + worker->index) % test->file_count];
+            LexerEngine engine = (round + worker->index) % 2
+                                     ? LEXER_ENGINE_DFA
+                                     : LEXER_ENGINE_SWITCH;
+            unsigned int lex_threads = round % 2 ? 2 : 1;
+
+            char *text = NULL;
+            size_t length = 0;
+            int status = libTestLex(file, engine, lex_threads) ||
+                         libTestCompile(file->name, &text, &length) !=
+                             file->out_status ||
+                         length != file->out_length ||
+                         memcmp(text, file->out_text, length) != 0;
+            free(text);
+
+            if (status) {
+                printf("ERROR: %s differs on thread %d in round %d\n",
+                       file->name, worker->index, round);
+                atomic_fetch_add(&test->failures, 1);
+            }
+        }
+    }
+    return NULL;
+}
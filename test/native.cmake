@@ -0,0 +1,40 @@
+# `native.cmake` - build a native executable with -o and compare it to --run
+#
+# cmake -DRENAISSCRIPT=<binary> -DSOURCE=<file> -DOUTPUT=<executable>
+#       [-DINPUT=<file>] [-DOPTIONS=<opt|opt>] -P native.cmake
+#
+# The executable must print what the interpreter prints and fail with it.
+
+string(REPLACE "|" ";" options "${OPTIONS}")
+execute_process(
+  COMMAND ${RENAISSCRIPT} ${options} -o ${OUTPUT} ${SOURCE}
+  OUTPUT_VARIABLE build_output
+  RESULT_VARIABLE build_result)
+if(NOT build_result EQUAL 0)
+  message(FATAL_ERROR "building ${OUTPUT} failed: ${build_output}")
+endif()
+
+set(input_args)
+if(INPUT)
+  set(input_args INPUT_FILE ${INPUT})
+endif()
+execute_process(
+  COMMAND ${OUTPUT} ${input_args}
+  OUTPUT_VARIABLE native_output
+  RESULT_VARIABLE native_result)
+execute_process(
+  COMMAND ${RENAISSCRIPT} ${options} --run ${SOURCE} ${input_args}
+  OUTPUT_VARIABLE run_output
+  RESULT_VARIABLE run_result)
+
+# --run fails with 1 on any nonzero exit value
+if(NOT native_result EQUAL 0)
+  set(native_result 1)
+endif()
+if(NOT native_result EQUAL run_result)
+  message(FATAL_ERROR "exit codes differ: ${native_result} != ${run_result}")
+endif()
+if(NOT native_output STREQUAL run_output)
+  file(WRITE "${OUTPUT}.txt" "${native_output}")
+  message(FATAL_ERROR "outputs differ, see ${OUTPUT}.txt")
+endif()
@@ -0,0 +1,186 @@
+// 'parsetest.c' - parser must build a well formed tree from any token stream
+//
+// Parses the files given as arguments, random soups of grammar fragments and
+// deeply nested inputs, and checks every tree: at most one node per token
+// plus the root, every main token owned by one node, children added before
+// their parents, lists and pairs inside the extra array. Syntax errors are
+// expected from the soups, crashes and malformed trees are not.
+
+#include "parser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PARSETEST_ROUNDS 2000
+#define PARSETEST_MAX_PIECES 200
+#define PARSETEST_NESTING 100000
+
+static const char *const parsetest_pieces[] = {
+    "define", "maketh",  "count",   "glyph",     "nought", "x",
+    "y",      "f",       "(",       ")",         "{",      "}",
+    "[",      "]",       ";",       ",",         ":",      "=",
+    "+=",     "+",       "-",       "*",         "**",     "//",
+    "!",      "++",      "&&",      "==",        "<",      "if",
+    "else",   "rehearse", "switch", "case",      "cease",  "persist",
+    "thither", "returneth", "sayeth", "heareth", "yay",    "1",
+    "2.5",    "'a'",     "\"s\"",   "@",         "''",
+};
+
+#define PARSETEST_PIECE_COUNT                                                  \
+    (int)(sizeof(parsetest_pieces) / sizeof(parsetest_pieces[0]))
+
+static int parseChecked(const char *name, const char *contents,
+                        unsigned long length, int *status);
+static int checkTree(const Ast *ast, const TokenBuffer *tokens);
+static int checkChild(uint32_t parent, uint32_t child);
+static int checkRange(const Ast *ast, uint32_t parent, uint32_t start,
+                      uint32_t end);
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    int status;
+    srand(1);
+
+    for (int i = 1; i < argc && !failed; i++) {
+        FILE *file_ptr = fopen(argv[i], "rb");
+        if (file_ptr == NULL) {
+            printf("ERROR: cannot open '%s'\n", argv[i]);
+            return 1;
+        }
+        char *contents = calloc(1 << 20, 1);
+        unsigned long length =
+            fread(contents, 1, (1 << 20) - LEXER_PADDING, file_ptr);
+        fclose(file_ptr);
+
+        failed = parseChecked(argv[i], contents, length, &status);
+        free(contents);
+    }
+
+    char *contents = malloc(PARSETEST_MAX_PIECES * 12 + 1);
+    for (int round = 0; round < PARSETEST_ROUNDS && !failed; round++) {
+        unsigned long length = 0;
+        int pieces = rand() % PARSETEST_MAX_PIECES;
+        for (int i = 0; i < pieces; i++) {
+            const char *text =
+                parsetest_pieces[rand() % PARSETEST_PIECE_COUNT];
+            unsigned long piece_length = strlen(text);
+            memcpy(contents + length, text, piece_length);
+            length += piece_length;
+            contents[length++] = rand() % 8 ? ' ' : '\n';
+        }
+        failed = parseChecked("<random>", contents, length, &status);
+    }
+    free(contents);
+
+    // nesting past the limit fails without exhausting the stack
+    static const char *const nested[] = {"(", "{", "-", "2 ** ", "x: "};
+    contents = malloc(PARSETEST_NESTING * 5 + 1);
+    for (int i = 0; i < 5 && !failed; i++) {
+        unsigned long piece_length = strlen(nested[i]);
+        for (unsigned long j = 0; j < PARSETEST_NESTING; j++) {
+            memcpy(contents + j * piece_length, nested[i], piece_length);
+        }
+        failed = parseChecked("<nested>", contents,
+                              PARSETEST_NESTING * piece_length, &status) ||
+                 status == 0;
+    }
+    free(contents);
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+// parse contents with syntax errors discarded, 1 when the tree is malformed
+static int parseChecked(const char *name, const char *contents,
+                        unsigned long length, int *status) {
+    FILE *devnull = fopen("/dev/null", "w");
+    TokenBuffer tokens = {0};
+    Lexer *lexer = initLexer(contents, length);
+    int failed = devnull == NULL || lexerTokenizeAll(lexer, &tokens, stdout);
+
+    Ast ast;
+    if (!failed) {
+        *status = parseTokens(lexer, &tokens, name, devnull, &ast);
+        failed = checkTree(&ast, &tokens);
+        astCleanup(&ast);
+    }
+    if (failed) {
+        printf("ERROR: malformed tree of '%s'\n", name);
+    }
+
+    lexerCleanUp(&lexer);
+    tokenBufferCleanup(&tokens);
+    if (devnull != NULL) {
+        fclose(devnull);
+    }
+    return failed;
+}
+
+static int checkTree(const Ast *ast, const TokenBuffer *tokens) {
+    if (ast->node_count == 0 || ast->node_count > tokens->count + 1 ||
+        ast->extra_count > ast->extra_capacity || ast->kinds[0] != AST_ROOT) {
+        return 1;
+    }
+
+    char *owned = calloc(tokens->count, 1);
+    int failed = checkRange(ast, ast->node_count, ast->lhs[0], ast->rhs[0]);
+    for (uint32_t node = 1; node < ast->node_count && !failed; node++) {
+        uint32_t token = ast->main_tokens[node];
+        uint32_t lhs = ast->lhs[node];
+        uint32_t rhs = ast->rhs[node];
+        failed = token >= tokens->count || owned[token]++;
+
+        switch (ast->kinds[node]) {
+        case AST_BLOCK:
+            failed |= checkRange(ast, node, lhs, rhs);
+            break;
+        case AST_FUNCTION:
+            failed |= lhs + 2 > ast->extra_count ||
+                      checkRange(ast, node, ast->extra[lhs],
+                                 ast->extra[lhs + 1]) ||
+                      checkChild(node, rhs) || rhs == 0;
+            break;
+        case AST_IF:
+            failed |= checkChild(node, lhs) ||
+                      rhs + 2 > ast->extra_count ||
+                      checkChild(node, ast->extra[rhs]) ||
+                      checkChild(node, ast->extra[rhs + 1]);
+            break;
+        case AST_SWITCH:
+        case AST_CASE:
+        case AST_CALL:
+            failed |= checkChild(node, lhs) ||
+                      rhs + 2 > ast->extra_count ||
+                      checkRange(ast, node, ast->extra[rhs],
+                                 ast->extra[rhs + 1]);
+            break;
+        default:
+            failed |= ast->kinds[node] >= AST_KIND_COUNT ||
+                      checkChild(node, lhs) ||
+                      checkChild(node, rhs);
+            break;
+        }
+    }
+
+    free(owned);
+    return failed;
+}
+
+// children are added before their parent, 0 is no child
+static int checkChild(uint32_t parent, uint32_t child) {
+    return child >= parent;
+}
+
+static int checkRange(const Ast *ast, uint32_t parent, uint32_t start,
+                      uint32_t end) {
+    if (start > end || end > ast->extra_count) {
+        return 1;
+    }
+    for (uint32_t i = start; i < end; i++) {
+        if (ast->extra[i] == 0 || checkChild(parent, ast->extra[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
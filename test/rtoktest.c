@@ -0,0 +1,160 @@
+// 'rtoktest.c' - token files must read back the tokens the lexer gave
+//
+// Lexes the files given as arguments, writes each to a token file with its
+// source and checks every record against the token buffer: type names,
+// slices, positions from lexerGetPosition and the embedded source. A copy
+// with a record slicing past the source must fail to open. With
+// --read <source> <rtok> an existing token file is checked instead.
+
+#include "lexer.h"
+#include "rtok.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RTOKTEST_FILE "rtoktest.rtok"
+
+static int checkTokenFile(const char *name, const char *rtok_name,
+                          int write_file);
+static int compareRecords(Lexer *lexer, const TokenBuffer *tokens,
+                          const RtokFile *file);
+static int checkCorruptRecord(const char *rtok_name);
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+
+    if (argc == 4 && strcmp(argv[1], "--read") == 0) {
+        failed = checkTokenFile(argv[2], argv[3], 0);
+    } else {
+        for (int i = 1; i < argc && !failed; i++) {
+            failed = checkTokenFile(argv[i], RTOKTEST_FILE, 1) ||
+                     checkCorruptRecord(RTOKTEST_FILE);
+        }
+        remove(RTOKTEST_FILE);
+    }
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static int checkTokenFile(const char *name, const char *rtok_name,
+                          int write_file) {
+    FILE *file_ptr = fopen(name, "rb");
+    if (file_ptr == NULL) {
+        printf("ERROR: cannot open '%s'\n", name);
+        return 1;
+    }
+    char *contents = calloc(1 << 20, 1);
+    unsigned long length =
+        fread(contents, 1, (1 << 20) - LEXER_PADDING, file_ptr);
+    fclose(file_ptr);
+
+    TokenBuffer tokens = {0};
+    Lexer *lexer = initLexer(contents, length);
+    int status = lexerTokenizeAll(lexer, &tokens, stdout);
+
+    if (!status && write_file) {
+        file_ptr = fopen(rtok_name, "wb");
+        status = file_ptr == NULL ||
+                 rtokWrite(file_ptr, lexer, &tokens, 1, stdout);
+        if (file_ptr != NULL && fclose(file_ptr) != 0) {
+            status = 1;
+        }
+    }
+
+    RtokFile file;
+    if (!status && !rtokOpen(rtok_name, &file, stdout)) {
+        status = compareRecords(lexer, &tokens, &file);
+        rtokClose(&file);
+    } else {
+        status = 1;
+    }
+    if (status) {
+        printf("ERROR: %s token file differs\n", name);
+    }
+
+    lexerCleanUp(&lexer);
+    tokenBufferCleanup(&tokens);
+    free(contents);
+    return status;
+}
+
+static int compareRecords(Lexer *lexer, const TokenBuffer *tokens,
+                          const RtokFile *file) {
+    if (file->header->type_count != TK_TYPE_COUNT ||
+        file->header->source_length != lexer->content_length) {
+        return 1;
+    }
+    for (int i = 0; i < TK_TYPE_COUNT; i++) {
+        if (strcmp(rtokTypeName(file, i), tk_map[i]) != 0) {
+            return 1;
+        }
+    }
+
+    // TK_EOF is not stored
+    if (file->token_count + 1 != tokens->count) {
+        return 1;
+    }
+    for (unsigned long i = 0; i < file->token_count; i++) {
+        const RtokRecord *record = &file->records[i];
+        unsigned long line;
+        unsigned long column;
+        if (lexerGetPosition(lexer, tokens->begins[i], &line, &column,
+                             stdout) ||
+            record->type != tokens->types[i] ||
+            record->offset != tokens->starts[i] ||
+            record->length != tokens->lengths[i] || record->line != line ||
+            record->column != column) {
+            return 1;
+        }
+    }
+
+    return file->source == NULL ||
+           memcmp(file->source, lexer->contents, lexer->content_length) != 0;
+}
+
+// point the last record past the source, rtokOpen must reject the file
+static int checkCorruptRecord(const char *rtok_name) {
+    FILE *file_ptr = fopen(rtok_name, "rb");
+    if (file_ptr == NULL) {
+        printf("ERROR: cannot open '%s'\n", rtok_name);
+        return 1;
+    }
+    char *data = malloc(1 << 24);
+    unsigned long length = fread(data, 1, 1 << 24, file_ptr);
+    fclose(file_ptr);
+
+    RtokHeader header;
+    memcpy(&header, data, sizeof(RtokHeader));
+    if (header.token_count == 0) {
+        free(data);
+        return 0;
+    }
+    RtokRecord record;
+    char *last = data + header.records_offset +
+                 (header.token_count - 1) * sizeof(RtokRecord);
+    memcpy(&record, last, sizeof(RtokRecord));
+    record.offset = (uint32_t)header.source_length;
+    record.length = 1;
+    memcpy(last, &record, sizeof(RtokRecord));
+
+    file_ptr = fopen(rtok_name, "wb");
+    int status =
+        file_ptr == NULL || fwrite(data, 1, length, file_ptr) != length;
+    if (file_ptr != NULL && fclose(file_ptr) != 0) {
+        status = 1;
+    }
+    free(data);
+
+    RtokFile file;
+    if (!status && !rtokOpen(rtok_name, &file, stdout)) {
+        rtokClose(&file);
+        status = 1;
+    }
+    if (status) {
+        printf("ERROR: '%s' with a record past the source opened\n",
+               rtok_name);
+    }
+    return status;
+}
@@ -0,0 +1,77 @@
+// 'scantest.c' - vector scan kernels must agree with the scalar kernels
+//
+// Fills buffers with runs of blanks, plain bytes and the bytes the kernels
+// stop at, then compares every kernel result at every start position.
+
+#include "scan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCANTEST_ROUNDS 2000
+#define SCANTEST_MAX_LENGTH 300
+
+static const char scantest_bytes[] = {' ', ' ', ' ', '\t', '\r', '\n', '\n',
+                                      '#', '"', '\\', '\0', 'a', 'b', '0',
+                                      '=', '\'', (char)0x80, (char)0xff};
+
+static void fillBuffer(char *buffer, unsigned long length);
+static int compareKernels(const ScanKernels *expect, const ScanKernels *test,
+                          const char *buffer, unsigned long length);
+
+int main(void) {
+    const ScanKernels *scalar = scanGetKernels(SCAN_SCALAR);
+    char *buffer = malloc(SCANTEST_MAX_LENGTH);
+    int failed = 0;
+
+    srand(1);
+    for (int level = SCAN_SCALAR + 1; level < SCAN_COUNT; level++) {
+        const ScanKernels *kernels = scanGetKernels((ScanLevel)level);
+        if (kernels == NULL) {
+            printf("skip level %d (unsupported)\n", level);
+            continue;
+        }
+
+        for (int round = 0; round < SCANTEST_ROUNDS && !failed; round++) {
+            unsigned long length = (unsigned long)rand() % SCANTEST_MAX_LENGTH;
+            fillBuffer(buffer, length);
+            failed = compareKernels(scalar, kernels, buffer, length);
+        }
+        printf("%s: %s\n", kernels->name, failed ? "FAILED" : "ok");
+    }
+
+    free(buffer);
+    return failed;
+}
+
+// random runs, long enough to cross several vector blocks
+static void fillBuffer(char *buffer, unsigned long length) {
+    unsigned long index = 0;
+    while (index < length) {
+        char byte = scantest_bytes[rand() % sizeof(scantest_bytes)];
+        unsigned long run = (unsigned long)rand() % 48 + 1;
+        while (run-- > 0 && index < length) {
+            buffer[index++] = byte;
+        }
+    }
+}
+
+static int compareKernels(const ScanKernels *expect, const ScanKernels *test,
+                          const char *buffer, unsigned long length) {
+    for (unsigned long pos = 0; pos <= length; pos++) {
+        if (expect->find_newline(buffer, pos, length) !=
+                test->find_newline(buffer, pos, length) ||
+            expect->find_comment_end(buffer, pos, length) !=
+                test->find_comment_end(buffer, pos, length) ||
+            expect->find_string_special(buffer, pos, length) !=
+                test->find_string_special(buffer, pos, length) ||
+            expect->skip_blanks(buffer, pos, length) !=
+                test->skip_blanks(buffer, pos, length)) {
+            printf("ERROR: %s kernel differs at %lu of %lu bytes\n",
+                   test->name, pos, length);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+# `server.cmake` - check --connect prints what compiling directly prints
+#
+# cmake -DRENAISSCRIPT=<binary> -DSOCKET=<path> -P server.cmake
+#
+# Starts a server on SOCKET, then compiles files named relative to the
+# working directory through it, --run reading stdin, comparing output and
+# exit code with direct compiles. The server starts under umask 000 and must
+# still create SOCKET for its user only. A stopped server removes SOCKET.
+
+file(REMOVE ${SOCKET} ${SOCKET}.log)
+execute_process(
+  COMMAND
+    sh -c "umask 000; \"$0\" --server=\"$1\" -j 2 > \"$1.log\" 2>&1 & echo $!"
+    ${RENAISSCRIPT} ${SOCKET}
+  OUTPUT_VARIABLE server
+  OUTPUT_STRIP_TRAILING_WHITESPACE)
+
+macro(stop_server)
+  execute_process(COMMAND kill ${server})
+  foreach(wait RANGE 50)
+    if(NOT EXISTS ${SOCKET})
+      break()
+    endif()
+    execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 0.1)
+  endforeach()
+endmacro()
+
+foreach(wait RANGE 50)
+  file(READ ${SOCKET}.log log)
+  if(log MATCHES "listening")
+    break()
+  endif()
+  execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 0.1)
+endforeach()
+if(NOT log MATCHES "listening")
+  stop_server()
+  message(FATAL_ERROR "server did not start: ${log}")
+endif()
+
+# only the server's user may connect, whatever the umask
+execute_process(
+  COMMAND stat -c %a ${SOCKET}
+  OUTPUT_VARIABLE mode
+  OUTPUT_STRIP_TRAILING_WHITESPACE)
+if(NOT mode STREQUAL "600")
+  stop_server()
+  message(FATAL_ERROR "socket mode ${mode}, expected 600")
+endif()
+
+# a request failing in the library (here opening the --rtok file) must
+# explain itself in the client's output, not on the server's terminal
+foreach(case "-S|--symbols|program.rn" "error.rn"
+             "-O2|--bytecode|-j|2|program.rn|file.rens" "--run|iterator.rn"
+             "--rtok=missing/program.rtok|program.rn")
+  string(REPLACE "|" ";" arguments "${case}")
+  execute_process(
+    COMMAND ${RENAISSCRIPT} ${arguments}
+    INPUT_FILE iterator-input.txt
+    OUTPUT_VARIABLE expected
+    RESULT_VARIABLE expected_result)
+  execute_process(
+    COMMAND ${RENAISSCRIPT} --connect=${SOCKET} ${arguments}
+    INPUT_FILE iterator-input.txt
+    OUTPUT_VARIABLE output
+    RESULT_VARIABLE result)
+
+  if(NOT output STREQUAL expected OR NOT result EQUAL expected_result)
+    stop_server()
+    message(FATAL_ERROR "${case}: output or exit code ${result} differs")
+  endif()
+  if(NOT result EQUAL 0 AND output STREQUAL "")
+    stop_server()
+    message(FATAL_ERROR "${case}: failed with no output")
+  endif()
+endforeach()
+
+stop_server()
+if(EXISTS ${SOCKET})
+  message(FATAL_ERROR "stopped server left ${SOCKET}")
+endif()
@@ -0,0 +1,30 @@
+# `stats.cmake` - check --stats=json against the symbol table of a file
+#
+# cmake -DRENAISSCRIPT=<binary> -DSOURCE=<file> -P stats.cmake
+#
+# The token total must equal the -S row count and bytes_read the file size.
+
+execute_process(
+  COMMAND ${RENAISSCRIPT} --stats=json -S ${SOURCE}
+  OUTPUT_VARIABLE table
+  ERROR_VARIABLE report
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "renaisscript failed: ${result}")
+endif()
+
+string(JSON tokens GET "${report}" tokens total)
+string(JSON bytes_read GET "${report}" bytes_read)
+string(JSON files GET "${report}" files)
+string(JSON lex_seconds GET "${report}" seconds lex)
+
+# every row after the header is one token
+string(REGEX MATCHALL "\n" newlines "${table}")
+list(LENGTH newlines rows)
+math(EXPR rows "${rows} - 1")
+file(SIZE ${SOURCE} size)
+
+if(NOT tokens EQUAL rows OR NOT bytes_read EQUAL size OR NOT files EQUAL 1)
+  message(FATAL_ERROR "stats differ: ${tokens} tokens for ${rows} rows, "
+                      "${bytes_read} bytes read of ${size}, ${files} files")
+endif()
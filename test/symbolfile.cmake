@@ -0,0 +1,25 @@
+# `symbolfile.cmake` - check -s failures reach the exit code and output
+#
+# cmake -DRENAISSCRIPT=<binary> -DDIRECTORY=<scratch> -P symbolfile.cmake
+#
+# A source with more rows than one buffered chunk is written to /dev/full, the
+# failed flush must be printed once with the compile output and fail it.
+
+file(MAKE_DIRECTORY ${DIRECTORY})
+string(REPEAT "number = number + 1;\n" 4096 rows)
+file(WRITE ${DIRECTORY}/rows.rn "${rows}")
+
+execute_process(
+  COMMAND ${RENAISSCRIPT} -s /dev/full ${DIRECTORY}/rows.rn
+  OUTPUT_VARIABLE output
+  RESULT_VARIABLE result)
+if(result EQUAL 0)
+  message(FATAL_ERROR "compile writing -s to /dev/full exited 0")
+endif()
+
+string(REGEX MATCHALL "\\[OUTPUT_WRITE_ERROR\\]" errors "${output}")
+list(LENGTH errors count)
+if(NOT count EQUAL 1)
+  message(FATAL_ERROR "expected one OUTPUT_WRITE_ERROR, got ${count}:\n"
+                      "${output}")
+endif()
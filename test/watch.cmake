@@ -0,0 +1,75 @@
+# `watch.cmake` - check --watch prints what compiling each save prints
+#
+# cmake -DRENAISSCRIPT=<binary> -DDIRECTORY=<dir> -P watch.cmake
+#
+# Watches two copies of program.rn in DIRECTORY, then saves an edit inside
+# the first in place and error.rn over the second by renaming a new file
+# over it. Each save must print what compiling the saved file directly
+# prints, and the -s file must hold the rows of both files.
+
+file(REMOVE_RECURSE ${DIRECTORY})
+file(MAKE_DIRECTORY ${DIRECTORY})
+configure_file(program.rn ${DIRECTORY}/first.rn COPYONLY)
+configure_file(program.rn ${DIRECTORY}/second.rn COPYONLY)
+set(options -S --symbols)
+
+macro(compile variable)
+  execute_process(
+    COMMAND ${RENAISSCRIPT} ${options} ${ARGN}
+    WORKING_DIRECTORY ${DIRECTORY}
+    OUTPUT_VARIABLE ${variable})
+endmacro()
+
+# wait for the log to hold expected, failing on anything else
+macro(expect_log step)
+  foreach(wait RANGE 100)
+    file(READ ${DIRECTORY}/watch.log log)
+    string(LENGTH "${log}" log_length)
+    string(LENGTH "${expected}" expected_length)
+    if(NOT log_length LESS expected_length)
+      break()
+    endif()
+    execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 0.05)
+  endforeach()
+  if(NOT log STREQUAL expected)
+    execute_process(COMMAND kill ${watcher})
+    message(FATAL_ERROR "${step}: watch output differs")
+  endif()
+endmacro()
+
+execute_process(
+  COMMAND sh -c "\"$0\" --watch -s rows.txt \"$@\" > watch.log 2>&1 & echo $!"
+          ${RENAISSCRIPT} ${options} first.rn second.rn
+  WORKING_DIRECTORY ${DIRECTORY}
+  OUTPUT_VARIABLE watcher
+  OUTPUT_STRIP_TRAILING_WHITESPACE)
+
+compile(expected first.rn second.rn)
+expect_log("start")
+
+# an edit in place in the middle of the first file
+file(READ ${DIRECTORY}/first.rn contents)
+string(REPLACE "fibonacci" "fib" contents "${contents}")
+file(WRITE ${DIRECTORY}/first.rn "${contents}")
+compile(saved first.rn)
+string(APPEND expected "${saved}")
+expect_log("edit")
+
+# an editor saving by renaming a new file over the second
+file(READ error.rn contents)
+file(WRITE ${DIRECTORY}/second.new "${contents}")
+file(RENAME ${DIRECTORY}/second.new ${DIRECTORY}/second.rn)
+compile(saved second.rn)
+string(APPEND expected "${saved}")
+expect_log("rename")
+
+execute_process(COMMAND kill ${watcher})
+execute_process(
+  COMMAND ${RENAISSCRIPT} -s expected.txt first.rn second.rn
+  WORKING_DIRECTORY ${DIRECTORY}
+  OUTPUT_QUIET)
+file(READ ${DIRECTORY}/rows.txt rows)
+file(READ ${DIRECTORY}/expected.txt expected_rows)
+if(NOT rows STREQUAL expected_rows)
+  message(FATAL_ERROR "-s file differs")
+endif()
@@ -0,0 +1,151 @@
+// `kwgen.c` - build-time keyword perfect hash generator
+//
+// Reads the KEYWORD entries of `tokens.def` and searches for multipliers that
+// map every reserved word to a distinct slot of a power of two table. Writes
+// the table and the KW_HASH macro used by lexerIdReservedKeyword to the
+// header given as the only argument.
+//
+// Usage: kwgen <output-header>
+
+#include <stdio.h>
+#include <string.h>
+
+#define KW_MAX_TABLE_SIZE 1024
+
+typedef struct KeywordStruct {
+    const char *word;
+    const char *type;
+} Keyword;
+
+static const Keyword keywords[] = {
+#define TOKEN(type)
+#define KEYWORD(type, word) {#word, #type},
+#include "tokens.def"
+#undef KEYWORD
+#undef TOKEN
+};
+
+static const unsigned long keyword_count =
+    sizeof(keywords) / sizeof(keywords[0]);
+
+static unsigned long hashKeyword(const char *word, unsigned long mul_first,
+                                 unsigned long mul_second,
+                                 unsigned long mul_last, unsigned long mask);
+static int findPerfectHash(unsigned long mask, unsigned long *mul_first,
+                           unsigned long *mul_second, unsigned long *mul_last);
+
+int main(const int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: kwgen <output-header>\n");
+        return 1;
+    }
+
+    unsigned long min_length = ~0UL;
+    unsigned long max_length = 0;
+    for (unsigned long i = 0; i < keyword_count; i++) {
+        unsigned long len = strlen(keywords[i].word);
+        min_length = len < min_length ? len : min_length;
+        max_length = len > max_length ? len : max_length;
+    }
+
+    // the hash reads the first two characters of a word
+    if (min_length < 2) {
+        fprintf(stderr, "ERROR: keywords need at least 2 characters "
+                        "[KEYWORD_LENGTH_ERROR]\n");
+        return 1;
+    }
+
+    // grow the table until a collision-free set of multipliers exists
+    unsigned long size = 1;
+    while (size < keyword_count) {
+        size *= 2;
+    }
+    unsigned long mul_first = 0;
+    unsigned long mul_second = 0;
+    unsigned long mul_last = 0;
+    while (findPerfectHash(size - 1, &mul_first, &mul_second, &mul_last)) {
+        size *= 2;
+        if (size > KW_MAX_TABLE_SIZE) {
+            fprintf(stderr, "ERROR: no keyword perfect hash found "
+                            "[KEYWORD_HASH_ERROR]\n");
+            return 1;
+        }
+    }
+
+    FILE *file_ptr = fopen(argv[1], "w");
+    if (file_ptr == NULL) {
+        fprintf(stderr, "error: '%s'\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(file_ptr,
+            "// `kwhash.h` - generated by kwgen from tokens.def, do not edit\n"
+            "\n"
+            "#define KW_MIN_LENGTH %lu\n"
+            "#define KW_MAX_LENGTH %lu\n"
+            "#define KW_HASH(word, len) \\\n"
+            "    (((unsigned char)(word)[0] * %luU + \\\n"
+            "      (unsigned char)(word)[1] * %luU + \\\n"
+            "      (unsigned char)(word)[(len)-1] * %luU + (len)) & %luU)\n"
+            "\n"
+            "static const struct {\n"
+            "    const char *word;\n"
+            "    unsigned long length;\n"
+            "    TokenType type;\n"
+            "} kw_table[%lu] = {\n",
+            min_length, max_length, mul_first, mul_second, mul_last, size - 1,
+            size);
+    for (unsigned long i = 0; i < keyword_count; i++) {
+        unsigned long slot = hashKeyword(keywords[i].word, mul_first,
+                                         mul_second, mul_last, size - 1);
+        fprintf(file_ptr, "    [%lu] = {\"%s\", %lu, %s},\n", slot,
+                keywords[i].word, strlen(keywords[i].word), keywords[i].type);
+    }
+    fprintf(file_ptr, "};\n");
+
+    if (fclose(file_ptr) != 0) {
+        fprintf(stderr, "error: '%s'\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
+
+// same function as the generated KW_HASH macro
+static unsigned long hashKeyword(const char *word, unsigned long mul_first,
+                                 unsigned long mul_second,
+                                 unsigned long mul_last, unsigned long mask) {
+    unsigned long len = strlen(word);
+    return ((unsigned char)word[0] * mul_first +
+            (unsigned char)word[1] * mul_second +
+            (unsigned char)word[len - 1] * mul_last + len) &
+           mask;
+}
+
+// try multipliers until every keyword lands in its own slot
+static int findPerfectHash(unsigned long mask, unsigned long *mul_first,
+                           unsigned long *mul_second, unsigned long *mul_last) {
+    for (unsigned long first = 1; first < 64; first++) {
+        for (unsigned long second = 0; second < 64; second++) {
+            for (unsigned long last = 0; last < 64; last++) {
+                unsigned char used[KW_MAX_TABLE_SIZE] = {0};
+                unsigned long i = 0;
+                for (; i < keyword_count; i++) {
+                    unsigned long slot = hashKeyword(keywords[i].word, first,
+                                                     second, last, mask);
+                    if (used[slot]) {
+                        break;
+                    }
+                    used[slot] = 1;
+                }
+
+                if (i == keyword_count) {
+                    *mul_first = first;
+                    *mul_second = second;
+                    *mul_last = last;
+                    return 0;
+                }
+            }
+        }
+    }
+    return 1;
+}